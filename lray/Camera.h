@@ -11,10 +11,13 @@
 namespace lray
 {
     class Ray;
+    class RayDifferential;
+    class RayStream;
 
     /**
+    @brief Shared among render jobs, references are counted atomically
     */
-    class Camera : public ReferenceCounted<Camera>
+    class Camera : public ReferenceCounted<Camera, ReferenceCountAtomic>
     {
     public:
         static constexpr f32 DefaultAngleInDegree = 60.0f;
@@ -31,6 +34,19 @@ namespace lray
         */
         Ray generateRay(f32 screenX, f32 screenY) const;
 
+        /**
+        @brief Generate a ray with differentials for one pixel steps
+        */
+        Ray generateRay(f32 screenX, f32 screenY, RayDifferential& differential) const;
+
+        /**
+        @brief Generate rays of a tile in row major order, several rays at once with SIMD
+        @param x ... left of the tile in screen
+        @param y ... top of the tile in screen
+        @param jitter ... subpixel offsets in [0 1), two per pixel. NULL for no offsets
+        */
+        void generateRays(RayStream& stream, s32 x, s32 y, s32 width, s32 height, const f32* jitter=NULL) const;
+
         /**
         @param width ... must be 0<width
         @param height ... must be 0<height
@@ -7,6 +7,12 @@
 */
 #include "../lray.h"
 #include "../math/RayTest.h"
+#include "../math/Ray.h"
+#include "../shape/TriangleProxy.h"
+#include "../core/Array.h"
+#include "../core/LinearArena.h"
+#include "../core/Numa.h"
+#include "../core/Allocator.h"
 
 namespace lray
 {
@@ -99,9 +105,33 @@ namespace lray
         BinQBVH();
         ~BinQBVH();
 
-        void build(s32 numPrimitives, const PrimitiveType* primitives);
+        /**
+        @brief Temporaries of a build are taken from the scratch arena of the calling thread
+        @param fast ... split at centers of bounds without SAH, which builds faster a tree slower to trace, for previews
+        */
+        void build(s32 numPrimitives, const PrimitiveType* primitives, bool fast=false);
+
+        /**
+        @brief Update bounding boxes keeping the topology, primitives must be the same as the last build
+        */
+        void refit();
+
+        /**
+        @brief Free nodes and primitive indices, the tree is empty until the next build
+        */
+        void release();
+
+        /**
+        @brief Placement of nodes and primitive indices among NUMA nodes, which is applied at every build and refit
+        */
+        void setPlacement(MemoryPlacement placement);
+        MemoryPlacement getPlacement() const{ return placement_;}
+
         HitRecord intersect(Ray& ray);
         s32 getDepth() const{ return depth_;}
+        s32 getNumNodes() const{ return nodes_.size();}
+        const Node& getNode(s32 index) const{ return nodes_[index];}
+        s32 getPrimitiveIndex(s32 index) const{ return primitiveIndices_[index];}
 
         void print(const char* filename);
     private:
@@ -109,12 +139,23 @@ namespace lray
         BinQBVH& operator=(const BinQBVH&) = delete;
 
         static const s32 MaxWorks = MaxDepth<<2;
+        static const u32 ReplicaAlignment = 4096;
+
+        struct Replica
+        {
+            Node* nodes_;
+            s32* primitiveIndices_;
+        };
+
+        void place(bool rebuilt);
+        void releaseReplicas();
 
         inline void getBBox(AABB& bbox, s32 start, s32 end);
 
-        void recursiveConstruct(s32 numPrimitives, const AABB& bbox);
+        void recursiveConstruct(s32 numPrimitives, const AABB& bbox, bool fast);
         void split(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, f32 invArea, s32 start, s32 numPrimitives, const AABB& bbox);
         void splitMid(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, s32 start, s32 numPrimitives, const AABB& bbox);
+        void splitCenter(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, s32 start, s32 numPrimitives, const AABB& bbox);
         void splitBinned(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, f32 area, s32 start, s32 numPrimitives, const AABB& bbox);
 
         f32 SAH_KI_;
@@ -122,10 +163,13 @@ namespace lray
         const PrimitiveType* primitives_;
 
         s32 depth_;
-        Array<Node> nodes_;
+        Array<Node, ArrayGeometricCapacityIncrement<> > nodes_;
         Array<s32> primitiveIndices_;
-        Array<f32> primitiveCentroids_;
-        Array<AABB> primitiveBBoxes_;
+        f32* primitiveCentroids_;
+        AABB* primitiveBBoxes_;
+        MemoryPlacement placement_;
+        s32 numReplicas_;
+        Replica* replicas_; ///< per NUMA node, the first is of the originals
         Work works_[MaxWorks];
     };
 
@@ -160,16 +204,22 @@ namespace lray
         ,SAH_KT_(1.0f)
         ,primitives_(NULL)
         ,depth_(0)
+        ,primitiveCentroids_(NULL)
+        ,primitiveBBoxes_(NULL)
+        ,placement_(MemoryPlacement_Default)
+        ,numReplicas_(0)
+        ,replicas_(NULL)
     {
     }
 
     template<class PrimitiveType, class PrimitivePolicy>
     BinQBVH<PrimitiveType, PrimitivePolicy>::~BinQBVH()
     {
+        releaseReplicas();
     }
 
     template<class PrimitiveType, class PrimitivePolicy>
-    void BinQBVH<PrimitiveType, PrimitivePolicy>::build(s32 numPrimitives, const PrimitiveType* primitives)
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::build(s32 numPrimitives, const PrimitiveType* primitives, bool fast)
     {
         f32 depth = 0<numPrimitives
             ? logf(static_cast<f32>(numPrimitives) / MinLeafPrimitives) / logf(4.0f)
@@ -180,11 +230,14 @@ namespace lray
 
         primitives_ = primitives;
         primitiveIndices_.resize(numPrimitives);
-        primitiveCentroids_.resize(numPrimitives*3);
-        primitiveBBoxes_.resize(numPrimitives);
+
+        LinearArena& scratch = getThreadScratch();
+        LinearArenaScope scope(scratch);
+        primitiveCentroids_ = scratch.allocate<f32>(numPrimitives*3);
+        primitiveBBoxes_ = scratch.allocate<AABB>(numPrimitives);
 
         //eprimitivecentroid, bboxOvZ
-        f32* centroidX = &primitiveCentroids_[0];
+        f32* centroidX = primitiveCentroids_;
         f32* centroidY = centroidX + numPrimitives;
         f32* centroidZ = centroidY + numPrimitives;
 
@@ -203,10 +256,130 @@ namespace lray
         }
 
         depth_ = 1;
-        recursiveConstruct(numPrimitives, bbox);
+        recursiveConstruct(numPrimitives, bbox, fast);
+
+        primitiveCentroids_ = NULL;
+        primitiveBBoxes_ = NULL;
+        place(true);
+    }
+
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::refit()
+    {
+        if(nodes_.size()<=0 || NULL == primitives_){
+            return;
+        }
+
+        //Children are always placed after their parent, so visit nodes backward
+        LinearArena& scratch = getThreadScratch();
+        LinearArenaScope scope(scratch);
+        AABB* nodeBBoxes = scratch.allocate<AABB>(nodes_.size());
+        for(s32 i=nodes_.size()-1; 0<=i; --i){
+            Node& node = nodes_[i];
+            AABB& bbox = nodeBBoxes[i];
+            bbox.setInvalid();
+            if(node.isLeaf()){
+                s32 start = node.getPrimitiveIndex();
+                s32 end = start + node.getNumPrimitives();
+                for(s32 j=start; j<end; ++j){
+                    bbox.extend(primitives_[primitiveIndices_[j]].getBBox());
+                }
+                continue;
+            }
+            s32 child = node.joint_.children_;
+            u8 axis[3] = {node.joint_.axis0_, node.joint_.axis1_, node.joint_.axis2_};
+            node.setJoint(child, &nodeBBoxes[child], axis);
+            for(s32 j=0; j<4; ++j){
+                bbox.extend(nodeBBoxes[child+j]);
+            }
+        }
+        place(false);
+    }
+
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::release()
+    {
+        releaseReplicas();
+        Array<Node, ArrayGeometricCapacityIncrement<> > nodes;
+        nodes_.swap(nodes);
+        Array<s32> primitiveIndices;
+        primitiveIndices_.swap(primitiveIndices);
+        primitives_ = NULL;
+        depth_ = 0;
+    }
+
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::setPlacement(MemoryPlacement placement)
+    {
+        if(placement_ == placement){
+            return;
+        }
+        placement_ = placement;
+        if(0<nodes_.size()){
+            place(true);
+        }
+    }
+
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::place(bool rebuilt)
+    {
+        size_t nodeBytes = sizeof(Node)*nodes_.size();
+        size_t indexBytes = sizeof(s32)*primitiveIndices_.size();
+        switch(placement_)
+        {
+        case MemoryPlacement_Interleave:
+            //Policies stay with the pages, refits need nothing
+            if(rebuilt){
+                releaseReplicas();
+                Numa::interleaveBlock(nodes_.begin(), nodeBytes);
+                Numa::interleaveBlock(primitiveIndices_.begin(), indexBytes);
+            }
+            break;
+        case MemoryPlacement_Replicate:
+        {
+            s32 numNodes = Numa::getNumNodes();
+            if(numNodes<=1){
+                releaseReplicas();
+                break;
+            }
+            if(rebuilt){
+                releaseReplicas();
+                numReplicas_ = numNodes;
+                replicas_ = LNEW Replica[numReplicas_];
+                replicas_[0].nodes_ = nodes_.begin();
+                replicas_[0].primitiveIndices_ = primitiveIndices_.begin();
+                Numa::bindBlock(nodes_.begin(), nodeBytes, 0);
+                Numa::bindBlock(primitiveIndices_.begin(), indexBytes, 0);
+                //Bind before the first touch by copying, pages are faulted on the node
+                for(s32 i=1; i<numReplicas_; ++i){
+                    replicas_[i].nodes_ = reinterpret_cast<Node*>(Allocator::allocateMapped(maximum(nodeBytes, sizeof(Node)), ReplicaAlignment, __FILE__, __LINE__));
+                    replicas_[i].primitiveIndices_ = reinterpret_cast<s32*>(Allocator::allocateMapped(maximum(indexBytes, sizeof(s32)), ReplicaAlignment, __FILE__, __LINE__));
+                    Numa::bindBlock(replicas_[i].nodes_, nodeBytes, i);
+                    Numa::bindBlock(replicas_[i].primitiveIndices_, indexBytes, i);
+                    memcpy(replicas_[i].primitiveIndices_, primitiveIndices_.begin(), indexBytes);
+                }
+            }
+            //Refits change only bounding boxes of nodes
+            for(s32 i=1; i<numReplicas_; ++i){
+                memcpy(replicas_[i].nodes_, nodes_.begin(), nodeBytes);
+            }
+        }
+            break;
+        default:
+            releaseReplicas();
+            break;
+        }
+    }
 
-        primitiveCentroids_.clear();
-        primitiveBBoxes_.clear();
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::releaseReplicas()
+    {
+        for(s32 i=1; i<numReplicas_; ++i){
+            LALIGNED_FREE(replicas_[i].primitiveIndices_, ReplicaAlignment);
+            LALIGNED_FREE(replicas_[i].nodes_, ReplicaAlignment);
+        }
+        LDELETE_ARRAY(replicas_);
+        numReplicas_ = 0;
     }
 
     template<class PrimitiveType, class PrimitivePolicy>
@@ -219,7 +392,7 @@ namespace lray
     }
 
     template<class PrimitiveType, class PrimitivePolicy>
-    void BinQBVH<PrimitiveType, PrimitivePolicy>::recursiveConstruct(s32 numPrimitives, const AABB& bbox)
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::recursiveConstruct(s32 numPrimitives, const AABB& bbox, bool fast)
     {
         AABB childBBox[4];
         s32 primStart[4];
@@ -239,7 +412,20 @@ namespace lray
             }
 
             primStart[0] = work.start_;
-            if(MaxBinningDepth<work.depth_){
+            if(fast){
+                //Split top
+                splitCenter(axis[0], num[0], num[2], childBBox[0], childBBox[2], primStart[0], work.numPrimitives_, work.bbox_);
+                primStart[2] = work.start_ + num[0];
+
+                //Split left
+                splitCenter(axis[1], num[0], num[1], childBBox[0], childBBox[1], work.start_, num[0], childBBox[0]);
+                primStart[1] = work.start_ + num[0];
+
+                //Split right
+                splitCenter(axis[2], num[2], num[3], childBBox[2], childBBox[3], primStart[2], num[2], childBBox[2]);
+                primStart[3] = primStart[2] + num[2];
+
+            } else if(MaxBinningDepth<work.depth_){
                 //Split top
                 splitMid(axis[0], num[0], num[2], childBBox[0], childBBox[2], primStart[0], work.numPrimitives_, work.bbox_);
                 primStart[2] = work.start_ + num[0];
@@ -293,10 +479,6 @@ namespace lray
                 primStart[3] = primStart[2] + num[2];
             }
 
-            if(nodes_.capacity()<(nodes_.size()+4)){
-                nodes_.reserve(nodes_.capacity()<<1);
-            }
-
             s32 child = nodes_.size();
             nodes_[work.node_].setJoint(child, childBBox, axis);
             nodes_.resize(nodes_.size()+4);
@@ -318,7 +500,7 @@ namespace lray
 
         //SAH, SĂ̕
         axis = static_cast<u8>(bbox.maxExtentAxis());
-        f32* bestCentroids = &primitiveCentroids_[0] + axis*primitiveIndices_.size();
+        f32* bestCentroids = primitiveCentroids_ + axis*primitiveIndices_.size();
         PrimitivePolicy::insertionsort(numPrimitives, &primitiveIndices_[start], bestCentroids);
 
         AABB bl, br;
@@ -355,13 +537,50 @@ namespace lray
         num_r = numPrimitives - num_l;
         s32 mid=start+num_l;
 
-        f32* centroids = &primitiveCentroids_[0] + axis * primitiveIndices_.size();
-        PrimitivePolicy::sort(numPrimitives, &primitiveIndices_[start], centroids);
+        f32* centroids = primitiveCentroids_ + axis * primitiveIndices_.size();
+        PrimitivePolicy::select(numPrimitives, &primitiveIndices_[start], num_l, centroids);
 
         getBBox(bbox_l, start, mid);
         getBBox(bbox_r, mid, end);
     }
 
+    template<class PrimitiveType, class PrimitivePolicy>
+    void BinQBVH<PrimitiveType, PrimitivePolicy>::splitCenter(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, s32 start, s32 numPrimitives, const AABB& bbox)
+    {
+        //Partition at the center of the longest axis in a pass
+        axis = static_cast<u8>(bbox.maxExtentAxis());
+        f32 separate = 0.5f*(bbox.bmin_[axis] + bbox.bmax_[axis]);
+        f32* centroids = primitiveCentroids_ + axis * primitiveIndices_.size();
+
+        s32 end = start + numPrimitives;
+        s32 left = start;
+        s32 right = end-1;
+        for(;;){
+            while(left<end && centroids[primitiveIndices_[left]]<=separate){
+                ++left;
+            }
+            while(start<=right && separate<centroids[primitiveIndices_[right]]){
+                --right;
+            }
+            if(right<=left){
+                break;
+            }
+            swap(primitiveIndices_[left], primitiveIndices_[right]);
+            ++left;
+            --right;
+        }
+
+        if(left <= start || end<=left){
+            splitMid(axis, num_l, num_r, bbox_l, bbox_r, start, numPrimitives, bbox);
+        } else{
+            getBBox(bbox_l, start, left);
+            getBBox(bbox_r, left, end);
+
+            num_l = left - start;
+            num_r = numPrimitives - num_l;
+        }
+    }
+
     template<class PrimitiveType, class PrimitivePolicy>
     void BinQBVH<PrimitiveType, PrimitivePolicy>::splitBinned(u8& axis, s32& num_l, s32& num_r, AABB& bbox_l, AABB& bbox_r, f32 area, s32 start, s32 numPrimitives, const AABB& bbox)
     {
@@ -374,12 +593,11 @@ namespace lray
         axis = 0;
         s32 end = start + numPrimitives;
 
-        f32* centroids = &primitiveCentroids_[0];
+        f32* centroids = primitiveCentroids_;
         f32* bestCentroids = centroids;
 
         f32 bestCost = std::numeric_limits<f32>::max();
         s32 midBin = NumBins/2;
-        s32 step = static_cast<s32>(::log10f(static_cast<f32>(numPrimitives)));
 
         Vector3 extent =bbox.extent();
         Vector3 unit = extent * (1.0f/NumBins);
@@ -388,12 +606,11 @@ namespace lray
                 _mm_store_ps(reinterpret_cast<f32*>(&minBins[i]), zero);
                 _mm_store_ps(reinterpret_cast<f32*>(&maxBins[i]), zero);
             }
-            PrimitivePolicy::sort(numPrimitives, &primitiveIndices_[start], centroids);
-
+            //All primitives are binned, which needs no order and results the same split for any order
             f32 invUnit = (absolute(unit[curAxis])<Epsilon)? 0.0f : 1.0f/unit[curAxis];
             f32 bmin = bbox.bmin_[curAxis];
 
-            for(s32 i = start; i < end; i+=step){
+            for(s32 i = start; i < end; ++i){
                 s32 index = primitiveIndices_[i];
                 s32 minIndex = minimum(static_cast<s32>(invUnit * (primitiveBBoxes_[index].bmin_[curAxis] - bmin)), NumBins-1);
                 s32 maxIndex = minimum(static_cast<s32>(invUnit * (primitiveBBoxes_[index].bmax_[curAxis] - bmin)), NumBins-1);
@@ -441,7 +658,6 @@ namespace lray
         f32 separate = unit[axis] * (midBin+1) + bbox.bmin_[axis];
         s32 mid = start+(numPrimitives >> 1);
 
-#if 1
         s32 left = start;
         s32 right = end-1;
         for(;;){
@@ -459,15 +675,6 @@ namespace lray
             ++left;
             --right;
         }
-#else
-        PrimitivePolicy::sort(numPrimitives, &primitiveIndices_[start], bestCentroids);
-        for(s32 i=start; i<end; ++i){
-            if(separate < bestCentroids[primitiveIndices_[i]]){
-                mid = i;
-                break;
-            }
-        }
-#endif
 
         if(mid <= start || end<=mid){
             splitMid(axis, num_l, num_r, bbox_l, bbox_r, start, numPrimitives, bbox);
@@ -509,12 +716,21 @@ namespace lray
         hitRecord.t_ = ray.t_;
         hitRecord.primitive_ = NULL;
 
+        //Read the copy on the node of this thread
+        const Node* nodes = nodes_.begin();
+        const s32* primitiveIndices = primitiveIndices_.begin();
+        if(NULL != replicas_){
+            const Replica& replica = replicas_[Numa::getThreadNode()];
+            nodes = replica.nodes_;
+            primitiveIndices = replica.primitiveIndices_;
+        }
+
         s32 stack = 0;
         u32 nodeStack[MaxDepth<<2];
         nodeStack[0] = 0;
         while(0<=stack){
             u32 index = nodeStack[stack];
-            const Node& node = nodes_[index];
+            const Node& node = nodes[index];
             LASSERT(node.leaf_.flags_ == node.joint_.flags_);
             --stack;
             if(node.isLeaf()){
@@ -522,7 +738,7 @@ namespace lray
                 u32 primEnd = primIndex + node.getNumPrimitives();
                 for(u32 i=primIndex; i<primEnd; ++i){
                     f32 t,v,w;
-                    s32 idx = primitiveIndices_[i];
+                    s32 idx = primitiveIndices[i];
                     Result result = primitives_[idx].testRay(t, v, w, ray);
                     if(Result_Fail == result){
                         continue;
@@ -0,0 +1,88 @@
+#ifndef INC_LRAY_ALLOCATOR_H__
+#define INC_LRAY_ALLOCATOR_H__
+/**
+@file Allocator.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+
+namespace lray
+{
+    /**
+    @brief Live and peak bytes allocated at a call site
+    */
+    struct AllocationSite
+    {
+        const Char* file_; ///< NULL if allocated without __FILE__ and __LINE__
+        s32 line_;
+        s64 liveBytes_;
+        s64 peakBytes_;
+        s64 numAllocations_;
+    };
+
+    /**
+    @brief Backend of lmalloc and the global operator new, which is selected at compile time.
+
+    LRAY_ALLOCATOR_ARENA ... thread caching arena of size classes, otherwise the system's malloc
+    LRAY_ALLOCATOR_STATS ... record allocations by call sites, LNEW and LMALLOC pass __FILE__ and __LINE__ also in release
+
+    Allocations over a threshold are mapped directly with transparent huge pages on Linux,
+    which are large node arrays of accelerators and geometries.
+    */
+    class Allocator
+    {
+    public:
+        static const size_t DefaultHugePageThreshold = 2*1024*1024;
+        static const s32 MaxSites = 4096;
+
+        /**
+        @param alignment ... a power of two, at least 16 bytes are aligned
+        @param file ... NULL if unknown
+        */
+        static void* allocate(size_t size, u32 alignment, const Char* file, s32 line);
+        static void deallocate(void* ptr);
+
+        /**
+        @brief Allocate a dedicated mapping of huge pages regardless of the threshold, for buffers placed among NUMA nodes.
+        Falls back to allocate where mappings are not available, freed by deallocate.
+        */
+        static void* allocateMapped(size_t size, u32 alignment, const Char* file, s32 line);
+
+        /**
+        @brief Whether a block is a dedicated mapping, the others share pages with other blocks of the heap
+        @param ptr ... a pointer returned by allocate or allocateMapped
+        */
+        static bool isMapped(const void* ptr);
+
+        /**
+        @brief Allocations of at least threshold bytes are backed by huge pages, 0 to disable
+        */
+        static void setHugePageThreshold(size_t threshold);
+        static size_t getHugePageThreshold();
+
+        /**
+        @brief Map huge pages from the reserved pool (MAP_HUGETLB) first, transparent ones are used if it is short
+        */
+        static void setExplicitHugePages(bool enable);
+        static bool isExplicitHugePages();
+
+        /**
+        @brief Totals of stats, 0 without LRAY_ALLOCATOR_STATS
+        */
+        static s64 getLiveBytes();
+        static s64 getPeakBytes();
+
+        /**
+        @brief Call sites in descending order of peak bytes
+        @return number of sites written
+        */
+        static s32 getAllocationSites(s32 maxSites, AllocationSite* sites);
+
+        /**
+        @brief Print top call sites to stdout
+        */
+        static void printAllocationSites(s32 maxSites);
+    };
+}
+#endif //INC_LRAY_ALLOCATOR_H__
@@ -25,6 +25,25 @@ namespace lray
         }
     };
 
+    /**
+    @brief Double the capacity, push_back and resize are amortized constant time
+    */
+    template<s32 size=16>
+    struct ArrayGeometricCapacityIncrement
+    {
+        static const s32 InitSize = size;
+
+        static s32 getInitCapacity(s32 capacity)
+        {
+            return capacity;
+        }
+
+        static s32 getNewCapacity(s32 capacity)
+        {
+            return (capacity<InitSize)? InitSize : capacity + minimum(capacity, 0x7FFFFFFF-capacity);
+        }
+    };
+
     //-------------------------------------------------------
     //---
     //---
@@ -137,8 +156,10 @@ namespace lray
                 }
 
             } else{
-                //Construct new items by default constructor
-                helper_reserve(size);
+                //Construct new items by default constructor, grow by the policy not to reallocate every call
+                if(capacity_<size){
+                    helper_reserve(maximum(size, capacity_increment_type::getNewCapacity(capacity_)));
+                }
                 for(s32 i = size_; i<size; ++i){
                     LPLACEMENT_NEW(&items_[i]) value_type;
                 }
@@ -248,10 +269,9 @@ namespace lray
             capacity = capacity_increment_type::getInitCapacity(capacity);
             value_type* newItems = reinterpret_cast<value_type*>(LMALLOC(capacity*sizeof(value_type)));
 
-            //Copy, and destruct
-            for(s32 i = 0; i<size_; ++i){
-                LPLACEMENT_NEW(&newItems[i]) value_type(items_[i]);
-                items_[i].~value_type();
+            //Trivially copyable, relocate by bytes
+            if(0<size_){
+                memcpy(newItems, items_, sizeof(value_type)*size_);
             }
 
             LFREE(items_);
@@ -269,8 +289,10 @@ namespace lray
                 }
 
             } else{
-                //Construct new items by default constructor
-                helper_reserve(size);
+                //Construct new items by default constructor, grow by the policy not to reallocate every call
+                if(capacity_<size){
+                    helper_reserve(maximum(size, capacity_increment_type::getNewCapacity(capacity_)));
+                }
                 for(s32 i = size_; i<size; ++i){
                     LPLACEMENT_NEW(&items_[i]) value_type;
                 }
@@ -318,6 +340,12 @@ namespace lray
         Array();
         Array(this_type&& rhs);
         explicit Array(size_type capacity);
+
+        /**
+        @brief Take the buffer of an array of another policy, the reserved capacity is kept
+        */
+        template<class RhsCapacityIncrement>
+        Array(Array<T, RhsCapacityIncrement>&& rhs);
         ~Array();
 
         inline size_type capacity() const;
@@ -349,11 +377,19 @@ namespace lray
 
         this_type& operator=(this_type&& rhs);
 
+        template<class RhsCapacityIncrement>
+        this_type& operator=(Array<T, RhsCapacityIncrement>&& rhs);
+
         s32 find(const T& ptr) const;
         void insertionsort(const T& t, SortCmp cmp);
     private:
+        template<class U, class V> friend class Array;
+
         Array(const this_type&) = delete;
         this_type& operator=(const this_type&) = delete;
+
+        template<class RhsCapacityIncrement>
+        void take(Array<T, RhsCapacityIncrement>& rhs);
     };
 
     template<class T, class CapacityIncrement>
@@ -373,6 +409,13 @@ namespace lray
     {
     }
 
+    template<class T, class CapacityIncrement>
+    template<class RhsCapacityIncrement>
+    Array<T, CapacityIncrement>::Array(Array<T, RhsCapacityIncrement>&& rhs)
+    {
+        take(rhs);
+    }
+
     template<class T, class CapacityIncrement>
     Array<T, CapacityIncrement>::~Array()
     {
@@ -527,6 +570,30 @@ namespace lray
         return *this;
     }
 
+    template<class T, class CapacityIncrement>
+    template<class RhsCapacityIncrement>
+    typename Array<T, CapacityIncrement>::this_type& Array<T, CapacityIncrement>::operator=(Array<T, RhsCapacityIncrement>&& rhs)
+    {
+        this->helper_clear();
+        LFREE(this->items_);
+        this->capacity_ = 0;
+        take(rhs);
+        return *this;
+    }
+
+    template<class T, class CapacityIncrement>
+    template<class RhsCapacityIncrement>
+    void Array<T, CapacityIncrement>::take(Array<T, RhsCapacityIncrement>& rhs)
+    {
+        this->capacity_ = rhs.capacity_;
+        this->size_ = rhs.size_;
+        this->items_ = rhs.items_;
+
+        rhs.capacity_ = 0;
+        rhs.size_ = 0;
+        rhs.items_ = NULL;
+    }
+
     template<class T, class CapacityIncrement>
     s32 Array<T, CapacityIncrement>::find(const T& ptr) const
     {
@@ -5,6 +5,7 @@
 @author t-sakai
 @date 2018/05/24 create
 */
+#include "../math/Vector2.h"
 #include "../math/Vector3.h"
 
 namespace lray
@@ -18,6 +19,9 @@ namespace lray
             ,b0_(0.0f)
             ,b1_(0.0f)
             ,b2_(0.0f)
+            ,uv_(0.0f)
+            ,dUVdx_(0.0f)
+            ,dUVdy_(0.0f)
         {}
 
         Result result_;
@@ -25,6 +29,9 @@ namespace lray
         f32 b0_;
         f32 b1_;
         f32 b2_;
+        Vector2 uv_; ///< texture coordinates, zero if the primitive has none
+        Vector2 dUVdx_; ///< derivatives of texture coordinates, tested with ray differentials
+        Vector2 dUVdy_;
 
         Vector3 point_;
         Vector3 shadingNormal_;
@@ -0,0 +1,290 @@
+#ifndef INC_LRAY_JOBSYSTEM_H__
+#define INC_LRAY_JOBSYSTEM_H__
+/**
+@file JobSystem.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace lray
+{
+    /**
+    @brief Number of hardware threads, at least one
+    */
+    inline s32 getNumHardwareThreads()
+    {
+        s32 numThreads = static_cast<s32>(std::thread::hardware_concurrency());
+        return (numThreads<=0)? 1 : numThreads;
+    }
+
+    class JobSystem;
+
+    /**
+    @brief A unit of work, which is done when its function and all of its children are done
+    */
+    struct LALIGN(64) Job
+    {
+        static const s32 MaxDependents = 4;
+        static const s32 DataSize = 64;
+
+        typedef void(*Function)(Job* job, s32 worker);
+
+        Function function_;
+        Job* parent_;
+        std::atomic<s32> unfinished_; ///< itself and unfinished children
+        std::atomic<s32> pending_; ///< unfinished prerequisites, and one until submitted
+        std::atomic<u32> generation_; ///< incremented whenever the slot is allocated
+        s32 numDependents_;
+        Job* dependents_[MaxDependents];
+        LALIGN16 u8 data_[DataSize];
+    };
+
+    //---------------------------------------------------------
+    //---
+    //--- JobQueue
+    //---
+    //---------------------------------------------------------
+    /**
+    @brief Chase-Lev work stealing deque of a fixed capacity.
+    The owner pushes and pops at the bottom, others steal from the top.
+    */
+    class JobQueue
+    {
+    public:
+        static const s32 Capacity = 4096;
+
+        JobQueue();
+
+        /**
+        @brief Only by the owner
+        @return false if full
+        */
+        bool push(Job* job);
+
+        /**
+        @brief Only by the owner, the last pushed first
+        */
+        Job* pop();
+
+        /**
+        @brief By any thread, the first pushed first
+        */
+        Job* steal();
+
+        bool empty() const;
+    private:
+        JobQueue(const JobQueue&) = delete;
+        JobQueue& operator=(const JobQueue&) = delete;
+
+        static const s64 Mask = Capacity-1;
+
+        LALIGN(64) std::atomic<s64> top_;
+        LALIGN(64) std::atomic<s64> bottom_;
+        LALIGN(64) std::atomic<Job*> jobs_[Capacity];
+    };
+
+    //---------------------------------------------------------
+    //---
+    //--- JobSystem
+    //---
+    //---------------------------------------------------------
+    /**
+    @brief Thread pool of work stealing workers.
+
+    Every worker owns a deque, jobs submitted on a worker go to its deque, and idle workers steal from others.
+    Threads out of the pool submit to a shared queue, and sleep in wait without running jobs.
+    Workers wait by running other jobs, so that jobs can wait for jobs of their own.
+    */
+    class JobSystem
+    {
+    public:
+        /**
+        @brief Jobs per thread in use at a time, done jobs are recycled, which generations tell
+        */
+        static const s32 MaxJobs = JobQueue::Capacity;
+
+        /**
+        @param numWorkers ... the number of hardware threads if not positive
+        @param pinCpus ... restrict each worker to a cpu, on Linux
+        */
+        explicit JobSystem(s32 numWorkers=0, bool pinCpus=false);
+        ~JobSystem();
+
+        /**
+        @brief The shared system for parallelFor, which is made at the first call
+        */
+        static JobSystem& getDefault();
+
+        s32 getNumWorkers() const{ return numWorkers_;}
+
+        /**
+        @return worker index of the calling thread, or -1 if it is out of the pool
+        */
+        s32 getCurrentWorker() const;
+
+        /**
+        @brief Create a job which calls func(worker), it runs after submitted and all its prerequisites have done
+        @param parent ... which is not done until the job is done, it must not be done yet
+        */
+        template<class Func>
+        Job* create(Func func, Job* parent=NULL);
+
+        /**
+        @brief job runs after prerequisite is done, both must not be submitted yet.
+        Dependents over Job::MaxDependents are relayed by extra jobs.
+        */
+        void addDependency(Job* job, Job* prerequisite);
+
+        void submit(Job* job);
+
+        /**
+        @brief Generation of a job, which is taken before the job is submitted.
+        A done slot can be recycled at any time, then the generation differs.
+        */
+        static inline u32 getGeneration(const Job* job);
+
+        bool isFinished(const Job* job) const;
+        bool isFinished(const Job* job, u32 generation) const;
+
+        /**
+        @brief Wait for a job, workers run other jobs in the meantime.
+        Without generation, the job must not be done yet.
+        */
+        void wait(const Job* job);
+        void wait(const Job* job, u32 generation);
+
+        /**
+        @brief Call func(i, worker) for each i in [begin, end) on workers
+
+        Indices are handed out dynamically in chunks of grainSize, so that unbalanced items are spread over workers.
+        worker is in [0 getNumWorkers()), and unique among running jobs, so that it can index per-worker storages.
+        */
+        template<class Func>
+        void parallelFor(s32 begin, s32 end, Func func, s32 grainSize=1);
+
+    private:
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+        @brief Ring of jobs for a thread, the last one is shared by threads out of the pool
+        */
+        struct JobPool
+        {
+            Job* jobs_;
+            u32 next_;
+        };
+
+        template<class Func>
+        static void run(Job* job, s32 worker)
+        {
+            (*reinterpret_cast<Func*>(job->data_))(worker);
+        }
+
+        Job* allocate();
+        void push(Job* job);
+        Job* find(s32 worker);
+        void execute(Job* job, s32 worker);
+        void finish(Job* job);
+        void signal();
+        void proc(s32 worker);
+
+        s32 numWorkers_;
+        bool pinCpus_;
+        std::atomic<bool> quit_;
+        JobQueue* queues_;
+        JobPool* pools_;
+        std::thread* threads_;
+
+        std::mutex sharedMutex_;
+        Job** sharedJobs_; ///< ring of jobs from threads out of the pool
+        u32 sharedTop_;
+        u32 sharedBottom_;
+        std::atomic<s32> numSharedJobs_;
+
+        std::mutex sleepMutex_;
+        std::condition_variable sleepCondition_;
+        std::atomic<u32> epoch_; ///< incremented on every submission
+        std::atomic<s32> numSleeping_;
+
+        std::mutex waitMutex_;
+        std::condition_variable waitCondition_;
+        std::atomic<s32> numWaiting_;
+    };
+
+    inline u32 JobSystem::getGeneration(const Job* job)
+    {
+        return job->generation_.load(std::memory_order_acquire);
+    }
+
+    template<class Func>
+    Job* JobSystem::create(Func func, Job* parent)
+    {
+        static_assert(sizeof(Func)<=Job::DataSize, "Func must fit in a job.");
+        static_assert(std::alignment_of<Func>::value<=16, "Func must be aligned within 16 bytes.");
+        static_assert(std::is_trivially_destructible<Func>::value, "Func must be trivially destructible.");
+
+        Job* job = allocate();
+        job->function_ = run<Func>;
+        job->parent_ = parent;
+        job->unfinished_.store(1, std::memory_order_relaxed);
+        job->pending_.store(1, std::memory_order_relaxed);
+        job->numDependents_ = 0;
+        LPLACEMENT_NEW(job->data_) Func(func);
+        if(NULL != parent){
+            LASSERT(0<parent->unfinished_.load(std::memory_order_relaxed));
+            parent->unfinished_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    template<class Func>
+    void JobSystem::parallelFor(s32 begin, s32 end, Func func, s32 grainSize)
+    {
+        LASSERT(0<grainSize);
+        s32 count = end - begin;
+        if(count<=0){
+            return;
+        }
+        s32 numJobs = minimum(numWorkers_, (count+grainSize-1)/grainSize);
+        //Threads out of the pool have no worker index of their own, a job keeps indices unique
+        s32 current = getCurrentWorker();
+        if(numJobs<=1 && 0<=current){
+            for(s32 i=begin; i<end; ++i){
+                func(i, current);
+            }
+            return;
+        }
+
+        //Jobs share a counter, chunks go to whichever worker is free
+        std::atomic<s32> next(begin);
+        std::atomic<s32>* pnext = &next;
+        Func* pfunc = &func;
+        Job* root = create([](s32){});
+        //The root can be recycled by jobs run while waiting, as soon as it is done
+        u32 generation = getGeneration(root);
+        for(s32 i=0; i<numJobs; ++i){
+            submit(create([pnext, pfunc, end, grainSize](s32 worker)
+            {
+                for(;;){
+                    s32 start = pnext->fetch_add(grainSize, std::memory_order_relaxed);
+                    if(end<=start){
+                        break;
+                    }
+                    s32 last = minimum(start+grainSize, end);
+                    for(s32 j=start; j<last; ++j){
+                        (*pfunc)(j, worker);
+                    }
+                }
+            }, root));
+        }
+        submit(root);
+        wait(root, generation);
+    }
+}
+#endif //INC_LRAY_JOBSYSTEM_H__
@@ -0,0 +1,126 @@
+#ifndef INC_LRAY_LINEARARENA_H__
+#define INC_LRAY_LINEARARENA_H__
+/**
+@file LinearArena.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+
+namespace lray
+{
+    /**
+    @brief Bump allocator for temporaries of a build or a frame.
+    Memory is given back only by rewinding to markers, and blocks are kept for the next use,
+    so that repeated builds don't go to the heap. Not thread safe, an arena is used by one thread.
+    */
+    class LinearArena
+    {
+        struct Block;
+    public:
+        static const size_t DefaultBlockSize = 1024*1024;
+
+        /**
+        @brief Position of an arena to rewind to
+        */
+        struct Marker
+        {
+            Block* block_;
+            size_t offset_;
+        };
+
+        explicit LinearArena(size_t blockSize=DefaultBlockSize);
+        ~LinearArena();
+
+        void* allocate(size_t size, u32 alignment=SSE_ALIGN);
+
+        /**
+        @brief Uninitialized array, T must not need destruction
+        */
+        template<class T>
+        T* allocate(s32 count);
+
+        inline Marker getMarker() const;
+
+        /**
+        @brief Give back memory allocated after the marker
+        */
+        void rewind(const Marker& marker);
+
+        /**
+        @brief Give back all, blocks are merged into one for the next use
+        */
+        void reset();
+
+        size_t getCapacity() const;
+        s32 getNumBlocks() const;
+    private:
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        static const size_t HeaderSize = 64;
+
+        struct Block
+        {
+            Block* next_;
+            size_t capacity_;
+        };
+
+        static Block* createBlock(size_t capacity);
+        static inline u8* getData(Block* block);
+        void release();
+
+        size_t blockSize_;
+        Block* head_;
+        Block* current_;
+        size_t offset_;
+    };
+
+    template<class T>
+    T* LinearArena::allocate(s32 count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value == true, "T must be trivially destructible.");
+        LASSERT(0<=count);
+        return reinterpret_cast<T*>(allocate(sizeof(T)*count, maximum(static_cast<u32>(alignof(T)), SSE_ALIGN)));
+    }
+
+    inline LinearArena::Marker LinearArena::getMarker() const
+    {
+        Marker marker = {current_, offset_};
+        return marker;
+    }
+
+    inline u8* LinearArena::getData(Block* block)
+    {
+        return reinterpret_cast<u8*>(block) + HeaderSize;
+    }
+
+    /**
+    @brief Rewind an arena at the end of a scope
+    */
+    class LinearArenaScope
+    {
+    public:
+        explicit LinearArenaScope(LinearArena& arena)
+            :arena_(arena)
+            ,marker_(arena.getMarker())
+        {}
+
+        ~LinearArenaScope()
+        {
+            arena_.rewind(marker_);
+        }
+    private:
+        LinearArenaScope(const LinearArenaScope&) = delete;
+        LinearArenaScope& operator=(const LinearArenaScope&) = delete;
+
+        LinearArena& arena_;
+        LinearArena::Marker marker_;
+    };
+
+    /**
+    @brief Scratch arena of the calling thread
+    */
+    LinearArena& getThreadScratch();
+}
+#endif //INC_LRAY_LINEARARENA_H__
@@ -0,0 +1,82 @@
+#ifndef INC_LRAY_MAPPEDFILE_H__
+#define INC_LRAY_MAPPEDFILE_H__
+/**
+@file MappedFile.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+
+namespace lray
+{
+    //---------------------------------------------------------
+    //---
+    //--- MappedFile
+    //---
+    //---------------------------------------------------------
+    /**
+    @brief Map a whole file to memory.
+
+    Pages are mapped copy-on-write, so that modifications are visible only in this process and never written back.
+    */
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        MappedFile(MappedFile&& rhs);
+        ~MappedFile();
+
+        bool open(const Char* filepath);
+        void close();
+
+        inline bool valid() const;
+        inline s64 size() const;
+        inline u8* data();
+        inline const u8* data() const;
+
+        /**
+        @brief Hint that a range will be read soon, then the system starts reading ahead asynchronously
+        */
+        void prefetch(s64 offset, s64 size);
+
+        /**
+        @brief Hint that a range will be read sequentially
+        */
+        void sequential(s64 offset, s64 size);
+
+        MappedFile& operator=(MappedFile&& rhs);
+    private:
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+        void* file_;
+        void* mapping_;
+#else
+        s32 file_;
+#endif
+        s64 size_;
+        u8* data_;
+    };
+
+    inline bool MappedFile::valid() const
+    {
+        return NULL != data_;
+    }
+
+    inline s64 MappedFile::size() const
+    {
+        return size_;
+    }
+
+    inline u8* MappedFile::data()
+    {
+        return data_;
+    }
+
+    inline const u8* MappedFile::data() const
+    {
+        return data_;
+    }
+}
+#endif //INC_LRAY_MAPPEDFILE_H__
@@ -0,0 +1,81 @@
+#ifndef INC_LRAY_NUMA_H__
+#define INC_LRAY_NUMA_H__
+/**
+@file Numa.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+
+namespace lray
+{
+    /**
+    @brief Where large read-mostly buffers, such as accelerators and geometries, are placed among NUMA nodes.
+    Only buffers in dedicated mappings, which are over the huge page threshold of Allocator, are moved.
+    */
+    enum MemoryPlacement
+    {
+        MemoryPlacement_Default = 0, ///< first touch
+        MemoryPlacement_Interleave, ///< pages are spread over nodes round robin
+        MemoryPlacement_Replicate, ///< a copy per node, threads read the copy of their node
+        MemoryPlacement_Num,
+    };
+
+    const Char* getMemoryPlacementName(MemoryPlacement placement);
+
+    /**
+    @brief NUMA topology and placement, without libnuma.
+    Single node fallbacks on platforms other than Linux, where placements do nothing.
+    */
+    class Numa
+    {
+    public:
+        static const s32 MaxNodes = 64;
+
+        static s32 getNumNodes();
+
+        /**
+        @brief Node of the calling thread, the pinned node or the node of the current cpu
+        */
+        static s32 getThreadNode();
+
+        /**
+        @brief Restrict the calling thread to cpus of a node
+        */
+        static bool pinThread(s32 node);
+
+        /**
+        @brief Allow the calling thread to run on all cpus again
+        */
+        static void unpinThread();
+
+        /**
+        @brief Pin workers of job systems to nodes, contiguous workers share a node.
+        Workers follow a switch when they take their next jobs.
+        */
+        static void setPinWorkers(bool pin);
+        static bool isPinningWorkers();
+        static void pinWorker(s32 worker, s32 numWorkers);
+
+        /**
+        @brief Spread pages in a range over all nodes, touched pages are moved.
+        Only whole pages in the range are placed.
+        @return false if nothing was placed
+        */
+        static bool interleave(void* ptr, size_t size);
+
+        /**
+        @brief Place pages in a range on a node, touched pages are moved
+        @return false if nothing was placed
+        */
+        static bool bind(void* ptr, size_t size, s32 node);
+
+        /**
+        @brief interleave and bind for blocks of lmalloc.
+        Only dedicated mappings are placed, blocks of the heap share pages and the policies would remain after free.
+        */
+        static bool interleaveBlock(void* block, size_t size);
+        static bool bindBlock(void* block, size_t size, s32 node);
+    };
+}
+#endif //INC_LRAY_NUMA_H__
@@ -0,0 +1,42 @@
+#ifndef INC_LRAY_PARALLEL_H__
+#define INC_LRAY_PARALLEL_H__
+/**
+@file Parallel.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "JobSystem.h"
+
+namespace lray
+{
+    /**
+    @brief Call func(i, worker) for each i in [begin, end) on workers of the default job system
+
+    Indices are handed out dynamically in chunks of grainSize, so that unbalanced items are spread over threads.
+    worker is in [0 getNumHardwareThreads()), and unique among running jobs, so that it can index per-thread storages.
+    Workers are pinned to NUMA nodes if Numa::setPinWorkers is on.
+    Func must be safe to be called concurrently.
+    */
+    template<class Func>
+    void parallelForWorkers(s32 begin, s32 end, Func func, s32 grainSize=1)
+    {
+        JobSystem::getDefault().parallelFor(begin, end, func, grainSize);
+    }
+
+    /**
+    @brief Call func(i) for each i in [begin, end) on workers of the default job system
+
+    Indices are handed out dynamically in chunks of grainSize, so that unbalanced items are spread over threads.
+    Func must be safe to be called concurrently.
+    */
+    template<class Func>
+    void parallelFor(s32 begin, s32 end, Func func, s32 grainSize=1)
+    {
+        parallelForWorkers(begin, end, [&func](s32 index, s32)
+        {
+            func(index);
+        }, grainSize);
+    }
+}
+#endif //INC_LRAY_PARALLEL_H__
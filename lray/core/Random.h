@@ -164,6 +164,11 @@ namespace lray
         */
         f64 drand();
 
+        /**
+        @brief 状態を2^64ステップ進める, 重ならない系列を作る
+        */
+        void jump();
+
         void swap(RandXorshift128Plus& rhs);
     private:
         u64 s0_;
@@ -208,6 +213,11 @@ namespace lray
         */
         f64 drand();
 
+        /**
+        @brief 状態を2^64ステップ進める, 重ならない系列を作る
+        */
+        void jump();
+
         void swap(RandXorshift128Plus32& rhs);
     private:
         u64 s0_;
@@ -216,6 +226,92 @@ namespace lray
         s32 flag_;
     };
 
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x4
+    //---
+    //---------------------------------------------
+    /**
+    @brief SSE2で4系列のxorshift128+を同時に進める, 各レーンは2^64ずつjumpした系列
+    */
+    class RandXorshift128Plus32x4
+    {
+    public:
+        static const s32 NumLanes = 4;
+
+        RandXorshift128Plus32x4();
+        explicit RandXorshift128Plus32x4(u64 seed);
+        ~RandXorshift128Plus32x4();
+
+        /**
+        @brief 擬似乱数生成器初期化
+        @param seed
+        */
+        void srand(u64 seed);
+
+        /**
+        @brief 全レーンを2^64*NumLanesステップ進める, スレッド毎に重ならない系列を作る
+        */
+        void jump();
+
+        /**
+        @brief 各レーン32bitの乱数生成
+        */
+        lm128i rand();
+
+        /**
+        @brief 各レーン0.0 - 0.999999881の乱数生成
+        */
+        lm128 frand2();
+    private:
+        lm128i s0_[2];
+        lm128i s1_[2];
+    };
+
+#if defined(__AVX2__)
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x8
+    //---
+    //---------------------------------------------
+    /**
+    @brief AVX2で8系列のxorshift128+を同時に進める, 各レーンは2^64ずつjumpした系列
+    */
+    class RandXorshift128Plus32x8
+    {
+    public:
+        static const s32 NumLanes = 8;
+
+        RandXorshift128Plus32x8();
+        explicit RandXorshift128Plus32x8(u64 seed);
+        ~RandXorshift128Plus32x8();
+
+        /**
+        @brief 擬似乱数生成器初期化
+        @param seed
+        */
+        void srand(u64 seed);
+
+        /**
+        @brief 全レーンを2^64*NumLanesステップ進める, スレッド毎に重ならない系列を作る
+        */
+        void jump();
+
+        /**
+        @brief 各レーン32bitの乱数生成
+        */
+        __m256i rand();
+
+        /**
+        @brief 各レーン0.0 - 0.999999881の乱数生成
+        */
+        __m256 frand2();
+    private:
+        __m256i s0_[2];
+        __m256i s1_[2];
+    };
+#endif
+
     //---------------------------------------------
     //---
     //--- RandWELL
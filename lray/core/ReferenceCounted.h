@@ -6,41 +6,108 @@
 @date 2017/12/14 create
 */
 #include "IntrusivePtr.h"
+#include <atomic>
 
 namespace lray
 {
+    //---------------------------------------------------------
+    //---
+    //--- ReferenceCountPolicy
+    //---
+    //---------------------------------------------------------
+    /**
+    @brief Plain counter, for objects owned by one thread at a time
+    */
+    struct ReferenceCountNonAtomic
+    {
+        typedef s32 counter_type;
+
+        static inline void increment(counter_type& count)
+        {
+            ++count;
+        }
+
+        /**
+        @return true if the last reference was released
+        */
+        static inline bool decrement(counter_type& count)
+        {
+            return 0 == --count;
+        }
+
+        static inline s32 get(const counter_type& count)
+        {
+            return count;
+        }
+    };
+
+    /**
+    @brief Atomic counter, for objects shared among threads.
+    Increments are relaxed, a new reference is made only from an existing one.
+    The last decrement acquires, writes of other owners happen before the deletion.
+    */
+    struct ReferenceCountAtomic
+    {
+        typedef std::atomic<s32> counter_type;
+
+        static inline void increment(counter_type& count)
+        {
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static inline bool decrement(counter_type& count)
+        {
+            if(1 != count.fetch_sub(1, std::memory_order_release)){
+                return false;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+
+        static inline s32 get(const counter_type& count)
+        {
+            return count.load(std::memory_order_relaxed);
+        }
+    };
+
     //---------------------------------------------------------
     //---
     //--- ReferenceCounted
     //---
     //---------------------------------------------------------
-    template<class Derived> class ReferenceCounted;
-    template<class T>
-    void intrusive_ptr_addref(ReferenceCounted<T>* ptr)
+    template<class Derived, class CountPolicy> class ReferenceCounted;
+    template<class T, class CountPolicy>
+    void intrusive_ptr_addref(ReferenceCounted<T, CountPolicy>* ptr)
     {
-        ++ptr->referenceCount_;
+        CountPolicy::increment(ptr->referenceCount_);
     }
-    template<class T>
-    void intrusive_ptr_release(ReferenceCounted<T>* ptr)
+    template<class T, class CountPolicy>
+    void intrusive_ptr_release(ReferenceCounted<T, CountPolicy>* ptr)
     {
-        if(0==--ptr->referenceCount_){
+        if(CountPolicy::decrement(ptr->referenceCount_)){
             LDELETE_RAW(ptr);
         }
     }
 
-    template<class Derived>
+    template<class Derived, class CountPolicy=ReferenceCountNonAtomic>
     class ReferenceCounted
     {
     public:
-        typedef ReferenceCounted<Derived> this_type;
+        typedef ReferenceCounted<Derived, CountPolicy> this_type;
         typedef IntrusivePtr<Derived> pointer_type;
+        typedef CountPolicy count_policy_type;
+
+        s32 getReferenceCount() const
+        {
+            return CountPolicy::get(referenceCount_);
+        }
 
     protected:
         ReferenceCounted(const this_type&) = delete;
         this_type& operator=(const this_type&) = delete;
 
-        friend void intrusive_ptr_addref<Derived>(ReferenceCounted<Derived>* ptr);
-        friend void intrusive_ptr_release<Derived>(ReferenceCounted<Derived>* ptr);
+        friend void intrusive_ptr_addref<Derived, CountPolicy>(ReferenceCounted<Derived, CountPolicy>* ptr);
+        friend void intrusive_ptr_release<Derived, CountPolicy>(ReferenceCounted<Derived, CountPolicy>* ptr);
 
         ReferenceCounted()
             :referenceCount_(0)
@@ -49,7 +116,7 @@ namespace lray
         virtual ~ReferenceCounted()
         {}
 
-        s32 referenceCount_;
+        typename CountPolicy::counter_type referenceCount_;
     };
 }
 #endif //INC_LRAY_REFERENCECOUNTED_H__
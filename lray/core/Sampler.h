@@ -0,0 +1,110 @@
+#ifndef INC_LRAY_SAMPLER_H_
+#define INC_LRAY_SAMPLER_H_
+/**
+@file Sampler.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+
+namespace lray
+{
+    //---------------------------------------------
+    //---
+    //--- Samplers
+    //---
+    //--- Low discrepancy samplers share an interface,
+    //---   Sampler(s32 x, s32 y, u32 seed) ... decorrelate pixels
+    //---   f32 get1D(u32 index, u32 dimension) const ... [0, 1)
+    //---   void get2D(f32& x, f32& y, u32 index, u32 dimension) const ... dimension and dimension+1
+    //--- A sample is computed from its index without state, so that threads share nothing.
+    //--- Sobol and Halton pad dimensions over MaxDimensions with independently scrambled lower ones.
+    //---
+    //---------------------------------------------
+
+    /**
+    @brief Reverse the order of bits
+    */
+    u32 reverseBits(u32 x);
+
+    /**
+    @brief Owen scrambling of the bits from the most significant, Laine and Karras' hash with Burley's constants
+    */
+    u32 nestedUniformScramble(u32 x, u32 seed);
+
+    //---------------------------------------------
+    //---
+    //--- SobolSampler
+    //---
+    //---------------------------------------------
+    /**
+    @brief Owen scrambled Sobol sequence with Joe and Kuo's direction numbers,
+    whose orders of samples are also scrambled per pixel (Burley, "Practical Hash-based Owen Scrambling")
+    */
+    class SobolSampler
+    {
+    public:
+        static const u32 MaxDimensions = 16;
+
+        explicit SobolSampler(s32 x=0, s32 y=0, u32 seed=0);
+
+        f32 get1D(u32 index, u32 dimension) const;
+        void get2D(f32& x, f32& y, u32 index, u32 dimension) const;
+
+        /**
+        @brief Unscrambled sample in 0.32 fixed point
+        */
+        static u32 sobol(u32 index, u32 dimension);
+    private:
+        u32 seed_;
+    };
+
+    //---------------------------------------------
+    //---
+    //--- HaltonSampler
+    //---
+    //---------------------------------------------
+    /**
+    @brief Halton sequence of prime bases, whose digits are Owen scrambled by hashes of their prefixes
+    */
+    class HaltonSampler
+    {
+    public:
+        static const u32 MaxDimensions = 16;
+
+        explicit HaltonSampler(s32 x=0, s32 y=0, u32 seed=0);
+
+        f32 get1D(u32 index, u32 dimension) const;
+        void get2D(f32& x, f32& y, u32 index, u32 dimension) const;
+
+        /**
+        @brief Unscrambled radical inverse
+        */
+        static f32 halton(u32 index, u32 dimension);
+    private:
+        u32 seed_;
+    };
+
+    //---------------------------------------------
+    //---
+    //--- LatticeSampler
+    //---
+    //---------------------------------------------
+    /**
+    @brief Extensible rank-1 lattice in base 2 of a Korobov generator by the golden ratio,
+    whose 2D projections are close to Fibonacci lattices. Pixels are Cranley-Patterson rotated by
+    the R2 sequence over pixel coordinates, which distributes errors as blue noise on screen.
+    */
+    class LatticeSampler
+    {
+    public:
+        explicit LatticeSampler(s32 x=0, s32 y=0, u32 seed=0);
+
+        f32 get1D(u32 index, u32 dimension) const;
+        void get2D(f32& x, f32& y, u32 index, u32 dimension) const;
+    private:
+        u32 shift_; ///< rotation of the pixel in 0.32 fixed point
+        u32 seed_;
+    };
+}
+#endif //INC_LRAY_SAMPLER_H_
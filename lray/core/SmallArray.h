@@ -0,0 +1,299 @@
+#ifndef INC_LRAY_SMALLARRAY_H_
+#define INC_LRAY_SMALLARRAY_H_
+/**
+@file SmallArray.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "Array.h"
+
+namespace lray
+{
+    /**
+    @brief Array which holds up to N items inline, spills to the heap beyond.
+    For tiny arrays of per-ray or per-node data, T must be trivially copyable.
+    */
+    template<class T, s32 N, class CapacityIncrement=ArrayGeometricCapacityIncrement<> >
+    class SmallArray
+    {
+    public:
+        static_assert(std::is_trivially_copyable<T>::value == true, "T must be trivially copyable.");
+        static_assert(0<N, "N must be positive.");
+
+        typedef SmallArray<T, N, CapacityIncrement> this_type;
+        typedef T value_type;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+        typedef s32 size_type;
+        typedef CapacityIncrement capacity_increment_type;
+
+        static const s32 InlineCapacity = N;
+
+        SmallArray();
+        SmallArray(this_type&& rhs);
+        ~SmallArray();
+
+        inline size_type capacity() const;
+        inline size_type size() const;
+        inline bool isInline() const;
+
+        inline T& operator[](s32 index);
+        inline const T& operator[](s32 index) const;
+
+        inline T& front();
+        inline const T& front() const;
+        inline T& back();
+        inline const T& back() const;
+
+        void push_back(const T& t);
+        void pop_back();
+
+        inline iterator begin();
+        inline const_iterator begin() const;
+
+        inline iterator end();
+        inline const_iterator end() const;
+
+        void clear();
+        void reserve(size_type capacity);
+        void resize(size_type size);
+        void removeAt(s32 index);
+
+        /**
+        @brief Inline items are copied into the reserved storage of this, heap buffers are taken
+        */
+        this_type& operator=(this_type&& rhs);
+    private:
+        SmallArray(const this_type&) = delete;
+        this_type& operator=(const this_type&) = delete;
+
+        inline T* getInlineItems();
+        void release();
+
+        size_type capacity_;
+        size_type size_;
+        T* items_;
+        typename std::aligned_storage<sizeof(T)*N, alignof(T)>::type buffer_;
+    };
+
+    template<class T, s32 N, class CapacityIncrement>
+    SmallArray<T, N, CapacityIncrement>::SmallArray()
+        :capacity_(N)
+        ,size_(0)
+        ,items_(getInlineItems())
+    {
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    SmallArray<T, N, CapacityIncrement>::SmallArray(this_type&& rhs)
+        :capacity_(N)
+        ,size_(0)
+        ,items_(getInlineItems())
+    {
+        *this = move(rhs);
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    SmallArray<T, N, CapacityIncrement>::~SmallArray()
+    {
+        release();
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::size_type
+        SmallArray<T, N, CapacityIncrement>::capacity() const
+    {
+        return capacity_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::size_type
+        SmallArray<T, N, CapacityIncrement>::size() const
+    {
+        return size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline bool SmallArray<T, N, CapacityIncrement>::isInline() const
+    {
+        return items_ == reinterpret_cast<const T*>(&buffer_);
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline T& SmallArray<T, N, CapacityIncrement>::operator[](s32 index)
+    {
+        LASSERT(0<=index && index<size_);
+        return items_[index];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline const T& SmallArray<T, N, CapacityIncrement>::operator[](s32 index) const
+    {
+        LASSERT(0<=index && index<size_);
+        return items_[index];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline T& SmallArray<T, N, CapacityIncrement>::front()
+    {
+        LASSERT(0<size_);
+        return items_[0];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline const T& SmallArray<T, N, CapacityIncrement>::front() const
+    {
+        LASSERT(0<size_);
+        return items_[0];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline T& SmallArray<T, N, CapacityIncrement>::back()
+    {
+        LASSERT(0<size_);
+        return items_[size_-1];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline const T& SmallArray<T, N, CapacityIncrement>::back() const
+    {
+        LASSERT(0<size_);
+        return items_[size_-1];
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::push_back(const T& t)
+    {
+        if(capacity_<=size_){
+            //t may be an item of this
+            T tmp = t;
+            reserve(capacity_increment_type::getNewCapacity(capacity_));
+            items_[size_] = tmp;
+        }else{
+            items_[size_] = t;
+        }
+        ++size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::pop_back()
+    {
+        LASSERT(0<size_);
+        --size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::iterator SmallArray<T, N, CapacityIncrement>::begin()
+    {
+        return items_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::const_iterator SmallArray<T, N, CapacityIncrement>::begin() const
+    {
+        return items_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::iterator SmallArray<T, N, CapacityIncrement>::end()
+    {
+        return items_ + size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline typename SmallArray<T, N, CapacityIncrement>::const_iterator SmallArray<T, N, CapacityIncrement>::end() const
+    {
+        return items_ + size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::clear()
+    {
+        size_ = 0;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::reserve(size_type capacity)
+    {
+        if(capacity<=capacity_){
+            return;
+        }
+        capacity = capacity_increment_type::getInitCapacity(capacity);
+        T* items = reinterpret_cast<T*>(LMALLOC(capacity*sizeof(T)));
+        if(0<size_){
+            memcpy(items, items_, sizeof(T)*size_);
+        }
+        if(!isInline()){
+            LFREE(items_);
+        }
+        items_ = items;
+        capacity_ = capacity;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::resize(size_type size)
+    {
+        LASSERT(0<=size);
+        if(capacity_<size){
+            reserve(maximum(size, capacity_increment_type::getNewCapacity(capacity_)));
+        }
+        for(s32 i=size_; i<size; ++i){
+            LPLACEMENT_NEW(&items_[i]) value_type;
+        }
+        size_ = size;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::removeAt(s32 index)
+    {
+        LASSERT(0<=index && index<size_);
+        for(s32 i=index+1; i<size_; ++i){
+            items_[i-1] = items_[i];
+        }
+        --size_;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    typename SmallArray<T, N, CapacityIncrement>::this_type& SmallArray<T, N, CapacityIncrement>::operator=(this_type&& rhs)
+    {
+        if(this == &rhs){
+            return *this;
+        }
+        if(rhs.isInline()){
+            //Keep the storage of this if it is enough
+            size_ = 0;
+            reserve(rhs.size_);
+            if(0<rhs.size_){
+                memcpy(items_, rhs.items_, sizeof(T)*rhs.size_);
+            }
+            size_ = rhs.size_;
+        }else{
+            release();
+            capacity_ = rhs.capacity_;
+            size_ = rhs.size_;
+            items_ = rhs.items_;
+            rhs.capacity_ = N;
+            rhs.items_ = rhs.getInlineItems();
+        }
+        rhs.size_ = 0;
+        return *this;
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    inline T* SmallArray<T, N, CapacityIncrement>::getInlineItems()
+    {
+        return reinterpret_cast<T*>(&buffer_);
+    }
+
+    template<class T, s32 N, class CapacityIncrement>
+    void SmallArray<T, N, CapacityIncrement>::release()
+    {
+        if(!isInline()){
+            LFREE(items_);
+        }
+        items_ = getInlineItems();
+        capacity_ = N;
+        size_ = 0;
+    }
+}
+#endif //INC_LRAY_SMALLARRAY_H_
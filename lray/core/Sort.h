@@ -6,6 +6,8 @@
 @date 2018/01/22 create
 */
 #include "../lray.h"
+#include "Parallel.h"
+#include "LinearArena.h"
 
 namespace lray
 {
@@ -161,7 +163,7 @@ namespace lray
             if(i1<=i0){
                 break;
             }
-            lcore::swap(v[i0], v[i1]);
+            swap(v[i0], v[i1]);
             ++i0;
             --i1;
         }
@@ -192,19 +194,14 @@ namespace lray
 
     Uはbool operator(const T& a, const T& b) const{ return a<b;}が必要
     */
+    /**
+    @brief Hoare partition around the middle item
+    @param left ... [0 left) are to be sorted
+    @param right ... [right n) are to be sorted, items between are equal to the pivot
+    */
     template<class T, class U>
-    void introsort(s32 n, T* v, s32 depth, U func)
+    void hoarePartition(s32& left, s32& right, s32 n, T* v, U func)
     {
-        static const s32 SwitchN = 47;
-        if(n<SwitchN){
-            insertionsort(n, v, func);
-            return;
-        }
-        if(depth<=0){
-            heapsort(n, v, func);
-            return;
-        }
-
         s32 i0 = 0;
         s32 i1 = n-1;
 
@@ -226,21 +223,38 @@ namespace lray
             ++i0;
             --i1;
         }
+        left = i0;
+        right = i1+1;
+    }
+
+    template<class T, class U>
+    void introsort(s32 n, T* v, s32 depth, U func)
+    {
+        static const s32 SwitchN = 47;
+        if(n<SwitchN){
+            insertionsort(n, v, func);
+            return;
+        }
+        if(depth<=0){
+            heapsort(n, v, func);
+            return;
+        }
+
+        s32 left, right;
+        hoarePartition(left, right, n, v, func);
 
         --depth;
-        if(1<i0){
-            introsort(i0, v, depth, func);
+        if(1<left){
+            introsort(left, v, depth, func);
         }
 
-        ++i1;
-        n = n-i1;
+        n = n-right;
         if(1<n){
-            introsort(n, v+i1, depth, func);
+            introsort(n, v+right, depth, func);
         }
     }
 
-    template<class T, class U>
-    void introsort(s32 n, T* v, U func)
+    inline s32 getIntrosortDepth(s32 n)
     {
         s32 depth = 0;
         s32 t = n;
@@ -248,7 +262,13 @@ namespace lray
             ++depth;
             t >>= 1;
         }
-        introsort(n, v, depth, func);
+        return depth;
+    }
+
+    template<class T, class U>
+    void introsort(s32 n, T* v, U func)
+    {
+        introsort(n, v, getIntrosortDepth(n), func);
     }
 
     template<class T>
@@ -257,6 +277,49 @@ namespace lray
         introsort(n, v, less<T>);
     }
 
+    //------------------------------------------------
+    //---
+    //--- introselect
+    //---
+    //------------------------------------------------
+    /**
+    @brief Place the nth item as sorted, items before are not greater and after are not less, in linear time on average
+    */
+    template<class T, class U>
+    void introselect(s32 n, T* v, s32 nth, U func)
+    {
+        static const s32 SwitchN = 47;
+        LASSERT(0<=nth && nth<n);
+        s32 depth = getIntrosortDepth(n)*2;
+        while(SwitchN<=n){
+            if(depth<=0){
+                heapsort(n, v, func);
+                return;
+            }
+            --depth;
+
+            s32 left, right;
+            hoarePartition(left, right, n, v, func);
+            if(nth<left){
+                n = left;
+            }else if(right<=nth){
+                v += right;
+                nth -= right;
+                n -= right;
+            }else{
+                //Equal to the pivot
+                return;
+            }
+        }
+        insertionsort(n, v, func);
+    }
+
+    template<class T>
+    void introselect(s32 n, T* v, s32 nth)
+    {
+        introselect(n, v, nth, less<T>);
+    }
+
     //------------------------------------------------
     //---
     //--- radixsort
@@ -286,5 +349,119 @@ namespace lray
             dst[indices[bucket]++] = src[i];
         }
     }
+
+    //------------------------------------------------
+    //---
+    //--- parallel sorts
+    //---
+    //------------------------------------------------
+    /**
+    @brief Stable LSD radix sort of key-value pairs on worker threads, 8 bits a pass
+    @param keysTmp ... work space of n keys
+    @param valuesTmp ... work space of n values
+    */
+    template<class T>
+    void parallelRadixsort(s32 n, u32* keys, T* values, u32* keysTmp, T* valuesTmp)
+    {
+        static_assert(std::is_trivially_copyable<T>::value == true, "T must be trivially copyable.");
+        static const s32 Bits = 8;
+        static const s32 NumBuckets = 1<<Bits;
+        static const u32 Mask = NumBuckets-1;
+        static const s32 MinBlockSize = 4096;
+        LASSERT(0<=n);
+        if(n<=1){
+            return;
+        }
+
+        //Blocks are histogrammed and scattered by workers
+        s32 numBlocks = minimum(getNumHardwareThreads()*2, (n+MinBlockSize-1)/MinBlockSize);
+        s32 blockSize = (n+numBlocks-1)/numBlocks;
+        LinearArena& scratch = getThreadScratch();
+        LinearArenaScope scope(scratch);
+        s32* histograms = scratch.allocate<s32>(numBlocks*NumBuckets);
+
+        u32* srcKeys = keys;
+        T* srcValues = values;
+        u32* dstKeys = keysTmp;
+        T* dstValues = valuesTmp;
+        for(s32 shift=0; shift<32; shift+=Bits){
+            parallelFor(0, numBlocks, [=](s32 block)
+            {
+                s32* histogram = histograms + block*NumBuckets;
+                for(s32 i=0; i<NumBuckets; ++i){
+                    histogram[i] = 0;
+                }
+                s32 end = minimum((block+1)*blockSize, n);
+                for(s32 i=block*blockSize; i<end; ++i){
+                    ++histogram[(srcKeys[i]>>shift) & Mask];
+                }
+            });
+
+            //Skip a pass where all keys have the same digit, such as upper bits of Morton codes
+            u32 digit = (srcKeys[0]>>shift) & Mask;
+            s32 count = 0;
+            for(s32 i=0; i<numBlocks; ++i){
+                count += histograms[i*NumBuckets + digit];
+            }
+            if(n == count){
+                continue;
+            }
+
+            //Exclusive prefix sums in the order of digits then blocks, which keeps the sort stable
+            s32 offset = 0;
+            for(s32 i=0; i<NumBuckets; ++i){
+                for(s32 j=0; j<numBlocks; ++j){
+                    s32 c = histograms[j*NumBuckets + i];
+                    histograms[j*NumBuckets + i] = offset;
+                    offset += c;
+                }
+            }
+
+            parallelFor(0, numBlocks, [=](s32 block)
+            {
+                s32* histogram = histograms + block*NumBuckets;
+                s32 end = minimum((block+1)*blockSize, n);
+                for(s32 i=block*blockSize; i<end; ++i){
+                    s32 index = histogram[(srcKeys[i]>>shift) & Mask]++;
+                    dstKeys[index] = srcKeys[i];
+                    dstValues[index] = srcValues[i];
+                }
+            });
+            swap(srcKeys, dstKeys);
+            swap(srcValues, dstValues);
+        }
+        if(srcKeys != keys){
+            memcpy(keys, srcKeys, sizeof(u32)*n);
+            memcpy(values, srcValues, sizeof(T)*n);
+        }
+    }
+
+    /**
+    @brief Stable LSD radix sort on float keys, bits of keys are flipped to be ordered as unsigned integers
+    */
+    template<class T>
+    void parallelRadixsort(s32 n, f32* keys, T* values, f32* keysTmp, T* valuesTmp)
+    {
+        static const s32 BlockSize = 1<<16;
+        u32* bits = reinterpret_cast<u32*>(keys);
+        s32 numBlocks = (n+BlockSize-1)/BlockSize;
+        parallelFor(0, numBlocks, [bits, n](s32 block)
+        {
+            s32 end = minimum((block+1)*BlockSize, n);
+            for(s32 i=block*BlockSize; i<end; ++i){
+                u32 x = bits[i];
+                bits[i] = x ^ ((0U-(x>>31)) | 0x80000000U);
+            }
+        });
+        parallelRadixsort(n, bits, values, reinterpret_cast<u32*>(keysTmp), valuesTmp);
+        parallelFor(0, numBlocks, [bits, n](s32 block)
+        {
+            s32 end = minimum((block+1)*BlockSize, n);
+            for(s32 i=block*BlockSize; i<end; ++i){
+                u32 x = bits[i];
+                bits[i] = x ^ (((x>>31)-1U) | 0x80000000U);
+            }
+        });
+    }
 }
 #endif //INC_LRAY_SORT_H__
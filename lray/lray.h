@@ -133,10 +133,10 @@ void operator delete[](void* ptr, const char* file, int line);
 
 namespace lray
 {
-#ifdef _DEBUG
+#if defined(_DEBUG) || defined(LRAY_ALLOCATOR_STATS)
 #    define LNEW new(__FILE__,__LINE__)
 #    define LNEW_RAW new
-#else //_DEBUG
+#else //defined(_DEBUG) || defined(LRAY_ALLOCATOR_STATS)
 #    define LNEW new
 #    define LNEW_RAW new
 #endif
@@ -168,7 +168,7 @@ namespace lray
 
     //--- Allocation
     //---------------------------------------------------------
-#if defined(_DEBUG)
+#if defined(_DEBUG) || defined(LRAY_ALLOCATOR_STATS)
 
 #define LPLACEMENT_NEW(ptr) new(ptr)
 #define LDELETE(ptr) delete (ptr); (ptr)=NULL
@@ -188,7 +188,7 @@ namespace lray
 #define LALIGNED_FREE(ptr, align) lfree(ptr, align); (ptr)=NULL
 #define LALIGNED_FREE_RAW(ptr, align) lfree(ptr, align)
 
-#else //defined(_DEBUG)
+#else //defined(_DEBUG) || defined(LRAY_ALLOCATOR_STATS)
 
 #define LPLACEMENT_NEW(ptr) new(ptr)
 #define LDELETE(ptr) delete ptr; (ptr)=NULL
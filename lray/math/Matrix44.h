@@ -293,6 +293,73 @@ namespace lray
     void perspectiveFov(Matrix44& proj, Matrix44& invproj, f32 fovy, f32 aspect, f32 znear, f32 zfar);
 
     void ortho(Matrix44& proj, Matrix44& invproj, f32 width, f32 height, f32 znear, f32 zfar);
+
+    //------------------------------------------------------------------------------------------------
+    //--- Batch operations, with AVX if it is enabled
+    /**
+    @brief dst[i] = m0[i] * m1[i], dst can be the same as m0 or m1
+    */
+    void mul(s32 count, Matrix44* dst, const Matrix44* m0, const Matrix44* m1);
+
+    /**
+    @brief Invert count matrices through Matrix44SoA, dst can be the same as src
+    */
+    void invert(s32 count, Matrix44* dst, const Matrix44* src);
+
+    /**
+    @brief dst[i] = mul(m, src[i]), dst can be the same as src
+    */
+    void mul(s32 count, Vector3* dst, const Matrix44& m, const Vector3* src);
+
+    /**
+    @brief dst[i] = mul33(m, src[i]), dst can be the same as src
+    */
+    void mul33(s32 count, Vector3* dst, const Matrix44& m, const Vector3* src);
+
+    //--------------------------------------------
+    //---
+    //--- Matrix44SoA
+    //---
+    //--------------------------------------------
+    /**
+    @brief Width matrices in structure of arrays, the element (r, c) of the i-th matrix is m_[r][c][i].
+    All lanes are processed at once, such as transforms of instances.
+    Instances must be aligned to 32 bytes, which those on stacks or from LALIGNED_MALLOC are.
+    */
+    class LALIGN(32) Matrix44SoA
+    {
+    public:
+        static const s32 Width = 8;
+
+        /**
+        @brief Lanes from count are identities
+        */
+        void set(s32 count, const Matrix44* src);
+        void get(s32 count, Matrix44* dst) const;
+
+        /**
+        @brief this = m0 * m1 lane by lane, this can be the same as m0 or m1
+        */
+        void mul(const Matrix44SoA& m0, const Matrix44SoA& m1);
+
+        /**
+        @brief Inverses by cofactors, singular lanes result in non-finite values as Matrix44::getInvert
+        */
+        void getInvert(Matrix44SoA& dst) const;
+
+        /**
+        @brief Transform a point by the matrix of each lane, divided by w as mul(const Matrix44&, const Vector3&)
+        @param src ... coordinates in structure of arrays, src[0][i] is x of the i-th point
+        */
+        void mulPoint(f32 dst[3][Width], const f32 src[3][Width]) const;
+
+        /**
+        @brief Transform a vector by the upper 3x3 of the matrix of each lane
+        */
+        void mulVector(f32 dst[3][Width], const f32 src[3][Width]) const;
+
+        f32 m_[4][4][Width];
+    };
 }
 
 #endif //INC_LRAY_MATRIX44_H_
@@ -0,0 +1,43 @@
+#ifndef INC_LRAY_RAYDIFFERENTIAL_H_
+#define INC_LRAY_RAYDIFFERENTIAL_H_
+/**
+@file RayDifferential.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lray.h"
+#include "Vector3.h"
+
+namespace lray
+{
+    /**
+    @brief Derivatives of a ray's origin and direction with respect to screen x and y, kept aside of Ray for traversal
+    */
+    class RayDifferential
+    {
+    public:
+        RayDifferential()
+            :dPdx_(0.0f)
+            ,dPdy_(0.0f)
+            ,dDdx_(0.0f)
+            ,dDdy_(0.0f)
+        {}
+
+        /**
+        @brief Transfer origins to a hit point, the directions are left as they are
+        @param t ... distance to the point
+        @param direction ... direction of the ray
+        @param normal ... normal of the surface at the point
+        */
+        void transfer(f32 t, const Vector3& direction, const Vector3& normal);
+
+        Vector3 dPdx_;
+        Vector3 dPdy_;
+        Vector3 dDdx_;
+        Vector3 dDdy_;
+    };
+
+    static_assert(std::is_trivially_copyable<RayDifferential>::value == true, "RayDifferential must be trivially copyable.");
+}
+
+#endif //INC_LRAY_RAYDIFFERENTIAL_H_
@@ -0,0 +1,81 @@
+#ifndef INC_LRAY_RAYSTREAM_H_
+#define INC_LRAY_RAYSTREAM_H_
+/**
+@file RayStream.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lray.h"
+#include "Ray.h"
+
+namespace lray
+{
+    /**
+    @brief Rays in structure of arrays, which are padded and aligned for 8 wide SIMD
+    */
+    class RayStream
+    {
+    public:
+        static const s32 Align = 32;
+        static const s32 LaneWidth = 8;
+
+        RayStream();
+        ~RayStream();
+
+        /**
+        @brief Change the number of rays, contents are not kept
+        */
+        void resize(s32 size);
+
+        inline s32 size() const;
+        inline s32 capacity() const;
+
+        /**
+        @brief Gather a ray for single ray traversal
+        */
+        inline Ray getRay(s32 index) const;
+
+        f32* originX_;
+        f32* originY_;
+        f32* originZ_;
+        f32* directionX_;
+        f32* directionY_;
+        f32* directionZ_;
+        f32* invDirectionX_;
+        f32* invDirectionY_;
+        f32* invDirectionZ_;
+        f32* t_;
+    private:
+        RayStream(const RayStream&) = delete;
+        RayStream& operator=(const RayStream&) = delete;
+
+        static const s32 NumArrays = 10;
+
+        s32 size_;
+        s32 capacity_;
+        f32* buffer_;
+    };
+
+    inline s32 RayStream::size() const
+    {
+        return size_;
+    }
+
+    inline s32 RayStream::capacity() const
+    {
+        return capacity_;
+    }
+
+    inline Ray RayStream::getRay(s32 index) const
+    {
+        LASSERT(0<=index && index<size_);
+        Ray ray;
+        ray.origin_.set(originX_[index], originY_[index], originZ_[index]);
+        ray.direction_.set(directionX_[index], directionY_[index], directionZ_[index]);
+        ray.invDirection_.set(invDirectionX_[index], invDirectionY_[index], invDirectionZ_[index]);
+        ray.t_ = t_[index];
+        return ray;
+    }
+}
+
+#endif //INC_LRAY_RAYSTREAM_H_
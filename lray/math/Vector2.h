@@ -0,0 +1,69 @@
+#ifndef INC_LRAY_VECTOR2_H_
+#define INC_LRAY_VECTOR2_H_
+/**
+@file Vector2.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lray.h"
+
+namespace lray
+{
+    //--------------------------------------------
+    //---
+    //--- Vector2
+    //---
+    //--------------------------------------------
+    class Vector2
+    {
+    public:
+        Vector2(){}
+        explicit inline Vector2(f32 xy);
+        inline Vector2(f32 x, f32 y);
+
+        inline void set(f32 x, f32 y);
+
+        inline f32 operator[](s32 index) const;
+        inline f32& operator[](s32 index);
+
+        f32 x_;
+        f32 y_;
+    };
+
+    static_assert(std::is_trivially_copyable<Vector2>::value == true, "Vector2 must be trivially copyable.");
+
+    inline Vector2::Vector2(f32 xy)
+        :x_(xy)
+        ,y_(xy)
+    {
+    }
+
+    inline Vector2::Vector2(f32 x, f32 y)
+        :x_(x)
+        ,y_(y)
+    {
+    }
+
+    inline void Vector2::set(f32 x, f32 y)
+    {
+        x_ = x; y_ = y;
+    }
+
+    inline f32 Vector2::operator[](s32 index) const
+    {
+        LASSERT(0<=index && index < 2);
+        return (&x_)[index];
+    }
+
+    inline f32& Vector2::operator[](s32 index)
+    {
+        LASSERT(0<=index && index < 2);
+        return (&x_)[index];
+    }
+
+    inline Vector2 weightedAverage(f32 w0, f32 w1, f32 w2, const Vector2& v0, const Vector2& v1, const Vector2& v2)
+    {
+        return Vector2(w0*v0.x_ + w1*v1.x_ + w2*v2.x_, w0*v0.y_ + w1*v1.y_ + w2*v2.y_);
+    }
+}
+#endif //INC_LRAY_VECTOR2_H_
@@ -0,0 +1,173 @@
+#ifndef INC_LRAY_PATHTRACER_H__
+#define INC_LRAY_PATHTRACER_H__
+/**
+@file PathTracer.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../math/Vector3.h"
+#include "../math/RayStream.h"
+
+namespace lray
+{
+    class Camera;
+    class JobSystem;
+    class Scene;
+    class Ray;
+    class RandXorshift128Plus32;
+    class SobolSampler;
+
+    /**
+    @brief Progressive path tracer of diffuse surfaces, which adds one sample per pixel each pass
+    */
+    class PathTracer
+    {
+    public:
+        static const s32 TileSize = 32;
+        static const s32 DefaultMaxDepth = 8;
+        static const s32 DefaultRussianRouletteDepth = 3;
+        static const s32 DefaultMinSamples = 16;
+
+        PathTracer();
+        ~PathTracer();
+
+        /**
+        @brief Allocate the accumulation buffer and storages of threads, nothing is allocated while rendering
+        @param jobSystem ... which renders tiles, the default one if NULL
+        */
+        void initialize(s32 width, s32 height, JobSystem* jobSystem=NULL);
+
+        /**
+        @brief Clear accumulated samples
+        */
+        void reset();
+
+        inline void setMaxDepth(s32 maxDepth);
+        /**
+        @brief Paths longer than this are terminated randomly by their throughput
+        */
+        inline void setRussianRouletteDepth(s32 depth);
+        inline void setAlbedo(const Vector3& albedo);
+        inline void setBackground(const Vector3& radiance);
+        /**
+        @param direction ... toward the light
+        */
+        void setLight(const Vector3& direction, const Vector3& radiance);
+
+        /**
+        @brief Stop sampling tiles whose pixels have converged, so that later passes spend time on noisy tiles only
+        @param threshold ... relative standard error of pixel luminance, 0 to sample every pixel every pass
+        @param minSamples ... samples before testing convergence
+        */
+        void setAdaptive(f32 threshold, s32 minSamples=DefaultMinSamples);
+
+        /**
+        @brief Add one sample per pixel of tiles not converged, tiles are rendered in parallel
+        */
+        void renderPass(Scene& scene, const Camera& camera);
+
+        inline s32 getWidth() const;
+        inline s32 getHeight() const;
+        inline s32 getNumPasses() const;
+        /**
+        @brief Number of tiles which have not converged, rendering can stop at zero
+        */
+        inline s32 getNumActiveTiles() const;
+
+        /**
+        @brief Average of samples of a pixel in linear radiance
+        */
+        Vector3 getPixel(s32 x, s32 y) const;
+
+        /**
+        @brief Average of samples, gamma corrected to RGB8
+        */
+        void resolve(u8* rgb) const;
+    private:
+        PathTracer(const PathTracer&) = delete;
+        PathTracer& operator=(const PathTracer&) = delete;
+
+        /**
+        @brief Storages of a thread, bounded by the tile size
+        */
+        struct ThreadContext
+        {
+            RayStream rays_;
+            f32 jitter_[TileSize*TileSize*2];
+        };
+
+        void release();
+        void renderTile(ThreadContext& context, Scene& scene, const Camera& camera, s32 tile);
+        bool isConverged(s32 tile) const;
+        Vector3 trace(Scene& scene, Ray& ray, const SobolSampler& sampler, u32 sampleIndex, RandXorshift128Plus32& random) const;
+
+        s32 width_;
+        s32 height_;
+        s32 tilesX_;
+        s32 tilesY_;
+        s32 numPasses_;
+        s32 maxDepth_;
+        s32 russianRouletteDepth_;
+        Vector3 albedo_;
+        Vector3 background_;
+        Vector3 lightDirection_;
+        Vector3 lightRadiance_;
+        f32 threshold_;
+        s32 minSamples_;
+
+        f32* accumulation_;
+        f32* luminanceMean_; ///< running mean of luminance, Welford's method
+        f32* luminanceM2_; ///< running sum of squared differences from the mean
+        s32* tileSamples_;
+        s32 numActiveTiles_;
+        s32* activeTiles_;
+        bool* converged_;
+        JobSystem* jobSystem_;
+        s32 numContexts_;
+        ThreadContext* contexts_;
+    };
+
+    inline void PathTracer::setMaxDepth(s32 maxDepth)
+    {
+        LASSERT(0<maxDepth);
+        maxDepth_ = maxDepth;
+    }
+
+    inline void PathTracer::setRussianRouletteDepth(s32 depth)
+    {
+        LASSERT(0<=depth);
+        russianRouletteDepth_ = depth;
+    }
+
+    inline void PathTracer::setAlbedo(const Vector3& albedo)
+    {
+        albedo_ = albedo;
+    }
+
+    inline void PathTracer::setBackground(const Vector3& radiance)
+    {
+        background_ = radiance;
+    }
+
+    inline s32 PathTracer::getWidth() const
+    {
+        return width_;
+    }
+
+    inline s32 PathTracer::getHeight() const
+    {
+        return height_;
+    }
+
+    inline s32 PathTracer::getNumPasses() const
+    {
+        return numPasses_;
+    }
+
+    inline s32 PathTracer::getNumActiveTiles() const
+    {
+        return numActiveTiles_;
+    }
+}
+#endif //INC_LRAY_PATHTRACER_H__
@@ -0,0 +1,183 @@
+#ifndef INC_LRAY_GEOMETRYCACHE_H__
+#define INC_LRAY_GEOMETRYCACHE_H__
+/**
+@file GeometryCache.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../core/Array.h"
+#include "../math/AABB.h"
+#include "../shape/Primitive.h"
+#include "../shape/TriangleProxy.h"
+#include "../accel/BinQBVH.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+namespace lray
+{
+    /**
+    @brief Out-of-core geometry. World space primitives are stored as pages in a converted cache file,
+    which are loaded when rays reach their bounds first, and evicted in LRU order over a budget.
+    Files are read outside the lock, threads acquiring a page being loaded wait for it.
+    */
+    class GeometryCache
+    {
+    public:
+        static const s64 DefaultBudget = 1024LL*1024*1024;
+
+        /**
+        @brief Location and bounds of a page, always resident
+        */
+        struct PageInfo
+        {
+            AABB bbox_;
+            s64 offset_; ///< byte offset in the file
+            s32 numVertices_;
+            s32 numTriangles_;
+            s32 components_;
+            s32 reserved_;
+        };
+
+        /**
+        @brief Resident geometry of a page with its own accelerator
+        */
+        struct Page
+        {
+            Primitive primitive_;
+            Array<TriangleProxy> triangleProxies_;
+            BinQBVH<TriangleProxy> accelerator_;
+        };
+
+        explicit GeometryCache(s64 budget=DefaultBudget);
+        ~GeometryCache();
+
+        /**
+        @brief Open a cache file with its table of pages
+        */
+        bool open(const Char* path, s32 numPages, const PageInfo* pages);
+
+        /**
+        @brief Change the budget in bytes, resident pages over the budget are evicted
+        */
+        void setBudget(s64 budget);
+        inline s64 getBudget() const;
+        inline s64 getResidentBytes() const;
+        inline s64 getNumLoads() const;
+
+        inline s32 getNumPages() const;
+        inline const PageInfo& getPageInfo(s32 page) const;
+
+        /**
+        @brief Pin a page, which is loaded if not resident
+        @return NULL if failed to load
+        */
+        Page* acquire(s32 page);
+
+        /**
+        @brief Unpin a page acquired
+        */
+        void release(s32 page);
+
+        /**
+        @brief Write a primitive as a page
+        @param offset ... current byte position of the file
+        */
+        static bool writePage(PageInfo& info, FILE* file, s64 offset, const Primitive& primitive);
+
+        /**
+        @brief Byte size of a page in a file
+        */
+        static s64 calcFileBytes(const PageInfo& info);
+    private:
+        GeometryCache(const GeometryCache&) = delete;
+        GeometryCache& operator=(const GeometryCache&) = delete;
+
+        struct Entry
+        {
+            std::atomic<Page*> page_;
+            std::atomic<s32> pins_;
+            std::atomic<u64> lastUsed_;
+            bool loading_; ///< guarded by mutex_
+        };
+
+        void clear();
+        bool read(void* dst, s64 bytes, s64 offset);
+        Page* load(s32 page);
+        void evict();
+
+        s64 budget_;
+        s64 residentBytes_;
+        s64 numLoads_;
+        std::atomic<u64> tick_;
+        FILE* file_;
+        s32 numPages_;
+        PageInfo* pages_;
+        Entry* entries_;
+        std::mutex mutex_;
+        std::condition_variable loaded_;
+#ifdef _MSC_VER
+        std::mutex fileMutex_; ///< no positional reads, the file position is shared
+#endif
+    };
+
+    inline s64 GeometryCache::getBudget() const
+    {
+        return budget_;
+    }
+
+    inline s64 GeometryCache::getResidentBytes() const
+    {
+        return residentBytes_;
+    }
+
+    inline s64 GeometryCache::getNumLoads() const
+    {
+        return numLoads_;
+    }
+
+    inline s32 GeometryCache::getNumPages() const
+    {
+        return numPages_;
+    }
+
+    inline const GeometryCache::PageInfo& GeometryCache::getPageInfo(s32 page) const
+    {
+        LASSERT(0<=page && page<numPages_);
+        return pages_[page];
+    }
+
+    /**
+    @brief Proxy of a page for the top level accelerator
+    */
+    struct PageProxy
+    {
+        GeometryCache* cache_;
+        s32 page_;
+
+        Vector3 getCentroid() const;
+
+        AABB getBBox() const;
+
+        /**
+        @brief Test the page, which is loaded on demand. The page of the closest hit stays pinned with the hit for the calling thread.
+        */
+        Result testRay(f32& t, f32& v, f32& w, const Ray& ray) const;
+
+        /**
+        @brief The closest hit in pages of the last traversal on the calling thread
+        @return NULL if no hit
+        */
+        static const HitRecord* getHit();
+
+        /**
+        @brief Unpin the page of the closest hit, call after every traversal
+        */
+        static void releaseHit();
+    };
+
+    static_assert(std::is_trivially_copyable<PageProxy>::value == true, "PageProxy must be trivially copyable.");
+}
+#endif //INC_LRAY_GEOMETRYCACHE_H__
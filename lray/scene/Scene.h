@@ -7,10 +7,19 @@
 */
 #include "../lray.h"
 #include "../core/Array.h"
+#include "../core/MappedFile.h"
+#include "../core/ReferenceCounted.h"
+#include "../math/RayDifferential.h"
 #include "../shape/Node.h"
 #include "../shape/Mesh.h"
+#include "../shape/Skin.h"
 #include "../accel/BinQBVH.h"
 #include "../shape/TriangleProxy.h"
+#include "../texture/Texture.h"
+#include "GeometryCache.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace lray
 {
@@ -21,29 +30,272 @@ namespace lray
     public:
         typedef lray::Array<Mesh> MeshArray;
         typedef lray::Array<Node> NodeArray;
+        typedef lray::Array<Skin> SkinArray;
         typedef lray::Array<TriangleProxy> TriangleProxyArray;
+        typedef lray::Array<u8*> BufferArray;
+        typedef lray::Array<MappedFile> MappedFileArray;
+        typedef lray::Array<Texture> TextureArray;
+        typedef lray::Array<PageProxy> PageProxyArray;
 
         Scene();
         Scene(Scene&& rhs);
         explicit Scene(const Char* name, MeshArray&& meshes, NodeArray&& nodes);
+        /**
+        @param skins ... skins referred by nodes
+        @param buffers ... memory blocks which primitives view in place, the scene takes ownership
+        @param mappedFiles ... mapped files which primitives view in place
+        */
+        Scene(const Char* name, MeshArray&& meshes, NodeArray&& nodes, SkinArray&& skins, BufferArray&& buffers, MappedFileArray&& mappedFiles);
+        ~Scene();
+
+        /**
+        @brief Update nodes, skins and meshes, then refit the accelerator
+        @param rebuild ... rebuild the accelerator instead of refitting, the first update always builds
+        */
+        void updateFrame(bool rebuild=false);
+
+        /**
+        @brief Update like updateFrame, but only a fast accelerator is built for previews.
+        Rays test it until buildAccelerator or updateFrame is done.
+        */
+        void updatePreview();
+
+        /**
+        @brief Build the full quality accelerator for geometries of the last updatePreview, then rays switch to it.
+        Rays can be tested on the preview meanwhile.
+        */
+        void buildAccelerator();
+        inline bool isPreviewing() const;
+
+        /**
+        @brief Free the preview accelerator after buildAccelerator, no rays must be tested meanwhile.
+        updateFrame also frees it.
+        */
+        void releasePreview();
 
-        void updateFrame();
         Result test(Intersection& intersection, Ray& ray);
 
+        /**
+        @brief Test with differentials, which are transferred to the hit point to give derivatives of texture coordinates
+        */
+        Result test(Intersection& intersection, Ray& ray, RayDifferential& differential);
+
+        /**
+        @brief Set textures and the cache which their tiles are read through, the scene takes ownership of the cache
+        */
+        void setTextures(TextureArray&& textures, TileCache* tileCache);
+        inline s32 getNumTextures() const;
+        inline const Texture& getTexture(s32 index) const;
+        inline TileCache* getTileCache();
+
+        /**
+        @brief Make the scene out-of-core, which traces pages of the cache instead of meshes. The scene takes ownership.
+        */
+        void setGeometryCache(GeometryCache* geometryCache);
+        inline GeometryCache* getGeometryCache();
+
+        /**
+        @brief Placement of the accelerators and the refined geometries among NUMA nodes.
+        Geometries are interleaved for MemoryPlacement_Replicate, only accelerators are replicated.
+        */
+        void setPlacement(MemoryPlacement placement);
+        inline MemoryPlacement getPlacement() const;
+
         Scene& operator=(Scene&& rhs);
     private:
         Scene(const Scene&) = delete;
         Scene& operator=(const Scene&) = delete;
 
+        void releaseBuffers();
+        bool refine(bool rebuild);
+        void fillIntersection(Intersection& intersection, const HitRecord& hitRecord, const Ray& ray, RayDifferential* differential) const;
+        Result testPages(Intersection& intersection, Ray& ray, RayDifferential* differential);
+        void placeGeometries();
+
         String name_;
         MeshArray meshes_;
         MeshArray refinedMeshes_;
         NodeArray nodes_;
+        SkinArray skins_;
+        BufferArray buffers_;
+        MappedFileArray mappedFiles_;
+        TextureArray textures_;
+        TileCache* tileCache_;
+        GeometryCache* geometryCache_;
+        MemoryPlacement placement_;
 
         TriangleProxyArray triangleProxies_;
         BinQBVH<TriangleProxy> accelerator_;
+        BinQBVH<TriangleProxy> previewAccelerator_;
+        std::atomic<bool> previewing_; ///< rays test previewAccelerator_
+        PageProxyArray pageProxies_;
+        BinQBVH<PageProxy> pageAccelerator_;
+    };
+
+    inline s32 Scene::getNumTextures() const
+    {
+        return textures_.size();
+    }
+
+    inline const Texture& Scene::getTexture(s32 index) const
+    {
+        return textures_[index];
+    }
+
+    inline TileCache* Scene::getTileCache()
+    {
+        return tileCache_;
+    }
+
+    inline GeometryCache* Scene::getGeometryCache()
+    {
+        return geometryCache_;
+    }
+
+    inline MemoryPlacement Scene::getPlacement() const
+    {
+        return placement_;
+    }
+
+    inline bool Scene::isPreviewing() const
+    {
+        return previewing_.load(std::memory_order_acquire);
+    }
+
+    enum LoadFlag
+    {
+        LoadFlag_None = 0,
+        /// View tightly packed glTF buffers in place instead of copying them
+        LoadFlag_ZeroCopy = (0x01U<<0),
+        /// Merge duplicate vertices of owned primitives, mostly for non-indexed exports
+        LoadFlag_Weld = (0x01U<<1),
+        /// Reorder triangles and vertices of owned primitives for locality
+        LoadFlag_Reorder = (0x01U<<2),
+        /// Convert images and geometry to cache files even if valid ones exist
+        LoadFlag_RebuildCaches = (0x01U<<3),
+        /// Convert meshes to pages of a geometry cache, which are loaded on demand while tracing. Static poses only.
+        LoadFlag_OutOfCore = (0x01U<<4),
+    };
+
+    /**
+    @brief Directory to write cache files of later loads to, NULL or empty for next to scenes
+    */
+    void setCacheDirectory(const Char* directory);
+
+    /**
+    @brief Load a scene from gltf or glb. Binary buffers are mapped to memory.
+    Images are converted to tiled mip chains in "<filepath>.ltc", which is reused by later loads,
+    or kept in memory if the cache cannot be written.
+    With LoadFlag_OutOfCore, meshes are converted to world space pages in "<filepath>.lgc" likewise.
+    Caches are written to the cache directory instead if set, named with a hash of filepath.
+    Caches are rebuilt when sizes or modification times of filepath and external buffers and images it refers,
+    or LoadFlag_Weld and LoadFlag_Reorder for pages, differ.
+    */
+    void load(Scene& scene, const Char* filepath, u32 flags=LoadFlag_None);
+
+    enum LoadStage
+    {
+        LoadStage_Parse = 0, ///< reading glTF
+        LoadStage_Decode, ///< decoding primitives or pages
+        LoadStage_Textures, ///< reading images and tile caches
+        LoadStage_Preview, ///< refining and building the preview accelerator
+        LoadStage_Build, ///< the preview is ready, building the full quality accelerator
+        LoadStage_Done,
+        LoadStage_Failed,
+        LoadStage_Cancelled,
+    };
+
+    class LoadHandle;
+
+    /**
+    @brief Called on a worker when a load enters a stage, stages come in order one at a time
+    */
+    typedef void(*LoadCallback)(LoadHandle& handle, LoadStage stage, void* user);
+
+    /**
+    @brief State of an asynchronous load, which is shared by the caller and jobs of the load.
+    Releasing the last reference cancels the load and waits for it.
+    */
+    class LoadHandle : public ReferenceCounted<LoadHandle, ReferenceCountAtomic>
+    {
+    public:
+        ~LoadHandle();
+
+        inline LoadStage getStage() const;
+
+        /**
+        @brief Progress of the whole load in [0 1]
+        */
+        f32 getProgress() const;
+
+        /**
+        @brief The scene can be rendered, with the preview accelerator until the stage gets LoadStage_Done
+        */
+        inline bool isPreviewReady() const;
+        inline bool isFinished() const;
+
+        /**
+        @brief Stop at the next check, the scene is left untouched if its contents were not set yet, and rays miss it until the preview is ready
+        */
+        void cancel();
+        inline bool isCancelled() const;
+
+        /**
+        @brief Wait until the preview gets ready or the load finishes. Not from jobs of the default job system.
+        @return true if the preview is ready
+        */
+        bool waitPreview();
+
+        /**
+        @brief Wait until the load finishes. Not from jobs of the default job system.
+        */
+        LoadStage wait();
+
+    private:
+        friend class LoadPipeline;
+
+        LoadHandle(Scene& scene, const Char* filepath, u32 flags, LoadCallback callback, void* user);
+
+        Scene& scene_;
+        String filepath_;
+        u32 flags_;
+        LoadCallback callback_;
+        void* user_;
+        bool failed_; ///< only by jobs of the load, which run in order
+
+        std::atomic<s32> stage_;
+        std::atomic<bool> previewReady_;
+        std::atomic<bool> cancelled_;
+        std::atomic<s32> numDecodes_;
+        std::atomic<s32> numDecoded_;
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
     };
 
-    void load(Scene& scene, const Char* filepath);
+    inline LoadStage LoadHandle::getStage() const
+    {
+        return static_cast<LoadStage>(stage_.load(std::memory_order_acquire));
+    }
+
+    inline bool LoadHandle::isPreviewReady() const
+    {
+        return previewReady_.load(std::memory_order_acquire);
+    }
+
+    inline bool LoadHandle::isFinished() const
+    {
+        return LoadStage_Done<=getStage();
+    }
+
+    inline bool LoadHandle::isCancelled() const
+    {
+        return cancelled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+    @brief Load a scene on the default job system, stages run as dependent jobs: parse and decode, preview build, then full build.
+    The scene must not be touched until the preview gets ready, then rays can be tested while the full build runs.
+    */
+    LoadHandle::pointer_type loadAsync(Scene& scene, const Char* filepath, u32 flags=LoadFlag_None, LoadCallback callback=NULL, void* user=NULL);
 }
 #endif //INC_LRAY_SCENE_H__
@@ -33,8 +33,14 @@ namespace lray
         */
         void refine(const Mesh& src, const lray::Matrix44& matrix);
 
+        /**
+        @brief Resize primitives, used when refining primitives separately
+        */
+        void resize(s32 numPrimitives);
+
         inline s32 getNumPrimitives() const;
         inline const Primitive& getPrimitive(s32 index) const;
+        inline Primitive& getPrimitive(s32 index);
 
         Mesh& operator=(Mesh&& rhs);
     protected:
@@ -53,5 +59,10 @@ namespace lray
     {
         return primitives_[index];
     }
+
+    inline Primitive& Mesh::getPrimitive(s32 index)
+    {
+        return primitives_[index];
+    }
 }
 #endif //INC_LRAY_MESH_H__
@@ -0,0 +1,66 @@
+#ifndef INC_LRAY_MORPHTARGET_H__
+#define INC_LRAY_MORPHTARGET_H__
+/**
+@file MorphTarget.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../math/Vector3.h"
+
+namespace lray
+{
+    /**
+    @brief Sparse deltas of a blend shape, only vertices which move are stored
+    */
+    class MorphTarget
+    {
+    public:
+        MorphTarget();
+        MorphTarget(MorphTarget&& rhs);
+        /**
+        @param indices ... vertex indices in ascending order
+        @param positions ... position deltas
+        @param normals ... normal deltas, can be NULL
+        The target takes ownership of arrays.
+        */
+        MorphTarget(s32 numDeltas, s32* indices, Vector3* positions, Vector3* normals);
+        ~MorphTarget();
+
+        inline s32 getNumDeltas() const;
+        inline const s32* getIndices() const;
+        inline const Vector3* getPositions() const;
+        inline const Vector3* getNormals() const;
+
+        MorphTarget& operator=(MorphTarget&& rhs);
+    private:
+        MorphTarget(const MorphTarget&) = delete;
+        MorphTarget& operator=(const MorphTarget&) = delete;
+
+        s32 numDeltas_;
+        s32* indices_;
+        Vector3* positions_;
+        Vector3* normals_;
+    };
+
+    inline s32 MorphTarget::getNumDeltas() const
+    {
+        return numDeltas_;
+    }
+
+    inline const s32* MorphTarget::getIndices() const
+    {
+        return indices_;
+    }
+
+    inline const Vector3* MorphTarget::getPositions() const
+    {
+        return positions_;
+    }
+
+    inline const Vector3* MorphTarget::getNormals() const
+    {
+        return normals_;
+    }
+}
+#endif //INC_LRAY_MORPHTARGET_H__
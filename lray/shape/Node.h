@@ -7,6 +7,7 @@
 */
 #include "../lray.h"
 #include "../core/LString.h"
+#include "../core/SmallArray.h"
 #include "../math/Matrix44.h"
 
 namespace lray
@@ -22,7 +23,8 @@ namespace lray
             s32 parent,
             s32 numChildren,
             s32 childrenStart,
-            s32 mesh);
+            s32 mesh,
+            s32 skin=-1);
 
         inline Matrix44& getMatrix();
         inline const Matrix44& getMatrix() const;
@@ -34,6 +36,15 @@ namespace lray
         inline s32 getNumChildren() const;
         inline s32 getChildrenStart() const;
         inline s32 getMesh() const;
+        inline s32 getSkin() const;
+
+        /**
+        @brief Weights of morph targets of the mesh, which can be animated
+        */
+        inline s32 getNumWeights() const;
+        inline const f32* getWeights() const;
+        inline f32* getWeights();
+        void setWeights(s32 numWeights, const f32* weights);
 
         Node& operator=(Node&& rhs);
     private:
@@ -45,6 +56,8 @@ namespace lray
         s32 numChildren_;
         s32 childrenStart_;
         s32 mesh_;
+        s32 skin_;
+        SmallArray<f32, 4> weights_; ///< morph targets are few, kept inline
         Matrix44 matrix_;
         Matrix44 worldMatrix_;
     };
@@ -88,5 +101,25 @@ namespace lray
     {
         return mesh_;
     }
+
+    inline s32 Node::getSkin() const
+    {
+        return skin_;
+    }
+
+    inline s32 Node::getNumWeights() const
+    {
+        return weights_.size();
+    }
+
+    inline const f32* Node::getWeights() const
+    {
+        return (0<weights_.size())? &weights_[0] : NULL;
+    }
+
+    inline f32* Node::getWeights()
+    {
+        return (0<weights_.size())? &weights_[0] : NULL;
+    }
 }
 #endif //INC_LRAY_NODE_H__
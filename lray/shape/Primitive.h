@@ -6,9 +6,13 @@
 @date 2018/05/24 create
 */
 #include "../lray.h"
+#include "../math/Vector2.h"
 #include "../math/Vector3.h"
 #include "../shape/Triangle.h"
 #include "../shape/TriangleProxy.h"
+#include "../shape/Skin.h"
+#include "../shape/MorphTarget.h"
+#include "../core/Array.h"
 
 namespace lray
 {
@@ -17,11 +21,24 @@ namespace lray
     class Primitive
     {
     public:
+        typedef Array<MorphTarget> MorphTargetArray;
+
         enum Component
         {
             Component_Normal = (0x01<<0),
             Component_Texcoord = (0x01<<1),
             Component_Color = (0x01<<2),
+            Component_Skin = (0x01<<3),
+        };
+
+        /**
+        @brief Storages not owned by this primitive, which are viewed in place
+        */
+        enum Flag
+        {
+            Flag_SharedPositions = (0x01<<0),
+            Flag_SharedNormals = (0x01<<1),
+            Flag_SharedTriangles = (0x01<<2),
         };
 
         Primitive();
@@ -30,23 +47,62 @@ namespace lray
             Vector3* positions,
             Vector3* normals,
             s32 numTriangles,
-            Triangle* triangles);
+            Triangle* triangles,
+            s32 flags=0);
         Primitive(Primitive&& rhs);
         ~Primitive();
 
         inline void addComponent(Component component);
         inline bool hasComponent(Component component) const;
+        inline bool checkFlag(Flag flag) const;
 
         inline s32 getNumVertices() const;
         inline const Vector3& getPosition(s32 index) const;
         inline const Vector3& getNormal(s32 index) const;
         inline s32 getNumTriangles() const;
         inline const Triangle& getTriangle(s32 index) const;
+        inline const SkinWeight& getSkinWeight(s32 index) const;
+        inline const Vector2& getTexcoord(s32 index) const;
+
+        /**
+        @brief Set texture coordinates, one per vertex. The primitive takes ownership.
+        */
+        void setTexcoords(Vector2* texcoords);
+
+        /**
+        @brief Set influences of joints, one per vertex. The primitive takes ownership.
+        */
+        void setSkinWeights(SkinWeight* skinWeights);
+
+        /**
+        @brief Set blend shapes
+        */
+        void setMorphTargets(MorphTargetArray&& morphTargets);
+        inline s32 getNumMorphTargets() const;
 
         /**
         @brief Generate and refine elements from source
+        @param weights ... weights of morph targets of source
+        */
+        void refine(const Primitive& src, const lray::Matrix44& matrix, s32 numWeights=0, const f32* weights=NULL);
+
+        /**
+        @brief Generate and refine elements from source with linear blend skinning
+        @param numJoints ... size of palette, influences of other joints are ignored
+        @param palette ... matrices indexed by joints of skin weights
+        @param weights ... weights of morph targets of source
+        */
+        void refine(const Primitive& src, s32 numJoints, const lray::Matrix44* palette, s32 numWeights=0, const f32* weights=NULL);
+
+        /**
+        @brief Merge bitwise identical vertices, require owned storages. Primitives with morph targets are left as they are.
         */
-        void refine(const Primitive& src, const lray::Matrix44& matrix);
+        void weld();
+
+        /**
+        @brief Sort triangles in Morton order of centroids, and vertices in order of first use, require owned storages. Primitives with morph targets are left as they are.
+        */
+        void reorder();
 
         /**
         @brief Generate proxies to a destination buffer
@@ -58,12 +114,24 @@ namespace lray
         Primitive(const Primitive&) = delete;
         Primitive& operator=(const Primitive&) = delete;
 
+        void release();
+        void refineStorages(const Primitive& src);
+        /**
+        @brief Add sparse deltas of a target to refined vertices
+        */
+        void morph(const MorphTarget& target, f32 weight, const lray::Matrix44& matrix);
+        void morph(const MorphTarget& target, f32 weight, const SkinWeight* skinWeights, s32 numJoints, const lray::Matrix44* palette);
+
         s32 components_;
+        s32 flags_;
         s32 numVertices_;
         Vector3* positions_;
         Vector3* normals_;
         s32 numTriangles_;
         Triangle* triangles_;
+        SkinWeight* skinWeights_;
+        Vector2* texcoords_;
+        MorphTargetArray morphTargets_;
     };
 
     inline void Primitive::addComponent(Component component)
@@ -76,6 +144,16 @@ namespace lray
         return 0 != (components_ & component);
     }
 
+    inline bool Primitive::checkFlag(Flag flag) const
+    {
+        return 0 != (flags_ & flag);
+    }
+
+    inline s32 Primitive::getNumMorphTargets() const
+    {
+        return morphTargets_.size();
+    }
+
     inline s32 Primitive::getNumVertices() const
     {
         return numVertices_;
@@ -103,5 +181,17 @@ namespace lray
         LASSERT(0<=index && index<numTriangles_);
         return triangles_[index];
     }
+
+    inline const SkinWeight& Primitive::getSkinWeight(s32 index) const
+    {
+        LASSERT(0<=index && index<numVertices_);
+        return skinWeights_[index];
+    }
+
+    inline const Vector2& Primitive::getTexcoord(s32 index) const
+    {
+        LASSERT(0<=index && index<numVertices_);
+        return texcoords_[index];
+    }
 }
 #endif //INC_LRAY_PRIMITIVE_H__
@@ -0,0 +1,81 @@
+#ifndef INC_LRAY_SKIN_H__
+#define INC_LRAY_SKIN_H__
+/**
+@file Skin.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../core/Array.h"
+#include "../math/Matrix44.h"
+
+namespace lray
+{
+    class Node;
+
+    /**
+    @brief Four joint influences of a vertex
+    */
+    struct SkinWeight
+    {
+        static const s32 NumInfluences = 4;
+
+        u16 joints_[NumInfluences];
+        f32 weights_[NumInfluences];
+    };
+
+    static_assert(std::is_trivially_copyable<SkinWeight>::value == true, "SkinWeight must be trivially copyable.");
+
+    /**
+    @brief Joints and their matrix palette
+    */
+    class Skin
+    {
+    public:
+        typedef Array<s32> JointArray;
+        typedef Array<Matrix44> MatrixArray;
+
+        Skin();
+        Skin(Skin&& rhs);
+        /**
+        @param joints ... indices of nodes
+        @param inverseBindMatrices ... one per joint
+        */
+        Skin(JointArray&& joints, MatrixArray&& inverseBindMatrices);
+        ~Skin();
+
+        inline s32 getNumJoints() const;
+        inline s32 getJoint(s32 index) const;
+        inline const Matrix44* getPalette() const;
+
+        /**
+        @brief Update palette, world matrices of joints times inverse bind matrices
+        */
+        void updatePalette(const Node* nodes);
+
+        Skin& operator=(Skin&& rhs);
+    private:
+        Skin(const Skin&) = delete;
+        Skin& operator=(const Skin&) = delete;
+
+        JointArray joints_;
+        MatrixArray inverseBindMatrices_;
+        MatrixArray palette_;
+    };
+
+    inline s32 Skin::getNumJoints() const
+    {
+        return joints_.size();
+    }
+
+    inline s32 Skin::getJoint(s32 index) const
+    {
+        return joints_[index];
+    }
+
+    inline const Matrix44* Skin::getPalette() const
+    {
+        return (0<palette_.size())? &palette_[0] : NULL;
+    }
+}
+#endif //INC_LRAY_SKIN_H__
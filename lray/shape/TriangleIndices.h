@@ -0,0 +1,89 @@
+#ifndef INC_LRAY_TRIANGLEINDICES_H__
+#define INC_LRAY_TRIANGLEINDICES_H__
+/**
+@file TriangleIndices.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "Triangle.h"
+
+namespace lray
+{
+    enum TriangleTopology
+    {
+        TriangleTopology_List =0,
+        TriangleTopology_Strip,
+        TriangleTopology_Fan,
+    };
+
+    /**
+    @brief Number of triangles expanded from indices
+    */
+    s32 getNumTriangles(TriangleTopology topology, s32 numIndices);
+
+    /**
+    @brief Expand tightly packed indices to triangles
+    @param triangles[out] ... require getNumTriangles(topology, numIndices) triangles
+    */
+    void expandTriangles(Triangle* triangles, TriangleTopology topology, s32 numIndices, const u16* indices);
+    void expandTriangles(Triangle* triangles, TriangleTopology topology, s32 numIndices, const u32* indices);
+
+    /**
+    @brief Expand strided indices to triangles, the generic path
+    @param triangles[out] ... require getNumTriangles(topology, numIndices) triangles
+    */
+    template<class T>
+    void expandTrianglesStrided(Triangle* triangles, TriangleTopology topology, s32 numIndices, s32 byteStride, const u8* data)
+    {
+        switch(topology)
+        {
+        case TriangleTopology_List:
+        {
+            Triangle* tri = triangles;
+            for(s32 i=2; i<numIndices; i+=3, ++tri){
+                tri->indices_[0] = *reinterpret_cast<const T*>(data);
+                data += byteStride;
+                tri->indices_[1] = *reinterpret_cast<const T*>(data);
+                data += byteStride;
+                tri->indices_[2] = *reinterpret_cast<const T*>(data);
+                data += byteStride;
+            }
+        }
+        break;
+        case TriangleTopology_Strip:
+        {
+            Triangle* tri = triangles;
+            data += byteStride;
+            for(s32 i=2; i<numIndices; ++i, ++tri){
+                tri->indices_[0] = *reinterpret_cast<const T*>(data-byteStride);
+                tri->indices_[1] = *reinterpret_cast<const T*>(data);
+                tri->indices_[2] = *reinterpret_cast<const T*>(data+byteStride);
+                data += byteStride;
+            }
+        }
+        break;
+        case TriangleTopology_Fan:
+        {
+            Triangle* tri = triangles;
+            T index0 = *reinterpret_cast<const T*>(data);
+            data += byteStride;
+            for(s32 i=2; i<numIndices; ++i, ++tri){
+                tri->indices_[0] = index0;
+                tri->indices_[1] = *reinterpret_cast<const T*>(data);
+                tri->indices_[2] = *reinterpret_cast<const T*>(data+byteStride);
+                data += byteStride;
+            }
+        }
+        break;
+        default:
+            break;
+        }
+    }
+
+    /**
+    @brief Generate triangles for non-indexed vertices
+    @param triangles[out] ... require getNumTriangles(topology, numVertices) triangles
+    */
+    void generateTriangles(Triangle* triangles, TriangleTopology topology, s32 numVertices);
+}
+#endif //INC_LRAY_TRIANGLEINDICES_H__
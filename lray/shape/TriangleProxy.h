@@ -67,14 +67,17 @@ namespace lray
         //    return primitive.testRay(t, ray);
         //}
 
-        static inline void sort(s32 numPrimitives, s32* primitiveIndices, const f32* centroids)
+        /**
+        @brief Partition around the nth primitive in order of centroids
+        */
+        static inline void select(s32 numPrimitives, s32* primitiveIndices, s32 nth, const f32* centroids)
         {
-            introsort(numPrimitives, primitiveIndices, SortFuncCentroid(centroids));
+            introselect(numPrimitives, primitiveIndices, nth, SortFuncCentroid(centroids));
         }
 
         static inline void insertionsort(s32 numPrimitives, s32* primitiveIndices, const f32* centroids)
         {
-            insertionsort(numPrimitives, primitiveIndices, SortFuncCentroid(centroids));
+            lray::insertionsort(numPrimitives, primitiveIndices, SortFuncCentroid(centroids));
         }
     };
 }
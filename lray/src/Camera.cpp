@@ -5,9 +5,62 @@
 */
 #include "Camera.h"
 #include "math/Ray.h"
+#include "math/RayDifferential.h"
+#include "math/RayStream.h"
 
 namespace lray
 {
+namespace
+{
+#if defined(__AVX__)
+    struct Lanes
+    {
+        static const s32 Width = 8;
+        typedef __m256 Type;
+
+        static inline Type set1(f32 x){ return _mm256_set1_ps(x);}
+        static inline Type load(const f32* x){ return _mm256_load_ps(x);}
+        static inline void store(f32* dst, Type x){ _mm256_store_ps(dst, x);}
+        static inline Type add(Type x0, Type x1){ return _mm256_add_ps(x0, x1);}
+        static inline Type mul(Type x0, Type x1){ return _mm256_mul_ps(x0, x1);}
+        static inline Type div(Type x0, Type x1){ return _mm256_div_ps(x0, x1);}
+        static inline Type sqrt(Type x){ return _mm256_sqrt_ps(x);}
+        static inline Type and_(Type x0, Type x1){ return _mm256_and_ps(x0, x1);}
+        static inline Type andnot(Type x0, Type x1){ return _mm256_andnot_ps(x0, x1);}
+        static inline Type or_(Type x0, Type x1){ return _mm256_or_ps(x0, x1);}
+        static inline Type cmpeq(Type x0, Type x1){ return _mm256_cmp_ps(x0, x1, _CMP_EQ_OQ);}
+    };
+#else
+    struct Lanes
+    {
+        static const s32 Width = 4;
+        typedef lm128 Type;
+
+        static inline Type set1(f32 x){ return _mm_set1_ps(x);}
+        static inline Type load(const f32* x){ return _mm_load_ps(x);}
+        static inline void store(f32* dst, Type x){ _mm_store_ps(dst, x);}
+        static inline Type add(Type x0, Type x1){ return _mm_add_ps(x0, x1);}
+        static inline Type mul(Type x0, Type x1){ return _mm_mul_ps(x0, x1);}
+        static inline Type div(Type x0, Type x1){ return _mm_div_ps(x0, x1);}
+        static inline Type sqrt(Type x){ return _mm_sqrt_ps(x);}
+        static inline Type and_(Type x0, Type x1){ return _mm_and_ps(x0, x1);}
+        static inline Type andnot(Type x0, Type x1){ return _mm_andnot_ps(x0, x1);}
+        static inline Type or_(Type x0, Type x1){ return _mm_or_ps(x0, x1);}
+        static inline Type cmpeq(Type x0, Type x1){ return _mm_cmpeq_ps(x0, x1);}
+    };
+#endif
+
+    //Same as Ray::invertDirection, signed F32_MAX for zeros
+    inline Lanes::Type invert(Lanes::Type d)
+    {
+        Lanes::Type signMask = Lanes::set1(-0.0f);
+        Lanes::Type zero = Lanes::cmpeq(d, Lanes::set1(0.0f));
+        Lanes::Type inv = Lanes::div(Lanes::set1(1.0f), d);
+        Lanes::Type maxValue = Lanes::or_(Lanes::and_(d, signMask), Lanes::set1(F32_MAX));
+        return Lanes::or_(Lanes::and_(zero, maxValue), Lanes::andnot(zero, inv));
+    }
+}
+
     Camera::Camera()
         :width_(0)
         ,height_(0)
@@ -39,6 +92,91 @@ namespace lray
         return Ray(position_, direction, farClip_);
     }
 
+    Ray Camera::generateRay(f32 screenX, f32 screenY, RayDifferential& differential) const
+    {
+        f32 nx = invHalfWidth_*screenX - 1.0f;
+        f32 ny = 1.0f-invHalfHeight_*screenY;
+        Vector3 dx = mul(nx*rayDx_, right_);
+        Vector3 dy = mul(ny*rayDy_, up_);
+        Vector3 d = dx+dy+forward_;
+
+        //Derivatives of normalize(d), d changes linearly with screen coordinates
+        Vector3 ddx = mul(invHalfWidth_*rayDx_, right_);
+        Vector3 ddy = mul(-invHalfHeight_*rayDy_, up_);
+        f32 dd = dot(d, d);
+        f32 invLength = 1.0f/lray::sqrt(dd);
+        f32 invLength3 = invLength/dd;
+        differential.dPdx_ = Vector3(0.0f);
+        differential.dPdy_ = Vector3(0.0f);
+        differential.dDdx_ = (dd*ddx - dot(d, ddx)*d)*invLength3;
+        differential.dDdy_ = (dd*ddy - dot(d, ddy)*d)*invLength3;
+        return Ray(position_, d*invLength, farClip_);
+    }
+
+    void Camera::generateRays(RayStream& stream, s32 x, s32 y, s32 width, s32 height, const f32* jitter) const
+    {
+        LASSERT(0<=width && 0<=height);
+        s32 size = width*height;
+        stream.resize(size);
+
+        //Directions are affine in screen coordinates before normalization
+        Vector3 ax = mul(invHalfWidth_*rayDx_, right_);
+        Vector3 ay = mul(-invHalfHeight_*rayDy_, up_);
+        Vector3 a0 = forward_ - mul(rayDx_, right_) + mul(rayDy_, up_);
+        Lanes::Type axs[3], ays[3], a0s[3];
+        for(s32 i=0; i<3; ++i){
+            axs[i] = Lanes::set1(ax[i]);
+            ays[i] = Lanes::set1(ay[i]);
+            a0s[i] = Lanes::set1(a0[i]);
+        }
+        Lanes::Type originX = Lanes::set1(position_.x_);
+        Lanes::Type originY = Lanes::set1(position_.y_);
+        Lanes::Type originZ = Lanes::set1(position_.z_);
+        Lanes::Type t = Lanes::set1(farClip_);
+
+        LALIGN_VAR(32, f32, screenX[Lanes::Width]);
+        LALIGN_VAR(32, f32, screenY[Lanes::Width]);
+        s32 px = 0;
+        s32 py = 0;
+        for(s32 i=0; i<size; i+=Lanes::Width){
+            //Padded lanes continue to the next row, they are written but not counted
+            for(s32 j=0; j<Lanes::Width; ++j){
+                screenX[j] = static_cast<f32>(x+px);
+                screenY[j] = static_cast<f32>(y+py);
+                if(NULL != jitter && (i+j)<size){
+                    screenX[j] += jitter[(i+j)*2+0];
+                    screenY[j] += jitter[(i+j)*2+1];
+                }
+                if(width<=++px){
+                    px = 0;
+                    ++py;
+                }
+            }
+            Lanes::Type sx = Lanes::load(screenX);
+            Lanes::Type sy = Lanes::load(screenY);
+            Lanes::Type d[3];
+            for(s32 k=0; k<3; ++k){
+                d[k] = Lanes::add(Lanes::add(Lanes::mul(sx, axs[k]), Lanes::mul(sy, ays[k])), a0s[k]);
+            }
+            Lanes::Type lengthSqr = Lanes::add(Lanes::add(Lanes::mul(d[0], d[0]), Lanes::mul(d[1], d[1])), Lanes::mul(d[2], d[2]));
+            Lanes::Type invLength = Lanes::div(Lanes::set1(1.0f), Lanes::sqrt(lengthSqr));
+            d[0] = Lanes::mul(d[0], invLength);
+            d[1] = Lanes::mul(d[1], invLength);
+            d[2] = Lanes::mul(d[2], invLength);
+
+            Lanes::store(stream.originX_+i, originX);
+            Lanes::store(stream.originY_+i, originY);
+            Lanes::store(stream.originZ_+i, originZ);
+            Lanes::store(stream.directionX_+i, d[0]);
+            Lanes::store(stream.directionY_+i, d[1]);
+            Lanes::store(stream.directionZ_+i, d[2]);
+            Lanes::store(stream.invDirectionX_+i, invert(d[0]));
+            Lanes::store(stream.invDirectionY_+i, invert(d[1]));
+            Lanes::store(stream.invDirectionZ_+i, invert(d[2]));
+            Lanes::store(stream.t_+i, t);
+        }
+    }
+
     void Camera::setNearFarClip(f32 near, f32 far)
     {
         LASSERT(0.0f<=near);
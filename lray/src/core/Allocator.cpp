@@ -0,0 +1,592 @@
+/**
+@file Allocator.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/Allocator.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace lray
+{
+namespace
+{
+    static const size_t HugePageSize = 2*1024*1024;
+
+    enum Kind
+    {
+        Kind_System = 0,
+        Kind_Small,
+        Kind_Huge,
+    };
+
+    /**
+    @brief Placed just before every user pointer, frees are routed by this
+    */
+    struct BlockHeader
+    {
+        u64 size_; ///< requested bytes
+        u32 offset_; ///< from the start of the block to the user pointer
+        u16 site_;
+        u8 kind_;
+        u8 sizeClass_;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "BlockHeader must be 16 bytes.");
+
+    inline uintptr_t alignUp(uintptr_t x, uintptr_t alignment)
+    {
+        return (x + alignment - 1) & ~(alignment - 1);
+    }
+
+    inline BlockHeader* getHeader(void* ptr)
+    {
+        return reinterpret_cast<BlockHeader*>(ptr) - 1;
+    }
+
+    inline const BlockHeader* getHeader(const void* ptr)
+    {
+        return reinterpret_cast<const BlockHeader*>(ptr) - 1;
+    }
+
+    //Place a header and a user pointer in a block, which is aligned to 16 bytes
+    inline void* placeHeader(void* block, size_t size, u32 alignment, Kind kind, s32 sizeClass, u16 site)
+    {
+        uintptr_t start = reinterpret_cast<uintptr_t>(block);
+        uintptr_t user = alignUp(start + sizeof(BlockHeader), alignment);
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+        header->size_ = size;
+        header->offset_ = static_cast<u32>(user - start);
+        header->site_ = site;
+        header->kind_ = static_cast<u8>(kind);
+        header->sizeClass_ = static_cast<u8>(sizeClass);
+        return reinterpret_cast<void*>(user);
+    }
+
+    inline void* getBlock(void* ptr, const BlockHeader* header)
+    {
+        return reinterpret_cast<u8*>(ptr) - header->offset_;
+    }
+
+    std::atomic<size_t> hugePageThreshold_(Allocator::DefaultHugePageThreshold);
+    std::atomic<bool> explicitHugePages_(false);
+
+    //--------------------------------------------
+    //--- Huge pages
+    //--------------------------------------------
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    //Map with extra, then trim both ends for the range to start at a huge page
+    void* mapHugePages(size_t bytes)
+    {
+        size_t length = alignUp(bytes, HugePageSize);
+#if defined(MAP_HUGETLB)
+        //Reserved huge pages are aligned, fall back to transparent ones if the pool is short
+        if(explicitHugePages_.load(std::memory_order_relaxed)){
+            void* ptr = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+            if(MAP_FAILED != ptr){
+                return ptr;
+            }
+        }
+#endif
+        size_t mapped = length + HugePageSize;
+        void* ptr = mmap(NULL, mapped, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if(MAP_FAILED == ptr){
+            return NULL;
+        }
+        uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+        uintptr_t aligned = alignUp(start, HugePageSize);
+        if(start != aligned){
+            munmap(ptr, aligned - start);
+        }
+        size_t tail = (start + mapped) - (aligned + length);
+        if(0<tail){
+            munmap(reinterpret_cast<void*>(aligned + length), tail);
+        }
+        madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void unmapHugePages(void* ptr, size_t bytes)
+    {
+        munmap(ptr, alignUp(bytes, HugePageSize));
+    }
+#define LRAY_ALLOCATOR_HUGEPAGE
+#endif
+
+    //--------------------------------------------
+    //--- Stats
+    //--------------------------------------------
+#if defined(LRAY_ALLOCATOR_STATS)
+    struct SiteEntry
+    {
+        std::atomic<const Char*> file_;
+        s32 line_;
+        std::atomic<s64> liveBytes_;
+        std::atomic<s64> peakBytes_;
+        std::atomic<s64> numAllocations_;
+    };
+
+    //Entry 0 is for unknown sites
+    SiteEntry sites_[Allocator::MaxSites];
+    std::mutex sitesMutex_;
+    std::atomic<s64> liveBytes_(0);
+    std::atomic<s64> peakBytes_(0);
+
+    inline void updatePeak(std::atomic<s64>& peak, s64 bytes)
+    {
+        s64 current = peak.load(std::memory_order_relaxed);
+        while(current<bytes && !peak.compare_exchange_weak(current, bytes, std::memory_order_relaxed)){
+        }
+    }
+
+    //Open addressing by the address of a file name and a line, which are unique to a call site
+    u16 findSite(const Char* file, s32 line)
+    {
+        if(NULL == file){
+            return 0;
+        }
+        u32 mask = Allocator::MaxSites - 1;
+        u32 index = (static_cast<u32>(reinterpret_cast<uintptr_t>(file)>>4) ^ (static_cast<u32>(line)*0x9E3779B1U)) & mask;
+        for(s32 i=0; i<Allocator::MaxSites; ++i, index = (index+1) & mask){
+            if(0 == index){
+                continue;
+            }
+            SiteEntry& entry = sites_[index];
+            const Char* entryFile = entry.file_.load(std::memory_order_acquire);
+            if(NULL == entryFile){
+                std::lock_guard<std::mutex> lock(sitesMutex_);
+                entryFile = entry.file_.load(std::memory_order_acquire);
+                if(NULL == entryFile){
+                    entry.line_ = line;
+                    entry.file_.store(file, std::memory_order_release);
+                    return static_cast<u16>(index);
+                }
+            }
+            if(entryFile == file && entry.line_ == line){
+                return static_cast<u16>(index);
+            }
+        }
+        return 0;
+    }
+
+    inline void recordAllocation(u16 site, s64 bytes)
+    {
+        SiteEntry& entry = sites_[site];
+        updatePeak(entry.peakBytes_, entry.liveBytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        entry.numAllocations_.fetch_add(1, std::memory_order_relaxed);
+        updatePeak(peakBytes_, liveBytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    }
+
+    inline void recordDeallocation(u16 site, s64 bytes)
+    {
+        sites_[site].liveBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        liveBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+#endif
+
+    //--------------------------------------------
+    //--- Arena
+    //--------------------------------------------
+#if defined(LRAY_ALLOCATOR_ARENA)
+    //16 bytes steps to 128, then 4 classes per power of two to 32KB
+    static const s32 NumSizeClasses = 40;
+    static const size_t MaxSmallSize = 32*1024;
+    static const size_t BatchBytes = 64*1024;
+
+    inline s32 getSizeClass(size_t size)
+    {
+        size_t n = size - 1;
+        if(n<128){
+            return static_cast<s32>(n>>4);
+        }
+        s32 log2 = 7;
+        while((n>>(log2+1)) != 0){
+            ++log2;
+        }
+        s32 sub = static_cast<s32>((n>>(log2-2)) & 3);
+        return 8 + (log2-7)*4 + sub;
+    }
+
+    inline size_t getClassSize(s32 sizeClass)
+    {
+        if(sizeClass<8){
+            return static_cast<size_t>(sizeClass+1)<<4;
+        }
+        s32 log2 = 7 + (sizeClass-8)/4;
+        s32 sub = (sizeClass-8)%4;
+        return static_cast<size_t>(4+sub+1)<<(log2-2);
+    }
+
+    //Blocks moved between a thread and the central list at once
+    inline s32 getBatchSize(s32 sizeClass)
+    {
+        return static_cast<s32>(clamp(BatchBytes/getClassSize(sizeClass), static_cast<size_t>(4), static_cast<size_t>(128)));
+    }
+
+    struct FreeBlock
+    {
+        FreeBlock* next_;
+    };
+
+    /**
+    @brief Lists shared by threads, visited only when a thread cache runs out or overflows
+    */
+    struct CentralList
+    {
+        std::mutex mutex_;
+        FreeBlock* head_ = NULL;
+    };
+    CentralList centralLists_[NumSizeClasses];
+
+    /**
+    @brief Trivial to be accessible at any time of a thread, even after the guard is destructed
+    */
+    struct ThreadCache
+    {
+        FreeBlock* lists_[NumSizeClasses];
+        s32 counts_[NumSizeClasses];
+        bool initialized_;
+        bool finished_;
+    };
+    thread_local ThreadCache threadCache_;
+
+    void pushCentral(s32 sizeClass, FreeBlock* first, FreeBlock* last)
+    {
+        CentralList& central = centralLists_[sizeClass];
+        std::lock_guard<std::mutex> lock(central.mutex_);
+        last->next_ = central.head_;
+        central.head_ = first;
+    }
+
+    //Blocks from the central list, or carved from a new span which is never returned
+    FreeBlock* popCentral(s32 sizeClass, s32& count)
+    {
+        s32 batchSize = getBatchSize(sizeClass);
+        {
+            CentralList& central = centralLists_[sizeClass];
+            std::lock_guard<std::mutex> lock(central.mutex_);
+            if(NULL != central.head_){
+                FreeBlock* first = central.head_;
+                FreeBlock* last = first;
+                count = 1;
+                while(count<batchSize && NULL != last->next_){
+                    last = last->next_;
+                    ++count;
+                }
+                central.head_ = last->next_;
+                last->next_ = NULL;
+                return first;
+            }
+        }
+        size_t classSize = getClassSize(sizeClass);
+        u8* span = reinterpret_cast<u8*>(::malloc(classSize*batchSize));
+        if(NULL == span){
+            count = 0;
+            return NULL;
+        }
+        for(s32 i=0; i<batchSize-1; ++i){
+            reinterpret_cast<FreeBlock*>(span + classSize*i)->next_ = reinterpret_cast<FreeBlock*>(span + classSize*(i+1));
+        }
+        reinterpret_cast<FreeBlock*>(span + classSize*(batchSize-1))->next_ = NULL;
+        count = batchSize;
+        return reinterpret_cast<FreeBlock*>(span);
+    }
+
+    void flushThreadCache(ThreadCache& cache, s32 sizeClass)
+    {
+        FreeBlock* first = cache.lists_[sizeClass];
+        if(NULL == first){
+            return;
+        }
+        FreeBlock* last = first;
+        while(NULL != last->next_){
+            last = last->next_;
+        }
+        pushCentral(sizeClass, first, last);
+        cache.lists_[sizeClass] = NULL;
+        cache.counts_[sizeClass] = 0;
+    }
+
+    /**
+    @brief Return cached blocks when a thread exits
+    */
+    struct ThreadCacheGuard
+    {
+        ~ThreadCacheGuard()
+        {
+            ThreadCache& cache = threadCache_;
+            for(s32 i=0; i<NumSizeClasses; ++i){
+                flushThreadCache(cache, i);
+            }
+            cache.finished_ = true;
+        }
+        bool registered_;
+    };
+    thread_local ThreadCacheGuard threadCacheGuard_;
+
+    void* allocateSmall(s32 sizeClass)
+    {
+        ThreadCache& cache = threadCache_;
+        if(!cache.initialized_){
+            //Registering the guard may allocate, mark first not to come back
+            cache.initialized_ = true;
+            threadCacheGuard_.registered_ = true;
+        }
+        if(cache.finished_){
+            s32 count;
+            FreeBlock* block = popCentral(sizeClass, count);
+            if(1<count){
+                FreeBlock* last = block->next_;
+                while(NULL != last->next_){
+                    last = last->next_;
+                }
+                pushCentral(sizeClass, block->next_, last);
+            }
+            return block;
+        }
+        FreeBlock* block = cache.lists_[sizeClass];
+        if(NULL == block){
+            block = popCentral(sizeClass, cache.counts_[sizeClass]);
+            if(NULL == block){
+                return NULL;
+            }
+        }
+        cache.lists_[sizeClass] = block->next_;
+        --cache.counts_[sizeClass];
+        return block;
+    }
+
+    void deallocateSmall(void* ptr, s32 sizeClass)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+        ThreadCache& cache = threadCache_;
+        if(cache.finished_ || !cache.initialized_){
+            block->next_ = NULL;
+            pushCentral(sizeClass, block, block);
+            return;
+        }
+        block->next_ = cache.lists_[sizeClass];
+        cache.lists_[sizeClass] = block;
+        //Blocks freed by another thread than the allocator's pile up here, give a batch back
+        s32 batchSize = getBatchSize(sizeClass);
+        if(batchSize*2 < ++cache.counts_[sizeClass]){
+            FreeBlock* first = cache.lists_[sizeClass];
+            FreeBlock* last = first;
+            for(s32 i=1; i<batchSize; ++i){
+                last = last->next_;
+            }
+            cache.lists_[sizeClass] = last->next_;
+            cache.counts_[sizeClass] -= batchSize;
+            pushCentral(sizeClass, first, last);
+        }
+    }
+#endif
+}
+
+    void* Allocator::allocate(size_t size, u32 alignment, const Char* file, s32 line)
+    {
+        alignment = maximum(alignment, static_cast<u32>(sizeof(BlockHeader)));
+        LASSERT(0 == (alignment & (alignment-1)));
+#if defined(LRAY_ALLOCATOR_STATS)
+        u16 site = findSite(file, line);
+#else
+        (void)file;
+        (void)line;
+        u16 site = 0;
+#endif
+        //Blocks are aligned to 16 bytes, the header and padding are in alignment bytes
+        size_t bytes = size + alignment;
+        void* block = NULL;
+        Kind kind = Kind_System;
+        s32 sizeClass = 0;
+
+#if defined(LRAY_ALLOCATOR_HUGEPAGE)
+        size_t threshold = hugePageThreshold_.load(std::memory_order_relaxed);
+        if(0<threshold && threshold<=bytes){
+            //Huge pages are aligned, the user pointer is just after the header
+            bytes = size + alignUp(sizeof(BlockHeader), alignment);
+            block = mapHugePages(bytes);
+            kind = Kind_Huge;
+        }
+#endif
+#if defined(LRAY_ALLOCATOR_ARENA)
+        if(NULL == block && bytes<=MaxSmallSize){
+            sizeClass = getSizeClass(bytes);
+            block = allocateSmall(sizeClass);
+            kind = Kind_Small;
+        }
+#endif
+        if(NULL == block){
+            bytes = size + alignment;
+            block = ::malloc(bytes);
+            kind = Kind_System;
+            if(NULL == block){
+                return NULL;
+            }
+        }
+#if defined(LRAY_ALLOCATOR_STATS)
+        recordAllocation(site, static_cast<s64>(size));
+#endif
+        return placeHeader(block, size, alignment, kind, sizeClass, site);
+    }
+
+    void Allocator::deallocate(void* ptr)
+    {
+        if(NULL == ptr){
+            return;
+        }
+        BlockHeader* header = getHeader(ptr);
+#if defined(LRAY_ALLOCATOR_STATS)
+        recordDeallocation(header->site_, static_cast<s64>(header->size_));
+#endif
+        void* block = getBlock(ptr, header);
+        switch(header->kind_)
+        {
+#if defined(LRAY_ALLOCATOR_HUGEPAGE)
+        case Kind_Huge:
+            unmapHugePages(block, header->offset_ + header->size_);
+            break;
+#endif
+#if defined(LRAY_ALLOCATOR_ARENA)
+        case Kind_Small:
+            deallocateSmall(block, header->sizeClass_);
+            break;
+#endif
+        default:
+            ::free(block);
+            break;
+        }
+    }
+
+    void* Allocator::allocateMapped(size_t size, u32 alignment, const Char* file, s32 line)
+    {
+#if defined(LRAY_ALLOCATOR_HUGEPAGE)
+        alignment = maximum(alignment, static_cast<u32>(sizeof(BlockHeader)));
+        LASSERT(0 == (alignment & (alignment-1)));
+        size_t bytes = size + alignUp(sizeof(BlockHeader), alignment);
+        void* block = mapHugePages(bytes);
+        if(NULL != block){
+#if defined(LRAY_ALLOCATOR_STATS)
+            u16 site = findSite(file, line);
+            recordAllocation(site, static_cast<s64>(size));
+#else
+            u16 site = 0;
+#endif
+            return placeHeader(block, size, alignment, Kind_Huge, 0, site);
+        }
+#endif
+        return allocate(size, alignment, file, line);
+    }
+
+    bool Allocator::isMapped(const void* ptr)
+    {
+        return NULL != ptr && Kind_Huge == getHeader(ptr)->kind_;
+    }
+
+    void Allocator::setHugePageThreshold(size_t threshold)
+    {
+        hugePageThreshold_.store(threshold, std::memory_order_relaxed);
+    }
+
+    size_t Allocator::getHugePageThreshold()
+    {
+        return hugePageThreshold_.load(std::memory_order_relaxed);
+    }
+
+    void Allocator::setExplicitHugePages(bool enable)
+    {
+        explicitHugePages_.store(enable, std::memory_order_relaxed);
+    }
+
+    bool Allocator::isExplicitHugePages()
+    {
+        return explicitHugePages_.load(std::memory_order_relaxed);
+    }
+
+    s64 Allocator::getLiveBytes()
+    {
+#if defined(LRAY_ALLOCATOR_STATS)
+        return liveBytes_.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+
+    s64 Allocator::getPeakBytes()
+    {
+#if defined(LRAY_ALLOCATOR_STATS)
+        return peakBytes_.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+
+    s32 Allocator::getAllocationSites(s32 maxSites, AllocationSite* sites)
+    {
+        LASSERT(0<=maxSites);
+        LASSERT(maxSites<=0 || NULL != sites);
+        s32 count = 0;
+        if(maxSites<=0){
+            return count;
+        }
+#if defined(LRAY_ALLOCATOR_STATS)
+        for(s32 i=0; i<MaxSites; ++i){
+            const SiteEntry& entry = sites_[i];
+            const Char* file = entry.file_.load(std::memory_order_acquire);
+            if(0 != i && NULL == file){
+                continue;
+            }
+            AllocationSite site;
+            site.file_ = file;
+            site.line_ = (NULL == file)? 0 : entry.line_;
+            site.liveBytes_ = entry.liveBytes_.load(std::memory_order_relaxed);
+            site.peakBytes_ = entry.peakBytes_.load(std::memory_order_relaxed);
+            site.numAllocations_ = entry.numAllocations_.load(std::memory_order_relaxed);
+            if(site.numAllocations_<=0){
+                continue;
+            }
+            //Insert into the top maxSites
+            s32 j;
+            if(count<maxSites){
+                j = count++;
+            }else if(sites[maxSites-1].peakBytes_<site.peakBytes_){
+                j = maxSites-1;
+            }else{
+                continue;
+            }
+            for(; 0<j && sites[j-1].peakBytes_<site.peakBytes_; --j){
+                sites[j] = sites[j-1];
+            }
+            sites[j] = site;
+        }
+#else
+        (void)sites;
+#endif
+        return count;
+    }
+
+    void Allocator::printAllocationSites(s32 maxSites)
+    {
+        LASSERT(0<=maxSites);
+        AllocationSite* sites = reinterpret_cast<AllocationSite*>(::malloc(sizeof(AllocationSite)*maxSites));
+        if(NULL == sites){
+            return;
+        }
+        s32 count = getAllocationSites(maxSites, sites);
+        printf("live %lld bytes, peak %lld bytes\n", static_cast<long long>(getLiveBytes()), static_cast<long long>(getPeakBytes()));
+        for(s32 i=0; i<count; ++i){
+            printf("%s(%d): live %lld, peak %lld, %lld allocations\n",
+                (NULL == sites[i].file_)? "unknown" : sites[i].file_,
+                sites[i].line_,
+                static_cast<long long>(sites[i].liveBytes_),
+                static_cast<long long>(sites[i].peakBytes_),
+                static_cast<long long>(sites[i].numAllocations_));
+        }
+        ::free(sites);
+    }
+}
@@ -0,0 +1,412 @@
+/**
+@file JobSystem.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/JobSystem.h"
+#include "core/Numa.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace lray
+{
+namespace
+{
+    static const s32 NumSpins = 64;
+    static const u32 JobMask = JobSystem::MaxJobs-1;
+
+    thread_local const JobSystem* currentSystem_ = NULL;
+    thread_local s32 currentWorker_ = -1;
+
+    bool pinCpu(s32 worker)
+    {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker % minimum(getNumHardwareThreads(), static_cast<s32>(CPU_SETSIZE)), &cpus);
+        return 0 == sched_setaffinity(0, sizeof(cpu_set_t), &cpus);
+#else
+        (void)worker;
+        return false;
+#endif
+    }
+}
+
+    //---------------------------------------------------------
+    //---
+    //--- JobQueue
+    //---
+    //---------------------------------------------------------
+    JobQueue::JobQueue()
+        :top_(0)
+        ,bottom_(0)
+    {
+        for(s32 i=0; i<Capacity; ++i){
+            jobs_[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    bool JobQueue::push(Job* job)
+    {
+        s64 bottom = bottom_.load(std::memory_order_relaxed);
+        s64 top = top_.load(std::memory_order_acquire);
+        if(Capacity<=(bottom-top)){
+            return false;
+        }
+        jobs_[bottom&Mask].store(job, std::memory_order_relaxed);
+        bottom_.store(bottom+1, std::memory_order_release);
+        return true;
+    }
+
+    Job* JobQueue::pop()
+    {
+        s64 bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s64 top = top_.load(std::memory_order_relaxed);
+        if(bottom<top){
+            bottom_.store(bottom+1, std::memory_order_relaxed);
+            return NULL;
+        }
+        Job* job = jobs_[bottom&Mask].load(std::memory_order_relaxed);
+        if(top == bottom){
+            //The last one, race with thieves
+            if(!top_.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+                job = NULL;
+            }
+            bottom_.store(bottom+1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* JobQueue::steal()
+    {
+        s64 top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s64 bottom = bottom_.load(std::memory_order_acquire);
+        if(bottom<=top){
+            return NULL;
+        }
+        Job* job = jobs_[top&Mask].load(std::memory_order_relaxed);
+        if(!top_.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+            return NULL;
+        }
+        return job;
+    }
+
+    bool JobQueue::empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+    //---------------------------------------------------------
+    //---
+    //--- JobSystem
+    //---
+    //---------------------------------------------------------
+    JobSystem::JobSystem(s32 numWorkers, bool pinCpus)
+        :numWorkers_((numWorkers<=0)? getNumHardwareThreads() : numWorkers)
+        ,pinCpus_(pinCpus)
+        ,quit_(false)
+        ,queues_(NULL)
+        ,pools_(NULL)
+        ,threads_(NULL)
+        ,sharedJobs_(NULL)
+        ,sharedTop_(0)
+        ,sharedBottom_(0)
+        ,numSharedJobs_(0)
+        ,epoch_(0)
+        ,numSleeping_(0)
+        ,numWaiting_(0)
+    {
+        queues_ = reinterpret_cast<JobQueue*>(LALIGNED_MALLOC(sizeof(JobQueue)*numWorkers_, 64));
+        for(s32 i=0; i<numWorkers_; ++i){
+            LPLACEMENT_NEW(&queues_[i]) JobQueue();
+        }
+
+        //The last pool is for threads out of the pool
+        pools_ = LNEW JobPool[numWorkers_+1];
+        for(s32 i=0; i<=numWorkers_; ++i){
+            pools_[i].jobs_ = reinterpret_cast<Job*>(LALIGNED_MALLOC(sizeof(Job)*MaxJobs, 64));
+            pools_[i].next_ = 0;
+            for(s32 j=0; j<MaxJobs; ++j){
+                Job* job = LPLACEMENT_NEW(&pools_[i].jobs_[j]) Job();
+                job->unfinished_.store(0, std::memory_order_relaxed);
+                job->pending_.store(0, std::memory_order_relaxed);
+                job->generation_.store(0, std::memory_order_relaxed);
+            }
+        }
+        sharedJobs_ = LNEW Job*[MaxJobs];
+
+        threads_ = LNEW std::thread[numWorkers_];
+        for(s32 i=0; i<numWorkers_; ++i){
+            threads_[i] = std::thread(&JobSystem::proc, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            quit_.store(true);
+            sleepCondition_.notify_all();
+        }
+        for(s32 i=0; i<numWorkers_; ++i){
+            threads_[i].join();
+        }
+        LDELETE_ARRAY(threads_);
+        LDELETE_ARRAY(sharedJobs_);
+        for(s32 i=0; i<=numWorkers_; ++i){
+            LALIGNED_FREE(pools_[i].jobs_, 64);
+        }
+        LDELETE_ARRAY(pools_);
+        for(s32 i=0; i<numWorkers_; ++i){
+            queues_[i].~JobQueue();
+        }
+        LALIGNED_FREE(queues_, 64);
+    }
+
+    JobSystem& JobSystem::getDefault()
+    {
+        static JobSystem jobSystem;
+        return jobSystem;
+    }
+
+    s32 JobSystem::getCurrentWorker() const
+    {
+        return (this == currentSystem_)? currentWorker_ : -1;
+    }
+
+    void JobSystem::addDependency(Job* job, Job* prerequisite)
+    {
+        LASSERT(NULL != job);
+        LASSERT(NULL != prerequisite);
+        LASSERT(0<job->pending_.load(std::memory_order_relaxed));
+        LASSERT(0<prerequisite->pending_.load(std::memory_order_relaxed));
+        if(Job::MaxDependents<=prerequisite->numDependents_){
+            //Full, a relay takes over the last dependent, and is submitted when prerequisite is done
+            Job* relay = create([](s32){});
+            Job*& last = prerequisite->dependents_[Job::MaxDependents-1];
+            relay->dependents_[relay->numDependents_++] = last;
+            last = relay;
+            prerequisite = relay;
+        }
+        prerequisite->dependents_[prerequisite->numDependents_++] = job;
+        job->pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void JobSystem::submit(Job* job)
+    {
+        LASSERT(NULL != job);
+        if(1 == job->pending_.fetch_sub(1, std::memory_order_acq_rel)){
+            push(job);
+        }
+    }
+
+    bool JobSystem::isFinished(const Job* job) const
+    {
+        return 0 == job->unfinished_.load();
+    }
+
+    bool JobSystem::isFinished(const Job* job, u32 generation) const
+    {
+        //A recycled slot is marked unfinished after its generation is incremented
+        return 0 == job->unfinished_.load() || generation != job->generation_.load();
+    }
+
+    void JobSystem::wait(const Job* job)
+    {
+        LASSERT(NULL != job);
+        wait(job, getGeneration(job));
+    }
+
+    void JobSystem::wait(const Job* job, u32 generation)
+    {
+        LASSERT(NULL != job);
+        s32 worker = getCurrentWorker();
+        if(0<=worker){
+            while(!isFinished(job, generation)){
+                Job* other = find(worker);
+                if(NULL != other){
+                    execute(other, worker);
+                }else{
+                    std::this_thread::yield();
+                }
+            }
+            return;
+        }
+
+        //Out of the pool, sleep until a job is done
+        numWaiting_.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(waitMutex_);
+            while(!isFinished(job, generation)){
+                waitCondition_.wait(lock);
+            }
+        }
+        numWaiting_.fetch_sub(1);
+    }
+
+    Job* JobSystem::allocate()
+    {
+        s32 worker = getCurrentWorker();
+        JobPool& pool = pools_[(0<=worker)? worker : numWorkers_];
+        for(;;){
+            //Skip slots in use, such as parents not submitted yet
+            {
+                std::unique_lock<std::mutex> lock(sharedMutex_, std::defer_lock);
+                if(worker<0){
+                    lock.lock();
+                }
+                for(s32 i=0; i<MaxJobs; ++i){
+                    Job* job = &pool.jobs_[pool.next_ & JobMask];
+                    ++pool.next_;
+                    if(isFinished(job)){
+                        //Taken before other threads see it free, waiters see the generation first
+                        job->generation_.fetch_add(1);
+                        job->unfinished_.store(1);
+                        return job;
+                    }
+                }
+            }
+            //All are in use, wait for some to be done
+            Job* other = (0<=worker)? find(worker) : NULL;
+            if(NULL != other){
+                execute(other, worker);
+            }else{
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void JobSystem::push(Job* job)
+    {
+        s32 worker = getCurrentWorker();
+        if(0<=worker){
+            if(!queues_[worker].push(job)){
+                //Full, run it now
+                execute(job, worker);
+                return;
+            }
+        }else{
+            std::lock_guard<std::mutex> lock(sharedMutex_);
+            sharedJobs_[sharedBottom_ & JobMask] = job;
+            ++sharedBottom_;
+            numSharedJobs_.fetch_add(1, std::memory_order_relaxed);
+        }
+        signal();
+    }
+
+    Job* JobSystem::find(s32 worker)
+    {
+        Job* job = queues_[worker].pop();
+        if(NULL != job){
+            return job;
+        }
+        if(0<numSharedJobs_.load(std::memory_order_relaxed)){
+            std::lock_guard<std::mutex> lock(sharedMutex_);
+            if(sharedTop_ != sharedBottom_){
+                job = sharedJobs_[sharedTop_ & JobMask];
+                ++sharedTop_;
+                numSharedJobs_.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        //Steal from the next worker around
+        for(s32 i=1; i<numWorkers_; ++i){
+            s32 victim = worker + i;
+            victim = (numWorkers_<=victim)? victim-numWorkers_ : victim;
+            job = queues_[victim].steal();
+            if(NULL != job){
+                return job;
+            }
+        }
+        return NULL;
+    }
+
+    void JobSystem::execute(Job* job, s32 worker)
+    {
+        job->function_(job, worker);
+        finish(job);
+    }
+
+    void JobSystem::finish(Job* job)
+    {
+        while(NULL != job){
+            //The slot can be reused as soon as the job is done, copy before that
+            Job* parent = job->parent_;
+            s32 numDependents = job->numDependents_;
+            Job* dependents[Job::MaxDependents];
+            for(s32 i=0; i<numDependents; ++i){
+                dependents[i] = job->dependents_[i];
+            }
+            if(1 != job->unfinished_.fetch_sub(1)){
+                return;
+            }
+            for(s32 i=0; i<numDependents; ++i){
+                submit(dependents[i]);
+            }
+            if(0<numWaiting_.load()){
+                std::lock_guard<std::mutex> lock(waitMutex_);
+                waitCondition_.notify_all();
+            }
+            job = parent;
+        }
+    }
+
+    void JobSystem::signal()
+    {
+        epoch_.fetch_add(1);
+        if(0<numSleeping_.load()){
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            sleepCondition_.notify_one();
+        }
+    }
+
+    void JobSystem::proc(s32 worker)
+    {
+        currentSystem_ = this;
+        currentWorker_ = worker;
+        if(pinCpus_){
+            pinCpu(worker);
+        }
+
+        bool pinnedNuma = false;
+        while(!quit_.load(std::memory_order_relaxed)){
+            //Follow switches of NUMA pinning
+            if(pinnedNuma != Numa::isPinningWorkers()){
+                pinnedNuma = !pinnedNuma;
+                if(pinnedNuma){
+                    Numa::pinWorker(worker, numWorkers_);
+                }else if(pinCpus_){
+                    Numa::unpinThread();
+                    pinCpu(worker);
+                }else{
+                    Numa::unpinThread();
+                }
+            }
+
+            u32 epoch = epoch_.load();
+            Job* job = find(worker);
+            for(s32 i=0; NULL == job && i<NumSpins; ++i){
+                std::this_thread::yield();
+                job = find(worker);
+            }
+            if(NULL != job){
+                execute(job, worker);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            numSleeping_.fetch_add(1);
+            while(epoch == epoch_.load() && !quit_.load()){
+                sleepCondition_.wait(lock);
+            }
+            numSleeping_.fetch_sub(1);
+        }
+        currentSystem_ = NULL;
+        currentWorker_ = -1;
+    }
+}
@@ -0,0 +1,116 @@
+/**
+@file LinearArena.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/LinearArena.h"
+
+namespace lray
+{
+    LinearArena::LinearArena(size_t blockSize)
+        :blockSize_(blockSize)
+        ,head_(NULL)
+        ,current_(NULL)
+        ,offset_(0)
+    {
+        LASSERT(0<blockSize_);
+    }
+
+    LinearArena::~LinearArena()
+    {
+        release();
+    }
+
+    void LinearArena::release()
+    {
+        Block* block = head_;
+        while(NULL != block){
+            Block* next = block->next_;
+            LALIGNED_FREE(block, HeaderSize);
+            block = next;
+        }
+        head_ = current_ = NULL;
+        offset_ = 0;
+    }
+
+    LinearArena::Block* LinearArena::createBlock(size_t capacity)
+    {
+        Block* block = reinterpret_cast<Block*>(LALIGNED_MALLOC(HeaderSize + capacity, HeaderSize));
+        block->next_ = NULL;
+        block->capacity_ = capacity;
+        return block;
+    }
+
+    void* LinearArena::allocate(size_t size, u32 alignment)
+    {
+        LASSERT(0 == (alignment & (alignment-1)));
+        LASSERT(alignment<=HeaderSize);
+        if(NULL == current_){
+            if(NULL == head_){
+                head_ = createBlock(maximum(blockSize_, size));
+            }
+            current_ = head_;
+            offset_ = 0;
+        }
+        for(;;){
+            uintptr_t data = reinterpret_cast<uintptr_t>(getData(current_));
+            uintptr_t ptr = (data + offset_ + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            if(ptr + size <= data + current_->capacity_){
+                offset_ = ptr + size - data;
+                return reinterpret_cast<void*>(ptr);
+            }
+            //Blocks after the current are kept by rewinding, use them before creating
+            if(NULL == current_->next_){
+                current_->next_ = createBlock(maximum(blockSize_, size));
+            }
+            current_ = current_->next_;
+            offset_ = 0;
+        }
+    }
+
+    void LinearArena::rewind(const Marker& marker)
+    {
+        if(NULL == marker.block_ || (head_ == marker.block_ && 0 == marker.offset_)){
+            reset();
+            return;
+        }
+        current_ = marker.block_;
+        offset_ = marker.offset_;
+    }
+
+    void LinearArena::reset()
+    {
+        //Merge blocks, so that the next use of the same amount fits in one block
+        if(NULL != head_ && NULL != head_->next_){
+            size_t capacity = getCapacity();
+            release();
+            head_ = createBlock(capacity);
+        }
+        current_ = head_;
+        offset_ = 0;
+    }
+
+    size_t LinearArena::getCapacity() const
+    {
+        size_t capacity = 0;
+        for(const Block* block = head_; NULL != block; block = block->next_){
+            capacity += block->capacity_;
+        }
+        return capacity;
+    }
+
+    s32 LinearArena::getNumBlocks() const
+    {
+        s32 count = 0;
+        for(const Block* block = head_; NULL != block; block = block->next_){
+            ++count;
+        }
+        return count;
+    }
+
+    LinearArena& getThreadScratch()
+    {
+        static thread_local LinearArena scratch;
+        return scratch;
+    }
+}
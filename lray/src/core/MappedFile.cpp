@@ -0,0 +1,205 @@
+/**
+@file MappedFile.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/MappedFile.h"
+
+#ifdef _WIN32
+
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif //WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace lray
+{
+    namespace
+    {
+#ifndef _WIN32
+        //Round down to a page boundary, madvise requires an aligned address
+        inline void getPageRange(u8*& address, size_t& length, u8* data, s64 dataSize, s64 offset, s64 size)
+        {
+            static const uintptr_t PageMask = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) - 1;
+            if(dataSize<(offset+size)){
+                size = dataSize - offset;
+            }
+            uintptr_t start = reinterpret_cast<uintptr_t>(data + offset);
+            uintptr_t alignedStart = start & ~PageMask;
+            address = reinterpret_cast<u8*>(alignedStart);
+            length = static_cast<size_t>(size + (start-alignedStart));
+        }
+#endif
+    }
+
+    MappedFile::MappedFile()
+#ifdef _WIN32
+        :file_(INVALID_HANDLE_VALUE)
+        ,mapping_(NULL)
+#else
+        :file_(-1)
+#endif
+        ,size_(0)
+        ,data_(NULL)
+    {
+    }
+
+    MappedFile::MappedFile(MappedFile&& rhs)
+        :file_(rhs.file_)
+#ifdef _WIN32
+        ,mapping_(rhs.mapping_)
+#endif
+        ,size_(rhs.size_)
+        ,data_(rhs.data_)
+    {
+#ifdef _WIN32
+        rhs.file_ = INVALID_HANDLE_VALUE;
+        rhs.mapping_ = NULL;
+#else
+        rhs.file_ = -1;
+#endif
+        rhs.size_ = 0;
+        rhs.data_ = NULL;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const Char* filepath)
+    {
+        LASSERT(NULL != filepath);
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if(INVALID_HANDLE_VALUE == file_){
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart<=0){
+            close();
+            return false;
+        }
+        size_ = fileSize.QuadPart;
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if(NULL == mapping_){
+            close();
+            return false;
+        }
+        data_ = reinterpret_cast<u8*>(MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0));
+        if(NULL == data_){
+            close();
+            return false;
+        }
+#else
+        file_ = ::open(filepath, O_RDONLY);
+        if(file_<0){
+            return false;
+        }
+        struct stat fileStat;
+        if(fstat(file_, &fileStat)<0 || fileStat.st_size<=0){
+            close();
+            return false;
+        }
+        size_ = fileStat.st_size;
+        void* data = mmap(NULL, static_cast<size_t>(size_), PROT_READ|PROT_WRITE, MAP_PRIVATE, file_, 0);
+        if(MAP_FAILED == data){
+            close();
+            return false;
+        }
+        data_ = reinterpret_cast<u8*>(data);
+#endif
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if(NULL != data_){
+            UnmapViewOfFile(data_);
+            data_ = NULL;
+        }
+        if(NULL != mapping_){
+            CloseHandle(mapping_);
+            mapping_ = NULL;
+        }
+        if(INVALID_HANDLE_VALUE != file_){
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if(NULL != data_){
+            munmap(data_, static_cast<size_t>(size_));
+            data_ = NULL;
+        }
+        if(0<=file_){
+            ::close(file_);
+            file_ = -1;
+        }
+#endif
+        size_ = 0;
+    }
+
+    void MappedFile::prefetch(s64 offset, s64 size)
+    {
+        if(NULL == data_ || size<=0 || offset<0 || size_<=offset){
+            return;
+        }
+#ifdef _WIN32
+        if(size_<(offset+size)){
+            size = size_ - offset;
+        }
+        WIN32_MEMORY_RANGE_ENTRY entry;
+        entry.VirtualAddress = data_ + offset;
+        entry.NumberOfBytes = static_cast<SIZE_T>(size);
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+#else
+        u8* address;
+        size_t length;
+        getPageRange(address, length, data_, size_, offset, size);
+        madvise(address, length, MADV_WILLNEED);
+#endif
+    }
+
+    void MappedFile::sequential(s64 offset, s64 size)
+    {
+        if(NULL == data_ || size<=0 || offset<0 || size_<=offset){
+            return;
+        }
+#ifndef _WIN32
+        u8* address;
+        size_t length;
+        getPageRange(address, length, data_, size_, offset, size);
+        madvise(address, length, MADV_SEQUENTIAL);
+#endif
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& rhs)
+    {
+        if(this == &rhs){
+            return *this;
+        }
+        close();
+        file_ = rhs.file_;
+#ifdef _WIN32
+        mapping_ = rhs.mapping_;
+        rhs.file_ = INVALID_HANDLE_VALUE;
+        rhs.mapping_ = NULL;
+#else
+        rhs.file_ = -1;
+#endif
+        size_ = rhs.size_;
+        data_ = rhs.data_;
+        rhs.size_ = 0;
+        rhs.data_ = NULL;
+        return *this;
+    }
+}
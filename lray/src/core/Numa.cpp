@@ -0,0 +1,276 @@
+/**
+@file Numa.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/Numa.h"
+#include "core/Allocator.h"
+#include <atomic>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace lray
+{
+namespace
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    //From linux/mempolicy.h, numaif.h of libnuma may not be installed
+    static const s32 MPOL_Bind = 2;
+    static const s32 MPOL_Interleave = 3;
+    static const u32 MPOL_MF_Move = (0x01U<<1);
+
+    static const s32 MaxCpus = CPU_SETSIZE;
+
+    struct Topology
+    {
+        Topology()
+            :numNodes_(1)
+        {
+            for(s32 i=0; i<MaxCpus; ++i){
+                cpuToNode_[i] = 0;
+            }
+            CPU_ZERO(&cpus_[0]);
+            for(s32 i=0; i<MaxCpus; ++i){
+                CPU_SET(i, &cpus_[0]);
+            }
+
+            s32 maxNode = -1;
+            cpu_set_t cpus[Numa::MaxNodes];
+            for(s32 node=0; node<Numa::MaxNodes; ++node){
+                CPU_ZERO(&cpus[node]);
+                Char path[64];
+                snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+                if(!readCpuList(cpus[node], path)){
+                    continue;
+                }
+                maxNode = node;
+            }
+            //Nodes without cpus are kept, their memory is still a target of placements
+            if(maxNode<1){
+                return;
+            }
+            numNodes_ = maxNode + 1;
+            for(s32 node=0; node<numNodes_; ++node){
+                cpus_[node] = cpus[node];
+                for(s32 i=0; i<MaxCpus; ++i){
+                    if(CPU_ISSET(i, &cpus[node])){
+                        cpuToNode_[i] = node;
+                    }
+                }
+            }
+        }
+
+        //Format is like "0-3,8-11"
+        static bool readCpuList(cpu_set_t& cpus, const Char* path)
+        {
+            FILE* file = fopen(path, "rb");
+            if(NULL == file){
+                return false;
+            }
+            s32 first, last;
+            while(1 == fscanf(file, "%d", &first)){
+                last = first;
+                s32 c = fgetc(file);
+                if('-' == c){
+                    if(1 != fscanf(file, "%d", &last)){
+                        break;
+                    }
+                    c = fgetc(file);
+                }
+                for(s32 i=first; i<=last && i<MaxCpus; ++i){
+                    CPU_SET(i, &cpus);
+                }
+                if(',' != c){
+                    break;
+                }
+            }
+            fclose(file);
+            return true;
+        }
+
+        s32 numNodes_;
+        s32 cpuToNode_[MaxCpus];
+        cpu_set_t cpus_[Numa::MaxNodes];
+    };
+
+    const Topology& getTopology()
+    {
+        static Topology topology;
+        return topology;
+    }
+
+    //Round inward to whole pages
+    bool getPageRange(uintptr_t& start, size_t& length, void* ptr, size_t size)
+    {
+        if(NULL == ptr){
+            return false;
+        }
+        uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+        uintptr_t end = begin + size;
+        start = (begin + pageSize - 1) & ~(pageSize - 1);
+        end &= ~(pageSize - 1);
+        if(end<=start){
+            return false;
+        }
+        length = end - start;
+        return true;
+    }
+
+    bool setPolicy(void* ptr, size_t size, s32 mode, const u64* nodeMask)
+    {
+        uintptr_t start;
+        size_t length;
+        if(!getPageRange(start, length, ptr, size)){
+            return false;
+        }
+        return 0 == syscall(SYS_mbind, start, length, mode, nodeMask, static_cast<unsigned long>(Numa::MaxNodes+1), MPOL_MF_Move);
+    }
+#define LRAY_NUMA_LINUX
+#endif
+
+    thread_local s32 pinnedNode_ = -1;
+    std::atomic<bool> pinWorkers_(false);
+}
+
+    const Char* getMemoryPlacementName(MemoryPlacement placement)
+    {
+        static const Char* Names[] =
+        {
+            "Default",
+            "Interleave",
+            "Replicate",
+        };
+        static_assert(sizeof(Names)/sizeof(Names[0]) == MemoryPlacement_Num, "Names must cover placements.");
+        return (0<=placement && placement<MemoryPlacement_Num)? Names[placement] : "Unknown";
+    }
+
+    s32 Numa::getNumNodes()
+    {
+#if defined(LRAY_NUMA_LINUX)
+        return getTopology().numNodes_;
+#else
+        return 1;
+#endif
+    }
+
+    s32 Numa::getThreadNode()
+    {
+        if(0<=pinnedNode_){
+            return pinnedNode_;
+        }
+#if defined(LRAY_NUMA_LINUX)
+        const Topology& topology = getTopology();
+        if(topology.numNodes_<=1){
+            return 0;
+        }
+        s32 cpu = sched_getcpu();
+        return (0<=cpu && cpu<MaxCpus)? topology.cpuToNode_[cpu] : 0;
+#else
+        return 0;
+#endif
+    }
+
+    bool Numa::pinThread(s32 node)
+    {
+        LASSERT(0<=node && node<getNumNodes());
+#if defined(LRAY_NUMA_LINUX)
+        const Topology& topology = getTopology();
+        if(topology.numNodes_<=1 || 0 == CPU_COUNT(&topology.cpus_[node])){
+            return false;
+        }
+        if(0 != sched_setaffinity(0, sizeof(cpu_set_t), &topology.cpus_[node])){
+            return false;
+        }
+        pinnedNode_ = node;
+        return true;
+#else
+        (void)node;
+        return false;
+#endif
+    }
+
+    void Numa::unpinThread()
+    {
+        if(pinnedNode_<0){
+            return;
+        }
+#if defined(LRAY_NUMA_LINUX)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for(s32 i=0; i<MaxCpus; ++i){
+            CPU_SET(i, &cpus);
+        }
+        sched_setaffinity(0, sizeof(cpu_set_t), &cpus);
+#endif
+        pinnedNode_ = -1;
+    }
+
+    void Numa::setPinWorkers(bool pin)
+    {
+        pinWorkers_.store(pin, std::memory_order_relaxed);
+    }
+
+    bool Numa::isPinningWorkers()
+    {
+        return pinWorkers_.load(std::memory_order_relaxed);
+    }
+
+    void Numa::pinWorker(s32 worker, s32 numWorkers)
+    {
+        LASSERT(0<=worker && worker<numWorkers);
+        s32 numNodes = getNumNodes();
+        if(numNodes<=1){
+            return;
+        }
+        pinThread(static_cast<s32>(static_cast<s64>(worker) * numNodes / numWorkers));
+    }
+
+    bool Numa::interleave(void* ptr, size_t size)
+    {
+#if defined(LRAY_NUMA_LINUX)
+        s32 numNodes = getNumNodes();
+        if(numNodes<=1){
+            return false;
+        }
+        u64 nodeMask = (64<=numNodes)? ~0ULL : ((1ULL<<numNodes) - 1);
+        return setPolicy(ptr, size, MPOL_Interleave, &nodeMask);
+#else
+        (void)ptr;
+        (void)size;
+        return false;
+#endif
+    }
+
+    bool Numa::bind(void* ptr, size_t size, s32 node)
+    {
+        LASSERT(0<=node && node<getNumNodes());
+#if defined(LRAY_NUMA_LINUX)
+        if(getNumNodes()<=1){
+            return false;
+        }
+        u64 nodeMask = 1ULL<<node;
+        return setPolicy(ptr, size, MPOL_Bind, &nodeMask);
+#else
+        (void)ptr;
+        (void)size;
+        (void)node;
+        return false;
+#endif
+    }
+
+    bool Numa::interleaveBlock(void* block, size_t size)
+    {
+        return Allocator::isMapped(block) && interleave(block, size);
+    }
+
+    bool Numa::bindBlock(void* block, size_t size, s32 node)
+    {
+        return Allocator::isMapped(block) && bind(block, size, node);
+    }
+}
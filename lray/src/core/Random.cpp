@@ -79,6 +79,78 @@ namespace lray
             return ((counter<<32) | t) ^ other;
         }
 #endif
+
+        //x^(2^64) mod the characteristic polynomial of xorshift128+(23, 18, 5)
+        static const u64 Xorshift128PlusJump[2] = {0x8a5cd789635d2dffULL, 0x121fd2155c472f96ULL};
+
+        inline void stepXorshift128Plus(u64& s0, u64& s1)
+        {
+            u64 x = s0;
+            const u64 y = s1;
+            s0 = y;
+            x ^= x<<23;
+            s1 = x^y^(x>>18)^(y>>5);
+        }
+
+        void jumpXorshift128Plus(u64& s0, u64& s1)
+        {
+            u64 t0 = 0;
+            u64 t1 = 0;
+            for(s32 i=0; i<2; ++i){
+                for(s32 b=0; b<64; ++b){
+                    if(Xorshift128PlusJump[i] & (1ULL<<b)){
+                        t0 ^= s0;
+                        t1 ^= s1;
+                    }
+                    stepXorshift128Plus(s0, s1);
+                }
+            }
+            s0 = t0;
+            s1 = t1;
+        }
+
+        //Lane i of n lanes is the seed's sequence jumped i times
+        void seedLanes(u64* s0, u64* s1, s32 numLanes, u64 seed)
+        {
+            s0[0] = seed;
+            s1[0] = scramble(seed, 1);
+            for(s32 i=1; i<numLanes; ++i){
+                s0[i] = s0[i-1];
+                s1[i] = s1[i-1];
+                jumpXorshift128Plus(s0[i], s1[i]);
+            }
+        }
+
+        void jumpLanes(u64* s0, u64* s1, s32 numLanes)
+        {
+            for(s32 i=0; i<numLanes; ++i){
+                for(s32 j=0; j<numLanes; ++j){
+                    jumpXorshift128Plus(s0[i], s1[i]);
+                }
+            }
+        }
+
+        inline lm128i stepXorshift128Plus(lm128i& s0, lm128i& s1)
+        {
+            lm128i x = s0;
+            const lm128i y = s1;
+            s0 = y;
+            x = _mm_xor_si128(x, _mm_slli_epi64(x, 23));
+            s1 = _mm_xor_si128(_mm_xor_si128(x, y), _mm_xor_si128(_mm_srli_epi64(x, 18), _mm_srli_epi64(y, 5)));
+            return _mm_add_epi64(s1, y);
+        }
+
+#if defined(__AVX2__)
+        inline __m256i stepXorshift128Plus(__m256i& s0, __m256i& s1)
+        {
+            __m256i x = s0;
+            const __m256i y = s1;
+            s0 = y;
+            x = _mm256_xor_si256(x, _mm256_slli_epi64(x, 23));
+            s1 = _mm256_xor_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(_mm256_srli_epi64(x, 18), _mm256_srli_epi64(y, 5)));
+            return _mm256_add_epi64(s1, y);
+        }
+#endif
     }
 
     u32 scramble(u32 v, u32 i)
@@ -383,6 +455,11 @@ LRANDOM_XORSHIFT128PLUS_PROC
         return (*(f64*)&t)- 0.9999999999999998;
     }
 
+    void RandXorshift128Plus::jump()
+    {
+        jumpXorshift128Plus(s0_, s1_);
+    }
+
     void RandXorshift128Plus::swap(RandXorshift128Plus& rhs)
     {
         lray::swap(s0_, rhs.s0_);
@@ -463,6 +540,12 @@ LRANDOM_XORSHIFT128PLUS_PROC
         return rand()*(1.0/4294967295.0); 
     }
 
+    void RandXorshift128Plus32::jump()
+    {
+        jumpXorshift128Plus(s0_, s1_);
+        flag_ = 1;
+    }
+
     void RandXorshift128Plus32::swap(RandXorshift128Plus32& rhs)
     {
         lray::swap(s0_, rhs.s0_);
@@ -471,6 +554,129 @@ LRANDOM_XORSHIFT128PLUS_PROC
         lray::swap(flag_, rhs.flag_);
     }
 
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x4
+    //---
+    //---------------------------------------------
+    RandXorshift128Plus32x4::RandXorshift128Plus32x4()
+    {
+        srand(0x8a5cd789635d2dffULL);
+    }
+
+    RandXorshift128Plus32x4::RandXorshift128Plus32x4(u64 seed)
+    {
+        srand(seed);
+    }
+
+    RandXorshift128Plus32x4::~RandXorshift128Plus32x4()
+    {
+    }
+
+    void RandXorshift128Plus32x4::srand(u64 seed)
+    {
+        LALIGN16 u64 s0[NumLanes];
+        LALIGN16 u64 s1[NumLanes];
+        seedLanes(s0, s1, NumLanes, seed);
+        for(s32 i=0; i<2; ++i){
+            s0_[i] = _mm_load_si128(reinterpret_cast<const lm128i*>(s0+i*2));
+            s1_[i] = _mm_load_si128(reinterpret_cast<const lm128i*>(s1+i*2));
+        }
+    }
+
+    void RandXorshift128Plus32x4::jump()
+    {
+        LALIGN16 u64 s0[NumLanes];
+        LALIGN16 u64 s1[NumLanes];
+        for(s32 i=0; i<2; ++i){
+            _mm_store_si128(reinterpret_cast<lm128i*>(s0+i*2), s0_[i]);
+            _mm_store_si128(reinterpret_cast<lm128i*>(s1+i*2), s1_[i]);
+        }
+        jumpLanes(s0, s1, NumLanes);
+        for(s32 i=0; i<2; ++i){
+            s0_[i] = _mm_load_si128(reinterpret_cast<const lm128i*>(s0+i*2));
+            s1_[i] = _mm_load_si128(reinterpret_cast<const lm128i*>(s1+i*2));
+        }
+    }
+
+    lm128i RandXorshift128Plus32x4::rand()
+    {
+        //Upper halves of 64bit results, which are better than lower ones
+        lm128 r0 = _mm_castsi128_ps(stepXorshift128Plus(s0_[0], s1_[0]));
+        lm128 r1 = _mm_castsi128_ps(stepXorshift128Plus(s0_[1], s1_[1]));
+        return _mm_castps_si128(_mm_shuffle_ps(r0, r1, _MM_SHUFFLE(3,1,3,1)));
+    }
+
+    lm128 RandXorshift128Plus32x4::frand2()
+    {
+        lm128i t = rand();
+        t = _mm_or_si128(_mm_and_si128(t, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000));
+        return _mm_sub_ps(_mm_castsi128_ps(t), _mm_set1_ps(1.0f));
+    }
+
+#if defined(__AVX2__)
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x8
+    //---
+    //---------------------------------------------
+    RandXorshift128Plus32x8::RandXorshift128Plus32x8()
+    {
+        srand(0x8a5cd789635d2dffULL);
+    }
+
+    RandXorshift128Plus32x8::RandXorshift128Plus32x8(u64 seed)
+    {
+        srand(seed);
+    }
+
+    RandXorshift128Plus32x8::~RandXorshift128Plus32x8()
+    {
+    }
+
+    void RandXorshift128Plus32x8::srand(u64 seed)
+    {
+        LALIGN(32) u64 s0[NumLanes];
+        LALIGN(32) u64 s1[NumLanes];
+        seedLanes(s0, s1, NumLanes, seed);
+        for(s32 i=0; i<2; ++i){
+            s0_[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(s0+i*4));
+            s1_[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(s1+i*4));
+        }
+    }
+
+    void RandXorshift128Plus32x8::jump()
+    {
+        LALIGN(32) u64 s0[NumLanes];
+        LALIGN(32) u64 s1[NumLanes];
+        for(s32 i=0; i<2; ++i){
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s0+i*4), s0_[i]);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s1+i*4), s1_[i]);
+        }
+        jumpLanes(s0, s1, NumLanes);
+        for(s32 i=0; i<2; ++i){
+            s0_[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(s0+i*4));
+            s1_[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(s1+i*4));
+        }
+    }
+
+    __m256i RandXorshift128Plus32x8::rand()
+    {
+        __m256 r0 = _mm256_castsi256_ps(stepXorshift128Plus(s0_[0], s1_[0]));
+        __m256 r1 = _mm256_castsi256_ps(stepXorshift128Plus(s0_[1], s1_[1]));
+        //Shuffles are in 128bit lanes, (0 1 4 5 | 2 3 6 7) to (0 1 2 3 | 4 5 6 7)
+        __m256i r = _mm256_castps_si256(_mm256_shuffle_ps(r0, r1, _MM_SHUFFLE(3,1,3,1)));
+        return _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3,1,2,0));
+    }
+
+    __m256 RandXorshift128Plus32x8::frand2()
+    {
+        __m256i t = rand();
+        t = _mm256_or_si256(_mm256_and_si256(t, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000));
+        return _mm256_sub_ps(_mm256_castsi256_ps(t), _mm256_set1_ps(1.0f));
+    }
+#endif
+
     //---------------------------------------------
     //---
     //--- RandWELL
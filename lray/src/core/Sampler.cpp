@@ -0,0 +1,304 @@
+/**
+@file Sampler.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "core/Sampler.h"
+
+namespace lray
+{
+namespace
+{
+    static constexpr f32 OneMinusEpsilon = 0.99999994f;
+
+    //Joe and Kuo, new-joe-kuo-6.21201, 32 bits per dimension
+    static const u32 SobolMatrices[SobolSampler::MaxDimensions][32] =
+    {
+    {
+        0x80000000U, 0x40000000U, 0x20000000U, 0x10000000U, 0x08000000U, 0x04000000U, 0x02000000U, 0x01000000U,
+        0x00800000U, 0x00400000U, 0x00200000U, 0x00100000U, 0x00080000U, 0x00040000U, 0x00020000U, 0x00010000U,
+        0x00008000U, 0x00004000U, 0x00002000U, 0x00001000U, 0x00000800U, 0x00000400U, 0x00000200U, 0x00000100U,
+        0x00000080U, 0x00000040U, 0x00000020U, 0x00000010U, 0x00000008U, 0x00000004U, 0x00000002U, 0x00000001U,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0xA0000000U, 0xF0000000U, 0x88000000U, 0xCC000000U, 0xAA000000U, 0xFF000000U,
+        0x80800000U, 0xC0C00000U, 0xA0A00000U, 0xF0F00000U, 0x88880000U, 0xCCCC0000U, 0xAAAA0000U, 0xFFFF0000U,
+        0x80008000U, 0xC000C000U, 0xA000A000U, 0xF000F000U, 0x88008800U, 0xCC00CC00U, 0xAA00AA00U, 0xFF00FF00U,
+        0x80808080U, 0xC0C0C0C0U, 0xA0A0A0A0U, 0xF0F0F0F0U, 0x88888888U, 0xCCCCCCCCU, 0xAAAAAAAAU, 0xFFFFFFFFU,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0x60000000U, 0x90000000U, 0xE8000000U, 0x5C000000U, 0x8E000000U, 0xC5000000U,
+        0x68800000U, 0x9CC00000U, 0xEE600000U, 0x55900000U, 0x80680000U, 0xC09C0000U, 0x60EE0000U, 0x90550000U,
+        0xE8808000U, 0x5CC0C000U, 0x8E606000U, 0xC5909000U, 0x6868E800U, 0x9C9C5C00U, 0xEEEE8E00U, 0x5555C500U,
+        0x8000E880U, 0xC0005CC0U, 0x60008E60U, 0x9000C590U, 0xE8006868U, 0x5C009C9CU, 0x8E00EEEEU, 0xC5005555U,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0x20000000U, 0x50000000U, 0xF8000000U, 0x74000000U, 0xA2000000U, 0x93000000U,
+        0xD8800000U, 0x25400000U, 0x59E00000U, 0xE6D00000U, 0x78080000U, 0xB40C0000U, 0x82020000U, 0xC3050000U,
+        0x208F8000U, 0x51474000U, 0xFBEA2000U, 0x75D93000U, 0xA0858800U, 0x914E5400U, 0xDBE79E00U, 0x25DB6D00U,
+        0x58800080U, 0xE54000C0U, 0x79E00020U, 0xB6D00050U, 0x800800F8U, 0xC00C0074U, 0x200200A2U, 0x50050093U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0x20000000U, 0xB0000000U, 0xF8000000U, 0xDC000000U, 0x7A000000U, 0x9D000000U,
+        0x5A800000U, 0x2FC00000U, 0xA1600000U, 0xF0B00000U, 0xDA880000U, 0x6FC40000U, 0x81620000U, 0x40BB0000U,
+        0x22878000U, 0xB3C9C000U, 0xFB65A000U, 0xDDB2D000U, 0x78022800U, 0x9C0B3C00U, 0x5A0FB600U, 0x2D0DDB00U,
+        0xA2878080U, 0xF3C9C040U, 0xDB65A020U, 0x6DB2D0B0U, 0x800228F8U, 0x400B3CDCU, 0x200FB67AU, 0xB00DDB9DU,
+    },
+    {
+        0x80000000U, 0x40000000U, 0x60000000U, 0x30000000U, 0xC8000000U, 0x24000000U, 0x56000000U, 0xFB000000U,
+        0xE0800000U, 0x70400000U, 0xA8600000U, 0x14300000U, 0x9EC80000U, 0xDF240000U, 0xB6D60000U, 0x8BBB0000U,
+        0x48008000U, 0x64004000U, 0x36006000U, 0xCB003000U, 0x2880C800U, 0x54402400U, 0xFE605600U, 0xEF30FB00U,
+        0x7E48E080U, 0xAF647040U, 0x1EB6A860U, 0x9F8B1430U, 0xD6C81EC8U, 0xBB249F24U, 0x80D6D6D6U, 0x40BBBBBBU,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0xA0000000U, 0xD0000000U, 0x58000000U, 0x94000000U, 0x3E000000U, 0xE3000000U,
+        0xBE800000U, 0x23C00000U, 0x1E200000U, 0xF3100000U, 0x46780000U, 0x67840000U, 0x78460000U, 0x84670000U,
+        0xC6788000U, 0xA784C000U, 0xD846A000U, 0x5467D000U, 0x9E78D800U, 0x33845400U, 0xE6469E00U, 0xB7673300U,
+        0x20F86680U, 0x104477C0U, 0xF8668020U, 0x4477C010U, 0x668020F8U, 0x77C01044U, 0x8020F866U, 0xC0104477U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0xA0000000U, 0x50000000U, 0x88000000U, 0x24000000U, 0x12000000U, 0x2D000000U,
+        0x76800000U, 0x9E400000U, 0x08200000U, 0x64100000U, 0xB2280000U, 0x7D140000U, 0xFEA20000U, 0xBA490000U,
+        0x1A248000U, 0x491B4000U, 0xC4B5A000U, 0xE3739000U, 0xF6800800U, 0xDE400400U, 0xA8200A00U, 0x34100500U,
+        0x3A280880U, 0x59140240U, 0xECA20120U, 0x974902D0U, 0x6CA48768U, 0xD75B49E4U, 0xCC95A082U, 0x87639641U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0xA0000000U, 0x50000000U, 0x28000000U, 0xD4000000U, 0x6A000000U, 0x71000000U,
+        0x38800000U, 0x58400000U, 0xEA200000U, 0x31100000U, 0x98A80000U, 0x08540000U, 0xC22A0000U, 0xE5250000U,
+        0xF2B28000U, 0x79484000U, 0xFAA42000U, 0xBD731000U, 0x18A80800U, 0x48540400U, 0x622A0A00U, 0xB5250500U,
+        0xDAB28280U, 0xAD484D40U, 0x90A426A0U, 0xCC731710U, 0x20280B88U, 0x10140184U, 0x880A04A2U, 0x84350611U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0xE0000000U, 0xB0000000U, 0x98000000U, 0x94000000U, 0x8A000000U, 0x5B000000U,
+        0x33800000U, 0xD9C00000U, 0x72200000U, 0x3F100000U, 0xC1B80000U, 0xA6EC0000U, 0x53860000U, 0x29F50000U,
+        0x0A3A8000U, 0x1B2AC000U, 0xD392E000U, 0x69FF7000U, 0xEA380800U, 0xAB2C0400U, 0x4BA60E00U, 0xFDE50B00U,
+        0x60028980U, 0xF006C940U, 0x7834E8A0U, 0x241A75B0U, 0x123A8B38U, 0xCF2AC99CU, 0xB992E922U, 0x82FF78F1U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0xA0000000U, 0x10000000U, 0x08000000U, 0x6C000000U, 0x9E000000U, 0x23000000U,
+        0x57800000U, 0xADC00000U, 0x7FA00000U, 0x91D00000U, 0x49880000U, 0xCED40000U, 0x880A0000U, 0x2C0F0000U,
+        0x3E0D8000U, 0x3317C000U, 0x5FB06000U, 0xC1F8B000U, 0xE18D8800U, 0xB2D7C400U, 0x1E106A00U, 0x6328B100U,
+        0xF7858880U, 0xBDC3C2C0U, 0x77BA63E0U, 0xFDF7B330U, 0xD7800DF8U, 0xEDC0081CU, 0xDFA0041AU, 0x81D00A2DU,
+    },
+    {
+        0x80000000U, 0x40000000U, 0x20000000U, 0x30000000U, 0x58000000U, 0xAC000000U, 0x96000000U, 0x2B000000U,
+        0xD4800000U, 0x09400000U, 0xE2A00000U, 0x52500000U, 0x4E280000U, 0xC71C0000U, 0x629E0000U, 0x12670000U,
+        0x6E138000U, 0xF731C000U, 0x3A98A000U, 0xBE449000U, 0xF83B8800U, 0xDC2DC400U, 0xEE06A200U, 0xB7239300U,
+        0x1AA80D80U, 0x8E5C0EC0U, 0xA03E0B60U, 0x703701B0U, 0x783B88C8U, 0x9C2DCA54U, 0xCE06A74AU, 0x87239795U,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0xA0000000U, 0x50000000U, 0xF8000000U, 0x8C000000U, 0xE2000000U, 0x33000000U,
+        0x0F800000U, 0x21400000U, 0x95A00000U, 0x5E700000U, 0xD8080000U, 0x1C240000U, 0xBA160000U, 0xEF370000U,
+        0x15868000U, 0x9E6FC000U, 0x781B6000U, 0x4C349000U, 0x420E8800U, 0x630BCC00U, 0xF7AD6A00U, 0xAD739500U,
+        0x77800780U, 0x6D4004C0U, 0xD7A00420U, 0x3D700630U, 0x2F880F78U, 0xB1640AD4U, 0xCDB6077AU, 0x824706D7U,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0x60000000U, 0x90000000U, 0x38000000U, 0xC4000000U, 0x42000000U, 0xA3000000U,
+        0xF1800000U, 0xAA400000U, 0xFCE00000U, 0x85100000U, 0xE0080000U, 0x500C0000U, 0x58060000U, 0x54090000U,
+        0x7A038000U, 0x670C4000U, 0xB3842000U, 0x094A3000U, 0x0D6F1800U, 0x2F5AA400U, 0x1CE7CE00U, 0xD5145100U,
+        0xB8000080U, 0x040000C0U, 0x22000060U, 0x33000090U, 0xC9800038U, 0x6E4000C4U, 0xBEE00042U, 0x261000A3U,
+    },
+    {
+        0x80000000U, 0x40000000U, 0x20000000U, 0xF0000000U, 0xA8000000U, 0x54000000U, 0x9A000000U, 0x9D000000U,
+        0x1E800000U, 0x5CC00000U, 0x7D200000U, 0x8D100000U, 0x24880000U, 0x71C40000U, 0xEBA20000U, 0x75DF0000U,
+        0x6BA28000U, 0x35D14000U, 0x4BA3A000U, 0xC5D2D000U, 0xE3A16800U, 0x91DB8C00U, 0x79AEF200U, 0x0CDF4100U,
+        0x672A8080U, 0x50154040U, 0x1A01A020U, 0xDD0DD0F0U, 0x3E83E8A8U, 0xACCACC54U, 0xD52D529AU, 0xD91D919DU,
+    },
+    {
+        0x80000000U, 0xC0000000U, 0x20000000U, 0xD0000000U, 0xD8000000U, 0xC4000000U, 0x46000000U, 0x85000000U,
+        0xA5800000U, 0x76C00000U, 0xADA00000U, 0x6AB00000U, 0x2DA80000U, 0xAABC0000U, 0x0DAA0000U, 0x7AB10000U,
+        0xD5A78000U, 0xBEBD4000U, 0x93A3E000U, 0x3BB51000U, 0x3629B800U, 0x4D727C00U, 0x9B836200U, 0x27C4D700U,
+        0xB629B880U, 0x8D727CC0U, 0xBB836220U, 0xF7C4D7D0U, 0x6E29B858U, 0x49727C04U, 0xFD836266U, 0x72C4D755U,
+    },
+    };
+
+    static const u32 Primes[HaltonSampler::MaxDimensions] =
+    {
+        2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    };
+
+    //Wellons' lowbias32
+    inline u32 hash(u32 x)
+    {
+        x ^= x >> 16;
+        x *= 0x7FEB352DU;
+        x ^= x >> 15;
+        x *= 0x846CA68BU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    inline u32 hashCombine(u32 seed, u32 v)
+    {
+        return hash(seed ^ (v + 0x9E3779B9U + (seed<<6) + (seed>>2)));
+    }
+
+    inline u32 hashPixel(s32 x, s32 y, u32 seed)
+    {
+        return hashCombine(hashCombine(hash(seed), static_cast<u32>(x)), static_cast<u32>(y));
+    }
+
+    //0.32 fixed point to [0, 1)
+    inline f32 toF32(u32 x)
+    {
+        return static_cast<f32>(x>>8) * (1.0f/16777216.0f);
+    }
+
+    inline u32 laineKarrasPermutation(u32 x, u32 seed)
+    {
+        x += seed;
+        x ^= x * 0x6C50B47CU;
+        x ^= x * 0xB82F1E52U;
+        x ^= x * 0xC7AFE638U;
+        x ^= x * 0x8D22F6E6U;
+        return x;
+    }
+
+    //Permute each digit by a hash of the digits before, which is Owen scrambling in base b
+    f32 scrambledRadicalInverse(u32 base, u32 index, u32 seed)
+    {
+        const f64 invBase = 1.0/base;
+        f64 invBaseN = 1.0;
+        f64 value = 0.0;
+        u32 prefix = seed;
+        //Digits are needed after the index runs out, until they are under float precision
+        while(1.0e-8<invBaseN){
+            u32 digit = index % base;
+            index /= base;
+            u32 permuted = (digit + hash(prefix)) % base;
+            invBaseN *= invBase;
+            value += permuted*invBaseN;
+            prefix = hashCombine(prefix, digit);
+        }
+        return minimum(static_cast<f32>(value), OneMinusEpsilon);
+    }
+
+    //Korobov generator (1, a, a^2, ...) mod 2^32
+    inline u32 latticeGenerator(u32 dimension)
+    {
+        u32 generator = 1;
+        u32 a = 0x9E3779B9U;
+        for(; 0 != dimension; dimension >>= 1){
+            if(dimension & 1){
+                generator *= a;
+            }
+            a *= a;
+        }
+        return generator;
+    }
+}
+
+    u32 reverseBits(u32 x)
+    {
+        x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+        x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+        x = ((x >> 4) & 0x0F0F0F0FU) | ((x & 0x0F0F0F0FU) << 4);
+        x = ((x >> 8) & 0x00FF00FFU) | ((x & 0x00FF00FFU) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    u32 nestedUniformScramble(u32 x, u32 seed)
+    {
+        x = reverseBits(x);
+        x = laineKarrasPermutation(x, seed);
+        return reverseBits(x);
+    }
+
+    //---------------------------------------------
+    //---
+    //--- SobolSampler
+    //---
+    //---------------------------------------------
+    SobolSampler::SobolSampler(s32 x, s32 y, u32 seed)
+        :seed_(hashPixel(x, y, seed))
+    {
+    }
+
+    f32 SobolSampler::get1D(u32 index, u32 dimension) const
+    {
+        //Each group of dimensions has its own order of samples, not to correlate with the others
+        u32 seed = hashCombine(seed_, dimension/MaxDimensions);
+        u32 shuffled = nestedUniformScramble(index, seed);
+        u32 x = sobol(shuffled, dimension%MaxDimensions);
+        return toF32(nestedUniformScramble(x, hashCombine(seed, dimension)));
+    }
+
+    void SobolSampler::get2D(f32& x, f32& y, u32 index, u32 dimension) const
+    {
+        x = get1D(index, dimension);
+        y = get1D(index, dimension+1);
+    }
+
+    u32 SobolSampler::sobol(u32 index, u32 dimension)
+    {
+        LASSERT(dimension<MaxDimensions);
+        const u32* matrix = SobolMatrices[dimension];
+        u32 x = 0;
+        for(u32 i=0; 0 != index; index >>= 1, ++i){
+            if(index & 1){
+                x ^= matrix[i];
+            }
+        }
+        return x;
+    }
+
+    //---------------------------------------------
+    //---
+    //--- HaltonSampler
+    //---
+    //---------------------------------------------
+    HaltonSampler::HaltonSampler(s32 x, s32 y, u32 seed)
+        :seed_(hashPixel(x, y, seed))
+    {
+    }
+
+    f32 HaltonSampler::get1D(u32 index, u32 dimension) const
+    {
+        return scrambledRadicalInverse(Primes[dimension%MaxDimensions], index, hashCombine(seed_, dimension));
+    }
+
+    void HaltonSampler::get2D(f32& x, f32& y, u32 index, u32 dimension) const
+    {
+        x = get1D(index, dimension);
+        y = get1D(index, dimension+1);
+    }
+
+    f32 HaltonSampler::halton(u32 index, u32 dimension)
+    {
+        LASSERT(dimension<MaxDimensions);
+        const u32 base = Primes[dimension];
+        const f64 invBase = 1.0/base;
+        f64 invBaseN = 1.0;
+        f64 value = 0.0;
+        for(; 0 != index; index /= base){
+            invBaseN *= invBase;
+            value += (index % base)*invBaseN;
+        }
+        return minimum(static_cast<f32>(value), OneMinusEpsilon);
+    }
+
+    //---------------------------------------------
+    //---
+    //--- LatticeSampler
+    //---
+    //---------------------------------------------
+    LatticeSampler::LatticeSampler(s32 x, s32 y, u32 seed)
+        :shift_(static_cast<u32>(x)*0xC13FA9A9U + static_cast<u32>(y)*0x91E10DA5U)
+        ,seed_(hash(seed))
+    {
+    }
+
+    f32 LatticeSampler::get1D(u32 index, u32 dimension) const
+    {
+        //Radical inverse of the index makes the lattice extensible, every power of two of samples is a full lattice.
+        //Dimensions rotate by the same pixel shift with their own offsets, which keeps blue noise in each dimension.
+        u32 x = reverseBits(index)*latticeGenerator(dimension) + shift_ + hashCombine(seed_, dimension);
+        return toF32(x);
+    }
+
+    void LatticeSampler::get2D(f32& x, f32& y, u32 index, u32 dimension) const
+    {
+        x = get1D(index, dimension);
+        y = get1D(index, dimension+1);
+    }
+}
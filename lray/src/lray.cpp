@@ -4,6 +4,7 @@
 @date 2017/12/13 create
 */
 #include "lray.h"
+#include "core/Allocator.h"
 #ifdef _WIN32
 #include <Windows.h>
 #endif
@@ -56,41 +57,32 @@ namespace lray
     //---------------------------------------------------------
     void* lmalloc(size_t size)
     {
-        return malloc(size);
+        return Allocator::allocate(size, SSE_ALIGN, NULL, 0);
     }
 
     void* lmalloc(size_t size, u32 alignment)
     {
-#ifdef _MSC_VER
-        return _aligned_malloc(size, alignment);
-#else
-        void* memptr = NULL;
-        return 0==posix_memalign(&memptr, alignment, size)? memptr : NULL;
-#endif
+        return Allocator::allocate(size, alignment, NULL, 0);
     }
 
     void lfree(void* ptr)
     {
-        free(ptr);
+        Allocator::deallocate(ptr);
     }
 
     void lfree(void* ptr, u32 /*alignment*/)
     {
-#ifdef _MSC_VER
-        _aligned_free(ptr);
-#else
-        free(ptr);
-#endif
+        Allocator::deallocate(ptr);
     }
 
-    void* lmalloc(size_t size, const Char* /*file*/, s32 /*line*/)
+    void* lmalloc(size_t size, const Char* file, s32 line)
     {
-        return lmalloc(size);
+        return Allocator::allocate(size, SSE_ALIGN, file, line);
     }
 
-    void* lmalloc(size_t size, u32 alignment, const Char* /*file*/, s32 /*line*/)
+    void* lmalloc(size_t size, u32 alignment, const Char* file, s32 line)
     {
-        return lmalloc(size, alignment);
+        return Allocator::allocate(size, alignment, file, line);
     }
 
     //--- Utilities
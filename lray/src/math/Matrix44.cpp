@@ -33,6 +33,170 @@ namespace
 }
 #endif
 
+namespace
+{
+#if defined(__AVX__)
+    struct Lanes
+    {
+        static const s32 Width = 8;
+        typedef __m256 Type;
+
+        static inline Type set1(f32 x){ return _mm256_set1_ps(x);}
+        static inline Type load(const f32* x){ return _mm256_load_ps(x);}
+        static inline void store(f32* dst, Type x){ _mm256_store_ps(dst, x);}
+        static inline Type add(Type x0, Type x1){ return _mm256_add_ps(x0, x1);}
+        static inline Type sub(Type x0, Type x1){ return _mm256_sub_ps(x0, x1);}
+        static inline Type mul(Type x0, Type x1){ return _mm256_mul_ps(x0, x1);}
+        static inline Type div(Type x0, Type x1){ return _mm256_div_ps(x0, x1);}
+#if defined(__FMA__)
+        static inline Type madd(Type x0, Type x1, Type x2){ return _mm256_fmadd_ps(x0, x1, x2);}
+        static inline Type msub(Type x0, Type x1, Type x2){ return _mm256_fmsub_ps(x0, x1, x2);}
+#else
+        static inline Type madd(Type x0, Type x1, Type x2){ return _mm256_add_ps(_mm256_mul_ps(x0, x1), x2);}
+        static inline Type msub(Type x0, Type x1, Type x2){ return _mm256_sub_ps(_mm256_mul_ps(x0, x1), x2);}
+#endif
+    };
+#else
+    struct Lanes
+    {
+        static const s32 Width = 4;
+        typedef lm128 Type;
+
+        static inline Type set1(f32 x){ return _mm_set1_ps(x);}
+        static inline Type load(const f32* x){ return _mm_load_ps(x);}
+        static inline void store(f32* dst, Type x){ _mm_store_ps(dst, x);}
+        static inline Type add(Type x0, Type x1){ return _mm_add_ps(x0, x1);}
+        static inline Type sub(Type x0, Type x1){ return _mm_sub_ps(x0, x1);}
+        static inline Type mul(Type x0, Type x1){ return _mm_mul_ps(x0, x1);}
+        static inline Type div(Type x0, Type x1){ return _mm_div_ps(x0, x1);}
+        static inline Type madd(Type x0, Type x1, Type x2){ return _mm_add_ps(_mm_mul_ps(x0, x1), x2);}
+        static inline Type msub(Type x0, Type x1, Type x2){ return _mm_sub_ps(_mm_mul_ps(x0, x1), x2);}
+    };
+#endif
+    static_assert(0 == (Matrix44SoA::Width % Lanes::Width), "Matrix44SoA::Width must be a multiple of Lanes::Width.");
+
+    //x0*y0 - x1*y1
+    inline Lanes::Type det2(Lanes::Type x0, Lanes::Type y0, Lanes::Type x1, Lanes::Type y1)
+    {
+        return Lanes::msub(x0, y0, Lanes::mul(x1, y1));
+    }
+
+    //x0*y0 - x1*y1 + x2*y2
+    inline Lanes::Type cofactor(Lanes::Type x0, Lanes::Type y0, Lanes::Type x1, Lanes::Type y1, Lanes::Type x2, Lanes::Type y2)
+    {
+        return Lanes::madd(x2, y2, det2(x0, y0, x1, y1));
+    }
+
+    static_assert(sizeof(Vector3) == sizeof(f32)*3, "Vector3 must be packed.");
+
+    //Deinterleave four points into x, y, z
+    inline void load4(lm128& x, lm128& y, lm128& z, const Vector3* src)
+    {
+        const f32* p = &src[0].x_;
+        lm128 a = _mm_loadu_ps(p+0); //x0 y0 z0 x1
+        lm128 b = _mm_loadu_ps(p+4); //y1 z1 x2 y2
+        lm128 c = _mm_loadu_ps(p+8); //z2 x3 y3 z3
+        x = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,1,3,0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,1,0));
+        y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+        z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+    }
+
+    inline void store4(Vector3* dst, lm128 x, lm128 y, lm128 z)
+    {
+        f32* p = &dst[0].x_;
+        lm128 a = _mm_shuffle_ps(_mm_unpacklo_ps(x, y), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,1,0));
+        lm128 b = _mm_shuffle_ps(_mm_unpacklo_ps(y, z), _mm_unpackhi_ps(x, y), _MM_SHUFFLE(1,0,3,2));
+        lm128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3,3,2,2)), _mm_unpackhi_ps(y, z), _MM_SHUFFLE(3,2,2,0));
+        _mm_storeu_ps(p+0, a);
+        _mm_storeu_ps(p+4, b);
+        _mm_storeu_ps(p+8, c);
+    }
+
+    //Lanes::Width points in structure of arrays
+    inline void loadPoints(Lanes::Type& x, Lanes::Type& y, Lanes::Type& z, const Vector3* src)
+    {
+#if defined(__AVX__)
+        lm128 x0, y0, z0, x1, y1, z1;
+        load4(x0, y0, z0, src);
+        load4(x1, y1, z1, src+4);
+        x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+        y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+        z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+#else
+        load4(x, y, z, src);
+#endif
+    }
+
+    inline void storePoints(Vector3* dst, Lanes::Type x, Lanes::Type y, Lanes::Type z)
+    {
+#if defined(__AVX__)
+        store4(dst, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+        store4(dst+4, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+#else
+        store4(dst, x, y, z);
+#endif
+    }
+
+    //Less than Lanes::Width points through a buffer
+    inline void loadPoints(Lanes::Type& x, Lanes::Type& y, Lanes::Type& z, s32 count, const Vector3* src)
+    {
+        LALIGN(32) f32 xyz[3][Lanes::Width] = {};
+        for(s32 i=0; i<count; ++i){
+            xyz[0][i] = src[i].x_;
+            xyz[1][i] = src[i].y_;
+            xyz[2][i] = src[i].z_;
+        }
+        x = Lanes::load(xyz[0]);
+        y = Lanes::load(xyz[1]);
+        z = Lanes::load(xyz[2]);
+    }
+
+    inline void storePoints(Vector3* dst, s32 count, Lanes::Type x, Lanes::Type y, Lanes::Type z)
+    {
+        LALIGN(32) f32 xyz[3][Lanes::Width];
+        Lanes::store(xyz[0], x);
+        Lanes::store(xyz[1], y);
+        Lanes::store(xyz[2], z);
+        for(s32 i=0; i<count; ++i){
+            dst[i].x_ = xyz[0][i];
+            dst[i].y_ = xyz[1][i];
+            dst[i].z_ = xyz[2][i];
+        }
+    }
+
+    inline void transformPoints(Lanes::Type& x, Lanes::Type& y, Lanes::Type& z, const Lanes::Type columns[4][4])
+    {
+        Lanes::Type p[4];
+        for(s32 r=0; r<4; ++r){
+            p[r] = Lanes::madd(columns[r][0], x, Lanes::madd(columns[r][1], y, Lanes::madd(columns[r][2], z, columns[r][3])));
+        }
+        Lanes::Type invW = Lanes::div(Lanes::set1(1.0f), p[3]);
+        x = Lanes::mul(p[0], invW);
+        y = Lanes::mul(p[1], invW);
+        z = Lanes::mul(p[2], invW);
+    }
+
+    inline void transformVectors(Lanes::Type& x, Lanes::Type& y, Lanes::Type& z, const Lanes::Type columns[4][4])
+    {
+        Lanes::Type p[3];
+        for(s32 r=0; r<3; ++r){
+            p[r] = Lanes::madd(columns[r][0], x, Lanes::madd(columns[r][1], y, Lanes::mul(columns[r][2], z)));
+        }
+        x = p[0];
+        y = p[1];
+        z = p[2];
+    }
+
+    inline void broadcast(Lanes::Type columns[4][4], const Matrix44& m)
+    {
+        for(s32 r=0; r<4; ++r){
+            for(s32 c=0; c<4; ++c){
+                columns[r][c] = Lanes::set1(m.m_[r][c]);
+            }
+        }
+    }
+}
+
     //--------------------------------------------
     //---
     //--- Matrix44
@@ -1749,4 +1913,273 @@ namespace
         invproj.m_[2][0] = 0.0f; invproj.m_[2][1] = 0.0f; invproj.m_[2][2] = 1.0f/invDepth; invproj.m_[2][3] = znear;
         invproj.m_[3][0] = 0.0f; invproj.m_[3][1] = 0.0f; invproj.m_[3][2] = 0.0f; invproj.m_[3][3] = 1.0f;
     }
+
+    //------------------------------------------------------------------------------------------------
+    void mul(s32 count, Matrix44* dst, const Matrix44* m0, const Matrix44* m1)
+    {
+        LASSERT(0<=count);
+#if defined(__AVX__)
+        //Two rows at once, each half multiplies the rows of m1 by elements of its row
+        for(s32 i=0; i<count; ++i){
+            __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const lm128*>(m1[i].m_[0]));
+            __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const lm128*>(m1[i].m_[1]));
+            __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const lm128*>(m1[i].m_[2]));
+            __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const lm128*>(m1[i].m_[3]));
+            __m256 a01 = _mm256_loadu_ps(m0[i].m_[0]);
+            __m256 a23 = _mm256_loadu_ps(m0[i].m_[2]);
+
+            __m256 r01 = Lanes::mul(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(0,0,0,0)), b0);
+            __m256 r23 = Lanes::mul(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(0,0,0,0)), b0);
+            r01 = Lanes::madd(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(1,1,1,1)), b1, r01);
+            r23 = Lanes::madd(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(1,1,1,1)), b1, r23);
+            r01 = Lanes::madd(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(2,2,2,2)), b2, r01);
+            r23 = Lanes::madd(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(2,2,2,2)), b2, r23);
+            r01 = Lanes::madd(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(3,3,3,3)), b3, r01);
+            r23 = Lanes::madd(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(3,3,3,3)), b3, r23);
+
+            _mm256_storeu_ps(dst[i].m_[0], r01);
+            _mm256_storeu_ps(dst[i].m_[2], r23);
+        }
+#else
+        for(s32 i=0; i<count; ++i){
+            dst[i].mul(m0[i], m1[i]);
+        }
+#endif
+    }
+
+    void invert(s32 count, Matrix44* dst, const Matrix44* src)
+    {
+        LASSERT(0<=count);
+        Matrix44SoA block;
+        for(s32 i=0; i<count; i+=Matrix44SoA::Width){
+            s32 n = minimum(count-i, Matrix44SoA::Width);
+            block.set(n, src+i);
+            block.getInvert(block);
+            block.get(n, dst+i);
+        }
+    }
+
+    void mul(s32 count, Vector3* dst, const Matrix44& m, const Vector3* src)
+    {
+        LASSERT(0<=count);
+        Lanes::Type columns[4][4];
+        broadcast(columns, m);
+
+        Lanes::Type x, y, z;
+        s32 end = count - (count % Lanes::Width);
+        for(s32 i=0; i<end; i+=Lanes::Width){
+            loadPoints(x, y, z, src+i);
+            transformPoints(x, y, z, columns);
+            storePoints(dst+i, x, y, z);
+        }
+        if(end<count){
+            loadPoints(x, y, z, count-end, src+end);
+            transformPoints(x, y, z, columns);
+            storePoints(dst+end, count-end, x, y, z);
+        }
+    }
+
+    void mul33(s32 count, Vector3* dst, const Matrix44& m, const Vector3* src)
+    {
+        LASSERT(0<=count);
+        Lanes::Type columns[4][4];
+        broadcast(columns, m);
+
+        Lanes::Type x, y, z;
+        s32 end = count - (count % Lanes::Width);
+        for(s32 i=0; i<end; i+=Lanes::Width){
+            loadPoints(x, y, z, src+i);
+            transformVectors(x, y, z, columns);
+            storePoints(dst+i, x, y, z);
+        }
+        if(end<count){
+            loadPoints(x, y, z, count-end, src+end);
+            transformVectors(x, y, z, columns);
+            storePoints(dst+end, count-end, x, y, z);
+        }
+    }
+
+    //--------------------------------------------
+    //---
+    //--- Matrix44SoA
+    //---
+    //--------------------------------------------
+    void Matrix44SoA::set(s32 count, const Matrix44* src)
+    {
+        LASSERT(0<=count && count<=Width);
+        if(Width == count){
+            //Transpose the same rows of four matrices at once
+            for(s32 i=0; i<Width; i+=4){
+                for(s32 r=0; r<4; ++r){
+                    lm128 c0 = _mm_loadu_ps(src[i+0].m_[r]);
+                    lm128 c1 = _mm_loadu_ps(src[i+1].m_[r]);
+                    lm128 c2 = _mm_loadu_ps(src[i+2].m_[r]);
+                    lm128 c3 = _mm_loadu_ps(src[i+3].m_[r]);
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                    _mm_store_ps(&m_[r][0][i], c0);
+                    _mm_store_ps(&m_[r][1][i], c1);
+                    _mm_store_ps(&m_[r][2][i], c2);
+                    _mm_store_ps(&m_[r][3][i], c3);
+                }
+            }
+            return;
+        }
+        for(s32 r=0; r<4; ++r){
+            for(s32 c=0; c<4; ++c){
+                s32 i=0;
+                for(; i<count; ++i){
+                    m_[r][c][i] = src[i].m_[r][c];
+                }
+                f32 value = (r == c)? 1.0f : 0.0f;
+                for(; i<Width; ++i){
+                    m_[r][c][i] = value;
+                }
+            }
+        }
+    }
+
+    void Matrix44SoA::get(s32 count, Matrix44* dst) const
+    {
+        LASSERT(0<=count && count<=Width);
+        if(Width == count){
+            for(s32 i=0; i<Width; i+=4){
+                for(s32 r=0; r<4; ++r){
+                    lm128 c0 = _mm_load_ps(&m_[r][0][i]);
+                    lm128 c1 = _mm_load_ps(&m_[r][1][i]);
+                    lm128 c2 = _mm_load_ps(&m_[r][2][i]);
+                    lm128 c3 = _mm_load_ps(&m_[r][3][i]);
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                    _mm_storeu_ps(dst[i+0].m_[r], c0);
+                    _mm_storeu_ps(dst[i+1].m_[r], c1);
+                    _mm_storeu_ps(dst[i+2].m_[r], c2);
+                    _mm_storeu_ps(dst[i+3].m_[r], c3);
+                }
+            }
+            return;
+        }
+        for(s32 i=0; i<count; ++i){
+            for(s32 r=0; r<4; ++r){
+                for(s32 c=0; c<4; ++c){
+                    dst[i].m_[r][c] = m_[r][c][i];
+                }
+            }
+        }
+    }
+
+    void Matrix44SoA::mul(const Matrix44SoA& m0, const Matrix44SoA& m1)
+    {
+        for(s32 l=0; l<Width; l+=Lanes::Width){
+            Lanes::Type b[4][4];
+            for(s32 r=0; r<4; ++r){
+                for(s32 c=0; c<4; ++c){
+                    b[r][c] = Lanes::load(&m1.m_[r][c][l]);
+                }
+            }
+            for(s32 r=0; r<4; ++r){
+                Lanes::Type a0 = Lanes::load(&m0.m_[r][0][l]);
+                Lanes::Type a1 = Lanes::load(&m0.m_[r][1][l]);
+                Lanes::Type a2 = Lanes::load(&m0.m_[r][2][l]);
+                Lanes::Type a3 = Lanes::load(&m0.m_[r][3][l]);
+                for(s32 c=0; c<4; ++c){
+                    Lanes::Type t = Lanes::madd(a0, b[0][c], Lanes::madd(a1, b[1][c], Lanes::madd(a2, b[2][c], Lanes::mul(a3, b[3][c]))));
+                    Lanes::store(&m_[r][c][l], t);
+                }
+            }
+        }
+    }
+
+    void Matrix44SoA::getInvert(Matrix44SoA& dst) const
+    {
+        for(s32 l=0; l<Width; l+=Lanes::Width){
+            Lanes::Type a[4][4];
+            for(s32 r=0; r<4; ++r){
+                for(s32 c=0; c<4; ++c){
+                    a[r][c] = Lanes::load(&m_[r][c][l]);
+                }
+            }
+
+            //2x2 determinants of the upper and the lower two rows
+            Lanes::Type s0 = det2(a[0][0], a[1][1], a[1][0], a[0][1]);
+            Lanes::Type s1 = det2(a[0][0], a[1][2], a[1][0], a[0][2]);
+            Lanes::Type s2 = det2(a[0][0], a[1][3], a[1][0], a[0][3]);
+            Lanes::Type s3 = det2(a[0][1], a[1][2], a[1][1], a[0][2]);
+            Lanes::Type s4 = det2(a[0][1], a[1][3], a[1][1], a[0][3]);
+            Lanes::Type s5 = det2(a[0][2], a[1][3], a[1][2], a[0][3]);
+
+            Lanes::Type c0 = det2(a[2][0], a[3][1], a[3][0], a[2][1]);
+            Lanes::Type c1 = det2(a[2][0], a[3][2], a[3][0], a[2][2]);
+            Lanes::Type c2 = det2(a[2][0], a[3][3], a[3][0], a[2][3]);
+            Lanes::Type c3 = det2(a[2][1], a[3][2], a[3][1], a[2][2]);
+            Lanes::Type c4 = det2(a[2][1], a[3][3], a[3][1], a[2][3]);
+            Lanes::Type c5 = det2(a[2][2], a[3][3], a[3][2], a[2][3]);
+
+            Lanes::Type det = Lanes::add(det2(s0, c5, s1, c4), det2(s2, c3, s4, c1));
+            det = Lanes::madd(s3, c2, Lanes::madd(s5, c0, det));
+            Lanes::Type invDet = Lanes::div(Lanes::set1(1.0f), det);
+            Lanes::Type negInvDet = Lanes::sub(Lanes::set1(0.0f), invDet);
+
+            Lanes::Type b[4][4];
+            b[0][0] = Lanes::mul(cofactor(a[1][1], c5, a[1][2], c4, a[1][3], c3), invDet);
+            b[0][1] = Lanes::mul(cofactor(a[0][1], c5, a[0][2], c4, a[0][3], c3), negInvDet);
+            b[0][2] = Lanes::mul(cofactor(a[3][1], s5, a[3][2], s4, a[3][3], s3), invDet);
+            b[0][3] = Lanes::mul(cofactor(a[2][1], s5, a[2][2], s4, a[2][3], s3), negInvDet);
+
+            b[1][0] = Lanes::mul(cofactor(a[1][0], c5, a[1][2], c2, a[1][3], c1), negInvDet);
+            b[1][1] = Lanes::mul(cofactor(a[0][0], c5, a[0][2], c2, a[0][3], c1), invDet);
+            b[1][2] = Lanes::mul(cofactor(a[3][0], s5, a[3][2], s2, a[3][3], s1), negInvDet);
+            b[1][3] = Lanes::mul(cofactor(a[2][0], s5, a[2][2], s2, a[2][3], s1), invDet);
+
+            b[2][0] = Lanes::mul(cofactor(a[1][0], c4, a[1][1], c2, a[1][3], c0), invDet);
+            b[2][1] = Lanes::mul(cofactor(a[0][0], c4, a[0][1], c2, a[0][3], c0), negInvDet);
+            b[2][2] = Lanes::mul(cofactor(a[3][0], s4, a[3][1], s2, a[3][3], s0), invDet);
+            b[2][3] = Lanes::mul(cofactor(a[2][0], s4, a[2][1], s2, a[2][3], s0), negInvDet);
+
+            b[3][0] = Lanes::mul(cofactor(a[1][0], c3, a[1][1], c1, a[1][2], c0), negInvDet);
+            b[3][1] = Lanes::mul(cofactor(a[0][0], c3, a[0][1], c1, a[0][2], c0), invDet);
+            b[3][2] = Lanes::mul(cofactor(a[3][0], s3, a[3][1], s1, a[3][2], s0), negInvDet);
+            b[3][3] = Lanes::mul(cofactor(a[2][0], s3, a[2][1], s1, a[2][2], s0), invDet);
+
+            for(s32 r=0; r<4; ++r){
+                for(s32 c=0; c<4; ++c){
+                    Lanes::store(&dst.m_[r][c][l], b[r][c]);
+                }
+            }
+        }
+    }
+
+    void Matrix44SoA::mulPoint(f32 dst[3][Width], const f32 src[3][Width]) const
+    {
+        for(s32 l=0; l<Width; l+=Lanes::Width){
+            Lanes::Type x = Lanes::load(&src[0][l]);
+            Lanes::Type y = Lanes::load(&src[1][l]);
+            Lanes::Type z = Lanes::load(&src[2][l]);
+            Lanes::Type p[4];
+            for(s32 r=0; r<4; ++r){
+                p[r] = Lanes::madd(Lanes::load(&m_[r][0][l]), x,
+                    Lanes::madd(Lanes::load(&m_[r][1][l]), y,
+                    Lanes::madd(Lanes::load(&m_[r][2][l]), z, Lanes::load(&m_[r][3][l]))));
+            }
+            Lanes::Type invW = Lanes::div(Lanes::set1(1.0f), p[3]);
+            for(s32 r=0; r<3; ++r){
+                Lanes::store(&dst[r][l], Lanes::mul(p[r], invW));
+            }
+        }
+    }
+
+    void Matrix44SoA::mulVector(f32 dst[3][Width], const f32 src[3][Width]) const
+    {
+        for(s32 l=0; l<Width; l+=Lanes::Width){
+            Lanes::Type x = Lanes::load(&src[0][l]);
+            Lanes::Type y = Lanes::load(&src[1][l]);
+            Lanes::Type z = Lanes::load(&src[2][l]);
+            Lanes::Type p[3];
+            for(s32 r=0; r<3; ++r){
+                p[r] = Lanes::madd(Lanes::load(&m_[r][0][l]), x,
+                    Lanes::madd(Lanes::load(&m_[r][1][l]), y, Lanes::mul(Lanes::load(&m_[r][2][l]), z)));
+            }
+            for(s32 r=0; r<3; ++r){
+                Lanes::store(&dst[r][l], p[r]);
+            }
+        }
+    }
 }
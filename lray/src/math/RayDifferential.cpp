@@ -0,0 +1,24 @@
+/**
+@file RayDifferential.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "math/RayDifferential.h"
+
+namespace lray
+{
+    void RayDifferential::transfer(f32 t, const Vector3& direction, const Vector3& normal)
+    {
+        //Igehy, "Tracing Ray Differentials". Offsets of origins are projected onto the tangent plane.
+        Vector3 dx = dPdx_ + t*dDdx_;
+        Vector3 dy = dPdy_ + t*dDdy_;
+        f32 dn = dot(direction, normal);
+        if(F32_EPSILON<absolute(dn)){
+            f32 invDn = 1.0f/dn;
+            dx -= (dot(dx, normal)*invDn)*direction;
+            dy -= (dot(dy, normal)*invDn)*direction;
+        }
+        dPdx_ = dx;
+        dPdy_ = dy;
+    }
+}
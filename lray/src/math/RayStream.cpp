@@ -0,0 +1,55 @@
+/**
+@file RayStream.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "math/RayStream.h"
+
+namespace lray
+{
+    RayStream::RayStream()
+        :originX_(NULL)
+        ,originY_(NULL)
+        ,originZ_(NULL)
+        ,directionX_(NULL)
+        ,directionY_(NULL)
+        ,directionZ_(NULL)
+        ,invDirectionX_(NULL)
+        ,invDirectionY_(NULL)
+        ,invDirectionZ_(NULL)
+        ,t_(NULL)
+        ,size_(0)
+        ,capacity_(0)
+        ,buffer_(NULL)
+    {
+    }
+
+    RayStream::~RayStream()
+    {
+        LALIGNED_FREE(buffer_, Align);
+    }
+
+    void RayStream::resize(s32 size)
+    {
+        LASSERT(0<=size);
+        size_ = size;
+        s32 capacity = (size+LaneWidth-1) & ~(LaneWidth-1);
+        if(capacity<=capacity_){
+            return;
+        }
+        LALIGNED_FREE(buffer_, Align);
+        capacity_ = capacity;
+        buffer_ = reinterpret_cast<f32*>(LALIGNED_MALLOC(sizeof(f32)*NumArrays*capacity_, Align));
+
+        f32** arrays[NumArrays] =
+        {
+            &originX_, &originY_, &originZ_,
+            &directionX_, &directionY_, &directionZ_,
+            &invDirectionX_, &invDirectionY_, &invDirectionZ_,
+            &t_,
+        };
+        for(s32 i=0; i<NumArrays; ++i){
+            *arrays[i] = buffer_ + capacity_*i;
+        }
+    }
+}
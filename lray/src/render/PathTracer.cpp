@@ -0,0 +1,332 @@
+/**
+@file PathTracer.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "render/PathTracer.h"
+#include "Camera.h"
+#include "core/Intersection.h"
+#include "core/JobSystem.h"
+#include "core/Random.h"
+#include "core/Sampler.h"
+#include "math/Ray.h"
+#include "scene/Scene.h"
+
+namespace lray
+{
+namespace
+{
+    static constexpr f32 RayOffset = 1.0e-4f;
+    //Luminance under this is treated as this, so that dark pixels don't need forever to converge
+    static constexpr f32 MinLuminance = 1.0e-2f;
+
+    //Duff et al., "Building an Orthonormal Basis, Revisited"
+    inline void orthonormalBasis(Vector3& tangent, Vector3& binormal, const Vector3& normal)
+    {
+        f32 sign = (0.0f<=normal.z_)? 1.0f : -1.0f;
+        f32 a = -1.0f/(sign + normal.z_);
+        f32 b = normal.x_*normal.y_*a;
+        tangent.set(1.0f + sign*normal.x_*normal.x_*a, sign*b, -sign*normal.x_);
+        binormal.set(b, sign + normal.y_*normal.y_*a, -normal.y_);
+    }
+
+    //pdf is cos/PI
+    inline Vector3 sampleCosineHemisphere(const Vector3& normal, f32 u0, f32 u1)
+    {
+        f32 r = lray::sqrt(u0);
+        f32 phi = PI2*u1;
+        f32 x = r*lray::cos(phi);
+        f32 y = r*lray::sin(phi);
+        f32 z = lray::sqrt(maximum(1.0f-u0, 0.0f));
+        Vector3 tangent, binormal;
+        orthonormalBasis(tangent, binormal, normal);
+        return x*tangent + y*binormal + z*normal;
+    }
+
+    inline f32 maxComponent(const Vector3& v)
+    {
+        return maximum(v.x_, maximum(v.y_, v.z_));
+    }
+
+    inline f32 luminance(const Vector3& v)
+    {
+        return 0.2126f*v.x_ + 0.7152f*v.y_ + 0.0722f*v.z_;
+    }
+
+    inline u8 toU8(f32 x)
+    {
+        //Approximate sRGB with gamma 2.2
+        x = ::powf(clamp01(x), 1.0f/2.2f);
+        return static_cast<u8>(minimum(x*256.0f, 255.0f));
+    }
+
+    //Makes a ray without normalizing the direction again
+    inline Ray spawnRay(const Vector3& origin, const Vector3& direction, f32 t)
+    {
+        Ray ray;
+        ray.origin_ = origin;
+        ray.direction_ = direction;
+        ray.t_ = t;
+        ray.invertDirection();
+        return ray;
+    }
+}
+
+    PathTracer::PathTracer()
+        :width_(0)
+        ,height_(0)
+        ,tilesX_(0)
+        ,tilesY_(0)
+        ,numPasses_(0)
+        ,maxDepth_(DefaultMaxDepth)
+        ,russianRouletteDepth_(DefaultRussianRouletteDepth)
+        ,albedo_(0.8f)
+        ,background_(0.5f)
+        ,lightDirection_(0.0f, 1.0f, 0.0f)
+        ,lightRadiance_(0.0f)
+        ,threshold_(0.0f)
+        ,minSamples_(DefaultMinSamples)
+        ,accumulation_(NULL)
+        ,luminanceMean_(NULL)
+        ,luminanceM2_(NULL)
+        ,tileSamples_(NULL)
+        ,numActiveTiles_(0)
+        ,activeTiles_(NULL)
+        ,converged_(NULL)
+        ,jobSystem_(NULL)
+        ,numContexts_(0)
+        ,contexts_(NULL)
+    {
+    }
+
+    PathTracer::~PathTracer()
+    {
+        release();
+    }
+
+    void PathTracer::release()
+    {
+        LDELETE_ARRAY(contexts_);
+        LDELETE_ARRAY(converged_);
+        LDELETE_ARRAY(activeTiles_);
+        LDELETE_ARRAY(tileSamples_);
+        LDELETE_ARRAY(luminanceM2_);
+        LDELETE_ARRAY(luminanceMean_);
+        LDELETE_ARRAY(accumulation_);
+        numActiveTiles_ = 0;
+        numContexts_ = 0;
+    }
+
+    void PathTracer::initialize(s32 width, s32 height, JobSystem* jobSystem)
+    {
+        LASSERT(0<width);
+        LASSERT(0<height);
+        release();
+        width_ = width;
+        height_ = height;
+        tilesX_ = (width_+TileSize-1)/TileSize;
+        tilesY_ = (height_+TileSize-1)/TileSize;
+        accumulation_ = LNEW f32[width_*height_*3];
+        luminanceMean_ = LNEW f32[width_*height_];
+        luminanceM2_ = LNEW f32[width_*height_];
+        tileSamples_ = LNEW s32[tilesX_*tilesY_];
+        activeTiles_ = LNEW s32[tilesX_*tilesY_];
+        converged_ = LNEW bool[tilesX_*tilesY_];
+
+        jobSystem_ = (NULL != jobSystem)? jobSystem : &JobSystem::getDefault();
+        numContexts_ = jobSystem_->getNumWorkers();
+        contexts_ = LNEW ThreadContext[numContexts_];
+        for(s32 i=0; i<numContexts_; ++i){
+            contexts_[i].rays_.resize(TileSize*TileSize);
+        }
+        reset();
+    }
+
+    void PathTracer::reset()
+    {
+        numPasses_ = 0;
+        if(NULL == accumulation_){
+            return;
+        }
+        memset(accumulation_, 0, sizeof(f32)*width_*height_*3);
+        memset(luminanceMean_, 0, sizeof(f32)*width_*height_);
+        memset(luminanceM2_, 0, sizeof(f32)*width_*height_);
+        numActiveTiles_ = tilesX_*tilesY_;
+        for(s32 i=0; i<numActiveTiles_; ++i){
+            tileSamples_[i] = 0;
+            activeTiles_[i] = i;
+            converged_[i] = false;
+        }
+    }
+
+    void PathTracer::setLight(const Vector3& direction, const Vector3& radiance)
+    {
+        lightDirection_ = normalize(direction);
+        lightRadiance_ = radiance;
+    }
+
+    void PathTracer::setAdaptive(f32 threshold, s32 minSamples)
+    {
+        LASSERT(0.0f<=threshold);
+        LASSERT(1<minSamples);
+        threshold_ = threshold;
+        minSamples_ = minSamples;
+    }
+
+    void PathTracer::renderPass(Scene& scene, const Camera& camera)
+    {
+        LASSERT(NULL != accumulation_);
+        //A tile is owned by one thread in a pass, so that the accumulation buffer is shared without atomics
+        jobSystem_->parallelFor(0, numActiveTiles_, [this, &scene, &camera](s32 index, s32 worker)
+        {
+            s32 tile = activeTiles_[index];
+            renderTile(contexts_[worker], scene, camera, tile);
+            converged_[tile] = isConverged(tile);
+        });
+
+        //Drop converged tiles, a pass gets shorter and the time goes to noisy tiles in next passes
+        s32 numActiveTiles = 0;
+        for(s32 i=0; i<numActiveTiles_; ++i){
+            if(!converged_[activeTiles_[i]]){
+                activeTiles_[numActiveTiles++] = activeTiles_[i];
+            }
+        }
+        numActiveTiles_ = numActiveTiles;
+        ++numPasses_;
+    }
+
+    void PathTracer::renderTile(ThreadContext& context, Scene& scene, const Camera& camera, s32 tile)
+    {
+        s32 x0 = (tile%tilesX_)*TileSize;
+        s32 y0 = (tile/tilesX_)*TileSize;
+        s32 width = minimum(TileSize, width_-x0);
+        s32 height = minimum(TileSize, height_-y0);
+
+        //Russian roulette is pseudo random, seeded by the sample and the tile so that images don't depend on scheduling
+        RandXorshift128Plus32 random(scramble(static_cast<u64>(tileSamples_[tile])*tilesX_*tilesY_ + tile + 1, 0x9E3779B97F4A7C15ULL));
+        s32 numPixels = width*height;
+        //Dimensions 0 and 1 of the pixel's sequence are for the film, the rest for bounces
+        u32 sampleIndex = static_cast<u32>(tileSamples_[tile]);
+        for(s32 i=0; i<numPixels; ++i){
+            SobolSampler sampler(x0 + i%width, y0 + i/width);
+            sampler.get2D(context.jitter_[i*2+0], context.jitter_[i*2+1], sampleIndex, 0);
+        }
+        camera.generateRays(context.rays_, x0, y0, width, height, context.jitter_);
+
+        s32 count = ++tileSamples_[tile];
+        for(s32 i=0; i<numPixels; ++i){
+            SobolSampler sampler(x0 + i%width, y0 + i/width);
+            Ray ray = context.rays_.getRay(i);
+            Vector3 radiance = trace(scene, ray, sampler, sampleIndex, random);
+            s32 index = (y0 + i/width)*width_ + x0 + i%width;
+            f32* pixel = accumulation_ + index*3;
+            pixel[0] += radiance.x_;
+            pixel[1] += radiance.y_;
+            pixel[2] += radiance.z_;
+
+            //Welford's online variance
+            f32 y = luminance(radiance);
+            f32 delta = y - luminanceMean_[index];
+            luminanceMean_[index] += delta/count;
+            luminanceM2_[index] += delta*(y - luminanceMean_[index]);
+        }
+    }
+
+    bool PathTracer::isConverged(s32 tile) const
+    {
+        s32 count = tileSamples_[tile];
+        if(threshold_<=0.0f || count<minSamples_){
+            return false;
+        }
+        s32 x0 = (tile%tilesX_)*TileSize;
+        s32 y0 = (tile/tilesX_)*TileSize;
+        s32 x1 = minimum(x0+TileSize, width_);
+        s32 y1 = minimum(y0+TileSize, height_);
+        //Standard error of the mean is sqrt(M2/(n-1)/n), compared squared
+        f32 scale = 1.0f/(static_cast<f32>(count-1)*count);
+        f32 threshold2 = threshold_*threshold_;
+        for(s32 y=y0; y<y1; ++y){
+            for(s32 x=x0; x<x1; ++x){
+                s32 index = y*width_ + x;
+                f32 mean = maximum(luminanceMean_[index], MinLuminance);
+                if(threshold2*mean*mean < luminanceM2_[index]*scale){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    Vector3 PathTracer::trace(Scene& scene, Ray& ray, const SobolSampler& sampler, u32 sampleIndex, RandXorshift128Plus32& random) const
+    {
+        Vector3 radiance(0.0f);
+        Vector3 throughput(1.0f);
+        bool hasLight = 0.0f<maxComponent(lightRadiance_);
+        for(s32 depth=0; depth<maxDepth_; ++depth){
+            Intersection intersection;
+            if(Result_Fail == scene.test(intersection, ray)){
+                radiance += throughput*background_;
+                break;
+            }
+            Vector3 point = ray.origin_ + intersection.t_*ray.direction_;
+            Vector3 normal = normalize(intersection.shadingNormal_);
+            //Surfaces are two sided
+            if(0.0f<dot(normal, ray.direction_)){
+                normal = -normal;
+            }
+            Vector3 origin = point + RayOffset*normal;
+            throughput *= albedo_;
+
+            //Next event estimation of the directional light, brdf is albedo/PI and the light is a delta
+            f32 cosLight = dot(normal, lightDirection_);
+            if(hasLight && 0.0f<cosLight){
+                Intersection shadow;
+                Ray shadowRay = spawnRay(origin, lightDirection_, F32_MAX);
+                if(Result_Fail == scene.test(shadow, shadowRay)){
+                    radiance += (cosLight*INV_PI)*(throughput*lightRadiance_);
+                }
+            }
+
+            //Lambert with cosine sampling, weights are just albedo
+            f32 u0, u1;
+            sampler.get2D(u0, u1, sampleIndex, 2 + 2*depth);
+            ray = spawnRay(origin, sampleCosineHemisphere(normal, u0, u1), F32_MAX);
+
+            //Russian roulette
+            if(russianRouletteDepth_<=depth){
+                f32 survive = minimum(maxComponent(throughput), 0.95f);
+                if(survive<=random.frand2()){
+                    break;
+                }
+                throughput *= 1.0f/survive;
+            }
+        }
+        return radiance;
+    }
+
+    Vector3 PathTracer::getPixel(s32 x, s32 y) const
+    {
+        LASSERT(0<=x && x<width_);
+        LASSERT(0<=y && y<height_);
+        s32 count = tileSamples_[(y/TileSize)*tilesX_ + x/TileSize];
+        f32 scale = (0<count)? 1.0f/count : 0.0f;
+        const f32* pixel = accumulation_ + (y*width_ + x)*3;
+        return Vector3(pixel[0]*scale, pixel[1]*scale, pixel[2]*scale);
+    }
+
+    void PathTracer::resolve(u8* rgb) const
+    {
+        LASSERT(NULL != rgb);
+        for(s32 y=0; y<height_; ++y){
+            const s32* samples = tileSamples_ + (y/TileSize)*tilesX_;
+            for(s32 x=0; x<width_; ++x){
+                s32 count = samples[x/TileSize];
+                f32 scale = (0<count)? 1.0f/count : 0.0f;
+                s32 index = (y*width_ + x)*3;
+                rgb[index+0] = toU8(accumulation_[index+0]*scale);
+                rgb[index+1] = toU8(accumulation_[index+1]*scale);
+                rgb[index+2] = toU8(accumulation_[index+2]*scale);
+            }
+        }
+    }
+}
@@ -0,0 +1,345 @@
+/**
+@file GeometryCache.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "scene/GeometryCache.h"
+#include "texture/TileCache.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+namespace lray
+{
+namespace
+{
+    //The closest hit in pages on this thread, whose page is pinned until releaseHit
+    thread_local GeometryCache* hitCache_ = NULL;
+    thread_local s32 hitPage_ = -1;
+    thread_local HitRecord hitRecord_;
+
+    //Storages of the primitive, the proxies and the accelerator, roughly
+    inline s64 estimateResidentBytes(const GeometryCache::PageInfo& info)
+    {
+        s64 perTriangle = sizeof(TriangleProxy) + sizeof(s32) + sizeof(BinQBVH<TriangleProxy>::Node)/4;
+        return GeometryCache::calcFileBytes(info) + perTriangle*info.numTriangles_ + sizeof(GeometryCache::Page);
+    }
+
+    template<class T>
+    bool writeArray(const T* src, s32 size, FILE* file)
+    {
+        return static_cast<size_t>(size) == fwrite(src, sizeof(T), size, file);
+    }
+}
+
+    GeometryCache::GeometryCache(s64 budget)
+        :budget_(budget)
+        ,residentBytes_(0)
+        ,numLoads_(0)
+        ,tick_(0)
+        ,file_(NULL)
+        ,numPages_(0)
+        ,pages_(NULL)
+        ,entries_(NULL)
+    {
+    }
+
+    GeometryCache::~GeometryCache()
+    {
+        clear();
+    }
+
+    void GeometryCache::clear()
+    {
+        for(s32 i=0; i<numPages_; ++i){
+            Page* page = entries_[i].page_.load();
+            LDELETE(page);
+        }
+        LDELETE_ARRAY(entries_);
+        LDELETE_ARRAY(pages_);
+        numPages_ = 0;
+        residentBytes_ = 0;
+        if(NULL != file_){
+            fclose(file_);
+            file_ = NULL;
+        }
+    }
+
+    bool GeometryCache::open(const Char* path, s32 numPages, const PageInfo* pages)
+    {
+        LASSERT(NULL != path);
+        LASSERT(0<=numPages);
+        std::lock_guard<std::mutex> lock(mutex_);
+        clear();
+        file_ = fopen(path, "rb");
+        if(NULL == file_){
+            return false;
+        }
+        numPages_ = numPages;
+        pages_ = LNEW PageInfo[numPages_];
+        entries_ = LNEW Entry[numPages_];
+        for(s32 i=0; i<numPages_; ++i){
+            pages_[i] = pages[i];
+            entries_[i].page_.store(NULL);
+            entries_[i].pins_.store(0);
+            entries_[i].lastUsed_.store(0);
+            entries_[i].loading_ = false;
+        }
+        return true;
+    }
+
+    void GeometryCache::setBudget(s64 budget)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = budget;
+        evict();
+    }
+
+    GeometryCache::Page* GeometryCache::acquire(s32 page)
+    {
+        LASSERT(0<=page && page<numPages_);
+        Entry& entry = entries_[page];
+        //Pin before looking at the page, the evictor checks pins after taking the page away
+        entry.pins_.fetch_add(1);
+        Page* resident = entry.page_.load();
+        if(NULL == resident){
+            std::unique_lock<std::mutex> lock(mutex_);
+            for(;;){
+                resident = entry.page_.load();
+                if(NULL != resident || !entry.loading_){
+                    break;
+                }
+                loaded_.wait(lock);
+            }
+            if(NULL == resident){
+                //Mark the entry first, the others wait for it instead of reading the same page
+                entry.loading_ = true;
+                lock.unlock();
+                resident = load(page);
+                lock.lock();
+                entry.loading_ = false;
+                if(NULL != resident){
+                    entry.page_.store(resident);
+                    residentBytes_ += estimateResidentBytes(pages_[page]);
+                    ++numLoads_;
+                    tick_.fetch_add(1, std::memory_order_relaxed);
+                    evict();
+                }
+                lock.unlock();
+                loaded_.notify_all();
+                if(NULL == resident){
+                    entry.pins_.fetch_sub(1);
+                    return NULL;
+                }
+            }
+        }
+        //The clock advances only by loads, so that hot pages rarely write
+        u64 tick = tick_.load(std::memory_order_relaxed);
+        if(entry.lastUsed_.load(std::memory_order_relaxed) != tick){
+            entry.lastUsed_.store(tick, std::memory_order_relaxed);
+        }
+        return resident;
+    }
+
+    void GeometryCache::release(s32 page)
+    {
+        LASSERT(0<=page && page<numPages_);
+        entries_[page].pins_.fetch_sub(1);
+    }
+
+    bool GeometryCache::read(void* dst, s64 bytes, s64 offset)
+    {
+#ifdef _MSC_VER
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        return seekFile(file_, offset) && static_cast<size_t>(bytes) == fread(dst, 1, static_cast<size_t>(bytes), file_);
+#else
+        //Positional reads may return short
+        Char* d = static_cast<Char*>(dst);
+        while(0<bytes){
+            ssize_t size = pread(fileno(file_), d, static_cast<size_t>(bytes), static_cast<off_t>(offset));
+            if(size<=0){
+                return false;
+            }
+            d += size;
+            offset += size;
+            bytes -= size;
+        }
+        return true;
+#endif
+    }
+
+    GeometryCache::Page* GeometryCache::load(s32 index)
+    {
+        const PageInfo& info = pages_[index];
+        if(info.numVertices_<=0 || info.numTriangles_<=0){
+            return NULL;
+        }
+        Vector3* positions = LNEW Vector3[info.numVertices_];
+        Vector3* normals = NULL;
+        Vector2* texcoords = NULL;
+        Triangle* triangles = NULL;
+        s64 offset = info.offset_;
+        bool result = read(positions, sizeof(Vector3)*info.numVertices_, offset);
+        offset += sizeof(Vector3)*info.numVertices_;
+        if(result && 0 != (info.components_ & Primitive::Component_Normal)){
+            normals = LNEW Vector3[info.numVertices_];
+            result = read(normals, sizeof(Vector3)*info.numVertices_, offset);
+            offset += sizeof(Vector3)*info.numVertices_;
+        }
+        if(result && 0 != (info.components_ & Primitive::Component_Texcoord)){
+            texcoords = LNEW Vector2[info.numVertices_];
+            result = read(texcoords, sizeof(Vector2)*info.numVertices_, offset);
+            offset += sizeof(Vector2)*info.numVertices_;
+        }
+        if(result){
+            triangles = LNEW Triangle[info.numTriangles_];
+            result = read(triangles, sizeof(Triangle)*info.numTriangles_, offset);
+        }
+        if(!result){
+            LDELETE_ARRAY(triangles);
+            LDELETE_ARRAY(texcoords);
+            LDELETE_ARRAY(normals);
+            LDELETE_ARRAY(positions);
+            return NULL;
+        }
+
+        Page* page = LNEW Page;
+        page->primitive_ = Primitive(info.numVertices_, positions, normals, info.numTriangles_, triangles);
+        page->primitive_.setTexcoords(texcoords);
+        page->triangleProxies_.resize(info.numTriangles_);
+        page->primitive_.getTriangleProxies(&page->triangleProxies_[0]);
+        page->accelerator_.build(info.numTriangles_, &page->triangleProxies_[0]);
+        return page;
+    }
+
+    void GeometryCache::evict()
+    {
+        //Linear scan, loads are much rarer than traversals
+        for(s32 trial=0; budget_<residentBytes_ && trial<numPages_; ++trial){
+            s32 victim = -1;
+            u64 oldest = static_cast<u64>(-1);
+            for(s32 i=0; i<numPages_; ++i){
+                Entry& entry = entries_[i];
+                if(NULL == entry.page_.load(std::memory_order_relaxed) || 0 != entry.pins_.load()){
+                    continue;
+                }
+                u64 lastUsed = entry.lastUsed_.load(std::memory_order_relaxed);
+                if(lastUsed<oldest){
+                    oldest = lastUsed;
+                    victim = i;
+                }
+            }
+            if(victim<0){
+                break;
+            }
+            Entry& entry = entries_[victim];
+            Page* page = entry.page_.exchange(NULL);
+            if(0 != entry.pins_.load()){
+                //Pinned after the scan, give it back
+                entry.page_.store(page);
+                continue;
+            }
+            LDELETE(page);
+            residentBytes_ -= estimateResidentBytes(pages_[victim]);
+        }
+    }
+
+    bool GeometryCache::writePage(PageInfo& info, FILE* file, s64 offset, const Primitive& primitive)
+    {
+        LASSERT(NULL != file);
+        info.offset_ = offset;
+        info.numVertices_ = primitive.getNumVertices();
+        info.numTriangles_ = primitive.getNumTriangles();
+        info.components_ = 0;
+        info.reserved_ = 0;
+        info.bbox_.setInvalid();
+        if(info.numVertices_<=0){
+            return true;
+        }
+        for(s32 i=0; i<info.numVertices_; ++i){
+            const Vector3& position = primitive.getPosition(i);
+            info.bbox_.bmin_ = minimum(info.bbox_.bmin_, position);
+            info.bbox_.bmax_ = maximum(info.bbox_.bmax_, position);
+        }
+
+        bool result = writeArray(&primitive.getPosition(0), info.numVertices_, file);
+        if(result && primitive.hasComponent(Primitive::Component_Normal)){
+            info.components_ |= Primitive::Component_Normal;
+            result = writeArray(&primitive.getNormal(0), info.numVertices_, file);
+        }
+        if(result && primitive.hasComponent(Primitive::Component_Texcoord)){
+            info.components_ |= Primitive::Component_Texcoord;
+            result = writeArray(&primitive.getTexcoord(0), info.numVertices_, file);
+        }
+        if(result && 0<info.numTriangles_){
+            result = writeArray(&primitive.getTriangle(0), info.numTriangles_, file);
+        }
+        return result;
+    }
+
+    s64 GeometryCache::calcFileBytes(const PageInfo& info)
+    {
+        s64 vertexSize = sizeof(Vector3);
+        if(0 != (info.components_ & Primitive::Component_Normal)){
+            vertexSize += sizeof(Vector3);
+        }
+        if(0 != (info.components_ & Primitive::Component_Texcoord)){
+            vertexSize += sizeof(Vector2);
+        }
+        return vertexSize*info.numVertices_ + static_cast<s64>(sizeof(Triangle))*info.numTriangles_;
+    }
+
+    //--------------------------------------------
+    //---
+    //--- PageProxy
+    //---
+    //--------------------------------------------
+    Vector3 PageProxy::getCentroid() const
+    {
+        const AABB& bbox = cache_->getPageInfo(page_).bbox_;
+        return (bbox.bmin_ + bbox.bmax_)*0.5f;
+    }
+
+    AABB PageProxy::getBBox() const
+    {
+        return cache_->getPageInfo(page_).bbox_;
+    }
+
+    Result PageProxy::testRay(f32& t, f32& v, f32& w, const Ray& ray) const
+    {
+        GeometryCache::Page* page = cache_->acquire(page_);
+        if(NULL == page){
+            return Result_Fail;
+        }
+        Ray pageRay = ray;
+        HitRecord hitRecord = page->accelerator_.intersect(pageRay);
+        if(Result_Fail == hitRecord.result_){
+            cache_->release(page_);
+            return Result_Fail;
+        }
+        //Hits are always closer than the ray's extent, which replace the last one
+        releaseHit();
+        hitCache_ = cache_;
+        hitPage_ = page_;
+        hitRecord_ = hitRecord;
+        t = hitRecord.t_;
+        v = hitRecord.v_;
+        w = hitRecord.w_;
+        return hitRecord.result_;
+    }
+
+    const HitRecord* PageProxy::getHit()
+    {
+        return (0<=hitPage_)? &hitRecord_ : NULL;
+    }
+
+    void PageProxy::releaseHit()
+    {
+        if(0<=hitPage_){
+            hitCache_->release(hitPage_);
+            hitCache_ = NULL;
+            hitPage_ = -1;
+        }
+    }
+}
@@ -3,6 +3,10 @@
 @author t-sakai
 @date 2018/05/25 create
 */
+#include "lray.h"
+//Blocks of lmalloc have headers, buffers adopted from cppgltf must come from it
+#define CPPGLTF_MALLOC(size) lray::lmalloc(size)
+#define CPPGLTF_FREE(ptr) lray::lfree(ptr)
 #define CPPIMG_IMPLEMENTATION
 #include <cppimg/cppimg.h>
 #define CPPGLTF_IMPLEMENTATION
@@ -10,92 +14,437 @@
 
 #include "scene/Scene.h"
 #include "math/Quaternion.h"
+#include "core/Parallel.h"
+#include "core/LinearArena.h"
+#include "shape/TriangleIndices.h"
+#include <ctype.h>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace lray
 {
     Scene::Scene()
+        :tileCache_(NULL)
+        ,geometryCache_(NULL)
+        ,placement_(MemoryPlacement_Default)
+        ,previewing_(false)
     {
     }
 
     Scene::Scene(Scene&& rhs)
         :meshes_(move(rhs.meshes_))
         ,nodes_(move(rhs.nodes_))
+        ,skins_(move(rhs.skins_))
+        ,buffers_(move(rhs.buffers_))
+        ,mappedFiles_(move(rhs.mappedFiles_))
+        ,textures_(move(rhs.textures_))
+        ,tileCache_(rhs.tileCache_)
+        ,geometryCache_(rhs.geometryCache_)
+        ,placement_(rhs.placement_)
+        ,previewing_(false)
     {
+        rhs.tileCache_ = NULL;
+        rhs.geometryCache_ = NULL;
     }
 
     Scene::Scene(const Char* name, MeshArray&& meshes, NodeArray&& nodes)
         :meshes_(move(meshes))
         ,nodes_(move(nodes))
+        ,tileCache_(NULL)
+        ,geometryCache_(NULL)
+        ,placement_(MemoryPlacement_Default)
+        ,previewing_(false)
     {
         if(NULL != name){
             name_.assign(name);
         }
     }
 
+    Scene::Scene(const Char* name, MeshArray&& meshes, NodeArray&& nodes, SkinArray&& skins, BufferArray&& buffers, MappedFileArray&& mappedFiles)
+        :meshes_(move(meshes))
+        ,nodes_(move(nodes))
+        ,skins_(move(skins))
+        ,buffers_(move(buffers))
+        ,mappedFiles_(move(mappedFiles))
+        ,tileCache_(NULL)
+        ,geometryCache_(NULL)
+        ,placement_(MemoryPlacement_Default)
+        ,previewing_(false)
+    {
+        if(NULL != name){
+            name_.assign(name);
+        }
+    }
+
+    Scene::~Scene()
+    {
+        //Primitives may view the buffers, release them first
+        refinedMeshes_.clear();
+        meshes_.clear();
+        releaseBuffers();
+        LDELETE(tileCache_);
+        LDELETE(geometryCache_);
+    }
+
     Scene& Scene::operator=(Scene&& rhs)
     {
         if(this == &rhs){
             return *this;
         }
+        //Refined primitives, proxies and accelerators describe the old meshes, and may view the old buffers
+        accelerator_.release();
+        previewAccelerator_.release();
+        pageAccelerator_.release();
+        triangleProxies_.clear();
+        refinedMeshes_.clear();
         name_ = move(rhs.name_);
         meshes_ = move(rhs.meshes_);
         nodes_ = move(rhs.nodes_);
+        skins_ = move(rhs.skins_);
+        releaseBuffers();
+        buffers_ = move(rhs.buffers_);
+        mappedFiles_ = move(rhs.mappedFiles_);
+        textures_ = move(rhs.textures_);
+        LDELETE(tileCache_);
+        tileCache_ = rhs.tileCache_;
+        rhs.tileCache_ = NULL;
+        pageProxies_.clear();
+        LDELETE(geometryCache_);
+        geometryCache_ = rhs.geometryCache_;
+        rhs.geometryCache_ = NULL;
+        previewing_.store(false, std::memory_order_relaxed);
+        setPlacement(rhs.placement_);
         return *this;
     }
 
+    void Scene::setTextures(TextureArray&& textures, TileCache* tileCache)
+    {
+        textures_ = move(textures);
+        if(tileCache_ != tileCache){
+            LDELETE(tileCache_);
+            tileCache_ = tileCache;
+        }
+    }
+
+    void Scene::setGeometryCache(GeometryCache* geometryCache)
+    {
+        pageProxies_.clear();
+        if(geometryCache_ != geometryCache){
+            LDELETE(geometryCache_);
+            geometryCache_ = geometryCache;
+        }
+    }
+
+    void Scene::setPlacement(MemoryPlacement placement)
+    {
+        placement_ = placement;
+        accelerator_.setPlacement(placement);
+        previewAccelerator_.setPlacement(placement);
+        pageAccelerator_.setPlacement(placement);
+        if(0<triangleProxies_.size()){
+            placeGeometries();
+        }
+    }
+
+    void Scene::placeGeometries()
+    {
+        //Replicas of primitives would need proxies of their own, so geometries are only interleaved
+        if(MemoryPlacement_Default == placement_){
+            return;
+        }
+        for(s32 i=0; i<refinedMeshes_.size(); ++i){
+            for(s32 j=0; j<refinedMeshes_[i].getNumPrimitives(); ++j){
+                const Primitive& primitive = refinedMeshes_[i].getPrimitive(j);
+                if(0<primitive.getNumVertices()){
+                    Numa::interleaveBlock(const_cast<Vector3*>(&primitive.getPosition(0)), sizeof(Vector3)*primitive.getNumVertices());
+                    if(primitive.hasComponent(Primitive::Component_Normal)){
+                        Numa::interleaveBlock(const_cast<Vector3*>(&primitive.getNormal(0)), sizeof(Vector3)*primitive.getNumVertices());
+                    }
+                }
+                if(0<primitive.getNumTriangles()){
+                    Numa::interleaveBlock(const_cast<Triangle*>(&primitive.getTriangle(0)), sizeof(Triangle)*primitive.getNumTriangles());
+                }
+            }
+        }
+        Numa::interleaveBlock(triangleProxies_.begin(), sizeof(TriangleProxy)*triangleProxies_.size());
+    }
+
+    void Scene::releaseBuffers()
+    {
+        //Buffers are allocated by cppgltf, which also goes through lmalloc
+        for(s32 i=0; i<buffers_.size(); ++i){
+            LFREE(buffers_[i]);
+        }
+        buffers_.clear();
+        mappedFiles_.clear();
+    }
+
+    void Scene::fillIntersection(Intersection& intersection, const HitRecord& hitRecord, const Ray& ray, RayDifferential* differential) const
+    {
+        intersection.result_ = Result_Success;
+        intersection.t_ = hitRecord.t_;
+        intersection.b0_ = 1.0f-hitRecord.v_-hitRecord.w_;
+        intersection.b1_ = hitRecord.v_;
+        intersection.b2_ = hitRecord.w_;
+        const TriangleProxy& proxy = *reinterpret_cast<const TriangleProxy*>(hitRecord.primitive_);
+        const Primitive& primitive = *proxy.primitive_;
+        const Triangle& triangle = primitive.getTriangle(proxy.index_);
+
+        //Calc normal
+        f32 w0 = intersection.b0_;
+        f32 w1 = intersection.b1_;
+        f32 w2 = intersection.b2_;
+        const Vector3& n0 = primitive.getNormal(triangle.indices_[0]);
+        const Vector3& n1 = primitive.getNormal(triangle.indices_[1]);
+        const Vector3& n2 = primitive.getNormal(triangle.indices_[2]);
+        intersection.shadingNormal_ = weightedAverage(w0, w1, w2, n0, n1, n2);
+
+        if(primitive.hasComponent(Primitive::Component_Texcoord)){
+            const Vector2& t0 = primitive.getTexcoord(triangle.indices_[0]);
+            const Vector2& t1 = primitive.getTexcoord(triangle.indices_[1]);
+            const Vector2& t2 = primitive.getTexcoord(triangle.indices_[2]);
+            intersection.uv_ = weightedAverage(w0, w1, w2, t0, t1, t2);
+        }
+        if(NULL == differential){
+            return;
+        }
+
+        //Transfer differentials to the hit point on the plane of the triangle
+        const Vector3& p0 = primitive.getPosition(triangle.indices_[0]);
+        Vector3 e1 = primitive.getPosition(triangle.indices_[1]) - p0;
+        Vector3 e2 = primitive.getPosition(triangle.indices_[2]) - p0;
+        intersection.point_ = ray.origin_ + hitRecord.t_*ray.direction_;
+        intersection.geometricNormal_ = normalize(cross(e1, e2));
+        differential->transfer(hitRecord.t_, ray.direction_, intersection.geometricNormal_);
+        if(!primitive.hasComponent(Primitive::Component_Texcoord)){
+            return;
+        }
+
+        //Solve offsets in barycentric coordinates, then map them to texture coordinates
+        f32 a = dot(e1, e1);
+        f32 b = dot(e1, e2);
+        f32 c = dot(e2, e2);
+        f32 det = a*c - b*b;
+        if(absolute(det)<F32_EPSILON*a*c){
+            return;
+        }
+        f32 invDet = 1.0f/det;
+        const Vector2& t0 = primitive.getTexcoord(triangle.indices_[0]);
+        const Vector2& t1 = primitive.getTexcoord(triangle.indices_[1]);
+        const Vector2& t2 = primitive.getTexcoord(triangle.indices_[2]);
+        Vector2 duv1(t1.x_-t0.x_, t1.y_-t0.y_);
+        Vector2 duv2(t2.x_-t0.x_, t2.y_-t0.y_);
+        const Vector3* dP[2] = {&differential->dPdx_, &differential->dPdy_};
+        Vector2* dUV[2] = {&intersection.dUVdx_, &intersection.dUVdy_};
+        for(s32 i=0; i<2; ++i){
+            f32 r1 = dot(e1, *dP[i]);
+            f32 r2 = dot(e2, *dP[i]);
+            f32 db1 = (c*r1 - b*r2)*invDet;
+            f32 db2 = (a*r2 - b*r1)*invDet;
+            dUV[i]->set(db1*duv1.x_ + db2*duv2.x_, db1*duv1.y_ + db2*duv2.y_);
+        }
+    }
+
     Result Scene::test(Intersection& intersection, Ray& ray)
     {
-        HitRecord hitRecord = accelerator_.intersect(ray);
+        if(NULL != geometryCache_){
+            return testPages(intersection, ray, NULL);
+        }
+        BinQBVH<TriangleProxy>& accelerator = (isPreviewing())? previewAccelerator_ : accelerator_;
+        HitRecord hitRecord = accelerator.intersect(ray);
         if(Result_Fail != hitRecord.result_){
-            intersection.result_ = Result_Success;
-            intersection.t_ = hitRecord.t_;
-            intersection.b0_ = 1.0f-hitRecord.v_-hitRecord.w_;
-            intersection.b1_ = hitRecord.v_;
-            intersection.b2_ = hitRecord.w_;
-            const TriangleProxy& proxy = *reinterpret_cast<const TriangleProxy*>(hitRecord.primitive_);
-            const Primitive& primitive = *proxy.primitive_;
-            const Triangle& triangle = primitive.getTriangle(proxy.index_);
-
-            //Calc normal
-            f32 w0 = intersection.b0_;
-            f32 w1 = intersection.b1_;
-            f32 w2 = intersection.b2_;
-            const Vector3& n0 = primitive.getNormal(triangle.indices_[0]);
-            const Vector3& n1 = primitive.getNormal(triangle.indices_[1]);
-            const Vector3& n2 = primitive.getNormal(triangle.indices_[2]);
-            intersection.shadingNormal_ = weightedAverage(w0, w1, w2, n0, n1, n2);
+            fillIntersection(intersection, hitRecord, ray, NULL);
         }
         return intersection.result_;
     }
 
-    void Scene::updateFrame()
+    Result Scene::test(Intersection& intersection, Ray& ray, RayDifferential& differential)
     {
-        refinedMeshes_.resize(meshes_.size());
+        if(NULL != geometryCache_){
+            return testPages(intersection, ray, &differential);
+        }
+        BinQBVH<TriangleProxy>& accelerator = (isPreviewing())? previewAccelerator_ : accelerator_;
+        HitRecord hitRecord = accelerator.intersect(ray);
+        if(Result_Fail != hitRecord.result_){
+            fillIntersection(intersection, hitRecord, ray, &differential);
+        }
+        return intersection.result_;
+    }
 
-        //Update world matrices and meshes of root nodes
-        s32 inode=0;
-        for(; inode<nodes_.size(); ++inode){
-            Node& node = nodes_[inode];
-            if(0<=node.getParent()){
-                break;
-            }
-            node.getWorldMatrix() = node.getMatrix();
+    Result Scene::testPages(Intersection& intersection, Ray& ray, RayDifferential* differential)
+    {
+        if(pageProxies_.size()<=0){
+            return intersection.result_;
+        }
+        HitRecord hitRecord = pageAccelerator_.intersect(ray);
 
-            s32 imesh = node.getMesh();
-            if(0<=imesh){
-                refinedMeshes_[imesh].refine(meshes_[imesh], node.getWorldMatrix());
+        //Proxies of pages report only distances, the triangle is kept with its page pinned
+        const HitRecord* pageHit = PageProxy::getHit();
+        if(Result_Fail != hitRecord.result_ && NULL != pageHit){
+            fillIntersection(intersection, *pageHit, ray, differential);
+        }
+        PageProxy::releaseHit();
+        return intersection.result_;
+    }
+
+    void Scene::updateFrame(bool rebuild)
+    {
+        //Pages are static, build the top level once
+        if(NULL != geometryCache_){
+            if(pageProxies_.size() != geometryCache_->getNumPages()){
+                pageProxies_.resize(geometryCache_->getNumPages());
+                for(s32 i=0; i<pageProxies_.size(); ++i){
+                    pageProxies_[i].cache_ = geometryCache_;
+                    pageProxies_[i].page_ = i;
+                }
+                if(0<pageProxies_.size()){
+                    pageAccelerator_.build(pageProxies_.size(), &pageProxies_[0]);
+                }
             }
+            return;
+        }
+
+        //The full accelerator is not built yet while previewing, otherwise rays do not reach the preview anymore
+        rebuild = rebuild || isPreviewing();
+        releasePreview();
+        if(!refine(rebuild)){
+            return;
+        }
+        accelerator_.build(triangleProxies_.size(), triangleProxies_.begin());
+        placeGeometries();
+        previewing_.store(false, std::memory_order_release);
+        releasePreview();
+    }
+
+    void Scene::updatePreview()
+    {
+        if(NULL != geometryCache_){
+            updateFrame();
+            return;
+        }
+        refine(true);
+        previewAccelerator_.build(triangleProxies_.size(), triangleProxies_.begin(), true);
+        previewing_.store(true, std::memory_order_release);
+    }
+
+    void Scene::buildAccelerator()
+    {
+        if(!isPreviewing()){
+            return;
+        }
+        accelerator_.build(triangleProxies_.size(), triangleProxies_.begin());
+        placeGeometries();
+        previewing_.store(false, std::memory_order_release);
+    }
+
+    void Scene::releasePreview()
+    {
+        if(!isPreviewing()){
+            previewAccelerator_.release();
         }
-        //Update descendant's
-        for(; inode<nodes_.size(); ++inode){
+    }
+
+    bool Scene::refine(bool rebuild)
+    {
+        //Update world matrices, parents are always placed before their children
+        for(s32 inode=0; inode<nodes_.size(); ++inode){
             Node& node = nodes_[inode];
             s32 iparent = node.getParent();
-            node.getWorldMatrix().mul(node.getMatrix(), nodes_[iparent].getWorldMatrix());
+            if(iparent<0){
+                node.getWorldMatrix() = node.getMatrix();
+            }else{
+                node.getWorldMatrix().mul(nodes_[iparent].getWorldMatrix(), node.getMatrix());
+            }
+        }
 
+        //Update palettes of skins
+        for(s32 i=0; i<skins_.size(); ++i){
+            skins_[i].updatePalette(&nodes_[0]);
+        }
+
+        //Gather primitives to refine
+        struct RefineTask
+        {
+            Primitive* dst_;
+            const Primitive* src_;
+            const Matrix44* matrix_;
+            s32 numJoints_;
+            const Matrix44* palette_;
+            s32 numWeights_;
+            const f32* weights_;
+        };
+        if(refinedMeshes_.size() != meshes_.size()){
+            refinedMeshes_.resize(meshes_.size());
+            rebuild = true;
+        }
+        //Temporaries of a frame don't go to the heap
+        LinearArena& scratch = getThreadScratch();
+        LinearArenaScope scope(scratch);
+        s32 maxTasks = 0;
+        for(s32 i=0; i<meshes_.size(); ++i){
+            maxTasks += meshes_[i].getNumPrimitives();
+        }
+        RefineTask* tasks = scratch.allocate<RefineTask>(maxTasks);
+        s32 numTasks = 0;
+
+        //A mesh is refined once, by the last node referring it
+        bool* refined = scratch.allocate<bool>(meshes_.size());
+        for(s32 i=0; i<meshes_.size(); ++i){
+            refined[i] = false;
+        }
+        for(s32 inode=nodes_.size()-1; 0<=inode; --inode){
+            const Node& node = nodes_[inode];
             s32 imesh = node.getMesh();
-            if(0<=imesh){
-                refinedMeshes_[imesh].refine(meshes_[imesh], node.getWorldMatrix());
+            if(imesh<0 || refined[imesh]){
+                continue;
+            }
+            refined[imesh] = true;
+            const Mesh& mesh = meshes_[imesh];
+            Mesh& refinedMesh = refinedMeshes_[imesh];
+            if(refinedMesh.getNumPrimitives() != mesh.getNumPrimitives()){
+                refinedMesh.resize(mesh.getNumPrimitives());
+                rebuild = true;
             }
+            //Skinned vertices are placed by joints, not by the node
+            const Skin* skin = (0<=node.getSkin())? &skins_[node.getSkin()] : NULL;
+            for(s32 i=0; i<mesh.getNumPrimitives(); ++i){
+                const Primitive& primitive = mesh.getPrimitive(i);
+                //Proxies refer triangles by index, a refit is valid only for the same counts
+                if(refinedMesh.getPrimitive(i).getNumTriangles() != primitive.getNumTriangles()){
+                    rebuild = true;
+                }
+                RefineTask task;
+                task.dst_ = &refinedMesh.getPrimitive(i);
+                task.src_ = &primitive;
+                task.matrix_ = &node.getWorldMatrix();
+                bool skinned = NULL != skin && primitive.hasComponent(Primitive::Component_Skin);
+                task.numJoints_ = (skinned)? skin->getNumJoints() : 0;
+                task.palette_ = (skinned)? skin->getPalette() : NULL;
+                task.numWeights_ = node.getNumWeights();
+                task.weights_ = node.getWeights();
+                tasks[numTasks++] = task;
+            }
+        }
+
+        //Refine in parallel, primitives are independent
+        parallelFor(0, numTasks, [tasks](s32 index)
+        {
+            RefineTask& task = tasks[index];
+            if(NULL != task.palette_){
+                task.dst_->refine(*task.src_, task.numJoints_, task.palette_, task.numWeights_, task.weights_);
+            }else{
+                task.dst_->refine(*task.src_, *task.matrix_, task.numWeights_, task.weights_);
+            }
+        });
+
+        //Triangles don't change, only positions do, so refit
+        if(!rebuild && 0<triangleProxies_.size()){
+            accelerator_.refit();
+            return false;
         }
 
         //Get triangle proxies
@@ -117,12 +466,284 @@ namespace lray
                 numTriangles += refinedMeshes_[i].getPrimitive(j).getNumTriangles();
             }
         }
-        accelerator_.build(numTriangles, &triangleProxies_[0]);
+        return true;
     }
 
 
  namespace
  {
+     static const u32 GLBMagic = 0x46546C67U; //glTF
+     static const u32 GLBVersion = 2;
+     static const u32 GLBChunkJSON = 0x4E4F534AU; //JSON
+     static const u32 GLBChunkBIN = 0x004E4942U; //BIN
+
+     /**
+     @brief Input stream on a memory block, used for the JSON chunk of a mapped glb and embedded images
+     */
+     template<class Base>
+     class MemoryStreamBase : public Base
+     {
+     public:
+         MemoryStreamBase()
+             :size_(0)
+             ,position_(0)
+             ,data_(NULL)
+         {}
+
+         MemoryStreamBase(s64 size, const u8* data)
+             :size_(size)
+             ,position_(0)
+             ,data_(data)
+         {}
+
+         virtual bool valid() const
+         {
+             return NULL != data_;
+         }
+
+         virtual bool seek(s64 pos, s32 whence)
+         {
+             switch(whence)
+             {
+             case SEEK_CUR:
+                 pos += position_;
+                 break;
+             case SEEK_END:
+                 pos += size_;
+                 break;
+             default:
+                 break;
+             }
+             if(pos<0 || size_<pos){
+                 return false;
+             }
+             position_ = pos;
+             return true;
+         }
+
+         virtual s64 tell()
+         {
+             return position_;
+         }
+
+         virtual s64 size()
+         {
+             return size_;
+         }
+
+         virtual s64 read(s64 size, void* dst)
+         {
+             size = minimum(size, size_-position_);
+             ::memcpy(dst, data_+position_, static_cast<size_t>(size));
+             position_ += size;
+             return size;
+         }
+     private:
+         s64 size_;
+         s64 position_;
+         const u8* data_;
+     };
+
+     typedef MemoryStreamBase<cppgltf::IStream> MemoryStream;
+     typedef MemoryStreamBase<cppimg::IStream> ImageStream;
+
+     inline u32 readU32(const u8* data)
+     {
+         u32 x;
+         ::memcpy(&x, data, sizeof(u32));
+         return x;
+     }
+
+     /**
+     @brief Find chunks of a mapped glb
+     */
+     bool openGLB(MemoryStream& json, u8*& bin, s64& binSize, MappedFile& file)
+     {
+         bin = NULL;
+         binSize = 0;
+         const s64 HeaderSize = 12;
+         const s64 ChunkHeaderSize = 8;
+         if(file.size()<(HeaderSize+ChunkHeaderSize)){
+             return false;
+         }
+         u8* data = file.data();
+         if(GLBMagic != readU32(data) || GLBVersion != readU32(data+4)){
+             return false;
+         }
+         s64 length = minimum(static_cast<s64>(readU32(data+8)), file.size());
+
+         //The first chunk must be JSON, the second is optional BIN
+         s64 offset = HeaderSize;
+         s64 chunkLength = readU32(data+offset);
+         if(GLBChunkJSON != readU32(data+offset+4) || length<(offset+ChunkHeaderSize+chunkLength)){
+             return false;
+         }
+         json = MemoryStream(chunkLength, data+offset+ChunkHeaderSize);
+         offset += ChunkHeaderSize + chunkLength;
+
+         if((offset+ChunkHeaderSize)<=length){
+             chunkLength = readU32(data+offset);
+             if(GLBChunkBIN == readU32(data+offset+4) && (offset+ChunkHeaderSize+chunkLength)<=length){
+                 bin = data+offset+ChunkHeaderSize;
+                 binSize = chunkLength;
+                 //Start reading geometry ahead while parsing JSON
+                 file.sequential(offset+ChunkHeaderSize, chunkLength);
+                 file.prefetch(offset+ChunkHeaderSize, chunkLength);
+             }
+         }
+         return true;
+     }
+
+     bool hasExtension(const Char* filepath, s32 pathLength, const Char* extension)
+     {
+         s32 length = strlen_s32(extension);
+         if(pathLength<length){
+             return false;
+         }
+         const Char* str = filepath + pathLength - length;
+         for(s32 i=0; i<length; ++i){
+             if(::tolower(str[i]) != extension[i]){
+                 return false;
+             }
+         }
+         return true;
+     }
+
+     /**
+     @brief Where the memory of a glTF buffer comes from
+     */
+     struct BufferSource
+     {
+         u8* data_;
+         s32 mappedFile_; ///< index of a mapped file, or -1 if the memory is owned by glTF
+         bool viewed_; ///< viewed in place by primitives
+     };
+
+     /**
+     @brief States shared by decoders during loading
+     */
+     struct LoadContext
+     {
+         LoadContext(cppgltf::glTF& gltf, u32 flags)
+             :gltf_(gltf)
+             ,flags_(flags)
+             ,buffers_(NULL)
+         {
+             buffers_ = LNEW BufferSource[gltf_.buffers_.size()+1];
+             for(s32 i=0; i<gltf_.buffers_.size(); ++i){
+                 buffers_[i].data_ = gltf_.buffers_[i].data_;
+                 buffers_[i].mappedFile_ = -1;
+                 buffers_[i].viewed_ = false;
+             }
+         }
+
+         ~LoadContext()
+         {
+             LDELETE_ARRAY(buffers_);
+         }
+
+         inline bool isZeroCopy() const
+         {
+             return 0 != (flags_ & LoadFlag_ZeroCopy);
+         }
+
+         inline bool checkFlag(LoadFlag flag) const
+         {
+             return 0 != (flags_ & flag);
+         }
+
+         inline u8* getBufferData(s32 buffer)
+         {
+             return buffers_[buffer].data_;
+         }
+
+         /**
+         @brief Map buffers which glTF has not loaded, the BIN chunk of glb or external files
+         @param binFile ... index of the mapped glb in mappedFiles, which bin is in
+         */
+         void mapBuffers(Scene::MappedFileArray& mappedFiles, const Char* directoryPath, s32 binFile, u8* bin, s64 binSize)
+         {
+             bool binUsed = false;
+             for(s32 i=0; i<gltf_.buffers_.size(); ++i){
+                 cppgltf::Buffer& buffer = gltf_.buffers_[i];
+                 if(NULL != buffer.data_){
+                     continue;
+                 }
+                 if(buffer.uri_.length()<=0){
+                     //Only the first buffer without uri refers the BIN chunk
+                     if(!binUsed && NULL != bin && buffer.byteLength_<=binSize){
+                         LASSERT(0<=binFile && binFile<mappedFiles.size());
+                         buffers_[i].data_ = bin;
+                         buffers_[i].mappedFile_ = binFile;
+                         binUsed = true;
+                     }
+                     continue;
+                 }
+                 if(0 == ::strncmp(buffer.uri_.c_str(), "data:", 5)){
+                     continue;
+                 }
+                 String path(directoryPath);
+                 path.append(buffer.uri_.c_str());
+                 MappedFile file;
+                 if(!file.open(path.c_str()) || file.size()<buffer.byteLength_){
+                     continue;
+                 }
+                 file.sequential(0, file.size());
+                 file.prefetch(0, file.size());
+                 buffers_[i].data_ = file.data();
+                 buffers_[i].mappedFile_ = mappedFiles.size();
+                 mappedFiles.push_back(move(file));
+             }
+         }
+
+         cppgltf::glTF& gltf_;
+         u32 flags_;
+         BufferSource* buffers_;
+     };
+
+     /**
+     @brief A primitive to be decoded, which is independent of the others
+     */
+     struct DecodeTask
+     {
+         DecodeTask()
+             :mesh_(-1)
+             ,gltfPrimitive_(NULL)
+             ,normalizeInPlace_(false)
+             ,flags_(0)
+             ,numViewed_(0)
+         {}
+
+         /**
+         @brief Record a buffer viewed in place, the buffer will be adopted by the scene
+         */
+         inline void view(s32 buffer)
+         {
+             LASSERT(numViewed_<MaxViewed);
+             viewed_[numViewed_++] = buffer;
+         }
+
+         static const s32 MaxViewed = 3;
+
+         s32 mesh_;
+         cppgltf::Primitive* gltfPrimitive_;
+         bool normalizeInPlace_; ///< The first task viewing shared normals normalizes them
+         s32 flags_;
+         s32 numViewed_;
+         s32 viewed_[MaxViewed];
+         Primitive primitive_;
+     };
+
+     //Lists of the loader are built by push_back, grow geometrically
+     typedef Array<DecodeTask, ArrayGeometricCapacityIncrement<> > DecodeTaskArray;
+     typedef Array<GeometryCache::PageInfo, ArrayGeometricCapacityIncrement<> > PageInfoArray;
+     typedef Array<Primitive, ArrayGeometricCapacityIncrement<> > PrimitiveList;
+
+     inline bool isAligned4(const u8* data)
+     {
+         return 0 == (reinterpret_cast<uintptr_t>(data) & 0x03U);
+     }
+
      cppgltf::Attribute* findPrimitiveAttributes(cppgltf::Primitive& primitive, s32 semanticType, s32 semanticIndex)
      {
          for(s32 i=0; i<primitive.attributes_.size(); ++i){
@@ -135,8 +756,9 @@ namespace lray
          return NULL;
      }
 
-     void createPositions(s32& numPositions, Vector3** positions, cppgltf::glTF& gltf, cppgltf::Primitive& primitive)
+     void createPositions(s32& numPositions, Vector3** positions, DecodeTask& task, LoadContext& context, cppgltf::Primitive& primitive)
      {
+         cppgltf::glTF& gltf = context.gltf_;
          numPositions = 0;
          *positions = NULL;
          //Check having position attribute
@@ -162,12 +784,22 @@ namespace lray
              return;
          }
 
-         cppgltf::Buffer& buffer = gltf.buffers_[bufferView.buffer_];
+         u8* bufferData = context.getBufferData(bufferView.buffer_);
+         if(NULL == bufferData){
+             return;
+         }
          s32 byteStride = (bufferView.byteStride_<=0)? sizeof(f32)*3 : bufferView.byteStride_;
          numPositions = accessor.count_;
+         u8* data = bufferData + bufferView.byteOffset_ + accessor.byteOffset_;
+         if(context.isZeroCopy() && sizeof(Vector3) == byteStride && isAligned4(data)){
+             //Tightly packed, view in place
+             *positions = reinterpret_cast<Vector3*>(data);
+             task.flags_ |= Primitive::Flag_SharedPositions;
+             task.view(bufferView.buffer_);
+             return;
+         }
          *positions = LNEW Vector3[numPositions];
          Vector3 bmin(F32_INFINITY), bmax(-F32_INFINITY);
-         u8* data = buffer.data_ + bufferView.byteOffset_ + accessor.byteOffset_;
          for(s32 i=0; i<numPositions; ++i, data+=byteStride){
              Vector3* p = reinterpret_cast<Vector3*>(data);
              bmin = minimum(*p, bmin);
@@ -176,8 +808,9 @@ namespace lray
          }
      }
 
-     void createNormals(s32& numNormals, Vector3** normals, cppgltf::glTF& gltf, cppgltf::Primitive& primitive)
+     void createNormals(s32& numNormals, Vector3** normals, DecodeTask& task, LoadContext& context, cppgltf::Primitive& primitive)
      {
+         cppgltf::glTF& gltf = context.gltf_;
          numNormals = 0;
          *normals = NULL;
          //Check having normal attribute
@@ -203,122 +836,53 @@ namespace lray
              return;
          }
 
-         cppgltf::Buffer& buffer = gltf.buffers_[bufferView.buffer_];
+         u8* bufferData = context.getBufferData(bufferView.buffer_);
+         if(NULL == bufferData){
+             return;
+         }
          s32 byteStride = (bufferView.byteStride_<=0)? sizeof(f32)*3 : bufferView.byteStride_;
          numNormals = accessor.count_;
+         u8* data = bufferData + bufferView.byteOffset_ + accessor.byteOffset_;
+         if(context.isZeroCopy() && sizeof(Vector3) == byteStride && isAligned4(data)){
+             //Tightly packed, normalize and view in place
+             *normals = reinterpret_cast<Vector3*>(data);
+             if(task.normalizeInPlace_){
+                 for(s32 i=0; i<numNormals; ++i){
+                     (*normals)[i] = normalize((*normals)[i]);
+                 }
+             }
+             task.flags_ |= Primitive::Flag_SharedNormals;
+             task.view(bufferView.buffer_);
+             return;
+         }
          *normals = LNEW Vector3[numNormals];
-         u8* data = buffer.data_ + bufferView.byteOffset_ + accessor.byteOffset_;
          for(s32 i=0; i<numNormals; ++i, data+=byteStride){
              Vector3* p = reinterpret_cast<Vector3*>(data);
              (*normals)[i] = normalize(*p);
          }
      }
 
-     void generateTriangles(s32& numTriangles, Triangle** triangles, s32 primitiveMode, s32 numPositions)
-     {
-         switch(primitiveMode)
-         {
-         case cppgltf::GLTF_PRIMITIVE_TRIANGLES:
-         {
-             numTriangles = numPositions/3;
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             for(s32 i=0; i<numPositions; i+=3, ++tri){
-                 tri->indices_[0] = i;
-                 tri->indices_[1] = i+1;
-                 tri->indices_[2] = i+2;
-             }
-         }
-         break;
-         case cppgltf::GLTF_PRIMITIVE_TRIANGLE_STRIP:
-         {
-             numTriangles = maximum(numPositions-2, 0);
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             for(s32 i=2; i<numPositions; ++i, ++tri){
-                 tri->indices_[0] = i-2;
-                 tri->indices_[1] = i-1;
-                 tri->indices_[2] = i;
-             }
-         }
-         break;
-         case cppgltf::GLTF_PRIMITIVE_TRIANGLE_FAN:
-         {
-             numTriangles = maximum(numPositions-2, 0);
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             for(s32 i=2; i<numPositions; ++i, ++tri){
-                 tri->indices_[0] = 0;
-                 tri->indices_[1] = i-1;
-                 tri->indices_[2] = i;
-             }
-         }
-         break;
-         default:
-             numTriangles = 0;
-             *triangles = NULL;
-             break;
-         }
-     }
-
-     template<class T>
-     void createTriangles(s32& numTriangles, Triangle** triangles, s32 primitiveMode, s32 numIndices, s32 byteStride, u8* data)
+     bool getTriangleTopology(TriangleTopology& topology, s32 primitiveMode)
      {
          switch(primitiveMode)
          {
          case cppgltf::GLTF_PRIMITIVE_TRIANGLES:
-         {
-             numTriangles = numIndices/3;
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             for(s32 i=0; i<numIndices; i+=3, ++tri){
-                 tri->indices_[0] = *reinterpret_cast<T*>(data);
-                 data += byteStride;
-                 tri->indices_[1] = *reinterpret_cast<T*>(data);
-                 data += byteStride;
-                 tri->indices_[2] = *reinterpret_cast<T*>(data);
-                 data += byteStride;
-             }
-         }
-         break;
+             topology = TriangleTopology_List;
+             return true;
          case cppgltf::GLTF_PRIMITIVE_TRIANGLE_STRIP:
-         {
-             numTriangles = maximum(numIndices-2, 0);
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             data += byteStride;
-             for(s32 i=2; i<numIndices; ++i, ++tri){
-                 tri->indices_[0] = *reinterpret_cast<T*>(data-byteStride);
-                 tri->indices_[1] = *reinterpret_cast<T*>(data);
-                 tri->indices_[2] = *reinterpret_cast<T*>(data+byteStride);
-                 data += byteStride;
-             }
-         }
-         break;
+             topology = TriangleTopology_Strip;
+             return true;
          case cppgltf::GLTF_PRIMITIVE_TRIANGLE_FAN:
-         {
-             numTriangles = maximum(numIndices-2, 0);
-             *triangles = LNEW Triangle[numTriangles];
-             Triangle* tri = *triangles;
-             T index0 = *reinterpret_cast<T*>(data);
-             data += byteStride;
-             for(s32 i=2; i<numIndices; ++i, ++tri){
-                 tri->indices_[0] = index0;
-                 tri->indices_[1] = *reinterpret_cast<T*>(data);
-                 tri->indices_[2] = *reinterpret_cast<T*>(data+byteStride);
-                 data += byteStride;
-             }
-         }
-         break;
+             topology = TriangleTopology_Fan;
+             return true;
          default:
-             numTriangles = 0;
-             *triangles = NULL;
-             break;
+             return false;
          }
      }
 
-     void createTriangles(s32& numTriangles, Triangle** triangles, cppgltf::glTF& gltf, cppgltf::Primitive& primitive)
+     void createTriangles(s32& numTriangles, Triangle** triangles, DecodeTask& task, LoadContext& context, cppgltf::Primitive& primitive)
      {
+         cppgltf::glTF& gltf = context.gltf_;
          numTriangles = 0;
          *triangles = NULL;
          //Check having position attribute
@@ -331,9 +895,16 @@ namespace lray
          }
          cppgltf::Accessor& positionAccessor = gltf.accessors_[attribute->accessor_];
 
+         TriangleTopology topology;
+         if(!getTriangleTopology(topology, primitive.mode_)){
+             return;
+         }
+
          if(primitive.indices_<0 || gltf.accessors_.size()<=primitive.indices_){
              //Don't have indices, then create indices
-             generateTriangles(numTriangles, triangles, primitive.mode_, positionAccessor.count_);
+             numTriangles = getNumTriangles(topology, positionAccessor.count_);
+             *triangles = LNEW Triangle[numTriangles];
+             generateTriangles(*triangles, topology, positionAccessor.count_);
              return;
          }
 
@@ -355,103 +926,941 @@ namespace lray
              return;
          }
 
-         cppgltf::Buffer& buffer = gltf.buffers_[bufferView.buffer_];
-         s32 byteStride;
+         u8* bufferData = context.getBufferData(bufferView.buffer_);
+         if(NULL == bufferData){
+             return;
+         }
 
-         u8* data = buffer.data_ + bufferView.byteOffset_ + indexAccessor.byteOffset_;
+         u8* data = bufferData + bufferView.byteOffset_ + indexAccessor.byteOffset_;
 
-         switch(indexAccessor.componentType_){
-         case cppgltf::GLTF_TYPE_UNSIGNED_SHORT:
-         {
-             byteStride = (bufferView.byteStride_<=0)? 2 : bufferView.byteStride_;
-             createTriangles<u16>(numTriangles, triangles, primitive.mode_, indexAccessor.count_, byteStride, data);
-         }
-         break;
-         case cppgltf::GLTF_TYPE_INT:
-         {
-             byteStride = (bufferView.byteStride_<=0)? 4 : bufferView.byteStride_;
-             createTriangles<s32>(numTriangles, triangles, primitive.mode_, indexAccessor.count_, byteStride, data);
-         }
-         break;
-         case cppgltf::GLTF_TYPE_UNSIGNED_INT:
-         {
-             byteStride = (bufferView.byteStride_<=0)? 4 : bufferView.byteStride_;
-             createTriangles<u32>(numTriangles, triangles, primitive.mode_, indexAccessor.count_, byteStride, data);
+         if(context.isZeroCopy()
+             && cppgltf::GLTF_PRIMITIVE_TRIANGLES == primitive.mode_
+             && cppgltf::GLTF_TYPE_UNSIGNED_SHORT != indexAccessor.componentType_
+             && (bufferView.byteStride_<=0 || sizeof(s32) == bufferView.byteStride_)
+             && isAligned4(data)){
+             //Tightly packed 32bit triangle list has the same layout as Triangle, view in place
+             numTriangles = indexAccessor.count_/3;
+             *triangles = reinterpret_cast<Triangle*>(data);
+             task.flags_ |= Primitive::Flag_SharedTriangles;
+             task.view(bufferView.buffer_);
+             return;
          }
-         break;
+
+         numTriangles = getNumTriangles(topology, indexAccessor.count_);
+         *triangles = LNEW Triangle[numTriangles];
+         if(cppgltf::GLTF_TYPE_UNSIGNED_SHORT == indexAccessor.componentType_){
+             if(bufferView.byteStride_<=0 || sizeof(u16) == bufferView.byteStride_){
+                 expandTriangles(*triangles, topology, indexAccessor.count_, reinterpret_cast<const u16*>(data));
+             }else{
+                 expandTrianglesStrided<u16>(*triangles, topology, indexAccessor.count_, bufferView.byteStride_, data);
+             }
+         }else{
+             //Signed and unsigned 32bit indices have the same bits
+             if(bufferView.byteStride_<=0 || sizeof(u32) == bufferView.byteStride_){
+                 expandTriangles(*triangles, topology, indexAccessor.count_, reinterpret_cast<const u32*>(data));
+             }else{
+                 expandTrianglesStrided<u32>(*triangles, topology, indexAccessor.count_, bufferView.byteStride_, data);
+             }
          }
      }
 
-     Primitive createPrimitive(cppgltf::glTF& gltf, cppgltf::Primitive& gltfPrimitive)
+     /**
+     @brief Find data of an accessor with expected type
+     @return NULL if not found
+     */
+     const u8* findAccessorData(s32& count, s32& byteStride, s32& componentType, LoadContext& context, s32 accessorIndex, s32 type)
      {
-         s32 numVertices;
-         Vector3* positions = NULL;
-         createPositions(numVertices, &positions, gltf, gltfPrimitive);
-
-         s32 numNormals;
-         Vector3* normals = NULL;
-         createNormals(numNormals, &normals, gltf, gltfPrimitive);
-
-         s32 numTriangles;
-         Triangle* triangles = NULL;
-         createTriangles(numTriangles, &triangles, gltf, gltfPrimitive);
-         return Primitive(numVertices, positions, normals, numTriangles, triangles);
-     }
+         cppgltf::glTF& gltf = context.gltf_;
+         if(accessorIndex<0 || gltf.accessors_.size()<=accessorIndex){
+             return NULL;
+         }
+         cppgltf::Accessor& accessor = gltf.accessors_[accessorIndex];
+         if(accessor.type_ != type){
+             return NULL;
+         }
+         s32 componentSize;
+         switch(accessor.componentType_){
+         case cppgltf::GLTF_TYPE_UNSIGNED_BYTE:
+             componentSize = 1;
+             break;
+         case cppgltf::GLTF_TYPE_UNSIGNED_SHORT:
+             componentSize = 2;
+             break;
+         case cppgltf::GLTF_TYPE_FLOAT:
+             componentSize = 4;
+             break;
+         default:
+             return NULL;
+         }
+         if(accessor.bufferView_<0 || gltf.bufferViews_.size()<=accessor.bufferView_){
+             return NULL;
+         }
+         cppgltf::BufferView& bufferView = gltf.bufferViews_[accessor.bufferView_];
+         if(bufferView.buffer_<0 || gltf.buffers_.size()<=bufferView.buffer_){
+             return NULL;
+         }
+         u8* bufferData = context.getBufferData(bufferView.buffer_);
+         if(NULL == bufferData){
+             return NULL;
+         }
+         s32 numComponents;
+         switch(type){
+         case cppgltf::GLTF_TYPE_VEC2:
+             numComponents = 2;
+             break;
+         case cppgltf::GLTF_TYPE_VEC3:
+             numComponents = 3;
+             break;
+         case cppgltf::GLTF_TYPE_MAT4:
+             numComponents = 16;
+             break;
+         default:
+             numComponents = 4;
+             break;
+         }
+         count = accessor.count_;
+         byteStride = (bufferView.byteStride_<=0)? componentSize*numComponents : bufferView.byteStride_;
+         componentType = accessor.componentType_;
+         return bufferData + bufferView.byteOffset_ + accessor.byteOffset_;
+     }
+
+     inline f32 readNormalized(const u8* data, s32 componentType, s32 index)
+     {
+         switch(componentType){
+         case cppgltf::GLTF_TYPE_UNSIGNED_BYTE:
+             return data[index] * (1.0f/255.0f);
+         case cppgltf::GLTF_TYPE_UNSIGNED_SHORT:
+             return reinterpret_cast<const u16*>(data)[index] * (1.0f/65535.0f);
+         default:
+             return reinterpret_cast<const f32*>(data)[index];
+         }
+     }
+
+     /**
+     @brief Create skin weights from JOINTS_0 and WEIGHTS_0
+     @return NULL if the primitive is not skinned
+     */
+     SkinWeight* createSkinWeights(s32 numVertices, LoadContext& context, cppgltf::Primitive& primitive)
+     {
+         cppgltf::Attribute* jointsAttribute = findPrimitiveAttributes(primitive, cppgltf::GLTF_ATTRIBUTE_JOINTS, 0);
+         cppgltf::Attribute* weightsAttribute = findPrimitiveAttributes(primitive, cppgltf::GLTF_ATTRIBUTE_WEIGHTS, 0);
+         if(numVertices<=0 || NULL == jointsAttribute || NULL == weightsAttribute){
+             return NULL;
+         }
+         s32 numJoints, jointStride, jointType;
+         const u8* joints = findAccessorData(numJoints, jointStride, jointType, context, jointsAttribute->accessor_, cppgltf::GLTF_TYPE_VEC4);
+         s32 numWeights, weightStride, weightType;
+         const u8* weights = findAccessorData(numWeights, weightStride, weightType, context, weightsAttribute->accessor_, cppgltf::GLTF_TYPE_VEC4);
+         if(NULL == joints || NULL == weights
+             || cppgltf::GLTF_TYPE_FLOAT == jointType
+             || numJoints<numVertices || numWeights<numVertices){
+             return NULL;
+         }
+
+         SkinWeight* skinWeights = LNEW SkinWeight[numVertices];
+         for(s32 i=0; i<numVertices; ++i, joints+=jointStride, weights+=weightStride){
+             SkinWeight& skinWeight = skinWeights[i];
+             f32 total = 0.0f;
+             for(s32 j=0; j<SkinWeight::NumInfluences; ++j){
+                 skinWeight.joints_[j] = (cppgltf::GLTF_TYPE_UNSIGNED_BYTE == jointType)? joints[j] : reinterpret_cast<const u16*>(joints)[j];
+                 skinWeight.weights_[j] = readNormalized(weights, weightType, j);
+                 total += skinWeight.weights_[j];
+             }
+             //Weights should sum to one, but quantized ones don't exactly
+             f32 invTotal = (F32_EPSILON<total)? 1.0f/total : 0.0f;
+             for(s32 j=0; j<SkinWeight::NumInfluences; ++j){
+                 skinWeight.weights_[j] *= invTotal;
+             }
+         }
+         return skinWeights;
+     }
+
+     /**
+     @brief Create texture coordinates from TEXCOORD_0
+     @return NULL if the primitive has no texture coordinates
+     */
+     Vector2* createTexcoords(s32 numVertices, LoadContext& context, cppgltf::Primitive& primitive)
+     {
+         cppgltf::Attribute* attribute = findPrimitiveAttributes(primitive, cppgltf::GLTF_ATTRIBUTE_TEXCOORD, 0);
+         if(numVertices<=0 || NULL == attribute){
+             return NULL;
+         }
+         s32 count, byteStride, componentType;
+         const u8* data = findAccessorData(count, byteStride, componentType, context, attribute->accessor_, cppgltf::GLTF_TYPE_VEC2);
+         if(NULL == data || count<numVertices){
+             return NULL;
+         }
+
+         //Normalized integers are allowed as well as floats
+         Vector2* texcoords = LNEW Vector2[numVertices];
+         for(s32 i=0; i<numVertices; ++i, data+=byteStride){
+             texcoords[i].set(readNormalized(data, componentType, 0), readNormalized(data, componentType, 1));
+         }
+         return texcoords;
+     }
+
+     /**
+     @brief Create sparse morph targets, keeping only vertices which have non-zero deltas
+     */
+     void createMorphTargets(Primitive::MorphTargetArray& morphTargets, s32 numVertices, LoadContext& context, cppgltf::Primitive& primitive)
+     {
+         morphTargets.resize(primitive.targets_.size());
+         if(numVertices<=0){
+             return;
+         }
+         s32* indices = LNEW s32[numVertices];
+         for(s32 i=0; i<primitive.targets_.size(); ++i){
+             cppgltf::Target& target = primitive.targets_[i];
+             const u8* positions = NULL;
+             const u8* normals = NULL;
+             s32 positionStride = 0, normalStride = 0;
+             for(s32 j=0; j<target.attributes_.size(); ++j){
+                 cppgltf::Attribute& attribute = target.attributes_[j];
+                 if(0 != attribute.semanticIndex_){
+                     continue;
+                 }
+                 s32 count, byteStride, componentType;
+                 const u8* data = findAccessorData(count, byteStride, componentType, context, attribute.accessor_, cppgltf::GLTF_TYPE_VEC3);
+                 if(NULL == data || cppgltf::GLTF_TYPE_FLOAT != componentType || count<numVertices){
+                     continue;
+                 }
+                 if(cppgltf::GLTF_ATTRIBUTE_POSITION == attribute.semanticType_){
+                     positions = data;
+                     positionStride = byteStride;
+                 }else if(cppgltf::GLTF_ATTRIBUTE_NORMAL == attribute.semanticType_){
+                     normals = data;
+                     normalStride = byteStride;
+                 }
+             }
+
+             //Gather vertices which move
+             static const Vector3 Zero(0.0f);
+             s32 numDeltas = 0;
+             for(s32 j=0; j<numVertices; ++j){
+                 const Vector3* p = (NULL != positions)? reinterpret_cast<const Vector3*>(positions + positionStride*j) : &Zero;
+                 const Vector3* n = (NULL != normals)? reinterpret_cast<const Vector3*>(normals + normalStride*j) : &Zero;
+                 if(0.0f != p->x_ || 0.0f != p->y_ || 0.0f != p->z_
+                     || 0.0f != n->x_ || 0.0f != n->y_ || 0.0f != n->z_){
+                     indices[numDeltas++] = j;
+                 }
+             }
+             if(numDeltas<=0){
+                 continue;
+             }
+
+             s32* deltaIndices = LNEW s32[numDeltas];
+             Vector3* positionDeltas = LNEW Vector3[numDeltas];
+             Vector3* normalDeltas = (NULL != normals)? LNEW Vector3[numDeltas] : NULL;
+             for(s32 j=0; j<numDeltas; ++j){
+                 s32 index = indices[j];
+                 deltaIndices[j] = index;
+                 positionDeltas[j] = (NULL != positions)? *reinterpret_cast<const Vector3*>(positions + positionStride*index) : Zero;
+                 if(NULL != normalDeltas){
+                     normalDeltas[j] = *reinterpret_cast<const Vector3*>(normals + normalStride*index);
+                 }
+             }
+             morphTargets[i] = move(MorphTarget(numDeltas, deltaIndices, positionDeltas, normalDeltas));
+         }
+         LDELETE_ARRAY(indices);
+     }
+
+     Skin createSkin(LoadContext& context, cppgltf::Skin& gltfSkin, const s32* nodeRemap)
+     {
+         Skin::JointArray joints;
+         Skin::MatrixArray inverseBindMatrices;
+         joints.resize(gltfSkin.joints_.size());
+         inverseBindMatrices.resize(gltfSkin.joints_.size());
+
+         s32 count = 0, byteStride = 0, componentType = 0;
+         const u8* data = findAccessorData(count, byteStride, componentType, context, gltfSkin.inverseBindMatrices_, cppgltf::GLTF_TYPE_MAT4);
+         if(cppgltf::GLTF_TYPE_FLOAT != componentType){
+             data = NULL;
+         }
+         for(s32 i=0; i<joints.size(); ++i){
+             s32 joint = gltfSkin.joints_[i];
+             joints[i] = (0<=joint && joint<context.gltf_.nodes_.size())? nodeRemap[joint] : -1;
+             if(joints[i]<0){
+                 joints[i] = 0;
+             }
+             Matrix44& matrix = inverseBindMatrices[i];
+             if(NULL == data || count<=i){
+                 matrix.identity();
+                 continue;
+             }
+             const f32* m = reinterpret_cast<const f32*>(data + byteStride*i);
+             for(s32 r=0; r<4; ++r){
+                 for(s32 c=0; c<4; ++c){
+                     matrix.m_[r][c] = m[c*4+r]; //transpose glTF matrix
+                 }
+             }
+         }
+         return Skin(move(joints), move(inverseBindMatrices));
+     }
+
+     void createPrimitive(DecodeTask& task, LoadContext& context)
+     {
+         cppgltf::Primitive& gltfPrimitive = *task.gltfPrimitive_;
+         s32 numVertices;
+         Vector3* positions = NULL;
+         createPositions(numVertices, &positions, task, context, gltfPrimitive);
+
+         s32 numNormals;
+         Vector3* normals = NULL;
+         createNormals(numNormals, &normals, task, context, gltfPrimitive);
+
+         s32 numTriangles;
+         Triangle* triangles = NULL;
+         createTriangles(numTriangles, &triangles, task, context, gltfPrimitive);
+         task.primitive_ = Primitive(numVertices, positions, normals, numTriangles, triangles, task.flags_);
+         task.primitive_.setSkinWeights(createSkinWeights(numVertices, context, gltfPrimitive));
+         task.primitive_.setTexcoords(createTexcoords(numVertices, context, gltfPrimitive));
+         if(0<gltfPrimitive.targets_.size()){
+             Primitive::MorphTargetArray morphTargets;
+             createMorphTargets(morphTargets, numVertices, context, gltfPrimitive);
+             task.primitive_.setMorphTargets(move(morphTargets));
+         }
+
+         //Storages viewed in place are left as they are
+         if(0 != task.flags_){
+             return;
+         }
+         if(context.checkFlag(LoadFlag_Weld)){
+             task.primitive_.weld();
+         }
+         if(context.checkFlag(LoadFlag_Reorder)){
+             task.primitive_.reorder();
+         }
+     }
+
+     /**
+     @brief Size and modification time of a source file, caches of other stamps are rebuilt
+     */
+     struct SourceStamp
+     {
+         s64 size_;
+         s64 modified_;
+         u64 dependencies_; ///< hash of sizes and modification times of external buffers and images
+     };
+
+     bool getSourceStamp(SourceStamp& stamp, const Char* path)
+     {
+#ifdef _MSC_VER
+         struct _stat64 fileStat;
+         bool result = 0 == _stat64(path, &fileStat);
+#else
+         struct stat fileStat;
+         bool result = 0 == stat(path, &fileStat);
+#endif
+         stamp.size_ = result? static_cast<s64>(fileStat.st_size) : -1;
+         stamp.modified_ = result? static_cast<s64>(fileStat.st_mtime) : -1;
+         stamp.dependencies_ = 0;
+         return result;
+     }
+
+     static const u64 HashBasis = 0xCBF29CE484222325ULL;
+
+     //FNV-1a
+     u64 hashBytes(u64 hash, const void* data, s64 size)
+     {
+         const u8* bytes = reinterpret_cast<const u8*>(data);
+         for(s64 i=0; i<size; ++i){
+             hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+         }
+         return hash;
+     }
+
+     //The stamp of a file referred by a uri, embedded data are covered by the glTF itself
+     u64 hashUriStamp(u64 hash, const Char* directoryPath, const Char* uri)
+     {
+         if(NULL == uri || '\0' == uri[0] || 0 == ::strncmp(uri, "data:", 5)){
+             return hash;
+         }
+         String path(directoryPath);
+         path.append(uri);
+         SourceStamp stamp;
+         getSourceStamp(stamp, path.c_str());
+         const s64 values[2] = {stamp.size_, stamp.modified_};
+         return hashBytes(hash, values, sizeof(values));
+     }
+
+     /**
+     @brief Stamp of a glTF with external buffers and images it refers
+     */
+     void getSourceStamp(SourceStamp& stamp, const cppgltf::glTF& gltf, const Char* filepath, const Char* directoryPath)
+     {
+         getSourceStamp(stamp, filepath);
+         u64 hash = HashBasis;
+         for(s32 i=0; i<gltf.buffers_.size(); ++i){
+             hash = hashUriStamp(hash, directoryPath, gltf.buffers_[i].uri_.c_str());
+         }
+         for(s32 i=0; i<gltf.images_.size(); ++i){
+             hash = hashUriStamp(hash, directoryPath, gltf.images_[i].uri_.c_str());
+         }
+         stamp.dependencies_ = hash;
+     }
+
+     inline bool equal(const SourceStamp& stamp0, const SourceStamp& stamp1)
+     {
+         return stamp0.size_ == stamp1.size_
+             && stamp0.modified_ == stamp1.modified_
+             && stamp0.dependencies_ == stamp1.dependencies_;
+     }
+
+     std::mutex cacheDirectoryMutex_;
+     String cacheDirectory_;
+     std::atomic<u32> numTempFiles_(0);
+
+     inline void appendHex(String& str, u64 value)
+     {
+         static const Char Digits[] = "0123456789abcdef";
+         for(s32 i=60; 0<=i; i-=4){
+             str.append(Digits[(value>>i)&0x0FU]);
+         }
+     }
+
+     /**
+     @brief Path of a cache file, next to the scene, or in the cache directory named with a hash of the full path
+     */
+     void getCachePath(String& path, const Char* filepath, const Char* extension)
+     {
+         {
+             std::lock_guard<std::mutex> lock(cacheDirectoryMutex_);
+             path = cacheDirectory_;
+         }
+         if(path.length()<=0){
+             path.assign(filepath);
+             path.append(extension);
+             return;
+         }
+         if(PathDelimiter != path[path.length()-1]){
+             path.append(PathDelimiter);
+         }
+         s32 length = strlen_s32(filepath);
+         path.append(filepath + extractDirectoryPath(NULL, length, filepath));
+         path.append('.');
+         appendHex(path, hashBytes(HashBasis, filepath, length));
+         path.append(extension);
+     }
+
+     /**
+     @brief Unique path to write a cache to, which is renamed to the cache when completed
+     */
+     void getTempPath(String& tempPath, const String& path)
+     {
+#ifdef _MSC_VER
+         u64 process = static_cast<u64>(_getpid());
+#else
+         u64 process = static_cast<u64>(getpid());
+#endif
+         tempPath = path;
+         tempPath.append('.');
+         appendHex(tempPath, (process<<32) | numTempFiles_.fetch_add(1));
+         tempPath.append(".tmp");
+     }
+
+     /**
+     @brief Replace a cache with a temporary file written, other loads never see a partial cache
+     */
+     bool commitTempFile(const Char* tempPath, const Char* path, bool written)
+     {
+         if(written){
+#ifdef _MSC_VER
+             //rename does not overwrite
+             remove(path);
+#endif
+             written = 0 == rename(tempPath, path);
+         }
+         if(!written){
+             remove(tempPath);
+         }
+         return written;
+     }
+
+     static const u32 TextureCacheMagic = 0x3043544CU; //LTC0
+     static const u32 TextureCacheVersion = 3;
+
+     /**
+     @brief Header of a texture cache file, which is written last so that a partial file is never valid
+     */
+     struct TextureCacheHeader
+     {
+         u32 magic_;
+         u32 version_;
+         s32 numTextures_;
+         s32 reserved_;
+         SourceStamp source_;
+     };
+
+     struct TextureCacheEntry
+     {
+         s32 numLevels_;
+         s32 reserved_;
+         Texture::Level levels_[Texture::MaxLevels];
+     };
+
+     /**
+     @brief Decode an image to RGBA8
+     @return NULL if failed
+     */
+     u32* decodeImage(s32& width, s32& height, const u8* data, s64 size)
+     {
+         width = height = 0;
+         if(size<4){
+             return NULL;
+         }
+         typedef bool (*ReadFunc)(cppimg::IStream&, cppimg::s32&, cppimg::s32&, cppimg::ColorType&, cppimg::u8*);
+         ReadFunc readFunc;
+         if(0x89U == data[0] && 'P' == data[1] && 'N' == data[2] && 'G' == data[3]){
+             readFunc = cppimg::PNG::read;
+         }else if(0xFFU == data[0] && 0xD8U == data[1]){
+             readFunc = cppimg::JPEG::read;
+         }else if('B' == data[0] && 'M' == data[1]){
+             readFunc = cppimg::BMP::read;
+         }else{
+             readFunc = cppimg::TGA::read;
+         }
+
+         //Read the header first, then pixels
+         ImageStream stream(size, data);
+         cppimg::ColorType colorType;
+         if(!readFunc(stream, width, height, colorType, NULL) || width<=0 || height<=0){
+             return NULL;
+         }
+         s32 numChannels;
+         switch(colorType){
+         case cppimg::ColorType_GRAY:
+             numChannels = 1;
+             break;
+         case cppimg::ColorType_RGB:
+             numChannels = 3;
+             break;
+         default:
+             numChannels = 4;
+             break;
+         }
+         s64 numTexels = static_cast<s64>(width)*height;
+         u8* pixels = LNEW u8[numTexels*numChannels];
+         stream.seek(0, SEEK_SET);
+         if(!readFunc(stream, width, height, colorType, pixels)){
+             LDELETE_ARRAY(pixels);
+             return NULL;
+         }
+
+         u32* image = LNEW u32[numTexels];
+         const u8* p = pixels;
+         for(s64 i=0; i<numTexels; ++i, p+=numChannels){
+             switch(numChannels){
+             case 1:
+                 image[i] = 0xFF000000U | (p[0]<<16) | (p[0]<<8) | p[0];
+                 break;
+             case 3:
+                 image[i] = 0xFF000000U | (p[2]<<16) | (p[1]<<8) | p[0];
+                 break;
+             default:
+                 image[i] = (static_cast<u32>(p[3])<<24) | (p[2]<<16) | (p[1]<<8) | p[0];
+                 break;
+             }
+         }
+         LDELETE_ARRAY(pixels);
+         return image;
+     }
+
+     /**
+     @brief Read the table of a texture cache file
+     @return false if the file is not valid for the glTF
+     */
+     bool readTextureCache(TextureCacheEntry* entries, s32 numTextures, const SourceStamp& source, const Char* path)
+     {
+         FILE* file = fopen(path, "rb");
+         if(NULL == file){
+             return false;
+         }
+         bool result = false;
+         TextureCacheHeader header;
+         if(1 == fread(&header, sizeof(TextureCacheHeader), 1, file)
+             && TextureCacheMagic == header.magic_
+             && TextureCacheVersion == header.version_
+             && numTextures == header.numTextures_
+             && equal(source, header.source_)
+             && static_cast<size_t>(numTextures) == fread(entries, sizeof(TextureCacheEntry), numTextures, file)){
+             result = true;
+             for(s32 i=0; i<numTextures; ++i){
+                 if(entries[i].numLevels_<0 || Texture::MaxLevels<entries[i].numLevels_){
+                     result = false;
+                     break;
+                 }
+             }
+         }
+         fclose(file);
+         return result;
+     }
+
+     /**
+     @brief Decode an image in a buffer view or an external file to RGBA8
+     @return NULL if failed
+     */
+     u32* decodeImage(s32& width, s32& height, LoadContext& context, const Char* directoryPath, s32 index)
+     {
+         cppgltf::glTF& gltf = context.gltf_;
+         cppgltf::Image& gltfImage = gltf.images_[index];
+         const u8* data = NULL;
+         s64 size = 0;
+         MappedFile mappedFile;
+         if(0<=gltfImage.bufferView_ && gltfImage.bufferView_<gltf.bufferViews_.size()){
+             cppgltf::BufferView& bufferView = gltf.bufferViews_[gltfImage.bufferView_];
+             const u8* bufferData = (0<=bufferView.buffer_ && bufferView.buffer_<gltf.buffers_.size())? context.getBufferData(bufferView.buffer_) : NULL;
+             if(NULL != bufferData){
+                 data = bufferData + bufferView.byteOffset_;
+                 size = bufferView.byteLength_;
+             }
+         }else if(0<gltfImage.uri_.length() && 0 != ::strncmp(gltfImage.uri_.c_str(), "data:", 5)){
+             String imagePath(directoryPath);
+             imagePath.append(gltfImage.uri_.c_str());
+             if(mappedFile.open(imagePath.c_str())){
+                 mappedFile.sequential(0, mappedFile.size());
+                 data = mappedFile.data();
+                 size = mappedFile.size();
+             }
+         }
+         width = height = 0;
+         return (NULL != data)? decodeImage(width, height, data, size) : NULL;
+     }
+
+     /**
+     @brief Convert images to tiled mip chains, one image at a time to bound memory usage
+     */
+     bool writeTextureCache(TextureCacheEntry* entries, LoadContext& context, const SourceStamp& source, const Char* directoryPath, const Char* path)
+     {
+         cppgltf::glTF& gltf = context.gltf_;
+         String tempPath;
+         getTempPath(tempPath, String(path));
+         FILE* file = fopen(tempPath.c_str(), "wb");
+         if(NULL == file){
+             return false;
+         }
+
+         //Reserve the header and the table
+         TextureCacheHeader header = {0, 0, gltf.images_.size(), 0, source};
+         s64 offset = sizeof(TextureCacheHeader) + sizeof(TextureCacheEntry)*static_cast<s64>(gltf.images_.size());
+         bool result = 1 == fwrite(&header, sizeof(TextureCacheHeader), 1, file)
+             && seekFile(file, offset);
+
+         for(s32 i=0; result && i<gltf.images_.size(); ++i){
+             TextureCacheEntry& entry = entries[i];
+             memset(&entry, 0, sizeof(TextureCacheEntry));
+
+             s32 width, height;
+             u32* image = decodeImage(width, height, context, directoryPath, i);
+             if(NULL == image){
+                 continue;
+             }
+             entry.numLevels_ = Texture::writeTiles(entry.levels_, file, offset, width, height, image);
+             LDELETE_ARRAY(image);
+             if(entry.numLevels_<=0){
+                 result = false;
+                 break;
+             }
+             const Texture::Level& last = entry.levels_[entry.numLevels_-1];
+             offset = last.offset_ + static_cast<s64>(last.tilesX_)*last.tilesY_*TileCache::TileBytes;
+         }
+
+         //Complete the table, then the header
+         header.magic_ = TextureCacheMagic;
+         header.version_ = TextureCacheVersion;
+         result = result
+             && seekFile(file, sizeof(TextureCacheHeader))
+             && static_cast<size_t>(gltf.images_.size()) == fwrite(entries, sizeof(TextureCacheEntry), gltf.images_.size(), file)
+             && seekFile(file, 0)
+             && 1 == fwrite(&header, sizeof(TextureCacheHeader), 1, file);
+         result = (0 == fclose(file)) && result;
+         return commitTempFile(tempPath.c_str(), path, result);
+     }
+
+     /**
+     @brief Convert images to tiled mip chains in memory, if no cache file can be written
+     */
+     TileCache* createMemoryTextures(Scene::TextureArray& textures, LoadContext& context, const Char* directoryPath)
+     {
+         cppgltf::glTF& gltf = context.gltf_;
+         TileCache* tileCache = LNEW TileCache();
+         textures.resize(gltf.images_.size());
+         for(s32 i=0; i<gltf.images_.size(); ++i){
+             textures[i] = Texture();
+             s32 width, height;
+             u32* image = decodeImage(width, height, context, directoryPath, i);
+             if(NULL == image){
+                 continue;
+             }
+             s64 size = Texture::calcNumTiles(width, height)*TileCache::TileBytes;
+             u8* tiles = LNEW u8[size];
+             Texture::Level levels[Texture::MaxLevels];
+             s32 numLevels = Texture::writeTiles(levels, tiles, width, height, image);
+             LDELETE_ARRAY(image);
+             textures[i] = Texture(tileCache->addMemory(tiles, size), numLevels, levels);
+         }
+         return tileCache;
+     }
+
+     /**
+     @brief Create textures from images through a cache file, or in memory if the cache cannot be written
+     */
+     TileCache* createTextures(Scene::TextureArray& textures, LoadContext& context, const Char* filepath, const Char* directoryPath)
+     {
+         cppgltf::glTF& gltf = context.gltf_;
+         if(gltf.images_.size()<=0){
+             return NULL;
+         }
+         String path;
+         getCachePath(path, filepath, ".ltc");
+
+         SourceStamp source;
+         getSourceStamp(source, gltf, filepath, directoryPath);
+         TextureCacheEntry* entries = LNEW TextureCacheEntry[gltf.images_.size()];
+         bool result = !context.checkFlag(LoadFlag_RebuildCaches) && readTextureCache(entries, gltf.images_.size(), source, path.c_str());
+         if(!result){
+             result = writeTextureCache(entries, context, source, directoryPath, path.c_str());
+         }
+
+         TileCache* tileCache = NULL;
+         if(result){
+             tileCache = LNEW TileCache();
+             s32 file = tileCache->addFile(path.c_str());
+             if(0<=file){
+                 textures.resize(gltf.images_.size());
+                 for(s32 i=0; i<textures.size(); ++i){
+                     textures[i] = Texture(file, entries[i].numLevels_, entries[i].levels_);
+                 }
+             }else{
+                 LDELETE(tileCache);
+             }
+         }
+         LDELETE_ARRAY(entries);
+         if(NULL == tileCache){
+             tileCache = createMemoryTextures(textures, context, directoryPath);
+         }
+         return tileCache;
+     }
+
+     static const u32 GeometryCacheMagic = 0x3043474CU; //LGC0
+     static const u32 GeometryCacheVersion = 3;
+     static const u32 GeometryCacheFlags = LoadFlag_Weld | LoadFlag_Reorder; ///< flags which change pages
+
+     /**
+     @brief Header of a geometry cache file, the table of pages follows pages
+     */
+     struct GeometryCacheHeader
+     {
+         u32 magic_;
+         u32 version_;
+         s32 numPages_;
+         u32 flags_;
+         s64 tableOffset_;
+         SourceStamp source_;
+     };
+
+     bool readGeometryCache(PageInfoArray& pages, u32 flags, const SourceStamp& source, const Char* path)
+     {
+         FILE* file = fopen(path, "rb");
+         if(NULL == file){
+             return false;
+         }
+         bool result = false;
+         GeometryCacheHeader header;
+         if(1 == fread(&header, sizeof(GeometryCacheHeader), 1, file)
+             && GeometryCacheMagic == header.magic_
+             && GeometryCacheVersion == header.version_
+             && (flags & GeometryCacheFlags) == header.flags_
+             && equal(source, header.source_)
+             && 0<=header.numPages_
+             && seekFile(file, header.tableOffset_)){
+             pages.resize(header.numPages_);
+             result = header.numPages_<=0
+                 || static_cast<size_t>(header.numPages_) == fread(&pages[0], sizeof(GeometryCache::PageInfo), header.numPages_, file);
+         }
+         fclose(file);
+         return result;
+     }
+
+     /**
+     @brief Decode meshes one at a time, and write world space primitives of nodes as pages
+     */
+     bool writeGeometryCache(PageInfoArray& pages, DecodeTaskArray& tasks, Scene::NodeArray& nodes, LoadContext& context, const SourceStamp& source, const Char* path)
+     {
+         String tempPath;
+         getTempPath(tempPath, String(path));
+         FILE* file = fopen(tempPath.c_str(), "wb");
+         if(NULL == file){
+             return false;
+         }
+         GeometryCacheHeader header = {0, 0, 0, 0, 0, source};
+         s64 offset = sizeof(GeometryCacheHeader);
+         bool result = 1 == fwrite(&header, sizeof(GeometryCacheHeader), 1, file);
+
+         //Pages are placed in the rest pose, parents are always placed before their children
+         for(s32 i=0; i<nodes.size(); ++i){
+             Node& node = nodes[i];
+             if(node.getParent()<0){
+                 node.getWorldMatrix() = node.getMatrix();
+             }else{
+                 node.getWorldMatrix().mul(nodes[node.getParent()].getWorldMatrix(), node.getMatrix());
+             }
+         }
+
+         for(s32 i=0; result && i<tasks.size();){
+             s32 meshIndex = tasks[i].mesh_;
+             s32 end = i;
+             while(end<tasks.size() && meshIndex == tasks[end].mesh_){
+                 ++end;
+             }
+             parallelFor(i, end, [&tasks, &context](s32 index)
+             {
+                 createPrimitive(tasks[index], context);
+             });
+
+             for(s32 inode=0; result && inode<nodes.size(); ++inode){
+                 const Node& node = nodes[inode];
+                 if(meshIndex != node.getMesh()){
+                     continue;
+                 }
+                 for(s32 j=i; j<end; ++j){
+                     Primitive primitive;
+                     primitive.refine(tasks[j].primitive_, node.getWorldMatrix(), node.getNumWeights(), node.getWeights());
+                     if(primitive.getNumTriangles()<=0){
+                         continue;
+                     }
+                     GeometryCache::PageInfo info;
+                     if(!GeometryCache::writePage(info, file, offset, primitive)){
+                         result = false;
+                         break;
+                     }
+                     offset += GeometryCache::calcFileBytes(info);
+                     pages.push_back(info);
+                 }
+             }
+             for(; i<end; ++i){
+                 tasks[i].primitive_ = move(Primitive());
+             }
+         }
+
+         //Complete the table, then the header
+         header.magic_ = GeometryCacheMagic;
+         header.version_ = GeometryCacheVersion;
+         header.numPages_ = pages.size();
+         header.flags_ = context.flags_ & GeometryCacheFlags;
+         header.tableOffset_ = offset;
+         result = result
+             && (pages.size()<=0 || static_cast<size_t>(pages.size()) == fwrite(&pages[0], sizeof(GeometryCache::PageInfo), pages.size(), file))
+             && seekFile(file, 0)
+             && 1 == fwrite(&header, sizeof(GeometryCacheHeader), 1, file);
+         result = (0 == fclose(file)) && result;
+         return commitTempFile(tempPath.c_str(), path, result);
+     }
+
+     /**
+     @brief Create a geometry cache from meshes through a cache file
+     */
+     GeometryCache* createGeometryCache(DecodeTaskArray& tasks, Scene::NodeArray& nodes, LoadContext& context, const Char* filepath, const Char* directoryPath)
+     {
+         String path;
+         getCachePath(path, filepath, ".lgc");
+
+         SourceStamp source;
+         getSourceStamp(source, context.gltf_, filepath, directoryPath);
+         PageInfoArray pages;
+         bool result = !context.checkFlag(LoadFlag_RebuildCaches) && readGeometryCache(pages, context.flags_, source, path.c_str());
+         if(!result){
+             pages.clear();
+             result = writeGeometryCache(pages, tasks, nodes, context, source, path.c_str());
+         }
+         if(!result){
+             return NULL;
+         }
+         GeometryCache* geometryCache = LNEW GeometryCache();
+         if(!geometryCache->open(path.c_str(), pages.size(), (0<pages.size())? &pages[0] : NULL)){
+             LDELETE(geometryCache);
+         }
+         return geometryCache;
+     }
  }
 
-    void load(Scene& scene, const Char* filepath)
+    //---------------------------------------------------------
+    //---
+    //--- LoadPipeline
+    //---
+    //---------------------------------------------------------
+    /**
+    @brief Stages of loads, which report to a handle if any
+    */
+    class LoadPipeline
     {
-        cppgltf::IFStream ifstream;
-        if(!ifstream.open(filepath)){
-            return;
+    public:
+        static bool load(Scene& scene, const Char* filepath, u32 flags, LoadHandle* handle);
+        static LoadHandle::pointer_type start(Scene& scene, const Char* filepath, u32 flags, LoadCallback callback, void* user);
+
+    private:
+        static inline bool isCancelled(const LoadHandle* handle)
+        {
+            return NULL != handle && handle->isCancelled();
         }
 
+        static void setStage(LoadHandle* handle, LoadStage stage);
+        static void setNumDecodes(LoadHandle* handle, s32 numDecodes);
+        static void addDecoded(LoadHandle* handle);
+        static void runLoad(LoadHandle* handle);
+        static void runPreview(LoadHandle* handle);
+        static void runBuild(LoadHandle* handle);
+    };
+
+    bool LoadPipeline::load(Scene& scene, const Char* filepath, u32 flags, LoadHandle* handle)
+    {
         s32 pathLength = strlen_s32(filepath);
         Char* directoryPath = LNEW Char[pathLength+1];
         extractDirectoryPath(directoryPath, pathLength, filepath);
 
-        cppgltf::glTFHandler gltfHandler(directoryPath);
-        cppgltf::JSONReader gltfJsonReader(ifstream, gltfHandler);
-        bool result = gltfJsonReader.read();
+        //Binary buffers are mapped instead of being read into heap.
+        //Without a directory, cppgltf leaves external buffers unresolved, then they are mapped by us.
+        Scene::MappedFileArray mappedFiles;
+        cppgltf::glTFHandler gltfHandler(NULL);
+        bool result = false;
+        s32 binFile = -1;
+        u8* bin = NULL;
+        s64 binSize = 0;
+        if(hasExtension(filepath, pathLength, ".glb")){
+            MappedFile file;
+            if(!file.open(filepath)){
+                LDELETE_ARRAY(directoryPath);
+                return false;
+            }
+            MemoryStream jsonStream;
+            if(openGLB(jsonStream, bin, binSize, file)){
+                cppgltf::JSONReader gltfJsonReader(jsonStream, gltfHandler);
+                result = gltfJsonReader.read();
+            }
+            binFile = mappedFiles.size();
+            mappedFiles.push_back(move(file));
+
+        }else{
+            cppgltf::IFStream ifstream;
+            if(!ifstream.open(filepath)){
+                LDELETE_ARRAY(directoryPath);
+                return false;
+            }
+            cppgltf::JSONReader gltfJsonReader(ifstream, gltfHandler);
+            result = gltfJsonReader.read();
+            ifstream.close();
+        }
         if(!result){
             LDELETE_ARRAY(directoryPath);
-            return;
+            return false;
         }
-        ifstream.close();
 
         cppgltf::glTF& gltf = gltfHandler.get();
 
         //asset
         LASSERT("2.0" == gltf.asset_.version_);
 
-        //meshes
-        //--------------------------------------------
-        Scene::MeshArray meshArray;
-        for(s32 i=0; i<gltf.meshes_.size(); ++i){
-            cppgltf::Mesh& gltfMesh = gltf.meshes_[i];
-            Mesh::PrimitiveArray primitiveArray;
-            for(s32 j=0; j<gltfMesh.primitives_.size(); ++j){
-                cppgltf::Primitive& gltfPrim = gltfMesh.primitives_[j];
-                //check
-                if(gltfPrim.attributes_.size()<=0
-                    || gltfPrim.indices_<0){
-                    continue;
-                }
-                if(gltfPrim.mode_<cppgltf::GLTF_PRIMITIVE_TRIANGLES){
-                    continue;
-                }
-                Primitive primitive = createPrimitive(gltf, gltfPrim);
-                if(primitive.getNumVertices()<=0){
-                    continue;
-                }
-                primitiveArray.push_back(move(primitive));
-            }
-            if(primitiveArray.size()<=0){
-                continue;
-            }
-            Mesh mesh(move(primitiveArray));
-            meshArray.push_back(move(mesh));
-        }
+        LoadContext context(gltf, flags);
+        context.mapBuffers(mappedFiles, directoryPath, binFile, bin, binSize);
 
         //nodes
         //--------------------------------------------
@@ -461,7 +1870,15 @@ namespace lray
             for(s32 i=0; i<gltf.sortedNodes_.size(); ++i){
                 const cppgltf::glTF::SortNode& sortNode = gltf.sortedNodes_[i];
                 const cppgltf::Node& gltfNode = gltf.nodes_[sortNode.oldId_];
-                Node node(gltfNode.name_.c_str(), sortNode.parent_, sortNode.numChildren_, sortNode.childrenStart_, gltfNode.mesh_);
+                s32 skin = (0<=gltfNode.skin_ && gltfNode.skin_<gltf.skins_.size())? gltfNode.skin_ : -1;
+                Node node(gltfNode.name_.c_str(), sortNode.parent_, sortNode.numChildren_, sortNode.childrenStart_, gltfNode.mesh_, skin);
+                //Weights of a node override ones of its mesh
+                if(0<gltfNode.weights_.size()){
+                    node.setWeights(gltfNode.weights_.size(), &gltfNode.weights_[0]);
+                }else if(0<=gltfNode.mesh_ && gltfNode.mesh_<gltf.meshes_.size() && 0<gltf.meshes_[gltfNode.mesh_].weights_.size()){
+                    const cppgltf::Mesh& gltfMesh = gltf.meshes_[gltfNode.mesh_];
+                    node.setWeights(gltfMesh.weights_.size(), &gltfMesh.weights_[0]);
+                }
                 lray::Matrix44& matrix = node.getMatrix();
                 if(gltfNode.flags_.check(cppgltf::Node::Flag_Matrix)){
                     for(s32 m=0; m<4; ++m){
@@ -489,15 +1906,310 @@ namespace lray
             }
 
         }else{
-            nodeArray.reserve(meshArray.size());
-            for(s32 i=0; i<meshArray.size(); ++i){
+            nodeArray.reserve(gltf.meshes_.size());
+            for(s32 i=0; i<gltf.meshes_.size(); ++i){
                 Node node("", -1, 0, -1, i);
+                if(0<gltf.meshes_[i].weights_.size()){
+                    node.setWeights(gltf.meshes_[i].weights_.size(), &gltf.meshes_[i].weights_[0]);
+                }
                 nodeArray.push_back(move(node));
             }
         }
 
+        //meshes
+        //--------------------------------------------
+        //Gather primitives to decode
+        DecodeTaskArray tasks;
+        bool* normalizedAccessors = LNEW bool[gltf.accessors_.size()+1];
+        for(s32 i=0; i<gltf.accessors_.size(); ++i){
+            normalizedAccessors[i] = false;
+        }
+        for(s32 i=0; i<gltf.meshes_.size(); ++i){
+            cppgltf::Mesh& gltfMesh = gltf.meshes_[i];
+            for(s32 j=0; j<gltfMesh.primitives_.size(); ++j){
+                cppgltf::Primitive& gltfPrim = gltfMesh.primitives_[j];
+                //check
+                if(gltfPrim.attributes_.size()<=0){
+                    continue;
+                }
+                if(gltfPrim.mode_<cppgltf::GLTF_PRIMITIVE_TRIANGLES){
+                    continue;
+                }
+                tasks.push_back(DecodeTask());
+                DecodeTask& task = tasks.back();
+                task.mesh_ = i;
+                task.gltfPrimitive_ = &gltfPrim;
+
+                //Primitives may share normals, only one normalizes them in place
+                cppgltf::Attribute* normal = findPrimitiveAttributes(gltfPrim, cppgltf::GLTF_ATTRIBUTE_NORMAL, 0);
+                if(NULL != normal && 0<=normal->accessor_ && normal->accessor_<gltf.accessors_.size()
+                    && !normalizedAccessors[normal->accessor_]){
+                    normalizedAccessors[normal->accessor_] = true;
+                    task.normalizeInPlace_ = true;
+                }
+            }
+        }
+        LDELETE_ARRAY(normalizedAccessors);
+        setStage(handle, LoadStage_Decode);
+        setNumDecodes(handle, tasks.size());
+
+        Scene::MeshArray meshArray;
+        GeometryCache* geometryCache = NULL;
+        if(context.checkFlag(LoadFlag_OutOfCore)){
+            //Only pages of the cache are kept, meshes are decoded if the cache is not valid
+            geometryCache = createGeometryCache(tasks, nodeArray, context, filepath, directoryPath);
+        }else{
+            //Decode in parallel, tasks touch only their own primitive
+            parallelFor(0, tasks.size(), [&tasks, &context, handle](s32 index)
+            {
+                if(isCancelled(handle)){
+                    return;
+                }
+                createPrimitive(tasks[index], context);
+                addDecoded(handle);
+            });
+            if(isCancelled(handle)){
+                LDELETE_ARRAY(directoryPath);
+                return false;
+            }
+
+            //Assemble in the original order, one mesh per glTF mesh so that nodes can refer them by index
+            meshArray.resize(gltf.meshes_.size());
+            for(s32 i=0; i<tasks.size();){
+                s32 meshIndex = tasks[i].mesh_;
+                PrimitiveList primitiveArray;
+                for(; i<tasks.size() && meshIndex == tasks[i].mesh_; ++i){
+                    DecodeTask& task = tasks[i];
+                    for(s32 j=0; j<task.numViewed_; ++j){
+                        context.buffers_[task.viewed_[j]].viewed_ = true;
+                    }
+                    if(task.primitive_.getNumVertices()<=0){
+                        continue;
+                    }
+                    primitiveArray.push_back(move(task.primitive_));
+                }
+                meshArray[meshIndex] = move(Mesh(Mesh::PrimitiveArray(move(primitiveArray))));
+            }
+        }
+        tasks.clear();
+        if(isCancelled(handle)){
+            LDELETE(geometryCache);
+            LDELETE_ARRAY(directoryPath);
+            return false;
+        }
+
+        //textures
+        //--------------------------------------------
+        //Images may be in buffers which are released below
+        setStage(handle, LoadStage_Textures);
+        Scene::TextureArray textureArray;
+        TileCache* tileCache = createTextures(textureArray, context, filepath, directoryPath);
+
+        //Adopt buffers viewed in place, the others are released with the glTF
+        Scene::BufferArray bufferArray;
+        Scene::MappedFileArray viewedFiles;
+        for(s32 i=0; i<gltf.buffers_.size(); ++i){
+            const BufferSource& source = context.buffers_[i];
+            if(!source.viewed_ || NULL == source.data_){
+                continue;
+            }
+            if(0<=source.mappedFile_){
+                MappedFile& file = mappedFiles[source.mappedFile_];
+                if(file.valid()){
+                    viewedFiles.push_back(move(file));
+                }
+            }else{
+                bufferArray.push_back(gltf.buffers_[i].data_);
+                gltf.buffers_[i].data_ = NULL;
+            }
+        }
+        //Unmap the files not viewed
+        mappedFiles.clear();
+
+        //skins
+        //--------------------------------------------
+        Scene::SkinArray skinArray;
+        if(0<gltf.sortedNodes_.size()){
+            //Joints refer nodes before sorting
+            s32* nodeRemap = LNEW s32[gltf.nodes_.size()+1];
+            for(s32 i=0; i<gltf.nodes_.size(); ++i){
+                nodeRemap[i] = -1;
+            }
+            for(s32 i=0; i<gltf.sortedNodes_.size(); ++i){
+                nodeRemap[gltf.sortedNodes_[i].oldId_] = i;
+            }
+            skinArray.reserve(gltf.skins_.size());
+            for(s32 i=0; i<gltf.skins_.size(); ++i){
+                skinArray.push_back(createSkin(context, gltf.skins_[i], nodeRemap));
+            }
+            LDELETE_ARRAY(nodeRemap);
+        }
+
         const Char* name = (0<gltf.scenes_.size())? gltf.scenes_[0].name_.c_str() : "";
-        scene = move(Scene(name, move(meshArray), move(nodeArray)));
+        scene = move(Scene(name, move(meshArray), move(nodeArray), move(skinArray), move(bufferArray), move(viewedFiles)));
+        scene.setTextures(move(textureArray), tileCache);
+        if(NULL != geometryCache){
+            scene.setGeometryCache(geometryCache);
+        }
         LDELETE_ARRAY(directoryPath);
+        return true;
+    }
+
+    void LoadPipeline::setStage(LoadHandle* handle, LoadStage stage)
+    {
+        if(NULL == handle){
+            return;
+        }
+        //The caller may release the handle as soon as a final stage is seen, so the callback goes first
+        if(NULL != handle->callback_){
+            handle->callback_(*handle, stage, handle->user_);
+        }
+        std::lock_guard<std::mutex> lock(handle->mutex_);
+        handle->stage_.store(stage, std::memory_order_release);
+        handle->condition_.notify_all();
+    }
+
+    void LoadPipeline::setNumDecodes(LoadHandle* handle, s32 numDecodes)
+    {
+        if(NULL != handle){
+            handle->numDecodes_.store(numDecodes, std::memory_order_relaxed);
+        }
+    }
+
+    void LoadPipeline::addDecoded(LoadHandle* handle)
+    {
+        if(NULL != handle){
+            handle->numDecoded_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void LoadPipeline::runLoad(LoadHandle* handle)
+    {
+        setStage(handle, LoadStage_Parse);
+        //A cancelled load also returns false, which is not a failure
+        handle->failed_ = !load(handle->scene_, handle->filepath_.c_str(), handle->flags_, handle) && !handle->isCancelled();
+    }
+
+    void LoadPipeline::runPreview(LoadHandle* handle)
+    {
+        if(handle->failed_ || handle->isCancelled()){
+            return;
+        }
+        setStage(handle, LoadStage_Preview);
+        handle->scene_.updatePreview();
+        handle->previewReady_.store(true, std::memory_order_release);
+        setStage(handle, LoadStage_Build);
+    }
+
+    void LoadPipeline::runBuild(LoadHandle* handle)
+    {
+        LoadStage stage = LoadStage_Done;
+        if(handle->isCancelled()){
+            stage = LoadStage_Cancelled;
+        }else if(handle->failed_){
+            stage = LoadStage_Failed;
+        }else{
+            handle->scene_.buildAccelerator();
+        }
+        //The handle may be released after this
+        setStage(handle, stage);
+    }
+
+    LoadHandle::pointer_type LoadPipeline::start(Scene& scene, const Char* filepath, u32 flags, LoadCallback callback, void* user)
+    {
+        LoadHandle::pointer_type handle(LNEW LoadHandle(scene, filepath, flags, callback, user));
+        LoadHandle* ptr = handle.get();
+        JobSystem& jobSystem = JobSystem::getDefault();
+        Job* loadJob = jobSystem.create([ptr](s32){ runLoad(ptr);});
+        Job* previewJob = jobSystem.create([ptr](s32){ runPreview(ptr);});
+        Job* buildJob = jobSystem.create([ptr](s32){ runBuild(ptr);});
+        jobSystem.addDependency(previewJob, loadJob);
+        jobSystem.addDependency(buildJob, previewJob);
+        jobSystem.submit(buildJob);
+        jobSystem.submit(previewJob);
+        jobSystem.submit(loadJob);
+        return handle;
+    }
+
+    //---------------------------------------------------------
+    //---
+    //--- LoadHandle
+    //---
+    //---------------------------------------------------------
+    LoadHandle::LoadHandle(Scene& scene, const Char* filepath, u32 flags, LoadCallback callback, void* user)
+        :scene_(scene)
+        ,filepath_(filepath)
+        ,flags_(flags)
+        ,callback_(callback)
+        ,user_(user)
+        ,failed_(false)
+        ,stage_(LoadStage_Parse)
+        ,previewReady_(false)
+        ,cancelled_(false)
+        ,numDecodes_(0)
+        ,numDecoded_(0)
+    {
+    }
+
+    LoadHandle::~LoadHandle()
+    {
+        cancel();
+        wait();
+    }
+
+    f32 LoadHandle::getProgress() const
+    {
+        //Rough shares of stages in a load
+        static const f32 Starts[] = {0.0f, 0.1f, 0.6f, 0.7f, 0.8f, 1.0f};
+        LoadStage stage = getStage();
+        if(LoadStage_Done<=stage){
+            return 1.0f;
+        }
+        f32 progress = Starts[stage];
+        s32 numDecodes = numDecodes_.load(std::memory_order_relaxed);
+        if(LoadStage_Decode == stage && 0<numDecodes){
+            f32 decoded = static_cast<f32>(numDecoded_.load(std::memory_order_relaxed))/numDecodes;
+            progress += (Starts[LoadStage_Decode+1] - Starts[LoadStage_Decode]) * minimum(decoded, 1.0f);
+        }
+        return progress;
+    }
+
+    void LoadHandle::cancel()
+    {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    bool LoadHandle::waitPreview()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!isPreviewReady() && !isFinished()){
+            condition_.wait(lock);
+        }
+        return isPreviewReady();
+    }
+
+    LoadStage LoadHandle::wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!isFinished()){
+            condition_.wait(lock);
+        }
+        return getStage();
+    }
+
+    void setCacheDirectory(const Char* directory)
+    {
+        std::lock_guard<std::mutex> lock(cacheDirectoryMutex_);
+        cacheDirectory_.assign((NULL != directory)? directory : "");
+    }
+
+    void load(Scene& scene, const Char* filepath, u32 flags)
+    {
+        LoadPipeline::load(scene, filepath, flags, NULL);
+    }
+
+    LoadHandle::pointer_type loadAsync(Scene& scene, const Char* filepath, u32 flags, LoadCallback callback, void* user)
+    {
+        return LoadPipeline::start(scene, filepath, flags, callback, user);
     }
 }
@@ -71,6 +71,11 @@ namespace lray
         }
     }
 
+    void Mesh::resize(s32 numPrimitives)
+    {
+        primitives_.resize(numPrimitives);
+    }
+
     Mesh& Mesh::operator=(Mesh&& rhs)
     {
         if(this == &rhs){
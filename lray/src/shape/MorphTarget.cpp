@@ -0,0 +1,66 @@
+/**
+@file MorphTarget.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "shape/MorphTarget.h"
+
+namespace lray
+{
+    MorphTarget::MorphTarget()
+        :numDeltas_(0)
+        ,indices_(NULL)
+        ,positions_(NULL)
+        ,normals_(NULL)
+    {}
+
+    MorphTarget::MorphTarget(MorphTarget&& rhs)
+        :numDeltas_(rhs.numDeltas_)
+        ,indices_(rhs.indices_)
+        ,positions_(rhs.positions_)
+        ,normals_(rhs.normals_)
+    {
+        rhs.numDeltas_ = 0;
+        rhs.indices_ = NULL;
+        rhs.positions_ = NULL;
+        rhs.normals_ = NULL;
+    }
+
+    MorphTarget::MorphTarget(s32 numDeltas, s32* indices, Vector3* positions, Vector3* normals)
+        :numDeltas_(numDeltas)
+        ,indices_(indices)
+        ,positions_(positions)
+        ,normals_(normals)
+    {
+        LASSERT(0<=numDeltas_);
+    }
+
+    MorphTarget::~MorphTarget()
+    {
+        LDELETE_ARRAY(normals_);
+        LDELETE_ARRAY(positions_);
+        LDELETE_ARRAY(indices_);
+        numDeltas_ = 0;
+    }
+
+    MorphTarget& MorphTarget::operator=(MorphTarget&& rhs)
+    {
+        if(this == &rhs){
+            return *this;
+        }
+        LDELETE_ARRAY(normals_);
+        LDELETE_ARRAY(positions_);
+        LDELETE_ARRAY(indices_);
+
+        numDeltas_ = rhs.numDeltas_;
+        indices_ = rhs.indices_;
+        positions_ = rhs.positions_;
+        normals_ = rhs.normals_;
+
+        rhs.numDeltas_ = 0;
+        rhs.indices_ = NULL;
+        rhs.positions_ = NULL;
+        rhs.normals_ = NULL;
+        return *this;
+    }
+}
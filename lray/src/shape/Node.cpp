@@ -12,6 +12,7 @@ namespace lray
         ,numChildren_(0)
         ,childrenStart_(-1)
         ,mesh_(-1)
+        ,skin_(-1)
     {
         matrix_.identity();
         worldMatrix_.identity();
@@ -22,6 +23,8 @@ namespace lray
         ,numChildren_(rhs.numChildren_)
         ,childrenStart_(rhs.childrenStart_)
         ,mesh_(rhs.mesh_)
+        ,skin_(rhs.skin_)
+        ,weights_(move(rhs.weights_))
         ,matrix_(rhs.matrix_)
         ,worldMatrix_(rhs.worldMatrix_)
     {
@@ -29,6 +32,7 @@ namespace lray
         rhs.numChildren_ = 0;
         rhs.childrenStart_ = -1;
         rhs.mesh_ = -1;
+        rhs.skin_ = -1;
         rhs.matrix_.identity();
         rhs.worldMatrix_.identity();
     }
@@ -37,17 +41,28 @@ namespace lray
         s32 parent,
         s32 numChildren,
         s32 childrenStart,
-        s32 mesh)
+        s32 mesh,
+        s32 skin)
         :name_(name)
         ,parent_(parent)
         ,numChildren_(numChildren)
         ,childrenStart_(childrenStart)
         ,mesh_(mesh)
+        ,skin_(skin)
     {
         matrix_.identity();
         worldMatrix_.identity();
     }
 
+    void Node::setWeights(s32 numWeights, const f32* weights)
+    {
+        LASSERT(0<=numWeights);
+        weights_.resize(numWeights);
+        for(s32 i=0; i<numWeights; ++i){
+            weights_[i] = weights[i];
+        }
+    }
+
     Node& Node::operator=(Node&& rhs)
     {
         if(this == &rhs){
@@ -57,12 +72,15 @@ namespace lray
         numChildren_ = rhs.numChildren_;
         childrenStart_ = rhs.childrenStart_;
         mesh_ = rhs.mesh_;
+        skin_ = rhs.skin_;
+        weights_ = move(rhs.weights_);
         matrix_ = rhs.matrix_;
         worldMatrix_ = rhs.worldMatrix_;
         rhs.parent_ = -1;
         rhs.numChildren_ = 0;
         rhs.childrenStart_ = -1;
         rhs.mesh_ = -1;
+        rhs.skin_ = -1;
         rhs.matrix_.identity();
         rhs.worldMatrix_.identity();
         return *this;
@@ -4,16 +4,123 @@
 @date 2018/05/24 create
 */
 #include "shape/Primitive.h"
+#include "core/Sort.h"
 
 namespace lray
 {
+namespace
+{
+    inline u32 hashVertex(const Vector3& position, const Vector3* normal)
+    {
+        //FNV-1a over bits
+        u32 hash = 2166136261U;
+        const u32* p = reinterpret_cast<const u32*>(&position);
+        for(s32 i=0; i<3; ++i){
+            hash = (hash ^ p[i]) * 16777619U;
+        }
+        if(NULL != normal){
+            const u32* n = reinterpret_cast<const u32*>(normal);
+            for(s32 i=0; i<3; ++i){
+                hash = (hash ^ n[i]) * 16777619U;
+            }
+        }
+        return hash;
+    }
+
+    //Spread lower 10 bits to every third bit
+    inline u32 separateBy2(u32 x)
+    {
+        x &= 0x3FFU;
+        x = (x | (x<<16)) & 0x030000FFU;
+        x = (x | (x<<8)) & 0x0300F00FU;
+        x = (x | (x<<4)) & 0x030C30C3U;
+        x = (x | (x<<2)) & 0x09249249U;
+        return x;
+    }
+
+    struct MortonCode
+    {
+        u32 code_;
+        s32 index_;
+    };
+
+#ifdef LRAY_USE_SSE
+    inline void loadColumns(lm128 columns[4], const Matrix44& m)
+    {
+        columns[0] = _mm_loadu_ps(m.m_[0]);
+        columns[1] = _mm_loadu_ps(m.m_[1]);
+        columns[2] = _mm_loadu_ps(m.m_[2]);
+        columns[3] = _mm_loadu_ps(m.m_[3]);
+        _MM_TRANSPOSE4_PS(columns[0], columns[1], columns[2], columns[3]);
+    }
+
+    /**
+    @brief Columns of the matrix blended by joint influences
+    */
+    inline void blendJoints(lm128 columns[4], const SkinWeight& skinWeight, s32 numJoints, const Matrix44* palette)
+    {
+        //Blend rows of the palette, the last row of affine matrices is not needed
+        lm128 r0 = _mm_setzero_ps();
+        lm128 r1 = _mm_setzero_ps();
+        lm128 r2 = _mm_setzero_ps();
+        lm128 r3 = _mm_setzero_ps();
+        for(s32 j=0; j<SkinWeight::NumInfluences; ++j){
+            if(skinWeight.weights_[j]<=0.0f || numJoints<=skinWeight.joints_[j]){
+                continue;
+            }
+            const Matrix44& m = palette[skinWeight.joints_[j]];
+            lm128 w = _mm_set1_ps(skinWeight.weights_[j]);
+            r0 = _mm_add_ps(r0, _mm_mul_ps(w, _mm_loadu_ps(m.m_[0])));
+            r1 = _mm_add_ps(r1, _mm_mul_ps(w, _mm_loadu_ps(m.m_[1])));
+            r2 = _mm_add_ps(r2, _mm_mul_ps(w, _mm_loadu_ps(m.m_[2])));
+        }
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        columns[0] = r0;
+        columns[1] = r1;
+        columns[2] = r2;
+        columns[3] = r3;
+    }
+
+    inline lm128 transform33(const lm128 columns[4], const Vector3& v)
+    {
+        lm128 t = _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(v.x_)), _mm_mul_ps(columns[1], _mm_set1_ps(v.y_)));
+        return _mm_add_ps(t, _mm_mul_ps(columns[2], _mm_set1_ps(v.z_)));
+    }
+
+    inline lm128 transform(const lm128 columns[4], const Vector3& v)
+    {
+        return _mm_add_ps(transform33(columns, v), columns[3]);
+    }
+#else
+    inline void blendJoints(Matrix44& m, const SkinWeight& skinWeight, s32 numJoints, const Matrix44* palette)
+    {
+        m.zero();
+        for(s32 j=0; j<SkinWeight::NumInfluences; ++j){
+            if(skinWeight.weights_[j]<=0.0f || numJoints<=skinWeight.joints_[j]){
+                continue;
+            }
+            const Matrix44& joint = palette[skinWeight.joints_[j]];
+            for(s32 r=0; r<3; ++r){
+                for(s32 c=0; c<4; ++c){
+                    m.m_[r][c] += skinWeight.weights_[j] * joint.m_[r][c];
+                }
+            }
+        }
+        m.m_[3][3] = 1.0f;
+    }
+#endif
+}
+
     Primitive::Primitive()
         :components_(0)
+        ,flags_(0)
         ,numVertices_(0)
         ,positions_(NULL)
         ,normals_(NULL)
         ,numTriangles_(0)
         ,triangles_(NULL)
+        ,skinWeights_(NULL)
+        ,texcoords_(NULL)
     {
     }
 
@@ -22,13 +129,17 @@ namespace lray
         Vector3* positions,
         Vector3* normals,
         s32 numTriangles,
-        Triangle* triangles)
+        Triangle* triangles,
+        s32 flags)
         :components_(0)
+        ,flags_(flags)
         ,numVertices_(numVertices)
         ,positions_(positions)
         ,normals_(normals)
         ,numTriangles_(numTriangles)
         ,triangles_(triangles)
+        ,skinWeights_(NULL)
+        ,texcoords_(NULL)
     {
         if(NULL != normals_){
             addComponent(Component_Normal);
@@ -37,52 +148,110 @@ namespace lray
 
     Primitive::Primitive(Primitive&& rhs)
         :components_(rhs.components_)
+        ,flags_(rhs.flags_)
         ,numVertices_(rhs.numVertices_)
         ,positions_(rhs.positions_)
         ,normals_(rhs.normals_)
         ,numTriangles_(rhs.numTriangles_)
         ,triangles_(rhs.triangles_)
+        ,skinWeights_(rhs.skinWeights_)
+        ,texcoords_(rhs.texcoords_)
+        ,morphTargets_(move(rhs.morphTargets_))
     {
         rhs.components_ = 0;
+        rhs.flags_ = 0;
         rhs.numVertices_ = 0;
         rhs.positions_ = NULL;
         rhs.normals_ = NULL;
         rhs.numTriangles_ = 0;
         rhs.triangles_ = NULL;
+        rhs.skinWeights_ = NULL;
+        rhs.texcoords_ = NULL;
     }
 
     Primitive::~Primitive()
     {
-        LDELETE_ARRAY(triangles_);
-        LDELETE_ARRAY(normals_);
-        LDELETE_ARRAY(positions_);
+        release();
+    }
+
+    void Primitive::release()
+    {
+        //Skin weights, texture coordinates and morph targets are always owned
+        LDELETE_ARRAY(texcoords_);
+        LDELETE_ARRAY(skinWeights_);
+        morphTargets_.clear();
+        //Shared storages are owned by the scene, just forget them
+        if(checkFlag(Flag_SharedTriangles)){
+            triangles_ = NULL;
+        }else{
+            LDELETE_ARRAY(triangles_);
+        }
+        if(checkFlag(Flag_SharedNormals)){
+            normals_ = NULL;
+        }else{
+            LDELETE_ARRAY(normals_);
+        }
+        if(checkFlag(Flag_SharedPositions)){
+            positions_ = NULL;
+        }else{
+            LDELETE_ARRAY(positions_);
+        }
+        flags_ = 0;
     }
 
-    void Primitive::refine(const Primitive& src, const lray::Matrix44& matrix)
+    void Primitive::setSkinWeights(SkinWeight* skinWeights)
     {
-        components_ = src.components_;
+        LDELETE_ARRAY(skinWeights_);
+        skinWeights_ = skinWeights;
+        if(NULL != skinWeights_){
+            addComponent(Component_Skin);
+        }else{
+            components_ &= ~Component_Skin;
+        }
+    }
+
+    void Primitive::setTexcoords(Vector2* texcoords)
+    {
+        LDELETE_ARRAY(texcoords_);
+        texcoords_ = texcoords;
+        if(NULL != texcoords_){
+            addComponent(Component_Texcoord);
+        }else{
+            components_ &= ~Component_Texcoord;
+        }
+    }
+
+    void Primitive::refineStorages(const Primitive& src)
+    {
+        //Refined elements never carry skin weights
+        components_ = src.components_ & ~Component_Skin;
+
+        if(0 != flags_){
+            //Refined elements are always owned
+            release();
+            numVertices_ = 0;
+            numTriangles_ = 0;
+        }
 
         if(numVertices_<src.numVertices_){
+            LDELETE_ARRAY(texcoords_);
             LDELETE_ARRAY(normals_);
             LDELETE_ARRAY(positions_);
             positions_ = LNEW Vector3[src.numVertices_];
             if(src.hasComponent(Component_Normal)){
                 normals_ = LNEW Vector3[src.numVertices_];
             }
+        }else if(NULL == normals_ && src.hasComponent(Component_Normal)){
+            normals_ = LNEW Vector3[numVertices_];
         }
-        numVertices_ = src.numVertices_;
-
-        // transform positions
-        for(s32 i=0; i<numVertices_; ++i){
-            positions_[i] = mul(matrix, src.positions_[i]);
+        if(NULL == texcoords_ && src.hasComponent(Component_Texcoord)){
+            texcoords_ = LNEW Vector2[maximum(numVertices_, src.numVertices_)];
         }
+        numVertices_ = src.numVertices_;
 
-        // transform normals
-        if(src.hasComponent(Component_Normal)){
-            normals_ = LNEW Vector3[src.numVertices_];
-            for(s32 i=0; i<numVertices_; ++i){
-                normals_[i] = mul33(matrix, src.normals_[i]);
-            }
+        // copy texture coordinates
+        if(src.hasComponent(Component_Texcoord)){
+            ::memcpy(texcoords_, src.texcoords_, sizeof(Vector2)*numVertices_);
         }
 
         // copy triangles
@@ -94,6 +263,313 @@ namespace lray
         ::memcpy(triangles_, src.triangles_, sizeof(Triangle)*numTriangles_);
     }
 
+    void Primitive::refine(const Primitive& src, const lray::Matrix44& matrix, s32 numWeights, const f32* weights)
+    {
+        refineStorages(src);
+
+        // transform positions
+        mul(numVertices_, positions_, matrix, src.positions_);
+
+        // transform normals
+        bool hasNormal = src.hasComponent(Component_Normal);
+        if(hasNormal){
+            mul33(numVertices_, normals_, matrix, src.normals_);
+        }
+
+        // add deltas of morph targets
+        numWeights = minimum(numWeights, src.morphTargets_.size());
+        for(s32 i=0; i<numWeights; ++i){
+            if(F32_EPSILON<absolute(weights[i])){
+                morph(src.morphTargets_[i], weights[i], matrix);
+            }
+        }
+
+        if(hasNormal){
+            for(s32 i=0; i<numVertices_; ++i){
+                normals_[i] = normalize(normals_[i]);
+            }
+        }
+    }
+
+    void Primitive::refine(const Primitive& src, s32 numJoints, const lray::Matrix44* palette, s32 numWeights, const f32* weights)
+    {
+        LASSERT(src.hasComponent(Component_Skin));
+        LASSERT(NULL != palette);
+        refineStorages(src);
+
+        bool hasNormal = src.hasComponent(Component_Normal);
+        for(s32 i=0; i<numVertices_; ++i){
+            const SkinWeight& skinWeight = src.skinWeights_[i];
+#ifdef LRAY_USE_SSE
+            lm128 columns[4];
+            blendJoints(columns, skinWeight, numJoints, palette);
+            store3(&positions_[i].x_, transform(columns, src.positions_[i]));
+            if(hasNormal){
+                store3(&normals_[i].x_, transform33(columns, src.normals_[i]));
+            }
+#else
+            Matrix44 m;
+            blendJoints(m, skinWeight, numJoints, palette);
+            positions_[i] = mul(m, src.positions_[i]);
+            if(hasNormal){
+                normals_[i] = mul33(m, src.normals_[i]);
+            }
+#endif
+        }
+
+        // add deltas of morph targets, which are defined before skinning
+        numWeights = minimum(numWeights, src.morphTargets_.size());
+        for(s32 i=0; i<numWeights; ++i){
+            if(F32_EPSILON<absolute(weights[i])){
+                morph(src.morphTargets_[i], weights[i], src.skinWeights_, numJoints, palette);
+            }
+        }
+
+        if(hasNormal){
+            for(s32 i=0; i<numVertices_; ++i){
+                normals_[i] = normalize(normals_[i]);
+            }
+        }
+    }
+
+    void Primitive::morph(const MorphTarget& target, f32 weight, const lray::Matrix44& matrix)
+    {
+        const s32* indices = target.getIndices();
+        const Vector3* positions = target.getPositions();
+        const Vector3* normals = (NULL != normals_)? target.getNormals() : NULL;
+#ifdef LRAY_USE_SSE
+        //Deltas are directions, translation is not needed
+        lm128 columns[4];
+        loadColumns(columns, matrix);
+        lm128 w = _mm_set1_ps(weight);
+        for(s32 i=0; i<3; ++i){
+            columns[i] = _mm_mul_ps(columns[i], w);
+        }
+        for(s32 i=0; i<target.getNumDeltas(); ++i){
+            s32 index = indices[i];
+            lm128 p = load3(&positions_[index].x_);
+            store3(&positions_[index].x_, _mm_add_ps(p, transform33(columns, positions[i])));
+            if(NULL != normals){
+                lm128 n = load3(&normals_[index].x_);
+                store3(&normals_[index].x_, _mm_add_ps(n, transform33(columns, normals[i])));
+            }
+        }
+#else
+        for(s32 i=0; i<target.getNumDeltas(); ++i){
+            s32 index = indices[i];
+            positions_[index] += weight * mul33(matrix, positions[i]);
+            if(NULL != normals){
+                normals_[index] += weight * mul33(matrix, normals[i]);
+            }
+        }
+#endif
+    }
+
+    void Primitive::morph(const MorphTarget& target, f32 weight, const SkinWeight* skinWeights, s32 numJoints, const lray::Matrix44* palette)
+    {
+        const s32* indices = target.getIndices();
+        const Vector3* positions = target.getPositions();
+        const Vector3* normals = (NULL != normals_)? target.getNormals() : NULL;
+#ifdef LRAY_USE_SSE
+        lm128 w = _mm_set1_ps(weight);
+        for(s32 i=0; i<target.getNumDeltas(); ++i){
+            s32 index = indices[i];
+            //Skinning is linear, so skin a delta with the blended matrix of its vertex
+            lm128 columns[4];
+            blendJoints(columns, skinWeights[index], numJoints, palette);
+            lm128 p = load3(&positions_[index].x_);
+            store3(&positions_[index].x_, _mm_add_ps(p, _mm_mul_ps(w, transform33(columns, positions[i]))));
+            if(NULL != normals){
+                lm128 n = load3(&normals_[index].x_);
+                store3(&normals_[index].x_, _mm_add_ps(n, _mm_mul_ps(w, transform33(columns, normals[i]))));
+            }
+        }
+#else
+        for(s32 i=0; i<target.getNumDeltas(); ++i){
+            s32 index = indices[i];
+            Matrix44 m;
+            blendJoints(m, skinWeights[index], numJoints, palette);
+            positions_[index] += weight * mul33(m, positions[i]);
+            if(NULL != normals){
+                normals_[index] += weight * mul33(m, normals[i]);
+            }
+        }
+#endif
+    }
+
+    void Primitive::setMorphTargets(MorphTargetArray&& morphTargets)
+    {
+        morphTargets_ = move(morphTargets);
+    }
+
+    void Primitive::weld()
+    {
+        LASSERT(0 == flags_);
+        //Morph targets refer vertices by index
+        if(numVertices_<=0 || 0<morphTargets_.size()){
+            return;
+        }
+        bool hasNormal = hasComponent(Component_Normal);
+        bool hasSkin = hasComponent(Component_Skin);
+        bool hasTexcoord = hasComponent(Component_Texcoord);
+
+        u32 tableSize = 1;
+        while(tableSize<(static_cast<u32>(numVertices_)<<1)){
+            tableSize <<= 1;
+        }
+        u32 mask = tableSize-1;
+        s32* table = LNEW s32[tableSize];
+        for(u32 i=0; i<tableSize; ++i){
+            table[i] = -1;
+        }
+        s32* remap = LNEW s32[numVertices_];
+
+        //Unique vertices are compacted toward the front, never beyond the vertex being read
+        s32 count = 0;
+        for(s32 i=0; i<numVertices_; ++i){
+            const Vector3* normal = (hasNormal)? &normals_[i] : NULL;
+            u32 h = hashVertex(positions_[i], normal) & mask;
+            for(;;){
+                s32 j = table[h];
+                if(j<0){
+                    table[h] = count;
+                    positions_[count] = positions_[i];
+                    if(hasNormal){
+                        normals_[count] = normals_[i];
+                    }
+                    if(hasSkin){
+                        skinWeights_[count] = skinWeights_[i];
+                    }
+                    if(hasTexcoord){
+                        texcoords_[count] = texcoords_[i];
+                    }
+                    remap[i] = count;
+                    ++count;
+                    break;
+                }
+                if(0 == memcmp(&positions_[j], &positions_[i], sizeof(Vector3))
+                    && (!hasNormal || 0 == memcmp(&normals_[j], &normals_[i], sizeof(Vector3)))
+                    && (!hasSkin || 0 == memcmp(&skinWeights_[j], &skinWeights_[i], sizeof(SkinWeight)))
+                    && (!hasTexcoord || 0 == memcmp(&texcoords_[j], &texcoords_[i], sizeof(Vector2)))){
+                    remap[i] = j;
+                    break;
+                }
+                h = (h+1) & mask;
+            }
+        }
+
+        for(s32 i=0; i<numTriangles_; ++i){
+            for(s32 j=0; j<3; ++j){
+                triangles_[i].indices_[j] = remap[triangles_[i].indices_[j]];
+            }
+        }
+        numVertices_ = count;
+        LDELETE_ARRAY(remap);
+        LDELETE_ARRAY(table);
+    }
+
+    void Primitive::reorder()
+    {
+        LASSERT(0 == flags_);
+        //Morph targets refer vertices by index
+        if(numVertices_<=0 || numTriangles_<=0 || 0<morphTargets_.size()){
+            return;
+        }
+        bool hasNormal = hasComponent(Component_Normal);
+
+        Vector3 bmin = positions_[0];
+        Vector3 bmax = positions_[0];
+        for(s32 i=1; i<numVertices_; ++i){
+            bmin = minimum(bmin, positions_[i]);
+            bmax = maximum(bmax, positions_[i]);
+        }
+        Vector3 extent = bmax - bmin;
+        f32 invExtent[3];
+        for(s32 i=0; i<3; ++i){
+            invExtent[i] = (F32_EPSILON<extent[i])? 1023.0f/extent[i] : 0.0f;
+        }
+
+        //Triangles in Morton order of centroids
+        MortonCode* codes = LNEW MortonCode[numTriangles_];
+        static const f32 Inv3 = 1.0f/3.0f;
+        for(s32 i=0; i<numTriangles_; ++i){
+            const Triangle& triangle = triangles_[i];
+            Vector3 centroid = (positions_[triangle.indices_[0]] + positions_[triangle.indices_[1]] + positions_[triangle.indices_[2]]) * Inv3;
+            u32 code = 0;
+            for(s32 j=0; j<3; ++j){
+                u32 x = static_cast<u32>((centroid[j]-bmin[j])*invExtent[j]);
+                code |= separateBy2(x)<<(2-j);
+            }
+            codes[i].code_ = code;
+            codes[i].index_ = i;
+        }
+        introsort(numTriangles_, codes, [](const MortonCode& x0, const MortonCode& x1)
+        {
+            return (x0.code_ == x1.code_)? x0.index_<x1.index_ : x0.code_<x1.code_;
+        });
+
+        Triangle* triangles = LNEW Triangle[numTriangles_];
+        for(s32 i=0; i<numTriangles_; ++i){
+            triangles[i] = triangles_[codes[i].index_];
+        }
+        LDELETE_ARRAY(codes);
+
+        //Vertices in order of first use, unreferenced ones go last
+        s32* remap = LNEW s32[numVertices_];
+        for(s32 i=0; i<numVertices_; ++i){
+            remap[i] = -1;
+        }
+        s32 count = 0;
+        for(s32 i=0; i<numTriangles_; ++i){
+            for(s32 j=0; j<3; ++j){
+                s32 index = triangles[i].indices_[j];
+                if(remap[index]<0){
+                    remap[index] = count++;
+                }
+                triangles[i].indices_[j] = remap[index];
+            }
+        }
+        for(s32 i=0; i<numVertices_; ++i){
+            if(remap[i]<0){
+                remap[i] = count++;
+            }
+        }
+
+        Vector3* positions = LNEW Vector3[numVertices_];
+        for(s32 i=0; i<numVertices_; ++i){
+            positions[remap[i]] = positions_[i];
+        }
+        LDELETE_ARRAY(positions_);
+        positions_ = positions;
+        if(hasNormal){
+            Vector3* normals = LNEW Vector3[numVertices_];
+            for(s32 i=0; i<numVertices_; ++i){
+                normals[remap[i]] = normals_[i];
+            }
+            LDELETE_ARRAY(normals_);
+            normals_ = normals;
+        }
+        if(hasComponent(Component_Skin)){
+            SkinWeight* skinWeights = LNEW SkinWeight[numVertices_];
+            for(s32 i=0; i<numVertices_; ++i){
+                skinWeights[remap[i]] = skinWeights_[i];
+            }
+            LDELETE_ARRAY(skinWeights_);
+            skinWeights_ = skinWeights;
+        }
+        if(hasComponent(Component_Texcoord)){
+            Vector2* texcoords = LNEW Vector2[numVertices_];
+            for(s32 i=0; i<numVertices_; ++i){
+                texcoords[remap[i]] = texcoords_[i];
+            }
+            LDELETE_ARRAY(texcoords_);
+            texcoords_ = texcoords;
+        }
+        LDELETE_ARRAY(remap);
+        LDELETE_ARRAY(triangles_);
+        triangles_ = triangles;
+    }
+
     void Primitive::getTriangleProxies(TriangleProxy* dst) const
     {
         for(s32 i=0; i<numTriangles_; ++i){
@@ -107,23 +583,28 @@ namespace lray
         if(this == &rhs){
             return *this;
         }
-        LDELETE_ARRAY(triangles_);
-        LDELETE_ARRAY(normals_);
-        LDELETE_ARRAY(positions_);
+        release();
 
         components_ = rhs.components_;
+        flags_ = rhs.flags_;
         numVertices_ = rhs.numVertices_;
         positions_ = rhs.positions_;
         normals_ = rhs.normals_;
         numTriangles_ = rhs.numTriangles_;
         triangles_ = rhs.triangles_;
+        skinWeights_ = rhs.skinWeights_;
+        texcoords_ = rhs.texcoords_;
+        morphTargets_ = move(rhs.morphTargets_);
 
         rhs.components_ = 0;
+        rhs.flags_ = 0;
         rhs.numVertices_ = 0;
         rhs.positions_ = NULL;
         rhs.normals_ = NULL;
         rhs.numTriangles_ = 0;
         rhs.triangles_ = NULL;
+        rhs.skinWeights_ = NULL;
+        rhs.texcoords_ = NULL;
         return *this;
     }
 }
@@ -0,0 +1,54 @@
+/**
+@file Skin.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "shape/Skin.h"
+#include "shape/Node.h"
+
+namespace lray
+{
+    Skin::Skin()
+    {}
+
+    Skin::Skin(Skin&& rhs)
+        :joints_(move(rhs.joints_))
+        ,inverseBindMatrices_(move(rhs.inverseBindMatrices_))
+        ,palette_(move(rhs.palette_))
+    {}
+
+    Skin::Skin(JointArray&& joints, MatrixArray&& inverseBindMatrices)
+        :joints_(move(joints))
+        ,inverseBindMatrices_(move(inverseBindMatrices))
+    {
+        LASSERT(joints_.size() == inverseBindMatrices_.size());
+        palette_.resize(joints_.size());
+        for(s32 i=0; i<palette_.size(); ++i){
+            palette_[i].identity();
+        }
+    }
+
+    Skin::~Skin()
+    {}
+
+    void Skin::updatePalette(const Node* nodes)
+    {
+        LASSERT(NULL != nodes || joints_.size()<=0);
+        //Gather world matrices of joints, then multiply all at once
+        for(s32 i=0; i<joints_.size(); ++i){
+            palette_[i] = nodes[joints_[i]].getWorldMatrix();
+        }
+        mul(joints_.size(), palette_.begin(), palette_.begin(), inverseBindMatrices_.begin());
+    }
+
+    Skin& Skin::operator=(Skin&& rhs)
+    {
+        if(this == &rhs){
+            return *this;
+        }
+        joints_ = move(rhs.joints_);
+        inverseBindMatrices_ = move(rhs.inverseBindMatrices_);
+        palette_ = move(rhs.palette_);
+        return *this;
+    }
+}
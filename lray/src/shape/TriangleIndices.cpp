@@ -0,0 +1,199 @@
+/**
+@file TriangleIndices.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "shape/TriangleIndices.h"
+
+namespace lray
+{
+namespace
+{
+#ifdef LRAY_USE_SSE
+    //Load four indices widened to 32bit
+    inline lm128 load4(const u16* indices)
+    {
+        lm128i t = _mm_loadl_epi64(reinterpret_cast<const lm128i*>(indices));
+        return _mm_castsi128_ps(_mm_unpacklo_epi16(t, _mm_setzero_si128()));
+    }
+
+    inline lm128 load4(const u32* indices)
+    {
+        return _mm_loadu_ps(reinterpret_cast<const f32*>(indices));
+    }
+
+    inline lm128 load1(const u16* indices)
+    {
+        return _mm_castsi128_ps(_mm_set1_epi32(indices[0]));
+    }
+
+    inline lm128 load1(const u32* indices)
+    {
+        return _mm_load1_ps(reinterpret_cast<const f32*>(indices));
+    }
+
+    //Store four triangles, twelve indices
+    inline void store12(Triangle* triangles, const lm128& v0, const lm128& v1, const lm128& v2)
+    {
+        f32* dst = reinterpret_cast<f32*>(triangles);
+        _mm_storeu_ps(dst+0, v0);
+        _mm_storeu_ps(dst+4, v1);
+        _mm_storeu_ps(dst+8, v2);
+    }
+
+    inline void widen(s32* dst, s32 size, const u16* src)
+    {
+        s32 i=0;
+        lm128i zero = _mm_setzero_si128();
+        for(; (i+8)<=size; i+=8){
+            lm128i t = _mm_loadu_si128(reinterpret_cast<const lm128i*>(src+i));
+            _mm_storeu_si128(reinterpret_cast<lm128i*>(dst+i), _mm_unpacklo_epi16(t, zero));
+            _mm_storeu_si128(reinterpret_cast<lm128i*>(dst+i+4), _mm_unpackhi_epi16(t, zero));
+        }
+        for(; i<size; ++i){
+            dst[i] = src[i];
+        }
+    }
+#else
+    inline void widen(s32* dst, s32 size, const u16* src)
+    {
+        for(s32 i=0; i<size; ++i){
+            dst[i] = src[i];
+        }
+    }
+#endif
+
+    inline void widen(s32* dst, s32 size, const u32* src)
+    {
+        memcpy(dst, src, sizeof(s32)*size);
+    }
+
+    template<class T>
+    void expandStrip(Triangle* triangles, s32 numIndices, const T* indices)
+    {
+        s32 i=0;
+#ifdef LRAY_USE_SSE
+        //Four triangles (0,1,2) (1,2,3) (2,3,4) (3,4,5) from indices [0, 8)
+        for(; (i+8)<=numIndices; i+=4, triangles+=4){
+            lm128 a = load4(indices+i);
+            lm128 b = load4(indices+i+4);
+            lm128 v0 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(1,2,1,0));
+            lm128 v1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3,2,3,2));
+            lm128 t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1,0,3,3));
+            lm128 v2 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3,2,0,2));
+            store12(triangles, v0, v1, v2);
+        }
+#endif
+        for(; (i+2)<numIndices; ++i, ++triangles){
+            triangles->indices_[0] = indices[i];
+            triangles->indices_[1] = indices[i+1];
+            triangles->indices_[2] = indices[i+2];
+        }
+    }
+
+    template<class T>
+    void expandFan(Triangle* triangles, s32 numIndices, const T* indices)
+    {
+        s32 i=1;
+#ifdef LRAY_USE_SSE
+        //Four triangles (0,1,2) (0,2,3) (0,3,4) (0,4,5) from indices 0 and [i, i+8)
+        lm128 z = load1(indices);
+        for(; (i+8)<=numIndices; i+=4, triangles+=4){
+            lm128 a = load4(indices+i);
+            lm128 b = load4(indices+i+4);
+            lm128 t = _mm_shuffle_ps(z, a, _MM_SHUFFLE(1,0,0,0));
+            lm128 v0 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0,3,2,0));
+            t = _mm_shuffle_ps(a, z, _MM_SHUFFLE(0,0,2,1));
+            lm128 v1 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1,2,1,0));
+            t = _mm_shuffle_ps(a, z, _MM_SHUFFLE(0,0,3,3));
+            t = _mm_shuffle_ps(t, b, _MM_SHUFFLE(0,0,2,0));
+            lm128 v2 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(2,0,1,0));
+            store12(triangles, v0, v1, v2);
+        }
+#endif
+        for(; (i+1)<numIndices; ++i, ++triangles){
+            triangles->indices_[0] = indices[0];
+            triangles->indices_[1] = indices[i];
+            triangles->indices_[2] = indices[i+1];
+        }
+    }
+
+    template<class T>
+    void expand(Triangle* triangles, TriangleTopology topology, s32 numIndices, const T* indices)
+    {
+        switch(topology)
+        {
+        case TriangleTopology_List:
+            //Triangle has the same layout as a list of 32bit indices
+            widen(reinterpret_cast<s32*>(triangles), getNumTriangles(topology, numIndices)*3, indices);
+            break;
+        case TriangleTopology_Strip:
+            expandStrip(triangles, numIndices, indices);
+            break;
+        case TriangleTopology_Fan:
+            expandFan(triangles, numIndices, indices);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+    s32 getNumTriangles(TriangleTopology topology, s32 numIndices)
+    {
+        switch(topology)
+        {
+        case TriangleTopology_List:
+            return numIndices/3;
+        case TriangleTopology_Strip:
+        case TriangleTopology_Fan:
+            return maximum(numIndices-2, 0);
+        default:
+            return 0;
+        }
+    }
+
+    void expandTriangles(Triangle* triangles, TriangleTopology topology, s32 numIndices, const u16* indices)
+    {
+        LASSERT(NULL != triangles || getNumTriangles(topology, numIndices)<=0);
+        expand(triangles, topology, numIndices, indices);
+    }
+
+    void expandTriangles(Triangle* triangles, TriangleTopology topology, s32 numIndices, const u32* indices)
+    {
+        LASSERT(NULL != triangles || getNumTriangles(topology, numIndices)<=0);
+        expand(triangles, topology, numIndices, indices);
+    }
+
+    void generateTriangles(Triangle* triangles, TriangleTopology topology, s32 numVertices)
+    {
+        s32 numTriangles = getNumTriangles(topology, numVertices);
+        Triangle* tri = triangles;
+        switch(topology)
+        {
+        case TriangleTopology_List:
+            for(s32 i=0; i<numTriangles; ++i, ++tri){
+                tri->indices_[0] = 3*i;
+                tri->indices_[1] = 3*i+1;
+                tri->indices_[2] = 3*i+2;
+            }
+            break;
+        case TriangleTopology_Strip:
+            for(s32 i=0; i<numTriangles; ++i, ++tri){
+                tri->indices_[0] = i;
+                tri->indices_[1] = i+1;
+                tri->indices_[2] = i+2;
+            }
+            break;
+        case TriangleTopology_Fan:
+            for(s32 i=0; i<numTriangles; ++i, ++tri){
+                tri->indices_[0] = 0;
+                tri->indices_[1] = i+1;
+                tri->indices_[2] = i+2;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
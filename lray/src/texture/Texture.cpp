@@ -0,0 +1,263 @@
+/**
+@file Texture.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "texture/Texture.h"
+
+namespace lray
+{
+namespace
+{
+    inline s32 wrap(s32 x, s32 size)
+    {
+        x %= size;
+        return (x<0)? x+size : x;
+    }
+
+    inline lm128 toFloat(u32 texel)
+    {
+        lm128i t = _mm_cvtsi32_si128(static_cast<s32>(texel));
+        lm128i zero = _mm_setzero_si128();
+        t = _mm_unpacklo_epi8(t, zero);
+        t = _mm_unpacklo_epi16(t, zero);
+        return _mm_cvtepi32_ps(t);
+    }
+
+    inline u32 average(u32 t0, u32 t1, u32 t2, u32 t3)
+    {
+        u32 result = 0;
+        for(s32 i=0; i<32; i+=8){
+            u32 sum = ((t0>>i)&0xFFU) + ((t1>>i)&0xFFU) + ((t2>>i)&0xFFU) + ((t3>>i)&0xFFU);
+            result |= ((sum+2)>>2)<<i;
+        }
+        return result;
+    }
+
+    //Box filter, odd edges are clamped
+    void downsample(u32* dst, s32 dstWidth, s32 dstHeight, const u32* src, s32 srcWidth, s32 srcHeight)
+    {
+        for(s32 y=0; y<dstHeight; ++y){
+            s32 y0 = minimum(y*2, srcHeight-1);
+            s32 y1 = minimum(y*2+1, srcHeight-1);
+            for(s32 x=0; x<dstWidth; ++x){
+                s32 x0 = minimum(x*2, srcWidth-1);
+                s32 x1 = minimum(x*2+1, srcWidth-1);
+                dst[y*dstWidth+x] = average(src[y0*srcWidth+x0], src[y0*srcWidth+x1], src[y1*srcWidth+x0], src[y1*srcWidth+x1]);
+            }
+        }
+    }
+
+    struct FileWriter
+    {
+        bool write(const u32* tile)
+        {
+            return TileCache::TileTexels == fwrite(tile, sizeof(u32), TileCache::TileTexels, file_);
+        }
+
+        FILE* file_;
+    };
+
+    struct MemoryWriter
+    {
+        bool write(const u32* tile)
+        {
+            memcpy(tiles_, tile, TileCache::TileBytes);
+            tiles_ += TileCache::TileBytes;
+            return true;
+        }
+
+        u8* tiles_;
+    };
+
+    template<class Writer>
+    bool writeLevelTiles(Writer& writer, u32* tile, s32 width, s32 height, const u32* image)
+    {
+        s32 tilesX = (width+TileCache::TileMask)>>TileCache::TileSizeShift;
+        s32 tilesY = (height+TileCache::TileMask)>>TileCache::TileSizeShift;
+        for(s32 ty=0; ty<tilesY; ++ty){
+            for(s32 tx=0; tx<tilesX; ++tx){
+                //Texels out of the image are never fetched
+                memset(tile, 0, TileCache::TileBytes);
+                s32 sx = tx<<TileCache::TileSizeShift;
+                s32 sy = ty<<TileCache::TileSizeShift;
+                s32 w = minimum(TileCache::TileSize, width-sx);
+                s32 h = minimum(TileCache::TileSize, height-sy);
+                for(s32 y=0; y<h; ++y){
+                    memcpy(tile + y*TileCache::TileSize, image + (sy+y)*width + sx, sizeof(u32)*w);
+                }
+                if(!writer.write(tile)){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template<class Writer>
+    s32 writeMipTiles(Texture::Level levels[Texture::MaxLevels], Writer& writer, s64 offset, s32 width, s32 height, const u32* image)
+    {
+        if(width<=0 || height<=0){
+            return 0;
+        }
+
+        u32* tile = LNEW u32[TileCache::TileTexels];
+        u32* buffers[2] = {NULL, NULL};
+        const u32* src = image;
+        s32 numLevels = 0;
+        for(; numLevels<Texture::MaxLevels; ++numLevels){
+            Texture::Level& level = levels[numLevels];
+            level.width_ = width;
+            level.height_ = height;
+            level.tilesX_ = (width+TileCache::TileMask)>>TileCache::TileSizeShift;
+            level.tilesY_ = (height+TileCache::TileMask)>>TileCache::TileSizeShift;
+            level.offset_ = offset;
+            if(!writeLevelTiles(writer, tile, width, height, src)){
+                numLevels = -1;
+                break;
+            }
+            offset += static_cast<s64>(level.tilesX_)*level.tilesY_*TileCache::TileBytes;
+            if(width<=1 && height<=1){
+                ++numLevels;
+                break;
+            }
+
+            //Next level
+            s32 nextWidth = maximum(width>>1, 1);
+            s32 nextHeight = maximum(height>>1, 1);
+            u32*& dst = buffers[numLevels&0x01U];
+            if(NULL == dst){
+                dst = LNEW u32[static_cast<s64>(nextWidth)*nextHeight];
+            }
+            downsample(dst, nextWidth, nextHeight, src, width, height);
+            src = dst;
+            width = nextWidth;
+            height = nextHeight;
+        }
+        LDELETE_ARRAY(buffers[1]);
+        LDELETE_ARRAY(buffers[0]);
+        LDELETE_ARRAY(tile);
+        return maximum(numLevels, 0);
+    }
+}
+
+    Texture::Texture()
+        :file_(-1)
+        ,numLevels_(0)
+    {
+    }
+
+    Texture::Texture(s32 file, s32 numLevels, const Level* levels)
+        :file_(file)
+        ,numLevels_(numLevels)
+    {
+        LASSERT(0<=numLevels_ && numLevels_<=MaxLevels);
+        for(s32 i=0; i<numLevels_; ++i){
+            levels_[i] = levels[i];
+        }
+    }
+
+    u32 Texture::fetchTexel(TileCache& cache, const Level& level, s32 x, s32 y) const
+    {
+        x = wrap(x, level.width_);
+        y = wrap(y, level.height_);
+        s32 tile = (y>>TileCache::TileSizeShift)*level.tilesX_ + (x>>TileCache::TileSizeShift);
+        return cache.getTexel(file_, level.offset_ + static_cast<s64>(tile)*TileCache::TileBytes, ((y&TileCache::TileMask)<<TileCache::TileSizeShift) + (x&TileCache::TileMask));
+    }
+
+    u32 Texture::fetch(TileCache& cache, s32 level, s32 x, s32 y) const
+    {
+        if(numLevels_<=0){
+            return 0;
+        }
+        level = clamp(level, 0, numLevels_-1);
+        return fetchTexel(cache, levels_[level], x, y);
+    }
+
+    lm128 Texture::bilinear(TileCache& cache, const Level& level, f32 u, f32 v) const
+    {
+        f32 x = u*level.width_ - 0.5f;
+        f32 y = v*level.height_ - 0.5f;
+        f32 fx = floorf(x);
+        f32 fy = floorf(y);
+        s32 x0 = static_cast<s32>(fx);
+        s32 y0 = static_cast<s32>(fy);
+        fx = x - fx;
+        fy = y - fy;
+
+        lm128 t00 = toFloat(fetchTexel(cache, level, x0, y0));
+        lm128 t10 = toFloat(fetchTexel(cache, level, x0+1, y0));
+        lm128 t01 = toFloat(fetchTexel(cache, level, x0, y0+1));
+        lm128 t11 = toFloat(fetchTexel(cache, level, x0+1, y0+1));
+
+        lm128 wx = _mm_set1_ps(fx);
+        lm128 wy = _mm_set1_ps(fy);
+        lm128 t0 = _mm_add_ps(t00, _mm_mul_ps(wx, _mm_sub_ps(t10, t00)));
+        lm128 t1 = _mm_add_ps(t01, _mm_mul_ps(wx, _mm_sub_ps(t11, t01)));
+        return _mm_add_ps(t0, _mm_mul_ps(wy, _mm_sub_ps(t1, t0)));
+    }
+
+    Vector4 Texture::sample(TileCache& cache, f32 u, f32 v, f32 lod) const
+    {
+        if(numLevels_<=0){
+            return Vector4(0.0f);
+        }
+        lod = clamp(lod, 0.0f, static_cast<f32>(numLevels_-1));
+        s32 level0 = static_cast<s32>(lod);
+        s32 level1 = minimum(level0+1, numLevels_-1);
+        f32 t = lod - level0;
+
+        lm128 result = bilinear(cache, levels_[level0], u, v);
+        if(level0 != level1 && 0.0f<t){
+            lm128 result1 = bilinear(cache, levels_[level1], u, v);
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(t), _mm_sub_ps(result1, result)));
+        }
+        return Vector4(_mm_mul_ps(result, _mm_set1_ps(1.0f/255.0f)));
+    }
+
+    f32 Texture::calcLod(const Vector2& dUVdx, const Vector2& dUVdy) const
+    {
+        if(numLevels_<=0){
+            return 0.0f;
+        }
+        //The longer axis of the footprint in texels
+        f32 w = static_cast<f32>(levels_[0].width_);
+        f32 h = static_cast<f32>(levels_[0].height_);
+        f32 lx = (dUVdx.x_*w)*(dUVdx.x_*w) + (dUVdx.y_*h)*(dUVdx.y_*h);
+        f32 ly = (dUVdy.x_*w)*(dUVdy.x_*w) + (dUVdy.y_*h)*(dUVdy.y_*h);
+        f32 l = maximum(lx, ly);
+        return (1.0f<l)? 0.5f*log2(l) : 0.0f;
+    }
+
+    s64 Texture::calcNumTiles(s32 width, s32 height)
+    {
+        s64 numTiles = 0;
+        for(s32 i=0; i<MaxLevels; ++i){
+            s64 tilesX = (width+TileCache::TileMask)>>TileCache::TileSizeShift;
+            s64 tilesY = (height+TileCache::TileMask)>>TileCache::TileSizeShift;
+            numTiles += tilesX*tilesY;
+            if(width<=1 && height<=1){
+                break;
+            }
+            width = maximum(width>>1, 1);
+            height = maximum(height>>1, 1);
+        }
+        return numTiles;
+    }
+
+    s32 Texture::writeTiles(Level levels[MaxLevels], FILE* file, s64 offset, s32 width, s32 height, const u32* image)
+    {
+        LASSERT(NULL != file);
+        LASSERT(NULL != image);
+        FileWriter writer = {file};
+        return writeMipTiles(levels, writer, offset, width, height, image);
+    }
+
+    s32 Texture::writeTiles(Level levels[MaxLevels], u8* tiles, s32 width, s32 height, const u32* image)
+    {
+        LASSERT(NULL != tiles);
+        LASSERT(NULL != image);
+        MemoryWriter writer = {tiles};
+        return writeMipTiles(levels, writer, 0, width, height, image);
+    }
+}
@@ -0,0 +1,296 @@
+/**
+@file TileCache.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "texture/TileCache.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+namespace lray
+{
+    //--------------------------------------------
+    //--- TileCache::Shard
+    //--------------------------------------------
+    TileCache::Shard::Shard()
+        :numSlots_(0)
+        ,numUsed_(0)
+        ,tiles_(NULL)
+        ,slots_(NULL)
+        ,hashMask_(0)
+        ,hashTable_(NULL)
+        ,head_(-1)
+        ,tail_(-1)
+    {
+    }
+
+    void TileCache::Shard::release()
+    {
+        LDELETE_ARRAY(hashTable_);
+        LDELETE_ARRAY(slots_);
+        LDELETE_ARRAY(tiles_);
+        numSlots_ = 0;
+        numUsed_ = 0;
+        head_ = tail_ = -1;
+    }
+
+    void TileCache::Shard::allocate(s32 numSlots)
+    {
+        numSlots_ = numSlots;
+        tiles_ = LNEW u32[static_cast<s64>(numSlots_)*TileTexels];
+        slots_ = LNEW Slot[numSlots_];
+
+        s32 hashSize = 1;
+        while(hashSize<(numSlots_<<1)){
+            hashSize <<= 1;
+        }
+        hashMask_ = hashSize-1;
+        hashTable_ = LNEW s32[hashSize];
+        for(s32 i=0; i<hashSize; ++i){
+            hashTable_[i] = -1;
+        }
+    }
+
+    s32 TileCache::Shard::find(u64 key, s32 bucket) const
+    {
+        for(s32 slot = hashTable_[bucket]; 0<=slot; slot = slots_[slot].hashNext_){
+            if(key == slots_[slot].key_){
+                return slot;
+            }
+        }
+        return -1;
+    }
+
+    s32 TileCache::Shard::reserve()
+    {
+        //Take an unused slot, or evict the least recently used one. Slots being read are not in the list.
+        s32 slot;
+        if(numUsed_<numSlots_){
+            slot = numUsed_++;
+            slots_[slot].key_ = InvalidKey;
+            slots_[slot].prev_ = slots_[slot].next_ = -1;
+            slots_[slot].hashNext_ = -1;
+            slots_[slot].loading_ = 0;
+            return slot;
+        }
+        slot = tail_;
+        if(0<=slot){
+            unlink(slot);
+            removeHash(slot);
+        }
+        return slot;
+    }
+
+    void TileCache::Shard::unlink(s32 slot)
+    {
+        Slot& s = slots_[slot];
+        if(0<=s.prev_){
+            slots_[s.prev_].next_ = s.next_;
+        }else{
+            head_ = s.next_;
+        }
+        if(0<=s.next_){
+            slots_[s.next_].prev_ = s.prev_;
+        }else{
+            tail_ = s.prev_;
+        }
+        s.prev_ = s.next_ = -1;
+    }
+
+    void TileCache::Shard::pushFront(s32 slot)
+    {
+        Slot& s = slots_[slot];
+        s.prev_ = -1;
+        s.next_ = head_;
+        if(0<=head_){
+            slots_[head_].prev_ = slot;
+        }
+        head_ = slot;
+        if(tail_<0){
+            tail_ = slot;
+        }
+    }
+
+    void TileCache::Shard::pushBack(s32 slot)
+    {
+        Slot& s = slots_[slot];
+        s.prev_ = tail_;
+        s.next_ = -1;
+        if(0<=tail_){
+            slots_[tail_].next_ = slot;
+        }
+        tail_ = slot;
+        if(head_<0){
+            head_ = slot;
+        }
+    }
+
+    void TileCache::Shard::removeHash(s32 slot)
+    {
+        Slot& s = slots_[slot];
+        if(InvalidKey == s.key_){
+            return;
+        }
+        s32* link = &hashTable_[static_cast<s32>(hash(s.key_)) & hashMask_];
+        while(*link != slot){
+            LASSERT(0<=*link);
+            link = &slots_[*link].hashNext_;
+        }
+        *link = s.hashNext_;
+        s.hashNext_ = -1;
+        s.key_ = InvalidKey;
+    }
+
+    //--------------------------------------------
+    //--- TileCache
+    //--------------------------------------------
+    TileCache::TileCache(s64 budget)
+        :budget_(0)
+        ,numHits_(0)
+        ,numMisses_(0)
+    {
+        setBudget(budget);
+    }
+
+    TileCache::~TileCache()
+    {
+        for(s32 i=0; i<NumShards; ++i){
+            shards_[i].release();
+        }
+        for(s32 i=0; i<sources_.size(); ++i){
+            if(NULL != sources_[i].file_){
+                fclose(sources_[i].file_);
+            }
+            LDELETE_ARRAY(sources_[i].memory_);
+        }
+        sources_.clear();
+    }
+
+    void TileCache::setBudget(s64 budget)
+    {
+        budget_ = budget;
+        s32 numSlots = static_cast<s32>(minimum(maximum(budget/TileBytes/NumShards, static_cast<s64>(MinTiles)), static_cast<s64>(0x3FFFFFFF)));
+        for(s32 i=0; i<NumShards; ++i){
+            std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+            shards_[i].release();
+            shards_[i].allocate(numSlots);
+        }
+    }
+
+    s32 TileCache::addFile(const Char* path)
+    {
+        LASSERT(NULL != path);
+        FILE* file = fopen(path, "rb");
+        if(NULL == file){
+            return -1;
+        }
+        Source source = {file, NULL, 0};
+        std::lock_guard<std::mutex> lock(sourcesMutex_);
+        sources_.push_back(source);
+        return sources_.size()-1;
+    }
+
+    s32 TileCache::addMemory(u8* data, s64 size)
+    {
+        LASSERT(NULL != data);
+        LASSERT(0<=size);
+        Source source = {NULL, data, size};
+        std::lock_guard<std::mutex> lock(sourcesMutex_);
+        sources_.push_back(source);
+        return sources_.size()-1;
+    }
+
+    inline u64 TileCache::hash(u64 key)
+    {
+        key ^= key>>33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key>>33;
+        return key;
+    }
+
+    bool TileCache::readTile(u32* tile, s32 file, s64 offset)
+    {
+        std::unique_lock<std::mutex> lock(sourcesMutex_);
+        LASSERT(0<=file && file<sources_.size());
+        Source source = sources_[file];
+        if(NULL != source.memory_){
+            lock.unlock();
+            if(source.size_<offset+TileBytes){
+                return false;
+            }
+            memcpy(tile, source.memory_+offset, TileBytes);
+            return true;
+        }
+#ifdef _MSC_VER
+        //No positional reads, the file position is shared
+        return seekFile(source.file_, offset) && TileTexels == fread(tile, sizeof(u32), TileTexels, source.file_);
+#else
+        lock.unlock();
+        return TileBytes == pread(fileno(source.file_), tile, TileBytes, static_cast<off_t>(offset));
+#endif
+    }
+
+    u32 TileCache::getTexel(s32 file, s64 offset, s32 texel)
+    {
+        LASSERT(0<=file);
+        LASSERT(0<=offset && offset<(static_cast<s64>(0x01)<<48));
+        LASSERT(0<=texel && texel<TileTexels);
+        u64 key = (static_cast<u64>(file)<<48) | static_cast<u64>(offset);
+        u64 h = hash(key);
+        Shard& shard = shards_[h>>(64-ShardShift)];
+
+        std::unique_lock<std::mutex> lock(shard.mutex_);
+        s32 bucket = static_cast<s32>(h) & shard.hashMask_;
+        s32 slot;
+        for(;;){
+            slot = shard.find(key, bucket);
+            if(0<=slot){
+                if(shard.slots_[slot].loading_){
+                    shard.loaded_.wait(lock);
+                    continue;
+                }
+                numHits_.fetch_add(1, std::memory_order_relaxed);
+                if(shard.head_ != slot){
+                    shard.unlink(slot);
+                    shard.pushFront(slot);
+                }
+                return shard.tiles_[static_cast<s64>(slot)*TileTexels + texel];
+            }
+            slot = shard.reserve();
+            if(0<=slot){
+                break;
+            }
+            //All slots are being read
+            shard.loaded_.wait(lock);
+        }
+        numMisses_.fetch_add(1, std::memory_order_relaxed);
+
+        //Publish the key first, the others wait for the slot instead of reading the same tile
+        Slot& s = shard.slots_[slot];
+        s.key_ = key;
+        s.hashNext_ = shard.hashTable_[bucket];
+        s.loading_ = 1;
+        shard.hashTable_[bucket] = slot;
+        u32* tile = shard.tiles_ + static_cast<s64>(slot)*TileTexels;
+
+        lock.unlock();
+        bool read = readTile(tile, file, offset);
+        lock.lock();
+
+        s.loading_ = 0;
+        u32 result = 0;
+        if(read){
+            shard.pushFront(slot);
+            result = tile[texel];
+        }else{
+            //Leave the slot to be reused first
+            shard.removeHash(slot);
+            shard.pushBack(slot);
+        }
+        lock.unlock();
+        shard.loaded_.notify_all();
+        return result;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef INC_LRAY_TEXTURE_H__
+#define INC_LRAY_TEXTURE_H__
+/**
+@file Texture.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../math/Vector2.h"
+#include "../math/Vector4.h"
+#include "TileCache.h"
+
+namespace lray
+{
+    /**
+    @brief Mip-mapped RGBA8 texture, which is stored as tiles in a cache file
+    */
+    class Texture
+    {
+    public:
+        static const s32 MaxLevels = 16;
+
+        struct Level
+        {
+            s32 width_;
+            s32 height_;
+            s32 tilesX_;
+            s32 tilesY_;
+            s64 offset_; ///< byte offset of the first tile in the file
+        };
+
+        Texture();
+        Texture(s32 file, s32 numLevels, const Level* levels);
+
+        inline s32 getWidth() const;
+        inline s32 getHeight() const;
+        inline s32 getNumLevels() const;
+        inline const Level& getLevel(s32 level) const;
+
+        /**
+        @brief Texel in RGBA8, coordinates wrap around
+        */
+        u32 fetch(TileCache& cache, s32 level, s32 x, s32 y) const;
+
+        /**
+        @brief Trilinear sample in [0 1], coordinates wrap around
+        @param lod ... level of detail, 0 is the finest
+        */
+        Vector4 sample(TileCache& cache, f32 u, f32 v, f32 lod=0.0f) const;
+
+        /**
+        @brief Level of detail of a footprint in texture coordinates
+        */
+        f32 calcLod(const Vector2& dUVdx, const Vector2& dUVdy) const;
+
+        /**
+        @brief Number of tiles of the mip chain of an image
+        */
+        static s64 calcNumTiles(s32 width, s32 height);
+
+        /**
+        @brief Build a mip chain of an image, and write it as tiles to a file
+        @param levels[out]
+        @param offset ... current byte position of the file
+        @return number of levels, 0 if failed
+        */
+        static s32 writeTiles(Level levels[MaxLevels], FILE* file, s64 offset, s32 width, s32 height, const u32* image);
+
+        /**
+        @brief Build a mip chain of an image, and write it as tiles to memory from offset 0
+        @param tiles ... calcNumTiles(width, height)*TileCache::TileBytes bytes
+        @return number of levels, 0 if failed
+        */
+        static s32 writeTiles(Level levels[MaxLevels], u8* tiles, s32 width, s32 height, const u32* image);
+    private:
+        u32 fetchTexel(TileCache& cache, const Level& level, s32 x, s32 y) const;
+        lm128 bilinear(TileCache& cache, const Level& level, f32 u, f32 v) const;
+
+        s32 file_;
+        s32 numLevels_;
+        Level levels_[MaxLevels];
+    };
+
+    static_assert(std::is_trivially_copyable<Texture>::value == true, "Texture must be trivially copyable.");
+
+    inline s32 Texture::getWidth() const
+    {
+        return (0<numLevels_)? levels_[0].width_ : 0;
+    }
+
+    inline s32 Texture::getHeight() const
+    {
+        return (0<numLevels_)? levels_[0].height_ : 0;
+    }
+
+    inline s32 Texture::getNumLevels() const
+    {
+        return numLevels_;
+    }
+
+    inline const Texture::Level& Texture::getLevel(s32 level) const
+    {
+        LASSERT(0<=level && level<numLevels_);
+        return levels_[level];
+    }
+}
+#endif //INC_LRAY_TEXTURE_H__
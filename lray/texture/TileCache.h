@@ -0,0 +1,153 @@
+#ifndef INC_LRAY_TILECACHE_H__
+#define INC_LRAY_TILECACHE_H__
+/**
+@file TileCache.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "../lray.h"
+#include "../core/Array.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+namespace lray
+{
+    /**
+    @brief Bounded LRU cache of texture tiles, which are read from converted cache files, or memory blocks if files cannot be written, on demand.
+    Tiles are sharded by keys, each shard has its own lock and LRU list, and files are read outside locks.
+    */
+    class TileCache
+    {
+    public:
+        static const s32 TileSizeShift = 5;
+        static const s32 TileSize = (0x01<<TileSizeShift);
+        static const s32 TileMask = TileSize-1;
+        static const s32 TileTexels = TileSize*TileSize;
+        static const s32 TileBytes = TileTexels*sizeof(u32);
+        static const s64 DefaultBudget = 256*1024*1024;
+        static const s32 ShardShift = 4;
+        static const s32 NumShards = (0x01<<ShardShift);
+        static const s32 MinTiles = 4; ///< per shard
+
+        explicit TileCache(s64 budget=DefaultBudget);
+        ~TileCache();
+
+        /**
+        @brief Change the budget in bytes, cached tiles are dropped. Texels must not be fetched meanwhile.
+        */
+        void setBudget(s64 budget);
+        inline s64 getBudget() const;
+
+        /**
+        @brief Open a file to read tiles from
+        @return file id, -1 if failed
+        */
+        s32 addFile(const Char* path);
+
+        /**
+        @brief Take a block of tiles in memory to read tiles from, which is freed with the cache
+        @return file id
+        */
+        s32 addMemory(u8* data, s64 size);
+
+        /**
+        @brief Get a texel of a tile at a byte offset of a file, the tile is read if not cached
+        @param texel ... index in the tile
+        @return 0 if failed
+        */
+        u32 getTexel(s32 file, s64 offset, s32 texel);
+
+        inline s64 getNumHits() const;
+        inline s64 getNumMisses() const;
+    private:
+        TileCache(const TileCache&) = delete;
+        TileCache& operator=(const TileCache&) = delete;
+
+        static const u64 InvalidKey = static_cast<u64>(-1);
+
+        struct Slot
+        {
+            u64 key_;
+            s32 prev_;
+            s32 next_;
+            s32 hashNext_;
+            s32 loading_; ///< not in the LRU list while being read
+        };
+
+        struct Shard
+        {
+            Shard();
+
+            void release();
+            void allocate(s32 numSlots);
+            s32 find(u64 key, s32 bucket) const;
+            s32 reserve();
+            void unlink(s32 slot);
+            void pushFront(s32 slot);
+            void pushBack(s32 slot);
+            void removeHash(s32 slot);
+
+            std::mutex mutex_;
+            std::condition_variable loaded_;
+            s32 numSlots_;
+            s32 numUsed_;
+            u32* tiles_;
+            Slot* slots_;
+            s32 hashMask_;
+            s32* hashTable_;
+            s32 head_; ///< most recently used
+            s32 tail_; ///< least recently used
+        };
+
+        /**
+        @brief A file or a block in memory
+        */
+        struct Source
+        {
+            FILE* file_;
+            u8* memory_;
+            s64 size_; ///< of memory_
+        };
+
+        static inline u64 hash(u64 key);
+        bool readTile(u32* tile, s32 file, s64 offset);
+
+        s64 budget_;
+        Shard shards_[NumShards];
+        std::atomic<s64> numHits_;
+        std::atomic<s64> numMisses_;
+
+        Array<Source> sources_;
+        std::mutex sourcesMutex_;
+    };
+
+    inline s64 TileCache::getBudget() const
+    {
+        return budget_;
+    }
+
+    inline s64 TileCache::getNumHits() const
+    {
+        return numHits_.load(std::memory_order_relaxed);
+    }
+
+    inline s64 TileCache::getNumMisses() const
+    {
+        return numMisses_.load(std::memory_order_relaxed);
+    }
+
+    /**
+    @brief Seek in a file larger than 2GB
+    */
+    inline bool seekFile(FILE* file, s64 offset)
+    {
+#ifdef _MSC_VER
+        return 0 == _fseeki64(file, offset, SEEK_SET);
+#else
+        return 0 == fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    }
+}
+#endif //INC_LRAY_TILECACHE_H__
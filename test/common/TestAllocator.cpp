@@ -0,0 +1,133 @@
+#include "catch.hpp"
+#include "core/Allocator.h"
+#include "core/Parallel.h"
+#include "core/Random.h"
+#include <atomic>
+
+namespace
+{
+    bool isAligned(const void* ptr, lray::u32 alignment)
+    {
+        return 0 == (reinterpret_cast<uintptr_t>(ptr) & (alignment-1));
+    }
+
+    //Each thread allocates and frees blocks of random sizes, freeing some of other threads' too
+    void allocateRandomly(int numThreads, int numIterations, void** shared, int numShared)
+    {
+        lray::parallelForWorkers(0, numThreads, [=](lray::s32 index, lray::s32)
+        {
+            lray::RandXorshift128Plus32 random(index+1);
+            void* blocks[64] = {};
+            for(int i=0; i<numIterations; ++i){
+                int slot = random.rand() & 63;
+                lray::lfree(blocks[slot]);
+                blocks[slot] = lray::lmalloc(16 + (random.rand() & 4095));
+                if(0 == (i & 255)){
+                    //Blocks migrate between threads
+                    int other = random.rand() % numShared;
+                    void* ptr = reinterpret_cast<std::atomic<void*>*>(shared)[other].exchange(blocks[slot]);
+                    blocks[slot] = ptr;
+                }
+            }
+            for(int i=0; i<64; ++i){
+                lray::lfree(blocks[i]);
+            }
+        });
+    }
+}
+
+TEST_CASE("Test Allocator", "[Allocator]"){
+
+    SECTION("Alignment"){
+        static const lray::u32 Alignments[] = {16, 32, 64, 128, 4096};
+        for(lray::u32 alignment : Alignments){
+            for(size_t size=1; size<(1<<20); size*=7){
+                void* ptr = lray::lmalloc(size, alignment);
+                CHECK(isAligned(ptr, alignment));
+                memset(ptr, 0xFF, size);
+                lray::lfree(ptr, alignment);
+            }
+        }
+        void* ptr = lray::lmalloc(24);
+        CHECK(isAligned(ptr, 16));
+        lray::lfree(ptr);
+        lray::lfree(NULL);
+    }
+
+    SECTION("HugePages"){
+        size_t threshold = lray::Allocator::getHugePageThreshold();
+        lray::Allocator::setHugePageThreshold(64*1024);
+        size_t size = 3*1024*1024 + 5;
+        lray::u8* ptr = reinterpret_cast<lray::u8*>(lray::lmalloc(size, 64));
+        CHECK(isAligned(ptr, 64));
+        memset(ptr, 0x55, size);
+        CHECK(0x55 == ptr[size-1]);
+        lray::lfree(ptr, 64);
+        lray::Allocator::setHugePageThreshold(threshold);
+    }
+
+    SECTION("Mapped"){
+        //Small blocks share pages in the heap
+        void* small = lray::lmalloc(256, 64);
+        CHECK_FALSE(lray::Allocator::isMapped(small));
+        lray::lfree(small, 64);
+
+        lray::u8* ptr = reinterpret_cast<lray::u8*>(lray::Allocator::allocateMapped(1000, 4096, __FILE__, __LINE__));
+        CHECK(isAligned(ptr, 4096));
+#if defined(__linux__)
+        CHECK(lray::Allocator::isMapped(ptr));
+#endif
+        memset(ptr, 0x55, 1000);
+        CHECK(0x55 == ptr[999]);
+        lray::lfree(ptr, 4096);
+    }
+
+    SECTION("Threads"){
+        static const int NumShared = 16;
+        std::atomic<void*> shared[NumShared];
+        for(int i=0; i<NumShared; ++i){
+            shared[i].store(NULL);
+        }
+        allocateRandomly(lray::getNumHardwareThreads()*2, 1<<14, reinterpret_cast<void**>(shared), NumShared);
+        for(int i=0; i<NumShared; ++i){
+            lray::lfree(shared[i].load());
+        }
+        SUCCEED();
+    }
+
+#if defined(LRAY_ALLOCATOR_STATS)
+    SECTION("Stats"){
+        //The largest site, other allocations between may be counted in the totals
+        static const lray::s64 Size = 64*1024*1024;
+        const int line = __LINE__ + 1;
+        void* ptr = lray::lmalloc(Size, __FILE__, line);
+        lray::AllocationSite sites[4];
+        lray::s32 numSites = lray::Allocator::getAllocationSites(4, sites);
+        REQUIRE(0<numSites);
+        CHECK(line == sites[0].line_);
+        CHECK(Size == sites[0].liveBytes_);
+        CHECK(Size <= lray::Allocator::getPeakBytes());
+        lray::lfree(ptr);
+        numSites = lray::Allocator::getAllocationSites(4, sites);
+        REQUIRE(0<numSites);
+        CHECK(line == sites[0].line_);
+        CHECK(0 == sites[0].liveBytes_);
+        CHECK(Size == sites[0].peakBytes_);
+    }
+#endif
+}
+
+TEST_CASE("Benchmark Allocator", "[.][benchmark]"){
+
+    static const int NumShared = 16;
+    std::atomic<void*> shared[NumShared];
+    for(int i=0; i<NumShared; ++i){
+        shared[i].store(NULL);
+    }
+    BENCHMARK("Threads"){
+        allocateRandomly(lray::getNumHardwareThreads(), 1<<20, reinterpret_cast<void**>(shared), NumShared);
+    }
+    for(int i=0; i<NumShared; ++i){
+        lray::lfree(shared[i].load());
+    }
+}
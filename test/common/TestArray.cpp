@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "core/Array.h"
+#include "core/SmallArray.h"
 #include "core/Random.h"
 
 void createRandom(int size, int* data, int vmin, int vmax)
@@ -68,4 +69,150 @@ TEST_CASE("Test Array", "[Array]"){
         REQUIRE(NumSamples <= countDestruct);
     }
 
+    SECTION("Geometric"){
+        typedef lray::ArrayGeometricCapacityIncrement<16> Increment;
+        lray::Array<int, Increment> array;
+        int numReallocations = 0;
+        for(int i=0; i<(1<<16); ++i){
+            int capacity = array.capacity();
+            array.push_back(i);
+            numReallocations += (capacity != array.capacity())? 1 : 0;
+        }
+        CHECK(13 == numReallocations);
+        CHECK((1<<16) == array.capacity());
+
+        //resize grows by the policy too, explicit reserve is exact
+        lray::Array<int, Increment> nodes;
+        numReallocations = 0;
+        for(int i=0; i<(1<<12); ++i){
+            int capacity = nodes.capacity();
+            nodes.resize(nodes.size()+4);
+            numReallocations += (capacity != nodes.capacity())? 1 : 0;
+        }
+        CHECK(numReallocations<=12);
+        nodes.clear();
+        nodes.reserve(100000);
+        CHECK(100000 == nodes.capacity());
+    }
+
+    SECTION("MovePolicies"){
+        lray::Array<int, lray::ArrayGeometricCapacityIncrement<> > src;
+        src.reserve(1000);
+        for(int i=0; i<NumSamples; ++i){
+            src.push_back(i);
+        }
+        const int* items = src.begin();
+        lray::Array<int> dst(lray::move(src));
+        CHECK(1000 == dst.capacity());
+        CHECK(items == dst.begin());
+        CHECK(NumSamples == dst.size());
+        CHECK(0 == src.size());
+        src = lray::move(dst);
+        CHECK(items == src.begin());
+        CHECK((NumSamples-1) == src.back());
+    }
+
+    SECTION("SmallArray"){
+        lray::SmallArray<int, 4> array;
+        CHECK(array.isInline());
+        for(int i=0; i<4; ++i){
+            array.push_back(i);
+        }
+        CHECK(array.isInline());
+        array.push_back(4);
+        CHECK(!array.isInline());
+        for(int i=0; i<5; ++i){
+            CHECK(i == array[i]);
+        }
+
+        //Heap buffers are taken
+        const int* items = array.begin();
+        lray::SmallArray<int, 4> other(lray::move(array));
+        CHECK(items == other.begin());
+        CHECK(array.isInline());
+        CHECK(0 == array.size());
+
+        //Inline items are copied into the reserved storage
+        array.push_back(7);
+        other = lray::move(array);
+        CHECK(items == other.begin());
+        CHECK(1 == other.size());
+        CHECK(7 == other[0]);
+
+        other.removeAt(0);
+        CHECK(0 == other.size());
+        other.resize(32);
+        CHECK(32 == other.size());
+    }
+}
+
+namespace
+{
+    //A primitive list of the loader, or a node array of the accelerator
+    struct Item64
+    {
+        lray::f32 values_[16];
+    };
+
+    template<class ArrayType>
+    void pushItems(int count)
+    {
+        ArrayType array;
+        Item64 item = {};
+        for(int i=0; i<count; ++i){
+            item.values_[0] = static_cast<lray::f32>(i);
+            array.push_back(item);
+        }
+    }
+
+    template<class ArrayType>
+    void resizeNodes(int count)
+    {
+        ArrayType array;
+        while(array.size()<count){
+            array.resize(array.size()+4);
+        }
+    }
+
+    template<class ArrayType>
+    int pushSmall(int count)
+    {
+        int sum = 0;
+        for(int i=0; i<count; ++i){
+            ArrayType array;
+            for(int j=0; j<3; ++j){
+                array.push_back(i+j);
+            }
+            sum += array[i%3];
+        }
+        return sum;
+    }
+}
+
+TEST_CASE("Benchmark Array", "[.][benchmark]"){
+    typedef lray::ArrayStaticCapacityIncrement<> Static;
+    typedef lray::ArrayGeometricCapacityIncrement<> Geometric;
+    static const int NumItems = 1<<15;
+    static const int NumNodes = 1<<15;
+
+    BENCHMARK("push_back Static"){
+        pushItems<lray::Array<Item64, Static> >(NumItems);
+    }
+    BENCHMARK("push_back Geometric"){
+        pushItems<lray::Array<Item64, Geometric> >(NumItems);
+    }
+    BENCHMARK("resize Static"){
+        resizeNodes<lray::Array<Item64, Static> >(NumNodes);
+    }
+    BENCHMARK("resize Geometric"){
+        resizeNodes<lray::Array<Item64, Geometric> >(NumNodes);
+    }
+    int sum = 0;
+    BENCHMARK("tiny Array"){
+        sum += pushSmall<lray::Array<int> >(NumItems);
+    }
+    BENCHMARK("tiny SmallArray"){
+        sum += pushSmall<lray::SmallArray<int, 4> >(NumItems);
+    }
+    CHECK(0 != sum);
 }
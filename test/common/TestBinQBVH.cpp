@@ -0,0 +1,164 @@
+#include "catch.hpp"
+#include "core/Random.h"
+#include "core/Sort.h"
+#include "math/Ray.h"
+#include "shape/Primitive.h"
+#include "accel/BinQBVH.h"
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    typedef lray::BinQBVH<lray::TriangleProxy> BVH;
+
+    //Small random triangles in a box
+    lray::Primitive* createTriangles(lray::s32 numTriangles, lray::u32 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        lray::s32 numVertices = numTriangles*3;
+        lray::Vector3* positions = LNEW lray::Vector3[numVertices];
+        lray::Vector3* normals = LNEW lray::Vector3[numVertices];
+        lray::Triangle* triangles = LNEW lray::Triangle[numTriangles];
+        for(lray::s32 i=0; i<numTriangles; ++i){
+            lray::Vector3 center(random.frand2()*10.0f, random.frand2()*10.0f, random.frand2()*10.0f);
+            for(lray::s32 j=0; j<3; ++j){
+                positions[3*i+j] = lray::Vector3(center.x_+random.frand2()*0.5f, center.y_+random.frand2()*0.5f, center.z_+random.frand2()*0.5f);
+                normals[3*i+j] = lray::Vector3(0.0f, 1.0f, 0.0f);
+                triangles[i].indices_[j] = 3*i+j;
+            }
+        }
+        return LNEW lray::Primitive(numVertices, positions, normals, numTriangles, triangles);
+    }
+
+    //Triangle indices in a leaf, in order of triangles
+    std::vector<lray::s32> getLeafTriangles(const BVH& bvh, const lray::TriangleProxy* proxies, const BVH::Node& node)
+    {
+        std::vector<lray::s32> triangles;
+        for(lray::u32 i=0; i<node.getNumPrimitives(); ++i){
+            triangles.push_back(proxies[bvh.getPrimitiveIndex(node.getPrimitiveIndex()+i)].index_);
+        }
+        lray::introsort(static_cast<lray::s32>(triangles.size()), &triangles[0]);
+        return triangles;
+    }
+
+    //Trees are the same, if topologies, bounding boxes, and sets of triangles in leaves are the same
+    bool isSameTree(const BVH& bvh0, const lray::TriangleProxy* proxies0, const BVH& bvh1, const lray::TriangleProxy* proxies1)
+    {
+        if(bvh0.getNumNodes() != bvh1.getNumNodes() || bvh0.getDepth() != bvh1.getDepth()){
+            return false;
+        }
+        for(lray::s32 i=0; i<bvh0.getNumNodes(); ++i){
+            const BVH::Node& node0 = bvh0.getNode(i);
+            const BVH::Node& node1 = bvh1.getNode(i);
+            if(node0.isLeaf() != node1.isLeaf()){
+                return false;
+            }
+            if(node0.isLeaf()){
+                if(getLeafTriangles(bvh0, proxies0, node0) != getLeafTriangles(bvh1, proxies1, node1)){
+                    return false;
+                }
+                continue;
+            }
+            const BVH::Joint& joint0 = node0.joint_;
+            const BVH::Joint& joint1 = node1.joint_;
+            if(joint0.children_ != joint1.children_
+                || joint0.axis0_ != joint1.axis0_
+                || joint0.axis1_ != joint1.axis1_
+                || joint0.axis2_ != joint1.axis2_
+                || 0 != memcmp(joint0.bbox_, joint1.bbox_, sizeof(joint0.bbox_))){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    lray::Ray createRay(lray::RandXorshift128Plus32& random)
+    {
+        lray::Vector3 origin(random.frand2()*10.0f, random.frand2()*10.0f, -1.0f);
+        lray::Vector3 direction(random.frand2()-0.5f, random.frand2()-0.5f, 1.0f);
+        return lray::Ray(origin, lray::normalize(direction), 1.0e30f);
+    }
+}
+
+TEST_CASE("Test BinQBVH", "[BinQBVH]"){
+    static const lray::s32 NumTriangles = 1<<14;
+    lray::Primitive* primitive = createTriangles(NumTriangles, 1);
+    lray::TriangleProxy* proxies = LNEW lray::TriangleProxy[NumTriangles];
+    primitive->getTriangleProxies(proxies);
+
+    BVH bvh;
+    bvh.build(NumTriangles, proxies);
+
+    SECTION("Order independent"){
+        //Splits do not depend on the order of primitives
+        lray::TriangleProxy* shuffled = LNEW lray::TriangleProxy[NumTriangles];
+        for(lray::s32 i=0; i<NumTriangles; ++i){
+            shuffled[i] = proxies[i];
+        }
+        lray::RandXorshift128Plus32 random(2);
+        for(lray::s32 i=NumTriangles-1; 0<i; --i){
+            lray::s32 j = static_cast<lray::s32>(random.rand() % static_cast<lray::u32>(i+1));
+            lray::swap(shuffled[i], shuffled[j]);
+        }
+        BVH shuffledBVH;
+        shuffledBVH.build(NumTriangles, shuffled);
+        CHECK(isSameTree(bvh, proxies, shuffledBVH, shuffled));
+        LDELETE_ARRAY(shuffled);
+    }
+
+    SECTION("Intersect"){
+        //Compare with brute force, trees built fast for previews give the same hits
+        static const lray::s32 NumRays = 256;
+        BVH fastBVH;
+        fastBVH.build(NumTriangles, proxies, true);
+        lray::RandXorshift128Plus32 random(3);
+        for(lray::s32 i=0; i<NumRays; ++i){
+            lray::Ray ray = createRay(random);
+            lray::f32 tmax = ray.t_;
+            lray::f32 closest = tmax;
+            for(lray::s32 j=0; j<NumTriangles; ++j){
+                lray::f32 t, v, w;
+                if(lray::Result_Fail != proxies[j].testRay(t, v, w, ray) && lray::F32_HITEPSILON<t && t<closest){
+                    closest = t;
+                }
+            }
+            lray::Ray fastRay = ray;
+            lray::HitRecord hitRecord = bvh.intersect(ray);
+            lray::HitRecord fastHitRecord = fastBVH.intersect(fastRay);
+            if(closest<tmax){
+                REQUIRE(lray::Result_Fail != hitRecord.result_);
+                CHECK(hitRecord.t_ == Approx(closest));
+                REQUIRE(lray::Result_Fail != fastHitRecord.result_);
+                CHECK(fastHitRecord.t_ == Approx(closest));
+            }else{
+                CHECK(lray::Result_Fail == hitRecord.result_);
+                CHECK(lray::Result_Fail == fastHitRecord.result_);
+            }
+        }
+    }
+    LDELETE_ARRAY(proxies);
+    LDELETE(primitive);
+}
+
+TEST_CASE("Benchmark BinQBVH", "[.][benchmark]"){
+    static const lray::s32 NumTriangles = 1<<20;
+    lray::Primitive* primitive = createTriangles(NumTriangles, 1);
+    lray::TriangleProxy* proxies = LNEW lray::TriangleProxy[NumTriangles];
+    primitive->getTriangleProxies(proxies);
+
+    BVH bvh;
+    for(lray::s32 i=0; i<3; ++i){
+        auto start = std::chrono::high_resolution_clock::now();
+        bvh.build(NumTriangles, proxies);
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        printf("build %d triangles: %.1f ms, %d nodes\n", NumTriangles, duration.count()*1.0e3, bvh.getNumNodes());
+    }
+    for(lray::s32 i=0; i<3; ++i){
+        auto start = std::chrono::high_resolution_clock::now();
+        bvh.build(NumTriangles, proxies, true);
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        printf("fast build %d triangles: %.1f ms, %d nodes\n", NumTriangles, duration.count()*1.0e3, bvh.getNumNodes());
+    }
+    LDELETE_ARRAY(proxies);
+    LDELETE(primitive);
+}
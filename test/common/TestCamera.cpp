@@ -0,0 +1,82 @@
+#include "catch.hpp"
+#include "Camera.h"
+#include "math/Ray.h"
+#include "math/RayStream.h"
+
+namespace
+{
+    void setupCamera(lray::Camera& camera, int width, int height)
+    {
+        camera.setResolution(width, height);
+        camera.perspective(static_cast<lray::f32>(width)/height, 60.0f*lray::DEG_TO_RAD);
+        camera.lookAt(lray::Vector3(0.0f, 3.0f, 10.0f), lray::Vector3(1.0f, 2.0f, 0.0f), lray::Vector3(0.0f, 1.0f, 0.0f));
+    }
+
+    bool nearlyEqual(lray::f32 x0, lray::f32 x1)
+    {
+        return lray::absolute(x0-x1) <= 1.0e-5f*lray::maximum(1.0f, lray::absolute(x0));
+    }
+}
+
+TEST_CASE("Test Camera", "[Camera]"){
+
+    static const int Width = 64;
+    static const int Height = 48;
+    lray::Camera camera;
+    setupCamera(camera, Width, Height);
+
+    //A tile which is not a multiple of lanes
+    const int tileX = 13;
+    const int tileY = 7;
+    const int tileWidth = 21;
+    const int tileHeight = 5;
+    lray::f32 jitter[tileWidth*tileHeight*2];
+    for(int i=0; i<tileWidth*tileHeight*2; ++i){
+        jitter[i] = static_cast<lray::f32>(i%7)/7.0f;
+    }
+    lray::RayStream stream;
+    camera.generateRays(stream, tileX, tileY, tileWidth, tileHeight, jitter);
+    REQUIRE(stream.size() == tileWidth*tileHeight);
+
+    bool equal = true;
+    for(int y=0; y<tileHeight; ++y){
+        for(int x=0; x<tileWidth; ++x){
+            int index = y*tileWidth + x;
+            lray::Ray expected = camera.generateRay(tileX+x+jitter[index*2+0], tileY+y+jitter[index*2+1]);
+            lray::Ray result = stream.getRay(index);
+            for(int i=0; i<3; ++i){
+                equal = equal && nearlyEqual(expected.origin_[i], result.origin_[i]);
+                equal = equal && nearlyEqual(expected.direction_[i], result.direction_[i]);
+                equal = equal && nearlyEqual(expected.invDirection_[i], result.invDirection_[i]);
+            }
+            equal = equal && expected.t_ == result.t_;
+        }
+    }
+    CHECK(equal);
+}
+
+TEST_CASE("Benchmark Camera", "[.][benchmark]"){
+
+    static const int Width = 1024;
+    static const int Height = 1024;
+    lray::Camera camera;
+    setupCamera(camera, Width, Height);
+
+    lray::RayStream stream;
+    stream.resize(Width*Height);
+    //Value-initialized, which also touches buffers before timing
+    lray::Ray* rays = LNEW lray::Ray[Width*Height]();
+    camera.generateRays(stream, 0, 0, Width, Height);
+
+    BENCHMARK("generateRay"){
+        for(int y=0; y<Height; ++y){
+            for(int x=0; x<Width; ++x){
+                rays[y*Width+x] = camera.generateRay(static_cast<lray::f32>(x), static_cast<lray::f32>(y));
+            }
+        }
+    }
+    BENCHMARK("generateRays"){
+        camera.generateRays(stream, 0, 0, Width, Height);
+    }
+    LDELETE_ARRAY(rays);
+}
@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "scene/GeometryCache.h"
+#include "core/Random.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    //A quad per page, whose x is the index of the page
+    bool writePages(const char* path, std::vector<lray::GeometryCache::PageInfo>& pages, lray::s32 numPages)
+    {
+        FILE* file = fopen(path, "wb");
+        if(NULL == file){
+            return false;
+        }
+        pages.resize(numPages);
+        lray::s64 offset = 0;
+        bool result = true;
+        for(lray::s32 i=0; result && i<numPages; ++i){
+            lray::Vector3* positions = LNEW lray::Vector3[4];
+            lray::Vector3* normals = LNEW lray::Vector3[4];
+            lray::Triangle* triangles = LNEW lray::Triangle[2];
+            lray::f32 x = static_cast<lray::f32>(i);
+            positions[0] = lray::Vector3(x, 0.0f, 0.0f);
+            positions[1] = lray::Vector3(x, 1.0f, 0.0f);
+            positions[2] = lray::Vector3(x, 1.0f, 1.0f);
+            positions[3] = lray::Vector3(x, 0.0f, 1.0f);
+            for(lray::s32 j=0; j<4; ++j){
+                normals[j] = lray::Vector3(1.0f, 0.0f, 0.0f);
+            }
+            triangles[0].indices_[0] = 0; triangles[0].indices_[1] = 1; triangles[0].indices_[2] = 2;
+            triangles[1].indices_[0] = 0; triangles[1].indices_[1] = 2; triangles[1].indices_[2] = 3;
+            lray::Primitive primitive(4, positions, normals, 2, triangles);
+            result = lray::GeometryCache::writePage(pages[i], file, offset, primitive);
+            offset += lray::GeometryCache::calcFileBytes(pages[i]);
+        }
+        fclose(file);
+        return result;
+    }
+}
+
+TEST_CASE("Test GeometryCache", "[GeometryCache]"){
+    static const lray::s32 NumPages = 64;
+    const char* Path = "lray_test_pages.lgc";
+    std::vector<lray::GeometryCache::PageInfo> pages;
+    REQUIRE(writePages(Path, pages, NumPages));
+
+    {
+        //The smallest budget, pages are evicted as soon as unpinned
+        lray::GeometryCache cache(0);
+        REQUIRE(cache.open(Path, NumPages, &pages[0]));
+
+        SECTION("Acquire"){
+            lray::GeometryCache::Page* page = cache.acquire(3);
+            REQUIRE(NULL != page);
+            CHECK(4 == page->primitive_.getNumVertices());
+            CHECK(2 == page->primitive_.getNumTriangles());
+            CHECK(3.0f == page->primitive_.getPosition(2).x_);
+            CHECK(1.0f == page->primitive_.getNormal(2).x_);
+            //Pinned pages stay resident
+            CHECK(page == cache.acquire(3));
+            cache.release(3);
+            cache.release(3);
+            CHECK(1 == cache.getNumLoads());
+        }
+
+        SECTION("Threads"){
+            static const lray::s32 NumThreads = 8;
+            static const lray::s32 NumAcquires = 1<<12;
+            std::atomic<lray::s32> numErrors(0);
+            std::vector<std::thread> threads;
+            for(lray::s32 i=0; i<NumThreads; ++i){
+                threads.push_back(std::thread([&, i]()
+                {
+                    lray::RandXorshift128Plus32 random(i+1);
+                    for(lray::s32 j=0; j<NumAcquires; ++j){
+                        lray::s32 index = static_cast<lray::s32>(random.rand() % NumPages);
+                        lray::GeometryCache::Page* page = cache.acquire(index);
+                        if(NULL == page || static_cast<lray::f32>(index) != page->primitive_.getPosition(3).x_){
+                            numErrors.fetch_add(1);
+                        }
+                        if(NULL != page){
+                            cache.release(index);
+                        }
+                    }
+                }));
+            }
+            for(size_t i=0; i<threads.size(); ++i){
+                threads[i].join();
+            }
+            CHECK(0 == numErrors.load());
+            CHECK(0<cache.getNumLoads());
+            CHECK(cache.getNumLoads()<=NumThreads*NumAcquires);
+        }
+    }
+    remove(Path);
+}
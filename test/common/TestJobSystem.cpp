@@ -0,0 +1,266 @@
+#include "catch.hpp"
+#include "core/JobSystem.h"
+#include "core/Parallel.h"
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    //Some arithmetic which is not optimized away
+    lray::f32 work(lray::s32 index, lray::s32 iterations)
+    {
+        lray::f32 x = static_cast<lray::f32>(index);
+        for(lray::s32 i=0; i<iterations; ++i){
+            x = x*0.999f + 1.0f;
+        }
+        return x;
+    }
+
+    double measureParallelFor(lray::JobSystem& jobSystem, lray::s32 count, lray::s32 iterations, lray::f32* results)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        jobSystem.parallelFor(0, count, [results, iterations](lray::s32 index, lray::s32)
+        {
+            results[index] = work(index, iterations);
+        }, 16);
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return duration.count();
+    }
+}
+
+TEST_CASE("Test JobSystem", "[JobSystem]"){
+
+    SECTION("Queue"){
+        lray::Job jobs[3];
+        //Aligned to cache lines, as JobSystem allocates queues
+        lray::JobQueue* queue = LPLACEMENT_NEW(lray::lmalloc(sizeof(lray::JobQueue), 64)) lray::JobQueue();
+        CHECK(queue->empty());
+        for(lray::s32 i=0; i<3; ++i){
+            CHECK(queue->push(&jobs[i]));
+        }
+        //The owner takes the last, thieves take the first
+        CHECK(&jobs[2] == queue->pop());
+        CHECK(&jobs[0] == queue->steal());
+        CHECK(&jobs[1] == queue->pop());
+        CHECK(NULL == queue->pop());
+        CHECK(NULL == queue->steal());
+        for(lray::s32 i=0; i<lray::JobQueue::Capacity; ++i){
+            queue->push(&jobs[0]);
+        }
+        CHECK_FALSE(queue->push(&jobs[0]));
+        queue->~JobQueue();
+        lray::lfree(queue, 64);
+    }
+
+    SECTION("ParallelFor"){
+        lray::JobSystem jobSystem(4);
+        static const lray::s32 Count = 100003;
+        std::vector<std::atomic<lray::s32>> visits(Count);
+        for(lray::s32 i=0; i<Count; ++i){
+            visits[i] = 0;
+        }
+        std::atomic<bool> inRange(true);
+        jobSystem.parallelFor(0, Count, [&visits, &inRange](lray::s32 index, lray::s32 worker)
+        {
+            visits[index].fetch_add(1);
+            if(worker<0 || 4<=worker){
+                inRange = false;
+            }
+        }, 7);
+        bool once = true;
+        for(lray::s32 i=0; i<Count; ++i){
+            once = once && (1 == visits[i]);
+        }
+        CHECK(once);
+        CHECK(inRange);
+
+        //A single chunk from out of the pool runs on a worker, whose index is its own
+        lray::s32 current = -2;
+        lray::s32 index = -2;
+        jobSystem.parallelFor(0, 1, [&jobSystem, &current, &index](lray::s32, lray::s32 worker)
+        {
+            current = jobSystem.getCurrentWorker();
+            index = worker;
+        });
+        CHECK(0<=current);
+        CHECK(current == index);
+    }
+
+    SECTION("Nested"){
+        lray::JobSystem jobSystem(4);
+        std::atomic<lray::s32> count(0);
+        jobSystem.parallelFor(0, 64, [&jobSystem, &count](lray::s32, lray::s32)
+        {
+            jobSystem.parallelFor(0, 64, [&count](lray::s32, lray::s32)
+            {
+                count.fetch_add(1);
+            });
+        });
+        CHECK(64*64 == count);
+    }
+
+    SECTION("Dependencies"){
+        //a -> b, c -> d
+        lray::JobSystem jobSystem(4);
+        for(lray::s32 n=0; n<100; ++n){
+            std::atomic<lray::s32> order(0);
+            lray::s32 a = -1, b = -1, c = -1, d = -1;
+            lray::s32* pa = &a; lray::s32* pb = &b; lray::s32* pc = &c; lray::s32* pd = &d;
+            std::atomic<lray::s32>* porder = &order;
+            lray::Job* jobA = jobSystem.create([porder, pa](lray::s32){ *pa = porder->fetch_add(1);});
+            lray::Job* jobB = jobSystem.create([porder, pb](lray::s32){ *pb = porder->fetch_add(1);});
+            lray::Job* jobC = jobSystem.create([porder, pc](lray::s32){ *pc = porder->fetch_add(1);});
+            lray::Job* jobD = jobSystem.create([porder, pd](lray::s32){ *pd = porder->fetch_add(1);});
+            jobSystem.addDependency(jobB, jobA);
+            jobSystem.addDependency(jobC, jobA);
+            jobSystem.addDependency(jobD, jobB);
+            jobSystem.addDependency(jobD, jobC);
+            lray::u32 generation = lray::JobSystem::getGeneration(jobD);
+            jobSystem.submit(jobD);
+            jobSystem.submit(jobC);
+            jobSystem.submit(jobB);
+            jobSystem.submit(jobA);
+            jobSystem.wait(jobD, generation);
+            CHECK(0 == a);
+            CHECK(a<b);
+            CHECK(a<c);
+            CHECK(b<d);
+            CHECK(c<d);
+        }
+    }
+
+    SECTION("ManyDependents"){
+        //More dependents than a job holds, they are relayed
+        static const lray::s32 NumDependents = lray::Job::MaxDependents*5 + 1;
+        lray::JobSystem jobSystem(4);
+        std::atomic<lray::s32> order(0);
+        std::atomic<lray::s32>* porder = &order;
+        lray::s32 first = -1;
+        lray::s32* pfirst = &first;
+        std::atomic<lray::s32> numAfter(0);
+        std::atomic<lray::s32>* pnumAfter = &numAfter;
+        lray::Job* root = jobSystem.create([](lray::s32){});
+        lray::Job* prerequisite = jobSystem.create([porder, pfirst](lray::s32){ *pfirst = porder->fetch_add(1);}, root);
+        for(lray::s32 i=0; i<NumDependents; ++i){
+            lray::Job* dependent = jobSystem.create([porder, pnumAfter](lray::s32)
+            {
+                if(0<porder->fetch_add(1)){
+                    pnumAfter->fetch_add(1);
+                }
+            }, root);
+            jobSystem.addDependency(dependent, prerequisite);
+            jobSystem.submit(dependent);
+        }
+        lray::u32 generation = lray::JobSystem::getGeneration(root);
+        jobSystem.submit(prerequisite);
+        jobSystem.submit(root);
+        jobSystem.wait(root, generation);
+        CHECK(0 == first);
+        CHECK(NumDependents == numAfter);
+    }
+
+    SECTION("Recycled"){
+        //A slot recycled after done is not waited for
+        lray::JobSystem jobSystem(2);
+        lray::Job* job = jobSystem.create([](lray::s32){});
+        lray::u32 generation = lray::JobSystem::getGeneration(job);
+        jobSystem.submit(job);
+        jobSystem.wait(job, generation);
+
+        //Threads out of the pool cycle through the shared pool, the last one takes the slot again
+        std::vector<lray::Job*> jobs(lray::JobSystem::MaxJobs);
+        std::vector<lray::u32> generations(lray::JobSystem::MaxJobs);
+        for(lray::s32 i=0; i<lray::JobSystem::MaxJobs; ++i){
+            jobs[i] = jobSystem.create([](lray::s32){});
+            generations[i] = lray::JobSystem::getGeneration(jobs[i]);
+        }
+        CHECK(job == jobs[lray::JobSystem::MaxJobs-1]);
+        CHECK_FALSE(jobSystem.isFinished(job));
+        CHECK(jobSystem.isFinished(job, generation));
+        jobSystem.wait(job, generation);
+        for(lray::s32 i=0; i<lray::JobSystem::MaxJobs; ++i){
+            jobSystem.submit(jobs[i]);
+        }
+        for(lray::s32 i=0; i<lray::JobSystem::MaxJobs; ++i){
+            jobSystem.wait(jobs[i], generations[i]);
+        }
+    }
+
+    SECTION("Children"){
+        //More children than jobs in a pool, slots are recycled
+        lray::JobSystem jobSystem(2);
+        static const lray::s32 NumChildren = lray::JobSystem::MaxJobs*3;
+        std::atomic<lray::s32> count(0);
+        std::atomic<lray::s32>* pcount = &count;
+        lray::Job* root = jobSystem.create([](lray::s32){});
+        for(lray::s32 i=0; i<NumChildren; ++i){
+            jobSystem.submit(jobSystem.create([pcount](lray::s32){ pcount->fetch_add(1);}, root));
+            if(i == (NumChildren/2)){
+                CHECK_FALSE(jobSystem.isFinished(root));
+            }
+        }
+        jobSystem.submit(root);
+        jobSystem.wait(root);
+        CHECK(NumChildren == count);
+    }
+
+    SECTION("Threads"){
+        //Threads out of the pool share the default
+        static const lray::s32 NumThreads = 4;
+        std::atomic<lray::s32> count(0);
+        std::vector<std::thread> threads;
+        for(lray::s32 i=0; i<NumThreads; ++i){
+            threads.push_back(std::thread([&count]()
+            {
+                for(lray::s32 j=0; j<16; ++j){
+                    lray::parallelFor(0, 1000, [&count](lray::s32)
+                    {
+                        count.fetch_add(1);
+                    });
+                }
+            }));
+        }
+        for(std::thread& thread : threads){
+            thread.join();
+        }
+        CHECK(NumThreads*16*1000 == count);
+    }
+}
+
+TEST_CASE("Benchmark JobSystem", "[.][benchmark]"){
+    static const lray::s32 Count = 1<<16;
+    static const lray::s32 Iterations = 1000;
+    lray::f32* results = LNEW lray::f32[Count];
+
+    //Scalability of parallelFor over workers
+    double base = 0.0;
+    lray::s32 maxWorkers = lray::getNumHardwareThreads();
+    for(lray::s32 numWorkers=1; numWorkers<=maxWorkers; numWorkers = (numWorkers<maxWorkers && maxWorkers<numWorkers*2)? maxWorkers : numWorkers*2){
+        lray::JobSystem jobSystem(numWorkers);
+        measureParallelFor(jobSystem, Count, Iterations, results);
+        double duration = measureParallelFor(jobSystem, Count, Iterations, results);
+        base = (1 == numWorkers)? duration : base;
+        printf("parallelFor %d workers: %.2f ms, x%.2f\n", numWorkers, duration*1.0e3, base/duration);
+    }
+
+    //Overhead of tiny jobs
+    {
+        static const lray::s32 NumJobs = 1<<20;
+        lray::JobSystem jobSystem;
+        std::atomic<lray::s32> count(0);
+        std::atomic<lray::s32>* pcount = &count;
+        auto start = std::chrono::high_resolution_clock::now();
+        jobSystem.parallelFor(0, NumJobs/lray::JobSystem::MaxJobs, [&jobSystem, pcount](lray::s32, lray::s32)
+        {
+            lray::Job* root = jobSystem.create([](lray::s32){});
+            for(lray::s32 i=0; i<lray::JobSystem::MaxJobs-1; ++i){
+                jobSystem.submit(jobSystem.create([pcount](lray::s32){ pcount->fetch_add(1, std::memory_order_relaxed);}, root));
+            }
+            jobSystem.submit(root);
+            jobSystem.wait(root);
+        });
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        printf("tiny jobs: %.2f Mjobs/s\n", count.load()/duration.count()*1.0e-6);
+    }
+    LDELETE_ARRAY(results);
+}
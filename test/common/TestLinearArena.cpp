@@ -0,0 +1,72 @@
+#include "catch.hpp"
+#include "core/LinearArena.h"
+
+namespace
+{
+    bool isAligned(const void* ptr, lray::u32 alignment)
+    {
+        return 0 == (reinterpret_cast<uintptr_t>(ptr) & (alignment-1));
+    }
+}
+
+TEST_CASE("Test LinearArena", "[LinearArena]"){
+
+    SECTION("Alignment"){
+        lray::LinearArena arena(4096);
+        static const lray::u32 Alignments[] = {1, 4, 16, 32, 64};
+        for(lray::u32 alignment : Alignments){
+            for(size_t size=1; size<10000; size*=3){
+                lray::u8* ptr = reinterpret_cast<lray::u8*>(arena.allocate(size, alignment));
+                CHECK(isAligned(ptr, alignment));
+                memset(ptr, 0xFF, size);
+            }
+        }
+        double* values = arena.allocate<double>(7);
+        CHECK(isAligned(values, 16));
+    }
+
+    SECTION("Scope"){
+        lray::LinearArena arena(1024);
+        lray::s32* outer = arena.allocate<lray::s32>(16);
+        for(lray::s32 i=0; i<16; ++i){
+            outer[i] = i;
+        }
+        void* inner = NULL;
+        {
+            lray::LinearArenaScope scope(arena);
+            inner = arena.allocate(100);
+            //Spills to a new block
+            arena.allocate(4000);
+            CHECK(2 == arena.getNumBlocks());
+        }
+        //Rewound memory is given again, the outer is kept
+        CHECK(inner == arena.allocate(100));
+        for(lray::s32 i=0; i<16; ++i){
+            CHECK(i == outer[i]);
+        }
+    }
+
+    SECTION("Reuse"){
+        lray::LinearArena arena(1024);
+        for(lray::s32 i=0; i<8; ++i){
+            lray::LinearArenaScope scope(arena);
+            arena.allocate(800);
+            arena.allocate(800);
+            arena.allocate(3000);
+        }
+        //Blocks are merged, repeated uses stay in one block without growing
+        CHECK(1 == arena.getNumBlocks());
+        size_t capacity = arena.getCapacity();
+        void* first = NULL;
+        for(lray::s32 i=0; i<8; ++i){
+            lray::LinearArenaScope scope(arena);
+            void* ptr = arena.allocate(800);
+            arena.allocate(800);
+            arena.allocate(3000);
+            CHECK((0==i || first == ptr));
+            first = ptr;
+        }
+        CHECK(1 == arena.getNumBlocks());
+        CHECK(capacity == arena.getCapacity());
+    }
+}
@@ -0,0 +1,270 @@
+#include "catch.hpp"
+#include "core/Random.h"
+#include "math/Vector3.h"
+#include "math/Matrix34.h"
+#include "math/Matrix44.h"
+#include "math/Quaternion.h"
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    //Random entries with dominant diagonals, which are invertible
+    void createMatrices(std::vector<lray::Matrix44>& matrices, lray::s32 count, lray::u64 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        matrices.resize(count);
+        for(lray::s32 i=0; i<count; ++i){
+            for(lray::s32 r=0; r<4; ++r){
+                for(lray::s32 c=0; c<4; ++c){
+                    matrices[i].m_[r][c] = random.frand2()*2.0f - 1.0f + ((r == c)? 4.0f : 0.0f);
+                }
+            }
+        }
+    }
+
+    void createPoints(std::vector<lray::Vector3>& points, lray::s32 count, lray::u64 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        points.resize(count);
+        for(lray::s32 i=0; i<count; ++i){
+            points[i] = lray::Vector3(random.frand2()*2.0f-1.0f, random.frand2()*2.0f-1.0f, random.frand2()*2.0f-1.0f);
+        }
+    }
+
+    bool nearlyEqual(lray::f32 x0, lray::f32 x1)
+    {
+        return lray::absolute(x0-x1) <= 1.0e-4f*lray::maximum(1.0f, lray::absolute(x0));
+    }
+
+    bool nearlyEqual(const lray::Matrix44& m0, const lray::Matrix44& m1)
+    {
+        bool equal = true;
+        for(lray::s32 r=0; r<4; ++r){
+            for(lray::s32 c=0; c<4; ++c){
+                equal = equal && nearlyEqual(m0.m_[r][c], m1.m_[r][c]);
+            }
+        }
+        return equal;
+    }
+
+    bool nearlyEqual(const lray::Vector3& v0, const lray::Vector3& v1)
+    {
+        return nearlyEqual(v0.x_, v1.x_) && nearlyEqual(v0.y_, v1.y_) && nearlyEqual(v0.z_, v1.z_);
+    }
+
+    template<class Func>
+    double measure(lray::s32 count, Func func)
+    {
+        func();
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return count/duration.count()*1.0e-6;
+    }
+}
+
+TEST_CASE("Test Matrix44", "[Matrix44]"){
+    //Not a multiple of lanes
+    static const lray::s32 Count = 37;
+    std::vector<lray::Matrix44> m0;
+    std::vector<lray::Matrix44> m1;
+    std::vector<lray::Vector3> points;
+    createMatrices(m0, Count, 1);
+    createMatrices(m1, Count, 2);
+    createPoints(points, Count, 3);
+
+    SECTION("Mul"){
+        std::vector<lray::Matrix44> result(Count);
+        lray::mul(Count, &result[0], &m0[0], &m1[0]);
+        bool equal = true;
+        for(lray::s32 i=0; i<Count; ++i){
+            lray::Matrix44 expected;
+            expected.mul(m0[i], m1[i]);
+            equal = equal && nearlyEqual(expected, result[i]);
+        }
+        CHECK(equal);
+
+        //In place
+        lray::mul(Count, &m0[0], &m0[0], &m1[0]);
+        CHECK(0 == memcmp(&result[0], &m0[0], sizeof(lray::Matrix44)*Count));
+    }
+
+    SECTION("Invert"){
+        std::vector<lray::Matrix44> result(Count);
+        lray::invert(Count, &result[0], &m0[0]);
+        bool equal = true;
+        for(lray::s32 i=0; i<Count; ++i){
+            lray::Matrix44 expected;
+            m0[i].getInvert(expected);
+            equal = equal && nearlyEqual(expected, result[i]);
+        }
+        CHECK(equal);
+    }
+
+    SECTION("Points"){
+        std::vector<lray::Vector3> result(Count);
+        lray::mul(Count, &result[0], m0[0], &points[0]);
+        bool equal = true;
+        for(lray::s32 i=0; i<Count; ++i){
+            equal = equal && nearlyEqual(mul(m0[0], points[i]), result[i]);
+        }
+        CHECK(equal);
+
+        lray::mul33(Count, &result[0], m0[0], &points[0]);
+        equal = true;
+        for(lray::s32 i=0; i<Count; ++i){
+            equal = equal && nearlyEqual(mul33(m0[0], points[i]), result[i]);
+        }
+        CHECK(equal);
+    }
+
+    SECTION("SoA"){
+        static const lray::s32 Width = lray::Matrix44SoA::Width;
+        lray::Matrix44SoA soa0;
+        lray::Matrix44SoA soa1;
+        soa0.set(Width, &m0[0]);
+        soa1.set(Width-3, &m1[0]);
+
+        //Lanes out of count are identities
+        lray::Matrix44 matrices[Width];
+        soa1.get(Width, matrices);
+        CHECK(0 == memcmp(&matrices[Width-1], &lray::Matrix44::identity_, sizeof(lray::Matrix44)));
+
+        lray::Matrix44SoA product;
+        product.mul(soa0, soa1);
+        product.get(Width, matrices);
+        bool equal = true;
+        for(lray::s32 i=0; i<Width; ++i){
+            lray::Matrix44 expected;
+            expected.mul(m0[i], (i<Width-3)? m1[i] : lray::Matrix44::identity_);
+            equal = equal && nearlyEqual(expected, matrices[i]);
+        }
+        CHECK(equal);
+
+        LALIGN(32) lray::f32 src[3][Width];
+        LALIGN(32) lray::f32 point[3][Width];
+        LALIGN(32) lray::f32 vector[3][Width];
+        for(lray::s32 i=0; i<Width; ++i){
+            src[0][i] = points[i].x_;
+            src[1][i] = points[i].y_;
+            src[2][i] = points[i].z_;
+        }
+        soa0.mulPoint(point, src);
+        soa0.mulVector(vector, src);
+        soa0.getInvert(soa0);
+        soa0.get(Width, matrices);
+        equal = true;
+        for(lray::s32 i=0; i<Width; ++i){
+            equal = equal && nearlyEqual(mul(m0[i], points[i]), lray::Vector3(point[0][i], point[1][i], point[2][i]));
+            equal = equal && nearlyEqual(mul33(m0[i], points[i]), lray::Vector3(vector[0][i], vector[1][i], vector[2][i]));
+            lray::Matrix44 expected;
+            m0[i].getInvert(expected);
+            equal = equal && nearlyEqual(expected, matrices[i]);
+        }
+        CHECK(equal);
+    }
+}
+
+TEST_CASE("Benchmark Matrix", "[.][benchmark]"){
+    static const lray::s32 Count = 1<<16;
+    std::vector<lray::Matrix44> m0;
+    std::vector<lray::Matrix44> m1;
+    std::vector<lray::Matrix44> result(Count);
+    std::vector<lray::Vector3> points;
+    std::vector<lray::Vector3> transformed(Count);
+    createMatrices(m0, Count, 1);
+    createMatrices(m1, Count, 2);
+    createPoints(points, Count, 3);
+
+    //Matrix44
+    printf("Matrix44 mul: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=0; i<Count; ++i){
+            result[i].mul(m0[i], m1[i]);
+        }
+    }));
+    printf("Matrix44 batch mul: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        lray::mul(Count, &result[0], &m0[0], &m1[0]);
+    }));
+    printf("Matrix44 getInvert: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=0; i<Count; ++i){
+            m0[i].getInvert(result[i]);
+        }
+    }));
+    printf("Matrix44 batch invert: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        lray::invert(Count, &result[0], &m0[0]);
+    }));
+    printf("Matrix44 SoA mul: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        lray::Matrix44SoA soa0;
+        lray::Matrix44SoA soa1;
+        soa0.set(lray::Matrix44SoA::Width, &m0[0]);
+        soa1.set(lray::Matrix44SoA::Width, &m1[0]);
+        for(lray::s32 i=0; i<Count; i+=lray::Matrix44SoA::Width){
+            soa0.mul(soa0, soa1);
+        }
+        soa0.get(1, &result[0]);
+    }));
+    printf("Matrix44 SoA invert: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        lray::Matrix44SoA soa;
+        soa.set(lray::Matrix44SoA::Width, &m0[0]);
+        for(lray::s32 i=0; i<Count; i+=lray::Matrix44SoA::Width){
+            soa.getInvert(soa);
+        }
+        soa.get(1, &result[0]);
+    }));
+    printf("Matrix44 point: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=0; i<Count; ++i){
+            transformed[i] = mul(m0[0], points[i]);
+        }
+    }));
+    printf("Matrix44 batch point: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        lray::mul(Count, &transformed[0], m0[0], &points[0]);
+    }));
+
+    //Matrix34
+    std::vector<lray::Matrix34> m34(Count);
+    std::vector<lray::Matrix34> result34(Count);
+    for(lray::s32 i=0; i<Count; ++i){
+        m34[i] = lray::Matrix34(m0[i]);
+    }
+    printf("Matrix34 mul: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=1; i<Count; ++i){
+            result34[i].mul(m34[i-1], m34[i]);
+        }
+    }));
+    printf("Matrix34 invert: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=0; i<Count; ++i){
+            result34[i] = m34[i];
+            result34[i].invert();
+        }
+    }));
+
+    //Quaternion
+    std::vector<lray::Quaternion> quaternions(Count);
+    std::vector<lray::Quaternion> resultQuaternions(Count);
+    for(lray::s32 i=0; i<Count; ++i){
+        quaternions[i] = lray::Quaternion::rotateAxis(points[i], points[i].x_*lray::PI);
+    }
+    printf("Quaternion mul: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=1; i<Count; ++i){
+            resultQuaternions[i] = lray::mul(quaternions[i-1], quaternions[i]);
+        }
+    }));
+    printf("Quaternion getMatrix: %.1f Mops/s\n", measure(Count, [&]()
+    {
+        for(lray::s32 i=0; i<Count; ++i){
+            quaternions[i].getMatrix(result[i]);
+        }
+    }));
+}
@@ -0,0 +1,139 @@
+#include "catch.hpp"
+#include "core/Numa.h"
+#include "core/Parallel.h"
+#include "core/Random.h"
+#include "math/Ray.h"
+#include "shape/Primitive.h"
+#include "accel/BinQBVH.h"
+#include <chrono>
+
+namespace
+{
+    //Small random triangles in a box
+    lray::Primitive* createTriangles(lray::s32 numTriangles, lray::u32 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        lray::s32 numVertices = numTriangles*3;
+        lray::Vector3* positions = LNEW lray::Vector3[numVertices];
+        lray::Vector3* normals = LNEW lray::Vector3[numVertices];
+        lray::Triangle* triangles = LNEW lray::Triangle[numTriangles];
+        for(lray::s32 i=0; i<numTriangles; ++i){
+            lray::Vector3 center(random.frand2()*10.0f, random.frand2()*10.0f, random.frand2()*10.0f);
+            for(lray::s32 j=0; j<3; ++j){
+                positions[3*i+j] = lray::Vector3(center.x_+random.frand2()*0.5f, center.y_+random.frand2()*0.5f, center.z_+random.frand2()*0.5f);
+                normals[3*i+j] = lray::Vector3(0.0f, 1.0f, 0.0f);
+                triangles[i].indices_[j] = 3*i+j;
+            }
+        }
+        return LNEW lray::Primitive(numVertices, positions, normals, numTriangles, triangles);
+    }
+
+    lray::Ray createRay(lray::RandXorshift128Plus32& random)
+    {
+        lray::Vector3 origin(random.frand2()*10.0f, random.frand2()*10.0f, -1.0f);
+        lray::Vector3 direction(random.frand2()-0.5f, random.frand2()-0.5f, 1.0f);
+        return lray::Ray(origin, lray::normalize(direction), 1.0e30f);
+    }
+
+    //Trace rays on workers, return hit distances summed
+    lray::f32 traceRays(lray::BinQBVH<lray::TriangleProxy>& bvh, lray::s32 numRays)
+    {
+        static const lray::s32 RaysPerTask = 1024;
+        lray::s32 numTasks = (numRays + RaysPerTask - 1)/RaysPerTask;
+        lray::f32* sums = LNEW lray::f32[numTasks];
+        lray::parallelFor(0, numTasks, [&bvh, sums, numRays](lray::s32 task)
+        {
+            lray::RandXorshift128Plus32 random(task+1);
+            lray::s32 end = lray::minimum((task+1)*RaysPerTask, numRays);
+            lray::f32 sum = 0.0f;
+            for(lray::s32 i=task*RaysPerTask; i<end; ++i){
+                lray::Ray ray = createRay(random);
+                lray::HitRecord hitRecord = bvh.intersect(ray);
+                sum += (lray::Result_Fail == hitRecord.result_)? 0.0f : hitRecord.t_;
+            }
+            sums[task] = sum;
+        });
+        lray::f32 total = 0.0f;
+        for(lray::s32 i=0; i<numTasks; ++i){
+            total += sums[i];
+        }
+        LDELETE_ARRAY(sums);
+        return total;
+    }
+}
+
+TEST_CASE("Test Numa", "[Numa]"){
+
+    SECTION("Topology"){
+        lray::s32 numNodes = lray::Numa::getNumNodes();
+        CHECK(1<=numNodes);
+        CHECK(numNodes<=static_cast<lray::s32>(lray::Numa::MaxNodes));
+        lray::s32 node = lray::Numa::getThreadNode();
+        CHECK(0<=node);
+        CHECK(node<numNodes);
+    }
+
+    SECTION("Placement"){
+        //Contents are kept while pages are moved
+        static const size_t Size = 1024*1024;
+        lray::u8* buffer = reinterpret_cast<lray::u8*>(lray::lmalloc(Size, 4096));
+        for(size_t i=0; i<Size; ++i){
+            buffer[i] = static_cast<lray::u8>(i);
+        }
+        lray::Numa::interleave(buffer, Size);
+        lray::Numa::bind(buffer, Size, lray::Numa::getNumNodes()-1);
+        bool same = true;
+        for(size_t i=0; i<Size; ++i){
+            same = same && (static_cast<lray::u8>(i) == buffer[i]);
+        }
+        CHECK(same);
+        lray::lfree(buffer, 4096);
+    }
+
+    SECTION("Accelerator"){
+        static const lray::s32 NumTriangles = 4096;
+        static const lray::s32 NumRays = 4096;
+        lray::Primitive* primitive = createTriangles(NumTriangles, 1);
+        lray::TriangleProxy* proxies = LNEW lray::TriangleProxy[NumTriangles];
+        primitive->getTriangleProxies(proxies);
+
+        lray::BinQBVH<lray::TriangleProxy> bvh;
+        bvh.build(NumTriangles, proxies);
+        lray::f32 expected = traceRays(bvh, NumRays);
+        for(lray::s32 i=lray::MemoryPlacement_Interleave; i<lray::MemoryPlacement_Num; ++i){
+            bvh.setPlacement(static_cast<lray::MemoryPlacement>(i));
+            CHECK(expected == traceRays(bvh, NumRays));
+            bvh.build(NumTriangles, proxies);
+            bvh.refit();
+            CHECK(expected == traceRays(bvh, NumRays));
+        }
+        LDELETE_ARRAY(proxies);
+        LDELETE(primitive);
+    }
+}
+
+TEST_CASE("Benchmark Numa", "[.][benchmark]"){
+    static const lray::s32 NumTriangles = 1<<18;
+    static const lray::s32 NumRays = 1<<18;
+    lray::Primitive* primitive = createTriangles(NumTriangles, 1);
+    lray::TriangleProxy* proxies = LNEW lray::TriangleProxy[NumTriangles];
+    primitive->getTriangleProxies(proxies);
+
+    lray::BinQBVH<lray::TriangleProxy> bvh;
+    bvh.build(NumTriangles, proxies);
+    printf("NUMA nodes: %d\n", lray::Numa::getNumNodes());
+    for(lray::s32 pin=0; pin<2; ++pin){
+        lray::Numa::setPinWorkers(0 != pin);
+        for(lray::s32 i=0; i<lray::MemoryPlacement_Num; ++i){
+            lray::MemoryPlacement placement = static_cast<lray::MemoryPlacement>(i);
+            bvh.setPlacement(placement);
+            auto start = std::chrono::high_resolution_clock::now();
+            traceRays(bvh, NumRays);
+            std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+            printf("%s%s: %.2f Mrays/s\n", getMemoryPlacementName(placement), (0 != pin)? " pinned" : "", NumRays/duration.count()*1.0e-6);
+        }
+    }
+    lray::Numa::setPinWorkers(false);
+    LDELETE_ARRAY(proxies);
+    LDELETE(primitive);
+}
@@ -0,0 +1,153 @@
+#include "catch.hpp"
+#include "Camera.h"
+#include "core/JobSystem.h"
+#include "render/PathTracer.h"
+#include "scene/Scene.h"
+#include <vector>
+
+namespace
+{
+    //A box open toward +z in [x0 x1]x[-1 1]x[-1 0], light and rays bounce inside before escaping
+    lray::Scene* createOpenBox(lray::f32 x0, lray::f32 x1)
+    {
+        static const lray::s32 NumFaces = 5;
+        const lray::Vector3 corners[NumFaces][4] =
+        {
+            {lray::Vector3(x0,-1.0f,-1.0f), lray::Vector3(x1,-1.0f,-1.0f), lray::Vector3(x1,1.0f,-1.0f), lray::Vector3(x0,1.0f,-1.0f)}, //bottom
+            {lray::Vector3(x0,-1.0f,-1.0f), lray::Vector3(x0,1.0f,-1.0f), lray::Vector3(x0,1.0f,0.0f), lray::Vector3(x0,-1.0f,0.0f)}, //left
+            {lray::Vector3(x1,-1.0f,-1.0f), lray::Vector3(x1,-1.0f,0.0f), lray::Vector3(x1,1.0f,0.0f), lray::Vector3(x1,1.0f,-1.0f)}, //right
+            {lray::Vector3(x0,-1.0f,-1.0f), lray::Vector3(x0,-1.0f,0.0f), lray::Vector3(x1,-1.0f,0.0f), lray::Vector3(x1,-1.0f,-1.0f)}, //front
+            {lray::Vector3(x0,1.0f,-1.0f), lray::Vector3(x1,1.0f,-1.0f), lray::Vector3(x1,1.0f,0.0f), lray::Vector3(x0,1.0f,0.0f)}, //back
+        };
+        lray::Vector3* positions = LNEW lray::Vector3[NumFaces*4];
+        lray::Vector3* normals = LNEW lray::Vector3[NumFaces*4];
+        lray::Triangle* triangles = LNEW lray::Triangle[NumFaces*2];
+        for(lray::s32 i=0; i<NumFaces; ++i){
+            lray::Vector3 normal = normalize(cross(corners[i][1]-corners[i][0], corners[i][2]-corners[i][0]));
+            for(lray::s32 j=0; j<4; ++j){
+                positions[i*4+j] = corners[i][j];
+                normals[i*4+j] = normal;
+            }
+            triangles[i*2+0].indices_[0] = i*4+0; triangles[i*2+0].indices_[1] = i*4+1; triangles[i*2+0].indices_[2] = i*4+2;
+            triangles[i*2+1].indices_[0] = i*4+0; triangles[i*2+1].indices_[1] = i*4+2; triangles[i*2+1].indices_[2] = i*4+3;
+        }
+        lray::Mesh::PrimitiveArray primitives;
+        primitives.push_back(lray::Primitive(NumFaces*4, positions, normals, NumFaces*2, triangles));
+        lray::Scene::MeshArray meshes;
+        meshes.push_back(lray::Mesh(std::move(primitives)));
+        lray::Scene::NodeArray nodes;
+        nodes.push_back(lray::Node("box", -1, 0, 0, 0));
+        lray::Scene* scene = LNEW lray::Scene("box", std::move(meshes), std::move(nodes));
+        scene->updateFrame();
+        return scene;
+    }
+
+    //Looking down -z from above the box
+    void setupCamera(lray::Camera& camera, lray::s32 width, lray::s32 height, lray::f32 z)
+    {
+        camera.setResolution(width, height);
+        camera.perspective(static_cast<lray::f32>(width)/height, 60.0f*lray::DEG_TO_RAD);
+        camera.lookAt(lray::Vector3(0.0f, 0.0f, z), lray::Vector3(0.0f, 0.0f, 0.0f), lray::Vector3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+TEST_CASE("Test PathTracer", "[PathTracer]"){
+    static const lray::f32 Background = 0.5f;
+
+    SECTION("Furnace"){
+        //Surfaces which reflect everything are invisible in a uniform environment, the box fills the view
+        static const lray::s32 Size = 32;
+        static const lray::s32 NumPasses = 64;
+        lray::Scene* scene = createOpenBox(-1.0f, 1.0f);
+        lray::Camera camera;
+        setupCamera(camera, Size, Size, 1.5f);
+        lray::PathTracer pathTracer;
+        pathTracer.initialize(Size, Size);
+        pathTracer.setAlbedo(lray::Vector3(1.0f));
+        pathTracer.setBackground(lray::Vector3(Background));
+        pathTracer.setMaxDepth(256);
+        for(lray::s32 i=0; i<NumPasses; ++i){
+            pathTracer.renderPass(*scene, camera);
+        }
+        lray::Vector3 mean(0.0f);
+        for(lray::s32 y=0; y<Size; ++y){
+            for(lray::s32 x=0; x<Size; ++x){
+                mean += pathTracer.getPixel(x, y);
+            }
+        }
+        mean *= 1.0f/(Size*Size);
+        CHECK(mean.x_ == Approx(Background).epsilon(0.02));
+        CHECK(mean.y_ == Approx(Background).epsilon(0.02));
+        CHECK(mean.z_ == Approx(Background).epsilon(0.02));
+        LDELETE(scene);
+    }
+
+    SECTION("Workers"){
+        //Images do not depend on the number of threads nor scheduling
+        static const lray::s32 Width = 72;
+        static const lray::s32 Height = 40;
+        static const lray::s32 NumPasses = 4;
+        lray::Scene* scene = createOpenBox(-1.0f, 1.0f);
+        lray::Camera camera;
+        setupCamera(camera, Width, Height, 3.0f);
+        lray::JobSystem single(1);
+        lray::JobSystem multiple(4);
+        lray::PathTracer pathTracers[2];
+        pathTracers[0].initialize(Width, Height, &single);
+        pathTracers[1].initialize(Width, Height, &multiple);
+        for(lray::s32 i=0; i<2; ++i){
+            pathTracers[i].setBackground(lray::Vector3(Background));
+            pathTracers[i].setLight(lray::Vector3(0.3f, 0.2f, 1.0f), lray::Vector3(2.0f));
+            for(lray::s32 j=0; j<NumPasses; ++j){
+                pathTracers[i].renderPass(*scene, camera);
+            }
+        }
+        lray::s32 numDifferences = 0;
+        for(lray::s32 y=0; y<Height; ++y){
+            for(lray::s32 x=0; x<Width; ++x){
+                if(pathTracers[0].getPixel(x, y) != pathTracers[1].getPixel(x, y)){
+                    ++numDifferences;
+                }
+            }
+        }
+        CHECK(0 == numDifferences);
+        LDELETE(scene);
+    }
+
+    SECTION("Adaptive"){
+        //Two tiles, the box is seen only in the right one and the left one is flat background
+        static const lray::s32 Width = 2*lray::PathTracer::TileSize;
+        static const lray::s32 Height = lray::PathTracer::TileSize;
+        static const lray::s32 MinSamples = 4;
+        static const lray::s32 MaxPasses = 4096;
+        lray::Scene* scene = createOpenBox(0.3f, 2.5f);
+        lray::Camera camera;
+        setupCamera(camera, Width, Height, 3.0f);
+        lray::PathTracer pathTracer;
+        pathTracer.initialize(Width, Height);
+        pathTracer.setBackground(lray::Vector3(Background));
+        pathTracer.setLight(lray::Vector3(0.3f, 0.2f, 1.0f), lray::Vector3(2.0f));
+        pathTracer.setAdaptive(0.1f, MinSamples);
+        for(lray::s32 i=0; i<MinSamples; ++i){
+            pathTracer.renderPass(*scene, camera);
+        }
+        CHECK(1 == pathTracer.getNumActiveTiles());
+        lray::s32 numErrors = 0;
+        for(lray::s32 y=0; y<Height; ++y){
+            for(lray::s32 x=0; x<lray::PathTracer::TileSize; ++x){
+                if(pathTracer.getPixel(x, y) != lray::Vector3(Background)){
+                    ++numErrors;
+                }
+            }
+        }
+        CHECK(0 == numErrors);
+
+        //The noisy tile drops out later
+        while(0<pathTracer.getNumActiveTiles() && pathTracer.getNumPasses()<MaxPasses){
+            pathTracer.renderPass(*scene, camera);
+        }
+        CHECK(0 == pathTracer.getNumActiveTiles());
+        CHECK(MinSamples < pathTracer.getNumPasses());
+        LDELETE(scene);
+    }
+}
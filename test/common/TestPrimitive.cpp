@@ -0,0 +1,309 @@
+#include "catch.hpp"
+#include "core/Random.h"
+#include "math/Matrix44.h"
+#include "math/Ray.h"
+#include "shape/Primitive.h"
+#include "accel/BinQBVH.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    //A grid of quads on z=0 with jittered unit normals
+    lray::Primitive* createGrid(lray::s32 resolution, lray::u32 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        lray::s32 numVertices = (resolution+1)*(resolution+1);
+        lray::s32 numTriangles = resolution*resolution*2;
+        lray::Vector3* positions = LNEW lray::Vector3[numVertices];
+        lray::Vector3* normals = LNEW lray::Vector3[numVertices];
+        lray::Triangle* triangles = LNEW lray::Triangle[numTriangles];
+        for(lray::s32 y=0; y<=resolution; ++y){
+            for(lray::s32 x=0; x<=resolution; ++x){
+                lray::s32 index = y*(resolution+1) + x;
+                positions[index] = lray::Vector3(static_cast<lray::f32>(x)/resolution, static_cast<lray::f32>(y)/resolution, 0.0f);
+                normals[index] = normalize(lray::Vector3(random.frand2()*0.2f-0.1f, random.frand2()*0.2f-0.1f, 1.0f));
+            }
+        }
+        lray::Triangle* triangle = triangles;
+        for(lray::s32 y=0; y<resolution; ++y){
+            for(lray::s32 x=0; x<resolution; ++x){
+                lray::s32 v0 = y*(resolution+1) + x;
+                lray::s32 v1 = v0 + 1;
+                lray::s32 v2 = v0 + resolution + 1;
+                lray::s32 v3 = v2 + 1;
+                triangle->indices_[0] = v0; triangle->indices_[1] = v1; triangle->indices_[2] = v3;
+                ++triangle;
+                triangle->indices_[0] = v0; triangle->indices_[1] = v3; triangle->indices_[2] = v2;
+                ++triangle;
+            }
+        }
+        return LNEW lray::Primitive(numVertices, positions, normals, numTriangles, triangles);
+    }
+
+    //Vertices of every corner of triangles, as exported without indices
+    lray::Primitive* createNonIndexed(const lray::Primitive& src)
+    {
+        lray::s32 numTriangles = src.getNumTriangles();
+        lray::Vector3* positions = LNEW lray::Vector3[numTriangles*3];
+        lray::Vector3* normals = LNEW lray::Vector3[numTriangles*3];
+        lray::Triangle* triangles = LNEW lray::Triangle[numTriangles];
+        for(lray::s32 i=0; i<numTriangles; ++i){
+            for(lray::s32 j=0; j<3; ++j){
+                lray::s32 index = src.getTriangle(i).indices_[j];
+                positions[i*3+j] = src.getPosition(index);
+                normals[i*3+j] = src.getNormal(index);
+                triangles[i].indices_[j] = i*3+j;
+            }
+        }
+        return LNEW lray::Primitive(numTriangles*3, positions, normals, numTriangles, triangles);
+    }
+
+    //Positions and normals of corners of triangles in sorted order, which are independent of indexing
+    typedef std::array<lray::f32, 18> Corners;
+    std::vector<Corners> getCorners(const lray::Primitive& primitive)
+    {
+        std::vector<Corners> corners(primitive.getNumTriangles());
+        for(lray::s32 i=0; i<primitive.getNumTriangles(); ++i){
+            for(lray::s32 j=0; j<3; ++j){
+                lray::s32 index = primitive.getTriangle(i).indices_[j];
+                memcpy(&corners[i][j*6], &primitive.getPosition(index), sizeof(lray::Vector3));
+                memcpy(&corners[i][j*6+3], &primitive.getNormal(index), sizeof(lray::Vector3));
+            }
+        }
+        std::sort(corners.begin(), corners.end());
+        return corners;
+    }
+
+    //Deltas of every other vertex, normals are bent far off
+    lray::MorphTarget createMorphTarget(lray::s32 numVertices, lray::u32 seed)
+    {
+        lray::RandXorshift128Plus32 random(seed);
+        lray::s32 numDeltas = (numVertices+1)/2;
+        lray::s32* indices = LNEW lray::s32[numDeltas];
+        lray::Vector3* positions = LNEW lray::Vector3[numDeltas];
+        lray::Vector3* normals = LNEW lray::Vector3[numDeltas];
+        for(lray::s32 i=0; i<numDeltas; ++i){
+            indices[i] = i*2;
+            positions[i] = lray::Vector3(0.0f, 0.0f, random.frand2()*0.5f);
+            normals[i] = lray::Vector3(random.frand2(), random.frand2(), 0.0f);
+        }
+        return lray::MorphTarget(numDeltas, indices, positions, normals);
+    }
+
+    //Two joints blended along x
+    lray::SkinWeight* createSkinWeights(const lray::Primitive& primitive)
+    {
+        lray::SkinWeight* skinWeights = LNEW lray::SkinWeight[primitive.getNumVertices()];
+        for(lray::s32 i=0; i<primitive.getNumVertices(); ++i){
+            lray::SkinWeight& skinWeight = skinWeights[i];
+            for(lray::s32 j=0; j<lray::SkinWeight::NumInfluences; ++j){
+                skinWeight.joints_[j] = 0;
+                skinWeight.weights_[j] = 0.0f;
+            }
+            lray::f32 x = primitive.getPosition(i).x_;
+            skinWeight.joints_[0] = 0;
+            skinWeight.weights_[0] = 1.0f-x;
+            skinWeight.joints_[1] = 1;
+            skinWeight.weights_[1] = x;
+        }
+        return skinWeights;
+    }
+
+    void createPalette(lray::Matrix44 palette[2], lray::f32 angle)
+    {
+        palette[0].setRotateX(angle);
+        palette[0].translate(0.0f, 0.0f, 0.25f);
+        palette[1].setRotateY(-angle);
+        palette[1].translate(0.0f, 0.5f, 0.0f);
+    }
+
+    //Linear blend skinning of a point or a direction, one joint at a time
+    lray::Vector3 skin(const lray::SkinWeight& skinWeight, const lray::Matrix44* palette, const lray::Vector3& v, bool point)
+    {
+        lray::Vector3 result(0.0f, 0.0f, 0.0f);
+        for(lray::s32 j=0; j<lray::SkinWeight::NumInfluences; ++j){
+            const lray::Matrix44& m = palette[skinWeight.joints_[j]];
+            result += skinWeight.weights_[j] * ((point)? mul(m, v) : mul33(m, v));
+        }
+        return result;
+    }
+
+    bool nearlyEqual(const lray::Vector3& v0, const lray::Vector3& v1)
+    {
+        return v0.equals(v1, 1.0e-4f);
+    }
+
+    //Rays down onto the grid
+    lray::Ray createRay(lray::RandXorshift128Plus32& random)
+    {
+        lray::Vector3 origin(random.frand2()*2.0f-0.5f, random.frand2()*2.0f-0.5f, 5.0f);
+        lray::Vector3 direction(random.frand2()*0.2f-0.1f, random.frand2()*0.2f-0.1f, -1.0f);
+        return lray::Ray(origin, lray::normalize(direction), 1.0e30f);
+    }
+}
+
+TEST_CASE("Test Primitive", "[Primitive]"){
+    static const lray::s32 Resolution = 16;
+    static const lray::f32 Weight = 0.75f;
+    lray::Primitive* grid = createGrid(Resolution, 1);
+    lray::Matrix44 matrix;
+    matrix.setRotateX(0.5f);
+    matrix.translate(1.0f, 2.0f, 3.0f);
+
+    SECTION("Morph"){
+        lray::Primitive::MorphTargetArray morphTargets;
+        morphTargets.push_back(createMorphTarget(grid->getNumVertices(), 2));
+        const lray::MorphTarget& target = morphTargets[0];
+        std::vector<lray::Vector3> positions(grid->getNumVertices());
+        std::vector<lray::Vector3> normals(grid->getNumVertices());
+        for(lray::s32 i=0; i<grid->getNumVertices(); ++i){
+            positions[i] = grid->getPosition(i);
+            normals[i] = grid->getNormal(i);
+        }
+        for(lray::s32 i=0; i<target.getNumDeltas(); ++i){
+            lray::s32 index = target.getIndices()[i];
+            positions[index] += Weight*target.getPositions()[i];
+            normals[index] += Weight*target.getNormals()[i];
+        }
+        grid->setMorphTargets(std::move(morphTargets));
+
+        //Deltas are in the object space, refined normals are unit
+        lray::Primitive refined;
+        refined.refine(*grid, matrix, 1, &Weight);
+        REQUIRE(grid->getNumVertices() == refined.getNumVertices());
+        lray::s32 numErrors = 0;
+        for(lray::s32 i=0; i<refined.getNumVertices(); ++i){
+            if(!nearlyEqual(mul(matrix, positions[i]), refined.getPosition(i))
+                || !nearlyEqual(normalize(mul33(matrix, normals[i])), refined.getNormal(i))){
+                ++numErrors;
+            }
+        }
+        CHECK(0 == numErrors);
+    }
+
+    SECTION("Skin"){
+        //Morph deltas are added before skinning
+        lray::Primitive::MorphTargetArray morphTargets;
+        morphTargets.push_back(createMorphTarget(grid->getNumVertices(), 3));
+        const lray::MorphTarget& target = morphTargets[0];
+        std::vector<lray::Vector3> positions(grid->getNumVertices());
+        std::vector<lray::Vector3> normals(grid->getNumVertices());
+        for(lray::s32 i=0; i<grid->getNumVertices(); ++i){
+            positions[i] = grid->getPosition(i);
+            normals[i] = grid->getNormal(i);
+        }
+        for(lray::s32 i=0; i<target.getNumDeltas(); ++i){
+            lray::s32 index = target.getIndices()[i];
+            positions[index] += Weight*target.getPositions()[i];
+            normals[index] += Weight*target.getNormals()[i];
+        }
+        grid->setSkinWeights(createSkinWeights(*grid));
+        grid->setMorphTargets(std::move(morphTargets));
+        lray::Matrix44 palette[2];
+        createPalette(palette, 0.5f);
+
+        lray::Primitive posed;
+        posed.refine(*grid, 2, palette);
+        lray::Primitive morphed;
+        morphed.refine(*grid, 2, palette, 1, &Weight);
+        REQUIRE(grid->getNumVertices() == posed.getNumVertices());
+        REQUIRE(grid->getNumVertices() == morphed.getNumVertices());
+        lray::s32 numErrors = 0;
+        for(lray::s32 i=0; i<grid->getNumVertices(); ++i){
+            const lray::SkinWeight& skinWeight = grid->getSkinWeight(i);
+            if(!nearlyEqual(skin(skinWeight, palette, grid->getPosition(i), true), posed.getPosition(i))
+                || !nearlyEqual(normalize(skin(skinWeight, palette, grid->getNormal(i), false)), posed.getNormal(i))
+                || !nearlyEqual(skin(skinWeight, palette, positions[i], true), morphed.getPosition(i))
+                || !nearlyEqual(normalize(skin(skinWeight, palette, normals[i], false)), morphed.getNormal(i))){
+                ++numErrors;
+            }
+        }
+        CHECK(0 == numErrors);
+    }
+
+    SECTION("Refit"){
+        //A tree refitted to another pose gives the same hits as one built for the pose
+        static const lray::s32 NumRays = 1024;
+        lray::Primitive::MorphTargetArray morphTargets;
+        morphTargets.push_back(createMorphTarget(grid->getNumVertices(), 4));
+        grid->setSkinWeights(createSkinWeights(*grid));
+        grid->setMorphTargets(std::move(morphTargets));
+        lray::Matrix44 palette[2];
+        createPalette(palette, 0.1f);
+
+        lray::Primitive refined;
+        refined.refine(*grid, 2, palette);
+        std::vector<lray::TriangleProxy> proxies(refined.getNumTriangles());
+        refined.getTriangleProxies(&proxies[0]);
+        lray::BinQBVH<lray::TriangleProxy> refitted;
+        refitted.build(static_cast<lray::s32>(proxies.size()), &proxies[0]);
+
+        //Storages of the same sizes are reused, proxies still refer them
+        createPalette(palette, 0.6f);
+        refined.refine(*grid, 2, palette, 1, &Weight);
+        refitted.refit();
+        lray::BinQBVH<lray::TriangleProxy> rebuilt;
+        rebuilt.build(static_cast<lray::s32>(proxies.size()), &proxies[0]);
+
+        lray::RandXorshift128Plus32 random(5);
+        lray::s32 numHits = 0;
+        lray::s32 numErrors = 0;
+        for(lray::s32 i=0; i<NumRays; ++i){
+            lray::Ray ray = createRay(random);
+            lray::Ray rebuiltRay = ray;
+            lray::HitRecord hitRecord = refitted.intersect(ray);
+            lray::HitRecord rebuiltHitRecord = rebuilt.intersect(rebuiltRay);
+            if((lray::Result_Fail == hitRecord.result_) != (lray::Result_Fail == rebuiltHitRecord.result_)){
+                ++numErrors;
+                continue;
+            }
+            if(lray::Result_Fail == hitRecord.result_){
+                continue;
+            }
+            ++numHits;
+            if(1.0e-4f<lray::absolute(hitRecord.t_ - rebuiltHitRecord.t_)){
+                ++numErrors;
+            }
+        }
+        CHECK(0<numHits);
+        CHECK(0 == numErrors);
+    }
+
+    SECTION("Weld"){
+        //Shared corners are merged back to the grid
+        lray::Primitive* primitive = createNonIndexed(*grid);
+        CHECK(grid->getNumTriangles()*3 == primitive->getNumVertices());
+        primitive->weld();
+        CHECK(grid->getNumVertices() == primitive->getNumVertices());
+        CHECK(grid->getNumTriangles() == primitive->getNumTriangles());
+        CHECK(getCorners(*grid) == getCorners(*primitive));
+        LDELETE(primitive);
+    }
+
+    SECTION("Reorder"){
+        //The same triangles with the same windings in another order
+        lray::Primitive* primitive = createNonIndexed(*grid);
+        primitive->weld();
+        primitive->reorder();
+        CHECK(grid->getNumVertices() == primitive->getNumVertices());
+        CHECK(getCorners(*grid) == getCorners(*primitive));
+        //Vertices are in order of first use
+        lray::s32 next = 0;
+        lray::s32 numErrors = 0;
+        for(lray::s32 i=0; i<primitive->getNumTriangles(); ++i){
+            for(lray::s32 j=0; j<3; ++j){
+                lray::s32 index = primitive->getTriangle(i).indices_[j];
+                if(next<index){
+                    ++numErrors;
+                }
+                next = std::max(next, index+1);
+            }
+        }
+        CHECK(0 == numErrors);
+        LDELETE(primitive);
+    }
+    LDELETE(grid);
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+#include "core/Random.h"
+
+namespace
+{
+    //Lanes are the scalar sequence jumped by their indices
+    template<class T>
+    bool equalsScalar(T& random, lray::u64 seed)
+    {
+        static const int NumSamples = 64;
+        LALIGN(32) lray::u32 lanes[NumSamples][T::NumLanes];
+        for(int i=0; i<NumSamples; ++i){
+            auto r = random.rand();
+            memcpy(lanes[i], &r, sizeof(r));
+        }
+        bool result = true;
+        lray::RandXorshift128Plus scalar(seed);
+        for(int lane=0; lane<T::NumLanes; ++lane){
+            lray::RandXorshift128Plus stream = scalar;
+            for(int i=0; i<NumSamples; ++i){
+                result = result && lanes[i][lane] == static_cast<lray::u32>(stream.rand()>>32);
+            }
+            scalar.jump();
+        }
+        return result;
+    }
+}
+
+TEST_CASE("Test Random", "[Random]"){
+
+    static const lray::u64 Seed = 12345;
+
+    SECTION("Jump"){
+        //2^64 steps in 2^7 steps of the polynomial, distinct from the original
+        lray::RandXorshift128Plus random0(Seed);
+        lray::RandXorshift128Plus random1(Seed);
+        random1.jump();
+        CHECK(random0.rand() != random1.rand());
+    }
+
+    SECTION("x4"){
+        lray::RandXorshift128Plus32x4 random(Seed);
+        CHECK(equalsScalar(random, Seed));
+
+        lray::RandXorshift128Plus32x4 jumped(Seed);
+        jumped.jump();
+        lray::RandXorshift128Plus scalar(Seed);
+        for(int i=0; i<lray::RandXorshift128Plus32x4::NumLanes; ++i){
+            scalar.jump();
+        }
+        CHECK(equalsScalar(jumped, scalar.rand()) == false);
+
+        LALIGN16 lray::f32 samples[4];
+        bool inRange = true;
+        for(int i=0; i<1024; ++i){
+            _mm_store_ps(samples, random.frand2());
+            for(int j=0; j<4; ++j){
+                inRange = inRange && 0.0f<=samples[j] && samples[j]<1.0f;
+            }
+        }
+        CHECK(inRange);
+    }
+
+#if defined(__AVX2__)
+    SECTION("x8"){
+        lray::RandXorshift128Plus32x8 random(Seed);
+        CHECK(equalsScalar(random, Seed));
+    }
+#endif
+}
+
+TEST_CASE("Benchmark Random", "[.][benchmark]"){
+
+    //Small buffer refilled, not to measure memory bandwidth
+    static const int NumSamples = 4*1024;
+    static const int NumRepeats = 4*1024;
+    lray::f32* samples = LNEW lray::f32[NumSamples+8];
+    lray::f32* aligned = reinterpret_cast<lray::f32*>((reinterpret_cast<uintptr_t>(samples)+31) & ~static_cast<uintptr_t>(31));
+    memset(samples, 0, sizeof(lray::f32)*(NumSamples+8));
+
+    lray::RandXorshift128Plus32 scalar(lray::getStaticSeed64());
+    BENCHMARK("RandXorshift128Plus32"){
+        for(int r=0; r<NumRepeats; ++r){
+            for(int i=0; i<NumSamples; ++i){
+                aligned[i] = scalar.frand2();
+            }
+        }
+    }
+    lray::RandXorshift128Plus32x4 x4(lray::getStaticSeed64());
+    BENCHMARK("RandXorshift128Plus32x4"){
+        for(int r=0; r<NumRepeats; ++r){
+            for(int i=0; i<NumSamples; i+=4){
+                _mm_store_ps(aligned+i, x4.frand2());
+            }
+        }
+    }
+#if defined(__AVX2__)
+    lray::RandXorshift128Plus32x8 x8(lray::getStaticSeed64());
+    BENCHMARK("RandXorshift128Plus32x8"){
+        for(int r=0; r<NumRepeats; ++r){
+            for(int i=0; i<NumSamples; i+=8){
+                _mm256_store_ps(aligned+i, x8.frand2());
+            }
+        }
+    }
+#endif
+    LDELETE_ARRAY(samples);
+}
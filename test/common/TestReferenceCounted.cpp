@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "core/ReferenceCounted.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<lray::s32> numDestroyed_(0);
+
+    template<class CountPolicy>
+    class Counted : public lray::ReferenceCounted<Counted<CountPolicy>, CountPolicy>
+    {
+    public:
+        Counted()
+            :value_(0)
+        {}
+
+        ~Counted()
+        {
+            numDestroyed_.fetch_add(1);
+        }
+
+        lray::s32 value_;
+    };
+
+    typedef Counted<lray::ReferenceCountNonAtomic> NonAtomic;
+    typedef Counted<lray::ReferenceCountAtomic> Atomic;
+
+    //Copy and drop references to a shared object on threads
+    template<class T>
+    void copyReferences(typename T::pointer_type& shared, lray::s32 numThreads, lray::s32 numCopies)
+    {
+        std::vector<std::thread> threads;
+        for(lray::s32 i=0; i<numThreads; ++i){
+            threads.push_back(std::thread([&shared, numCopies]()
+            {
+                for(lray::s32 j=0; j<numCopies; ++j){
+                    typename T::pointer_type copy(shared);
+                }
+            }));
+        }
+        for(std::thread& thread : threads){
+            thread.join();
+        }
+    }
+
+    template<class T>
+    double measure(lray::s32 numThreads, lray::s32 numCopies)
+    {
+        typename T::pointer_type shared(LNEW T);
+        auto start = std::chrono::high_resolution_clock::now();
+        copyReferences<T>(shared, numThreads, numCopies);
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return numCopies*static_cast<double>(numThreads)/duration.count()*1.0e-6;
+    }
+}
+
+TEST_CASE("Test ReferenceCounted", "[ReferenceCounted]"){
+
+    SECTION("NonAtomic"){
+        numDestroyed_ = 0;
+        {
+            NonAtomic::pointer_type ptr0(LNEW NonAtomic);
+            CHECK(1 == ptr0->getReferenceCount());
+            {
+                NonAtomic::pointer_type ptr1(ptr0);
+                CHECK(2 == ptr0->getReferenceCount());
+            }
+            CHECK(1 == ptr0->getReferenceCount());
+        }
+        CHECK(1 == numDestroyed_);
+    }
+
+    SECTION("Atomic"){
+        //Released once after all threads drop their copies
+        static const lray::s32 NumThreads = 4;
+        static const lray::s32 NumCopies = 100000;
+        numDestroyed_ = 0;
+        {
+            Atomic::pointer_type shared(LNEW Atomic);
+            copyReferences<Atomic>(shared, NumThreads, NumCopies);
+            CHECK(1 == shared->getReferenceCount());
+            CHECK(0 == numDestroyed_);
+        }
+        CHECK(1 == numDestroyed_);
+    }
+}
+
+TEST_CASE("Benchmark ReferenceCounted", "[.][benchmark]"){
+    static const lray::s32 NumCopies = 1<<22;
+    printf("non-atomic 1 thread: %.1f Mcopies/s\n", measure<NonAtomic>(1, NumCopies));
+    lray::s32 maxThreads = lray::maximum(static_cast<lray::s32>(std::thread::hardware_concurrency()), 1);
+    for(lray::s32 numThreads=1; numThreads<=maxThreads; numThreads<<=1){
+        printf("atomic %d threads: %.1f Mcopies/s\n", numThreads, measure<Atomic>(numThreads, NumCopies));
+    }
+}
@@ -0,0 +1,149 @@
+#include "catch.hpp"
+#include "core/Sampler.h"
+#include "core/Random.h"
+
+namespace
+{
+    //Every elementary interval of area 1/numSamples has exactly one sample
+    template<class T>
+    bool isNet(const T& sampler, int log2Samples, lray::u32 dimension)
+    {
+        int numSamples = 1<<log2Samples;
+        int* counts = LNEW int[numSamples];
+        bool result = true;
+        for(int bitsX=0; bitsX<=log2Samples; ++bitsX){
+            int cellsX = 1<<bitsX;
+            int cellsY = numSamples/cellsX;
+            memset(counts, 0, sizeof(int)*numSamples);
+            for(int i=0; i<numSamples; ++i){
+                lray::f32 x, y;
+                sampler.get2D(x, y, i, dimension);
+                int cellX = static_cast<int>(x*cellsX);
+                int cellY = static_cast<int>(y*cellsY);
+                ++counts[cellY*cellsX + cellX];
+            }
+            for(int i=0; i<numSamples; ++i){
+                result = result && 1 == counts[i];
+            }
+        }
+        LDELETE_ARRAY(counts);
+        return result;
+    }
+
+    //Smooth function whose integral over [0,1)^2 is (1-cos(1))*(e-1)
+    lray::f32 integrand(lray::f32 x, lray::f32 y)
+    {
+        return ::sinf(x)*::expf(y);
+    }
+
+    template<class T>
+    lray::f64 calcError(const T& sampler, int numSamples)
+    {
+        lray::f64 sum = 0.0;
+        for(int i=0; i<numSamples; ++i){
+            lray::f32 x, y;
+            sampler.get2D(x, y, i, 0);
+            sum += integrand(x, y);
+        }
+        return lray::absolute(sum/numSamples - (1.0-::cos(1.0))*(::exp(1.0)-1.0));
+    }
+}
+
+TEST_CASE("Test Sampler", "[Sampler]"){
+
+    SECTION("Sobol"){
+        lray::SobolSampler sampler(3, 5, 7);
+        CHECK(isNet(sampler, 8, 0));
+        //Padded dimensions are scrambled on their own
+        CHECK(isNet(sampler, 8, lray::SobolSampler::MaxDimensions));
+        CHECK(lray::SobolSampler::sobol(1, 1) == 0x80000000U);
+        CHECK(lray::SobolSampler::sobol(3, 1) == 0x40000000U);
+    }
+
+    SECTION("Halton"){
+        CHECK(lray::HaltonSampler::halton(1, 0) == 0.5f);
+        CHECK(lray::HaltonSampler::halton(3, 0) == 0.75f);
+        CHECK(lray::HaltonSampler::halton(1, 1) == 1.0f/3.0f);
+
+        //Scrambling keeps the stratification by 2x3
+        lray::HaltonSampler sampler(3, 5, 7);
+        bool cells[6] = {};
+        for(int i=0; i<6; ++i){
+            lray::f32 x, y;
+            sampler.get2D(x, y, i, 0);
+            cells[static_cast<int>(y*3)*2 + static_cast<int>(x*2)] = true;
+        }
+        for(int i=0; i<6; ++i){
+            CHECK(cells[i]);
+        }
+    }
+
+    SECTION("Lattice"){
+        //Every power of two of samples is a lattice, stratified in each dimension
+        lray::LatticeSampler sampler(3, 5, 7);
+        for(lray::u32 dimension=0; dimension<4; ++dimension){
+            bool cells[256] = {};
+            for(int i=0; i<256; ++i){
+                cells[static_cast<int>(sampler.get1D(i, dimension)*256)] = true;
+            }
+            bool stratified = true;
+            for(int i=0; i<256; ++i){
+                stratified = stratified && cells[i];
+            }
+            CHECK(stratified);
+        }
+    }
+
+    SECTION("Convergence"){
+        static const int NumSamples = 1024;
+        static const int NumTrials = 16;
+        lray::f64 errors[4] = {};
+        lray::RandXorshift128Plus32 random(lray::getStaticSeed64());
+        for(int trial=0; trial<NumTrials; ++trial){
+            errors[0] += calcError(lray::SobolSampler(trial, 0), NumSamples);
+            errors[1] += calcError(lray::HaltonSampler(trial, 0), NumSamples);
+            errors[2] += calcError(lray::LatticeSampler(trial, 0), NumSamples);
+            lray::f64 sum = 0.0;
+            for(int i=0; i<NumSamples; ++i){
+                sum += integrand(random.frand2(), random.frand2());
+            }
+            errors[3] += lray::absolute(sum/NumSamples - (1.0-::cos(1.0))*(::exp(1.0)-1.0));
+        }
+        //Pseudo random error is about 1/sqrt(N), low discrepancy ones are far less
+        CHECK(errors[0]*10.0 < errors[3]);
+        CHECK(errors[1]*10.0 < errors[3]);
+        CHECK(errors[2]*10.0 < errors[3]);
+    }
+}
+
+TEST_CASE("Benchmark Sampler", "[.][benchmark]"){
+
+    static const int NumSamples = 1024*1024;
+    lray::SobolSampler sobol(1, 2);
+    lray::HaltonSampler halton(1, 2);
+    lray::LatticeSampler lattice(1, 2);
+    lray::RandXorshift128Plus32 random(lray::getStaticSeed64());
+    lray::f32 sum = 0.0f;
+
+    BENCHMARK("Sobol"){
+        for(int i=0; i<NumSamples; ++i){
+            sum += sobol.get1D(i, i&7);
+        }
+    }
+    BENCHMARK("Halton"){
+        for(int i=0; i<NumSamples; ++i){
+            sum += halton.get1D(i, i&7);
+        }
+    }
+    BENCHMARK("Lattice"){
+        for(int i=0; i<NumSamples; ++i){
+            sum += lattice.get1D(i, i&7);
+        }
+    }
+    BENCHMARK("RandXorshift128Plus32"){
+        for(int i=0; i<NumSamples; ++i){
+            sum += random.frand2();
+        }
+    }
+    CHECK(0.0f<sum);
+}
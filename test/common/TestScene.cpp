@@ -0,0 +1,336 @@
+#include "catch.hpp"
+#include "scene/Scene.h"
+#include "core/Intersection.h"
+#include "core/Random.h"
+#include "math/Ray.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //A grid of quads on z=0 in [offsetX 1+offsetX]x[0 1], written to a glTF with an external buffer
+    bool writeGrid(const char* gltfPath, const char* binPath, const char* binName, lray::s32 resolution, lray::f32 offsetX=0.0f)
+    {
+        lray::s32 numVertices = (resolution+1)*(resolution+1);
+        lray::s32 numIndices = resolution*resolution*6;
+        std::vector<lray::f32> positions;
+        std::vector<lray::f32> normals;
+        std::vector<lray::u32> indices;
+        for(lray::s32 y=0; y<=resolution; ++y){
+            for(lray::s32 x=0; x<=resolution; ++x){
+                positions.push_back(static_cast<lray::f32>(x)/resolution + offsetX);
+                positions.push_back(static_cast<lray::f32>(y)/resolution);
+                positions.push_back(0.0f);
+                normals.push_back(0.0f);
+                normals.push_back(0.0f);
+                normals.push_back(1.0f);
+            }
+        }
+        for(lray::s32 y=0; y<resolution; ++y){
+            for(lray::s32 x=0; x<resolution; ++x){
+                lray::u32 v0 = y*(resolution+1) + x;
+                lray::u32 v1 = v0 + 1;
+                lray::u32 v2 = v0 + resolution + 1;
+                lray::u32 v3 = v2 + 1;
+                indices.push_back(v0); indices.push_back(v1); indices.push_back(v3);
+                indices.push_back(v0); indices.push_back(v3); indices.push_back(v2);
+            }
+        }
+        size_t positionSize = sizeof(lray::f32)*positions.size();
+        size_t indexSize = sizeof(lray::u32)*indices.size();
+
+        FILE* bin = fopen(binPath, "wb");
+        if(NULL == bin){
+            return false;
+        }
+        fwrite(&positions[0], positionSize, 1, bin);
+        fwrite(&normals[0], positionSize, 1, bin);
+        fwrite(&indices[0], indexSize, 1, bin);
+        fclose(bin);
+
+        FILE* gltf = fopen(gltfPath, "wb");
+        if(NULL == gltf){
+            return false;
+        }
+        fprintf(gltf,
+            "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"mode\":4}]}],"
+            "\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%d}],"
+            "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%d},{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d},{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d}],"
+            "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[%f,0,0],\"max\":[%f,1,0]},"
+            "{\"bufferView\":1,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},"
+            "{\"bufferView\":2,\"componentType\":5125,\"count\":%d,\"type\":\"SCALAR\"}]}",
+            binName, static_cast<int>(positionSize*2+indexSize),
+            static_cast<int>(positionSize), static_cast<int>(positionSize), static_cast<int>(positionSize), static_cast<int>(positionSize*2), static_cast<int>(indexSize),
+            numVertices, offsetX, 1.0f+offsetX, numVertices, numIndices);
+        fclose(gltf);
+        return true;
+    }
+
+    //A gray image in an uncompressed TGA, referred by a glTF without meshes
+    bool writeImage(const char* gltfPath, const char* imagePath, lray::s32 size)
+    {
+        FILE* image = fopen(imagePath, "wb");
+        if(NULL == image){
+            return false;
+        }
+        lray::u8 header[18] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            static_cast<lray::u8>(size), static_cast<lray::u8>(size>>8), static_cast<lray::u8>(size), static_cast<lray::u8>(size>>8), 24, 0x20};
+        fwrite(header, sizeof(header), 1, image);
+        std::vector<lray::u8> pixels(size*size*3, 0x80);
+        fwrite(&pixels[0], pixels.size(), 1, image);
+        fclose(image);
+
+        FILE* gltf = fopen(gltfPath, "wb");
+        if(NULL == gltf){
+            return false;
+        }
+        fprintf(gltf, "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[]}],\"images\":[{\"uri\":\"%s\"}]}", imagePath);
+        fclose(gltf);
+        return true;
+    }
+
+    //Rays straight down onto the grid, half of them miss
+    lray::s32 countHits(lray::Scene& scene, lray::s32 numRays)
+    {
+        lray::RandXorshift128Plus32 random(1);
+        lray::s32 hits = 0;
+        for(lray::s32 i=0; i<numRays; ++i){
+            lray::Vector3 origin(random.frand2()*2.0f, random.frand2(), 1.0f);
+            lray::Ray ray(origin, lray::Vector3(0.0f, 0.0f, -1.0f), 1.0e30f);
+            lray::Intersection intersection;
+            if(lray::Result_Fail != scene.test(intersection, ray)){
+                ++hits;
+            }
+        }
+        return hits;
+    }
+
+    //Distances to hits of the same rays as countHits, negative for misses
+    std::vector<lray::f32> traceDistances(lray::Scene& scene, lray::s32 numRays)
+    {
+        lray::RandXorshift128Plus32 random(1);
+        std::vector<lray::f32> distances(numRays, -1.0f);
+        for(lray::s32 i=0; i<numRays; ++i){
+            lray::Vector3 origin(random.frand2()*2.0f, random.frand2(), 1.0f);
+            lray::Ray ray(origin, lray::Vector3(0.0f, 0.0f, -1.0f), 1.0e30f);
+            lray::Intersection intersection;
+            if(lray::Result_Fail != scene.test(intersection, ray)){
+                distances[i] = ray.t_;
+            }
+        }
+        return distances;
+    }
+
+    struct Stages
+    {
+        lray::s32 count_;
+        lray::LoadStage stages_[16];
+    };
+
+    void onStage(lray::LoadHandle&, lray::LoadStage stage, void* user)
+    {
+        Stages* stages = reinterpret_cast<Stages*>(user);
+        if(stages->count_<16){
+            stages->stages_[stages->count_++] = stage;
+        }
+    }
+
+    void cancelOnParse(lray::LoadHandle& handle, lray::LoadStage stage, void* user)
+    {
+        onStage(handle, stage, user);
+        if(lray::LoadStage_Parse == stage){
+            handle.cancel();
+        }
+    }
+}
+
+TEST_CASE("Test Scene", "[Scene]"){
+    static const lray::s32 Resolution = 64;
+    static const lray::s32 NumRays = 1024;
+    const char* GLTFPath = "lray_test_grid.gltf";
+    const char* BinPath = "lray_test_grid.bin";
+    REQUIRE(writeGrid(GLTFPath, BinPath, BinPath, Resolution));
+
+    lray::Scene expected;
+    lray::load(expected, GLTFPath);
+    expected.updateFrame();
+    lray::s32 expectedHits = countHits(expected, NumRays);
+    CHECK(0<expectedHits);
+    CHECK(expectedHits<NumRays);
+
+    SECTION("Async"){
+        lray::Scene scene;
+        Stages stages = {};
+        lray::LoadHandle::pointer_type handle = lray::loadAsync(scene, GLTFPath, lray::LoadFlag_None, onStage, &stages);
+        REQUIRE(handle->waitPreview());
+        //The preview and the full accelerator give the same hits
+        CHECK(expectedHits == countHits(scene, NumRays));
+        CHECK(lray::LoadStage_Done == handle->wait());
+        CHECK_FALSE(scene.isPreviewing());
+        CHECK(1.0f == handle->getProgress());
+        CHECK(expectedHits == countHits(scene, NumRays));
+
+        //Stages come in order
+        REQUIRE(6 == stages.count_);
+        for(lray::s32 i=0; i<stages.count_; ++i){
+            CHECK(static_cast<lray::LoadStage>(i) == stages.stages_[i]);
+        }
+    }
+
+    SECTION("WeldReorder"){
+        //Merging and sorting change only the layout of geometries
+        lray::Scene scene;
+        lray::load(scene, GLTFPath, lray::LoadFlag_Weld|lray::LoadFlag_Reorder);
+        scene.updateFrame();
+        CHECK(expectedHits == countHits(scene, NumRays));
+        CHECK(traceDistances(expected, NumRays) == traceDistances(scene, NumRays));
+    }
+
+    SECTION("Preview"){
+        lray::Scene scene;
+        lray::load(scene, GLTFPath);
+        scene.updatePreview();
+        CHECK(scene.isPreviewing());
+        CHECK(expectedHits == countHits(scene, NumRays));
+        scene.buildAccelerator();
+        CHECK_FALSE(scene.isPreviewing());
+        CHECK(expectedHits == countHits(scene, NumRays));
+        scene.releasePreview();
+        CHECK(expectedHits == countHits(scene, NumRays));
+    }
+
+    SECTION("Cancel"){
+        lray::Scene scene;
+        lray::LoadHandle::pointer_type handle = lray::loadAsync(scene, GLTFPath);
+        handle->cancel();
+        lray::LoadStage stage = handle->wait();
+        //It may have finished before cancelled
+        CHECK((lray::LoadStage_Cancelled == stage || lray::LoadStage_Done == stage));
+        if(!handle->isPreviewReady()){
+            CHECK(0 == countHits(scene, NumRays));
+        }
+    }
+
+    SECTION("CancelOnParse"){
+        //Cancelled before anything is decoded, the load never fails nor gets ready
+        lray::Scene scene;
+        Stages stages = {};
+        lray::LoadHandle::pointer_type handle = lray::loadAsync(scene, GLTFPath, lray::LoadFlag_None, cancelOnParse, &stages);
+        CHECK_FALSE(handle->waitPreview());
+        REQUIRE(lray::LoadStage_Cancelled == handle->wait());
+        CHECK_FALSE(handle->isPreviewReady());
+        REQUIRE(0<stages.count_);
+        CHECK(lray::LoadStage_Cancelled == stages.stages_[stages.count_-1]);
+        for(lray::s32 i=0; i<stages.count_; ++i){
+            CHECK(lray::LoadStage_Failed != stages.stages_[i]);
+        }
+        CHECK(0 == countHits(scene, NumRays));
+    }
+
+    SECTION("Reload"){
+        //The same counts of meshes, primitives and triangles, but other positions
+        const char* ShiftedPath = "lray_test_shifted.gltf";
+        const char* ShiftedBinPath = "lray_test_shifted.bin";
+        REQUIRE(writeGrid(ShiftedPath, ShiftedBinPath, ShiftedBinPath, Resolution, 1.0f));
+        lray::Scene shifted;
+        lray::load(shifted, ShiftedPath);
+        shifted.updateFrame();
+        lray::s32 shiftedHits = countHits(shifted, NumRays);
+
+        lray::Scene scene;
+        lray::load(scene, GLTFPath);
+        scene.updateFrame();
+        CHECK(expectedHits == countHits(scene, NumRays));
+        lray::load(scene, ShiftedPath);
+        scene.updateFrame();
+        CHECK(shiftedHits == countHits(scene, NumRays));
+        remove(ShiftedPath);
+        remove(ShiftedBinPath);
+    }
+
+    SECTION("StaleBuffer"){
+        //Only the external buffer changes, which must invalidate the page cache
+        const char* ShiftedPath = "lray_test_shifted.gltf";
+        const char* ShiftedBinPath = "lray_test_shifted.bin";
+        REQUIRE(writeGrid(ShiftedPath, ShiftedBinPath, ShiftedBinPath, Resolution, 1.0f));
+        lray::Scene shifted;
+        lray::load(shifted, ShiftedPath);
+        shifted.updateFrame();
+        lray::s32 shiftedHits = countHits(shifted, NumRays);
+        REQUIRE(shiftedHits != expectedHits);
+
+        lray::Scene scene;
+        lray::load(scene, GLTFPath, lray::LoadFlag_OutOfCore);
+        scene.updateFrame();
+        CHECK(expectedHits == countHits(scene, NumRays));
+
+        //Replace the buffer of the grid with shifted one, padded so that the size differs within the same second.
+        //The mapped buffer is replaced by renaming, not truncated.
+        const char* TempBinPath = "lray_test_temp.bin";
+        REQUIRE(writeGrid(ShiftedPath, TempBinPath, BinPath, Resolution, 1.0f));
+        FILE* bin = fopen(TempBinPath, "ab");
+        REQUIRE(NULL != bin);
+        lray::u32 padding = 0;
+        fwrite(&padding, sizeof(padding), 1, bin);
+        fclose(bin);
+        remove(BinPath);
+        REQUIRE(0 == rename(TempBinPath, BinPath));
+        lray::Scene reloaded;
+        lray::load(reloaded, GLTFPath, lray::LoadFlag_OutOfCore);
+        reloaded.updateFrame();
+        CHECK(shiftedHits == countHits(reloaded, NumRays));
+        remove(ShiftedPath);
+        remove(ShiftedBinPath);
+        std::string cachePath(GLTFPath);
+        remove((cachePath + ".lgc").c_str());
+    }
+
+    SECTION("CacheDirectory"){
+        const char* ImageGLTFPath = "lray_test_image.gltf";
+        const char* ImagePath = "lray_test_image.tga";
+        std::string cachePath(ImageGLTFPath);
+        cachePath += ".ltc";
+        REQUIRE(writeImage(ImageGLTFPath, ImagePath, 40));
+        remove(cachePath.c_str());
+
+        //Textures are kept in memory if the cache cannot be written
+        lray::setCacheDirectory("lray_test_missing_directory");
+        lray::Scene scene;
+        lray::load(scene, ImageGLTFPath);
+        lray::setCacheDirectory(NULL);
+        REQUIRE(1 == scene.getNumTextures());
+        REQUIRE(NULL != scene.getTileCache());
+        CHECK(40 == scene.getTexture(0).getWidth());
+        CHECK(0xFF808080U == scene.getTexture(0).fetch(*scene.getTileCache(), 0, 33, 39));
+        FILE* cache = fopen(cachePath.c_str(), "rb");
+        CHECK(NULL == cache);
+        if(NULL != cache){
+            fclose(cache);
+        }
+
+        //Next to the scene by default
+        lray::Scene cached;
+        lray::load(cached, ImageGLTFPath);
+        REQUIRE(1 == cached.getNumTextures());
+        CHECK(0xFF808080U == cached.getTexture(0).fetch(*cached.getTileCache(), 0, 33, 39));
+        cache = fopen(cachePath.c_str(), "rb");
+        CHECK(NULL != cache);
+        if(NULL != cache){
+            fclose(cache);
+        }
+        remove(cachePath.c_str());
+        remove(ImageGLTFPath);
+        remove(ImagePath);
+    }
+
+    SECTION("Failed"){
+        lray::Scene scene;
+        lray::LoadHandle::pointer_type handle = lray::loadAsync(scene, "lray_test_missing.gltf");
+        CHECK_FALSE(handle->waitPreview());
+        CHECK(lray::LoadStage_Failed == handle->wait());
+    }
+    remove(GLTFPath);
+    remove(BinPath);
+}
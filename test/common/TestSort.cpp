@@ -0,0 +1,81 @@
+#include "catch.hpp"
+#include "core/Sort.h"
+#include "core/Random.h"
+
+namespace
+{
+    void createKeys(int size, lray::f32* keys, lray::s32* values)
+    {
+        lray::RandXorshift128Plus32 random(1);
+        for(int i=0; i<size; ++i){
+            //Negatives, duplicates and zeros of both signs
+            keys[i] = static_cast<lray::f32>(static_cast<lray::s32>(random.rand() & 1023) - 512) * 0.25f;
+            if(0 == (i%97)){
+                keys[i] = -0.0f;
+            }
+            values[i] = i;
+        }
+    }
+}
+
+TEST_CASE("Test Sort", "[Sort]"){
+    static const int Size = 200000;
+
+    SECTION("parallelRadixsort"){
+        lray::f32* keys = LNEW lray::f32[Size*2];
+        lray::s32* values = LNEW lray::s32[Size*2];
+        createKeys(Size, keys, values);
+        lray::f32* original = LNEW lray::f32[Size];
+        memcpy(original, keys, sizeof(lray::f32)*Size);
+        lray::parallelRadixsort(Size, keys, values, keys+Size, values+Size);
+
+        //Sorted, stable, and keys are restored
+        bool sorted = true;
+        bool stable = true;
+        bool restored = true;
+        for(int i=1; i<Size; ++i){
+            sorted = sorted && (keys[i-1]<=keys[i]);
+            stable = stable && (keys[i-1]<keys[i] || values[i-1]<values[i] || (0.0f == keys[i] && 0.0f == keys[i-1]));
+        }
+        for(int i=0; i<Size; ++i){
+            restored = restored && (original[values[i]] == keys[i]);
+        }
+        CHECK(sorted);
+        CHECK(stable);
+        CHECK(restored);
+
+        //Upper digits of all keys are the same, passes are skipped
+        lray::u32* codes = LNEW lray::u32[Size*2];
+        for(int i=0; i<Size; ++i){
+            codes[i] = static_cast<lray::u32>((Size-i) & 0xFFFFU);
+            values[i] = i;
+        }
+        lray::parallelRadixsort(Size, codes, values, codes+Size, values+Size);
+        sorted = true;
+        for(int i=1; i<Size; ++i){
+            sorted = sorted && (codes[i-1]<codes[i] || (codes[i-1] == codes[i] && values[i-1]<values[i]));
+        }
+        CHECK(sorted);
+        LDELETE_ARRAY(codes);
+        LDELETE_ARRAY(original);
+        LDELETE_ARRAY(values);
+        LDELETE_ARRAY(keys);
+    }
+}
+
+TEST_CASE("Benchmark Sort", "[.][benchmark]"){
+    static const int Size = 1<<22;
+    lray::f32* keys = LNEW lray::f32[Size*2];
+    lray::s32* values = LNEW lray::s32[Size*2];
+
+    createKeys(Size, keys, values);
+    BENCHMARK("introsort"){
+        lray::introsort(Size, keys);
+    }
+    createKeys(Size, keys, values);
+    BENCHMARK("parallelRadixsort"){
+        lray::parallelRadixsort(Size, keys, values, keys+Size, values+Size);
+    }
+    LDELETE_ARRAY(values);
+    LDELETE_ARRAY(keys);
+}
@@ -0,0 +1,93 @@
+#include "catch.hpp"
+#include "texture/TileCache.h"
+#include "core/Random.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    //Every texel is its index in the file
+    bool writeTiles(const char* path, lray::s32 numTiles)
+    {
+        FILE* file = fopen(path, "wb");
+        if(NULL == file){
+            return false;
+        }
+        std::vector<lray::u32> tile(lray::TileCache::TileTexels);
+        for(lray::s32 i=0; i<numTiles; ++i){
+            for(lray::s32 j=0; j<lray::TileCache::TileTexels; ++j){
+                tile[j] = static_cast<lray::u32>(i*lray::TileCache::TileTexels + j);
+            }
+            fwrite(&tile[0], lray::TileCache::TileBytes, 1, file);
+        }
+        fclose(file);
+        return true;
+    }
+}
+
+TEST_CASE("Test TileCache", "[TileCache]"){
+    static const lray::s32 NumTiles = 1024;
+    const char* Path = "lray_test_tiles.bin";
+    REQUIRE(writeTiles(Path, NumTiles));
+
+    {
+        //The smallest budget, tiles are evicted
+        lray::TileCache cache(0);
+        lray::s32 file = cache.addFile(Path);
+        REQUIRE(0<=file);
+
+        SECTION("Fetch"){
+            CHECK(5 == cache.getTexel(file, 0, 5));
+            CHECK(static_cast<lray::u32>(3*lray::TileCache::TileTexels+7) == cache.getTexel(file, 3*lray::TileCache::TileBytes, 7));
+            CHECK(5 == cache.getTexel(file, 0, 5));
+            CHECK(1 == cache.getNumHits());
+            CHECK(2 == cache.getNumMisses());
+            //Out of the file
+            CHECK(0 == cache.getTexel(file, static_cast<lray::s64>(NumTiles)*lray::TileCache::TileBytes, 1));
+        }
+
+        SECTION("Memory"){
+            //The same tiles from memory
+            lray::s64 size = static_cast<lray::s64>(NumTiles)*lray::TileCache::TileBytes;
+            lray::u8* data = LNEW lray::u8[size];
+            FILE* f = fopen(Path, "rb");
+            REQUIRE(NULL != f);
+            REQUIRE(1 == fread(data, size, 1, f));
+            fclose(f);
+            lray::s32 memory = cache.addMemory(data, size);
+            REQUIRE(file != memory);
+            CHECK(static_cast<lray::u32>(3*lray::TileCache::TileTexels+7) == cache.getTexel(memory, 3*lray::TileCache::TileBytes, 7));
+            CHECK(static_cast<lray::u32>((NumTiles-1)*lray::TileCache::TileTexels) == cache.getTexel(memory, static_cast<lray::s64>(NumTiles-1)*lray::TileCache::TileBytes, 0));
+            CHECK(0 == cache.getTexel(memory, size, 1));
+        }
+
+        SECTION("Threads"){
+            static const lray::s32 NumThreads = 8;
+            static const lray::s32 NumFetches = 1<<14;
+            std::atomic<lray::s32> numErrors(0);
+            std::vector<std::thread> threads;
+            for(lray::s32 i=0; i<NumThreads; ++i){
+                threads.push_back(std::thread([&, i]()
+                {
+                    lray::RandXorshift128Plus32 random(i+1);
+                    for(lray::s32 j=0; j<NumFetches; ++j){
+                        lray::s32 tile = static_cast<lray::s32>(random.rand() % NumTiles);
+                        lray::s32 texel = static_cast<lray::s32>(random.rand() % lray::TileCache::TileTexels);
+                        lray::u32 value = cache.getTexel(file, static_cast<lray::s64>(tile)*lray::TileCache::TileBytes, texel);
+                        if(value != static_cast<lray::u32>(tile*lray::TileCache::TileTexels + texel)){
+                            numErrors.fetch_add(1);
+                        }
+                    }
+                }));
+            }
+            for(size_t i=0; i<threads.size(); ++i){
+                threads[i].join();
+            }
+            CHECK(0 == numErrors.load());
+            CHECK(NumThreads*NumFetches == cache.getNumHits() + cache.getNumMisses());
+        }
+    }
+    remove(Path);
+}
@@ -0,0 +1,94 @@
+#include "catch.hpp"
+#include "core/Random.h"
+#include "shape/TriangleIndices.h"
+
+namespace
+{
+    template<class T>
+    void createIndices(int size, T* indices, int numVertices)
+    {
+        lray::RandXorshift64Star32 random(lray::getDefaultSeed());
+        for(int i=0; i<size; ++i){
+            indices[i] = static_cast<T>(lray::range_ropen(random, 0, numVertices));
+        }
+    }
+
+    template<class T>
+    bool checkExpand(lray::TriangleTopology topology, int numIndices)
+    {
+        T* indices = LNEW T[numIndices];
+        createIndices(numIndices, indices, 0xFFFF);
+
+        lray::s32 numTriangles = lray::getNumTriangles(topology, numIndices);
+        lray::Triangle* expected = LNEW lray::Triangle[numTriangles];
+        lray::Triangle* result = LNEW lray::Triangle[numTriangles];
+        lray::expandTrianglesStrided<T>(expected, topology, numIndices, sizeof(T), reinterpret_cast<const lray::u8*>(indices));
+        lray::expandTriangles(result, topology, numIndices, indices);
+        bool equal = 0 == memcmp(expected, result, sizeof(lray::Triangle)*numTriangles);
+
+        LDELETE_ARRAY(result);
+        LDELETE_ARRAY(expected);
+        LDELETE_ARRAY(indices);
+        return equal;
+    }
+}
+
+TEST_CASE("Test TriangleIndices", "[TriangleIndices]"){
+
+    static const lray::TriangleTopology Topologies[] = {lray::TriangleTopology_List, lray::TriangleTopology_Strip, lray::TriangleTopology_Fan};
+
+    SECTION("Packed equals strided"){
+        for(lray::s32 t=0; t<3; ++t){
+            //Sizes around the vector widths to exercise tails
+            for(int numIndices=0; numIndices<40; ++numIndices){
+                REQUIRE(checkExpand<lray::u16>(Topologies[t], numIndices));
+                REQUIRE(checkExpand<lray::u32>(Topologies[t], numIndices));
+            }
+            REQUIRE(checkExpand<lray::u16>(Topologies[t], 10007));
+            REQUIRE(checkExpand<lray::u32>(Topologies[t], 10007));
+        }
+    }
+}
+
+TEST_CASE("Benchmark TriangleIndices", "[.][benchmark]"){
+
+    static const int NumIndices = 3*1024*1024;
+    lray::u16* indices16 = LNEW lray::u16[NumIndices];
+    lray::u32* indices32 = LNEW lray::u32[NumIndices];
+    createIndices(NumIndices, indices16, 0xFFFF);
+    for(int i=0; i<NumIndices; ++i){
+        indices32[i] = indices16[i];
+    }
+    lray::Triangle* triangles = LNEW lray::Triangle[NumIndices];
+    const lray::u8* data16 = reinterpret_cast<const lray::u8*>(indices16);
+    const lray::u8* data32 = reinterpret_cast<const lray::u8*>(indices32);
+
+    BENCHMARK("u16 list strided"){
+        lray::expandTrianglesStrided<lray::u16>(triangles, lray::TriangleTopology_List, NumIndices, sizeof(lray::u16), data16);
+    }
+    BENCHMARK("u16 list packed"){
+        lray::expandTriangles(triangles, lray::TriangleTopology_List, NumIndices, indices16);
+    }
+    BENCHMARK("u32 list strided"){
+        lray::expandTrianglesStrided<lray::u32>(triangles, lray::TriangleTopology_List, NumIndices, sizeof(lray::u32), data32);
+    }
+    BENCHMARK("u32 list packed"){
+        lray::expandTriangles(triangles, lray::TriangleTopology_List, NumIndices, indices32);
+    }
+    BENCHMARK("u16 strip strided"){
+        lray::expandTrianglesStrided<lray::u16>(triangles, lray::TriangleTopology_Strip, NumIndices, sizeof(lray::u16), data16);
+    }
+    BENCHMARK("u16 strip packed"){
+        lray::expandTriangles(triangles, lray::TriangleTopology_Strip, NumIndices, indices16);
+    }
+    BENCHMARK("u16 fan strided"){
+        lray::expandTrianglesStrided<lray::u16>(triangles, lray::TriangleTopology_Fan, NumIndices, sizeof(lray::u16), data16);
+    }
+    BENCHMARK("u16 fan packed"){
+        lray::expandTriangles(triangles, lray::TriangleTopology_Fan, NumIndices, indices16);
+    }
+
+    LDELETE_ARRAY(triangles);
+    LDELETE_ARRAY(indices32);
+    LDELETE_ARRAY(indices16);
+}
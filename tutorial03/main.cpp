@@ -3,6 +3,7 @@
 #include "lray.h"
 #include "Camera.h"
 #include "scene/Scene.h"
+#include "render/PathTracer.h"
 
 using namespace lray;
 
@@ -22,33 +23,21 @@ int main(int , char** )
     Scene scene;
     load(scene, "../../data/hatsune_miku_chibi_w_stand/scene.gltf");
 
-    //Set light environment
-    Vector3 lightDirection = normalize(Vector3(0.5f, 0.5f, 0.0f));
-
-    //
     scene.updateFrame();
 
-    //Loop over pixels
+    //Refine pass by pass within a time budget, or until every tile has converged
+    static const f64 TimeBudget = 10.0;
+    PathTracer tracer;
+    tracer.initialize(Width, Height);
+    tracer.setLight(Vector3(0.5f, 0.5f, 0.0f), Vector3(2.0f));
+    tracer.setAdaptive(0.02f);
     ClockType startTime = getPerformanceCounter();
-    for(s32 y=0; y<Height; ++y){
-        for(s32 x=0; x<Width; ++x){
-            Intersection intersection;
-            Ray ray = camera.generateRay(static_cast<f32>(x), static_cast<f32>(y));
-            u8 r,g,b;
-            Result result = scene.test(intersection, ray);
-            if(Result_Success & result){
-                f32 d = maximum(dot(intersection.shadingNormal_, lightDirection), 0.0f);
-                r = g = b = static_cast<u8>(minimum(clamp01(d)*256, 255.0f));
-            }else{
-                r = g = b = 128;
-            }
-            s32 pixel = (y*Width + x)*Bpp;
-            image[pixel+0] = r;
-            image[pixel+1] = g;
-            image[pixel+2] = b;
-        }
-    }
-    f64 elapsedTime = calcTime64(startTime, getPerformanceCounter());
+    f64 elapsedTime = 0.0;
+    do{
+        tracer.renderPass(scene, camera);
+        elapsedTime = calcTime64(startTime, getPerformanceCounter());
+    }while(elapsedTime<TimeBudget && 0<tracer.getNumActiveTiles());
+    tracer.resolve(image);
 
     //Output
     cppimg::OFStream file;
@@ -58,6 +47,6 @@ int main(int , char** )
     }
     delete[] image;
 
-    printf("Render time %lf sec\n", elapsedTime);
+    printf("Render time %lf sec, %d passes\n", elapsedTime, tracer.getNumPasses());
     return 0;
 }